@@ -0,0 +1,288 @@
+#include "alias.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+
+static const struct alias_base none = {ALIAS_BASE_NONE, 0};
+static const struct alias_base unknown = {ALIAS_BASE_UNKNOWN, 0};
+
+static bool same_site(struct alias_base a, struct alias_base b) {
+    return a.kind == b.kind && a.index == b.index;
+}
+
+static bool same_base(struct alias_base a, struct alias_base b) {
+    return same_site(a, b) && a.offset == b.offset;
+}
+
+// a pointer that may come from either of two sites, only stays known if they are the same one
+static struct alias_base meet(struct alias_base a, struct alias_base b) {
+    if (a.kind == ALIAS_BASE_NONE) {
+        return b;
+    }
+    if (b.kind == ALIAS_BASE_NONE || same_base(a, b)) {
+        return a;
+    }
+    if (same_site(a, b)) {
+        a.offset = ALIAS_OFFSET_UNKNOWN;
+        return a;
+    }
+    return unknown;
+}
+
+// how many bytes are read or written through a pointer operand
+static uint64_t access_size(struct operand pointer) {
+    struct ast_node* type = pointer.typename.type;
+    if (type != NULL && (type->type == AST_NODE_TYPE_POINTER || type->type == AST_NODE_TYPE_REFERENCE)) {
+        return ast_node_symbol_size(pointer.typename.module, type->children[0]);
+    }
+    return pointer.typename.size;
+}
+
+static bool is_pointer(struct ssa_type type) {
+    return type.type != NULL &&
+           (type.type->type == AST_NODE_TYPE_POINTER || type.type->type == AST_NODE_TYPE_REFERENCE);
+}
+
+struct alias_base alias_base(struct alias_analysis* analysis, struct operand pointer) {
+    switch (pointer.type) {
+        case OPERAND_TYPE_REGISTER:
+            if (pointer.value.integer < analysis->register_count) {
+                return analysis->bases[pointer.value.integer];
+            }
+            return unknown;
+        case OPERAND_TYPE_INTEGER:
+            // null, dereferencing it traps before it could alias anything
+            return pointer.value.integer == 0 ? none : unknown;
+        default:
+            return unknown;
+    }
+}
+
+static bool private_site(struct alias_analysis* analysis, struct alias_base base) {
+    return (base.kind == ALIAS_BASE_LOCAL || base.kind == ALIAS_BASE_HEAP) && !analysis->escaped[base.index];
+}
+
+// the local a pointer refers to if its contents are followed, UINT32_MAX if it isn't one
+static uint32_t followed_local(struct alias_analysis* analysis, struct operand pointer) {
+    struct alias_base base = alias_base(analysis, pointer);
+    if (base.kind != ALIAS_BASE_LOCAL || analysis->escaped[base.index]) {
+        return UINT32_MAX;
+    }
+    return base.index;
+}
+
+static bool update(struct alias_base* target, struct alias_base value) {
+    struct alias_base next = meet(*target, value);
+    if (same_base(next, *target)) {
+        return false;
+    }
+    *target = next;
+    return true;
+}
+
+// traces every register back to where it points until nothing changes, the bases only ever get less precise
+static void trace_bases(struct alias_analysis* analysis) {
+    struct unit* unit = analysis->unit;
+    for (uint32_t i = 0; i < analysis->register_count; i++) {
+        analysis->bases[i] = none;
+        analysis->contents[i] = none;
+    }
+    for (uint32_t i = 0; i < unit->argument_count; i++) {
+        struct operand argument = unit->arguments[i];
+        if (argument.type == OPERAND_TYPE_REGISTER && argument.value.integer < analysis->register_count) {
+            analysis->bases[argument.value.integer] = (struct alias_base){ALIAS_BASE_ARGUMENT, argument.value.integer};
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 0; i < unit->block_count; i++) {
+            struct block* block = unit->blocks[i];
+            for (uint32_t j = 0; j < block->instructions_count; j++) {
+                struct ssa_instruction* instruction = &block->instructions[j];
+                struct alias_base base = unknown;
+                switch (instruction->operator) {
+                    case OP_ALLOC:
+                        base = (struct alias_base){ALIAS_BASE_LOCAL, instruction->result.value.integer};
+                        break;
+                    case OP_HEAP_ALLOC:
+                        base = (struct alias_base){ALIAS_BASE_HEAP, instruction->result.value.integer};
+                        break;
+                    case OP_CAST:
+                    case OP_NULL_CHECK:
+                        if (is_pointer(instruction->result.typename)) {
+                            base = alias_base(analysis, instruction->operands[0]);
+                        }
+                        break;
+                    case OP_FIELD: {
+                        base = alias_base(analysis, instruction->operands[0]);
+                        struct operand offset = instruction->operands[1];
+                        if (base.kind == ALIAS_BASE_NONE || base.kind == ALIAS_BASE_UNKNOWN ||
+                            base.offset == ALIAS_OFFSET_UNKNOWN) {
+                            break;
+                        }
+                        bool known = offset.type == OPERAND_TYPE_INTEGER &&
+                                     offset.value.integer < ALIAS_OFFSET_UNKNOWN - base.offset;
+                        base.offset = known ? base.offset + (uint32_t) offset.value.integer : ALIAS_OFFSET_UNKNOWN;
+                        break;
+                    }
+                    case OP_LOAD: {
+                        uint32_t local = followed_local(analysis, instruction->operands[0]);
+                        if (local != UINT32_MAX) {
+                            base = analysis->contents[local];
+                        }
+                        break;
+                    }
+                    case OP_STORE: {
+                        uint32_t local = followed_local(analysis, instruction->operands[0]);
+                        if (local != UINT32_MAX) {
+                            changed |= update(&analysis->contents[local], alias_base(analysis, instruction->operands[1]));
+                        }
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                if (instruction->result.type == OPERAND_TYPE_REGISTER &&
+                    instruction->result.value.integer < analysis->register_count) {
+                    changed |= update(&analysis->bases[instruction->result.value.integer], base);
+                }
+            }
+        }
+    }
+}
+
+static void escape(struct alias_analysis* analysis, struct operand operand, bool* changed) {
+    struct alias_base base = alias_base(analysis, operand);
+    if (operand.type == OPERAND_TYPE_REGISTER && private_site(analysis, base)) {
+        analysis->escaped[base.index] = true;
+        *changed = true;
+    }
+}
+
+// marks the allocations whose address reaches something the bases don't follow. a pointer stored in a followed local
+// is still followed, unless the local may hold pointers to more than one place
+static bool find_escapes(struct alias_analysis* analysis) {
+    struct unit* unit = analysis->unit;
+    bool changed = false;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            switch (instruction->operator) {
+                case OP_LOAD:
+                case OP_CAST:
+                case OP_NULL_CHECK:
+                case OP_EQUAL:
+                case OP_NOT_EQUAL:
+                case OP_HEAP_FREE:
+                case OP_FIELD:
+                    continue;
+                case OP_STORE: {
+                    struct operand value = instruction->operands[1];
+                    uint32_t local = followed_local(analysis, instruction->operands[0]);
+                    if (local == UINT32_MAX || !same_base(analysis->contents[local], alias_base(analysis, value))) {
+                        escape(analysis, value, &changed);
+                    }
+                    continue;
+                }
+                default:
+                    for (int k = 0; k < MAX_OPERANDS; k++) {
+                        escape(analysis, instruction->operands[k], &changed);
+                    }
+                    continue;
+            }
+        }
+    }
+    return changed;
+}
+
+struct alias_analysis* alias_analysis_new(struct unit* unit) {
+    struct alias_analysis* analysis = malloc(sizeof(struct alias_analysis));
+    assert(analysis);
+    analysis->unit = unit;
+    analysis->register_count = unit_register_count(unit);
+    uint32_t count = analysis->register_count > 0 ? analysis->register_count : 1;
+    analysis->bases = malloc(sizeof(struct alias_base) * count);
+    analysis->contents = malloc(sizeof(struct alias_base) * count);
+    analysis->escaped = calloc(count, sizeof(bool));
+    assert(analysis->bases && analysis->contents && analysis->escaped);
+
+    // every allocation starts out private, each escape found can only make more pointers unknown and so more
+    // allocations escape, until none does
+    do {
+        trace_bases(analysis);
+    } while (find_escapes(analysis));
+    return analysis;
+}
+
+void alias_analysis_free(struct alias_analysis* analysis) {
+    free(analysis->bases);
+    free(analysis->contents);
+    free(analysis->escaped);
+    free(analysis);
+}
+
+enum alias_result alias_compare(struct alias_analysis* analysis, struct alias_base a, struct alias_base b) {
+    if (a.kind == ALIAS_BASE_NONE || b.kind == ALIAS_BASE_NONE) {
+        return ALIAS_NONE;
+    }
+    if (a.kind == ALIAS_BASE_UNKNOWN || b.kind == ALIAS_BASE_UNKNOWN) {
+        struct alias_base known = a.kind == ALIAS_BASE_UNKNOWN ? b : a;
+        return private_site(analysis, known) ? ALIAS_NONE : ALIAS_MAY;
+    }
+    // the only pointer arithmetic is taking the address of a field, a pointer derived from a site points a known
+    // number of bytes into it unless the paths to it disagree
+    if (same_site(a, b)) {
+        return a.kind != ALIAS_BASE_HEAP && a.offset == b.offset && a.offset != ALIAS_OFFSET_UNKNOWN ? ALIAS_MUST
+                                                                                                      : ALIAS_MAY;
+    }
+    // a caller can pass the same address for two arguments, `T*` ones included, and `T*!(p)` gives that address any
+    // pointer type, so neither ownership nor the types pointed to keep two arguments apart
+    if (a.kind == ALIAS_BASE_ARGUMENT && b.kind == ALIAS_BASE_ARGUMENT) {
+        return ALIAS_MAY;
+    }
+    return ALIAS_NONE;
+}
+
+enum alias_result alias_query(struct alias_analysis* analysis, struct operand a, struct operand b) {
+    if (a.type == OPERAND_TYPE_REGISTER && b.type == OPERAND_TYPE_REGISTER && a.value.integer == b.value.integer) {
+        return ALIAS_MUST;
+    }
+    struct alias_base base_a = alias_base(analysis, a);
+    struct alias_base base_b = alias_base(analysis, b);
+    enum alias_result result = alias_compare(analysis, base_a, base_b);
+    if (result == ALIAS_MAY && same_site(base_a, base_b) && base_a.offset != ALIAS_OFFSET_UNKNOWN &&
+        base_b.offset != ALIAS_OFFSET_UNKNOWN && base_a.offset != base_b.offset) {
+        bool disjoint = base_a.offset < base_b.offset ? base_a.offset + access_size(a) <= base_b.offset
+                                                      : base_b.offset + access_size(b) <= base_a.offset;
+        return disjoint ? ALIAS_NONE : ALIAS_MAY;
+    }
+    return result;
+}
+
+bool alias_clobbers_base(struct alias_analysis* analysis, struct ssa_instruction* instruction, struct alias_base base) {
+    switch (instruction->operator) {
+        case OP_STORE:
+            return alias_compare(analysis, alias_base(analysis, instruction->operands[0]), base) != ALIAS_NONE;
+        case OP_CALL: {
+            struct unit* callee = instruction->operands[0].type == OPERAND_TYPE_IR ? instruction->operands[0].value.unit
+                                                                                   : NULL;
+            if (callee != NULL && callee->pure) {
+                return false;
+            }
+            return base.kind != ALIAS_BASE_NONE && !private_site(analysis, base);
+        }
+        default:
+            return false;
+    }
+}
+
+bool alias_clobbers(struct alias_analysis* analysis, struct ssa_instruction* instruction, struct operand pointer) {
+    return alias_clobbers_base(analysis, instruction, alias_base(analysis, pointer));
+}
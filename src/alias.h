@@ -0,0 +1,78 @@
+#ifndef COMPILER_ALIAS_H
+#define COMPILER_ALIAS_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "unit.h"
+
+enum alias_result {
+    // the pointers never refer to the same memory
+    ALIAS_NONE,
+    ALIAS_MAY,
+    // the pointers always refer to the same memory
+    ALIAS_MUST,
+};
+
+enum alias_base_kind {
+    // nothing is known yet, or the pointer is only ever null
+    ALIAS_BASE_NONE,
+    // points into one of the unit's own allocations, index is the register the alloc defines
+    ALIAS_BASE_LOCAL,
+    // points where an argument does, index is the argument's register
+    ALIAS_BASE_ARGUMENT,
+    // points into memory from the heap, index is the register the heap alloc defines. a heap alloc in a loop gives
+    // different memory every time it runs, so only the pointer it just gave refers to the same memory for sure
+    ALIAS_BASE_HEAP,
+    ALIAS_BASE_UNKNOWN,
+};
+
+// a pointer into a site whose offset depends on the path taken to it
+#define ALIAS_OFFSET_UNKNOWN UINT32_MAX
+
+// where a pointer points, the allocation site it was derived from and how many bytes into it
+struct alias_base {
+    enum alias_base_kind kind;
+    uint32_t index;
+    uint32_t offset;
+};
+
+// what the pointers of a unit may point to. pointers only come from allocations, arguments and memory, so every
+// register is traced back to the allocation site or argument it was derived from, following pointers through the
+// locals they are kept in as long as those locals' addresses don't escape
+struct alias_analysis {
+    struct unit* unit;
+    uint32_t register_count;
+
+    // one entry per register
+    struct alias_base* bases;
+    // for allocations, where the pointers stored in them point
+    struct alias_base* contents;
+    // for allocations and heap allocs, true if their address is used for anything the analysis can't follow, a call,
+    // a return or arithmetic, memory they're in can be written without the unit storing to them directly
+    bool* escaped;
+};
+
+struct alias_analysis* alias_analysis_new(struct unit* unit);
+
+void alias_analysis_free(struct alias_analysis* analysis);
+
+// the allocation site a pointer operand was derived from
+struct alias_base alias_base(struct alias_analysis* analysis, struct operand pointer);
+
+// whether two pointers refer to the same memory. allocations are distinct from each other and from anything the
+// caller passed in, two pointers the caller passed in may be the same whatever their types. an allocation whose
+// address doesn't escape is only reachable through pointers derived from it.
+// pointers to different fields of the same site don't overlap when what they point to doesn't
+enum alias_result alias_query(struct alias_analysis* analysis, struct operand a, struct operand b);
+
+// whether pointers derived from two sites refer to the same memory, pointers at different offsets into the same site
+// may or may not overlap depending on how much is read through them
+enum alias_result alias_compare(struct alias_analysis* analysis, struct alias_base a, struct alias_base b);
+
+// true if the instruction may write the memory a pointer refers to, only stores and calls to impure functions write
+bool alias_clobbers(struct alias_analysis* analysis, struct ssa_instruction* instruction, struct operand pointer);
+
+// true if the instruction may write memory pointers derived from a site refer to
+bool alias_clobbers_base(struct alias_analysis* analysis, struct ssa_instruction* instruction, struct alias_base base);
+
+#endif //COMPILER_ALIAS_H
@@ -4,6 +4,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "ast_layout.h"
+#include "ast_module.h"
+#include "type_layout.h"
+
+static bool is_symbol_reference(struct ast_node* node)
+{
+    return node->type == AST_NODE_TYPE_STRUCT || node->type == AST_NODE_TYPE_INTERFACE;
+}
 
 struct ast_node* ast_node_new(enum ast_node_type type, struct token token)
 {
@@ -27,7 +35,11 @@ void ast_node_free(struct ast_node* node)
     }
     for (size_t i = 0; i < node->children_count; i++)
     {
-        ast_node_free(node->children[i]);
+        // the symbols a type refers to belong to the symbol tree
+        if (node->children[i]->parent == node)
+        {
+            ast_node_free(node->children[i]);
+        }
     }
     free(node->children);
     free(node);
@@ -35,6 +47,13 @@ void ast_node_free(struct ast_node* node)
 
 struct ast_node* ast_node_clone(struct ast_node* node)
 {
+    // a struct or interface in a type is a reference to its symbol, copying the symbol would go on forever when one of
+    // its methods names it again
+    if (is_symbol_reference(node))
+    {
+        return node;
+    }
+
     struct ast_node* copy = ast_node_new(node->type, node->token);
 
     for (size_t i = 0; i < node->children_count; i++)
@@ -59,7 +78,11 @@ void ast_node_append_child(struct ast_node* node, struct ast_node* child)
         assert(node->children);
     }
     node->children[node->children_count++] = child;
-    child->parent = node;
+    // a type only refers to a symbol that already has its place in the symbol tree, it doesn't take it from there
+    if (!is_symbol_reference(child) || child->parent == NULL)
+    {
+        child->parent = node;
+    }
 }
 
 void ast_node_remove_child(struct ast_node* node, struct ast_node* child)
@@ -79,12 +102,6 @@ void ast_node_remove_child(struct ast_node* node, struct ast_node* child)
     }
 }
 
-struct array_header
-{
-    size_t length;
-    size_t capacity;
-};
-
 size_t to_power_of_two(size_t x)
 {
     if (x <= 1) return 1;
@@ -117,25 +134,22 @@ size_t ast_node_symbol_size(struct ast_module* module, struct ast_node* node)
 
         case AST_NODE_TYPE_VOID: return 0;
 
+        // a pointer to an interface is a fat pointer, the data it points to followed by the vtable of the data's struct
         case AST_NODE_TYPE_POINTER:
-        case AST_NODE_TYPE_REFERENCE: return sizeof(void*); //TODO: research if you can really just assume this
+        case AST_NODE_TYPE_REFERENCE:
+            return node->children_count == 1 && node->children[0]->type == AST_NODE_TYPE_INTERFACE
+                   ? 2 * sizeof(void*)
+                   : sizeof(void*); //TODO: research if you can really just assume this
+
+        // a method taken out of a vtable
+        case AST_NODE_TYPE_ABSTRACT: return sizeof(void*);
 
-        case AST_NODE_TYPE_ARRAY: return sizeof(void*) + sizeof(struct array_header);
+        case AST_NODE_TYPE_ARRAY: return sizeof(void*);
 
         case AST_NODE_TYPE_SIMD: return ast_node_symbol_size(module, node->children[0]) * to_power_of_two(strtol(
                 node->children[1]->token.start, NULL, 10));
-        case AST_NODE_TYPE_STRUCT: {
-            size_t total = 0;
-            for (size_t i = 0; i < node->children_count; i++) {
-                struct ast_node* child = node->children[i];
-                if (child->type == AST_NODE_TYPE_FIELD) {
-                    struct ast_node* type = child->children[1];
-                    total += ast_node_symbol_size(module, type);
-                }
-            }
-            return total;
-        }
-            
+        case AST_NODE_TYPE_STRUCT: return type_layout_of(module, node)->size;
+
         default:
             fprintf(stderr, "expected a built-in type node\n");
             return 0;
@@ -156,4 +170,159 @@ struct ast_node* ast_node_symbol_sub(struct ast_node* parent_symbol, struct toke
         }
     }
     return NULL;
-}
\ No newline at end of file
+}
+size_t ast_node_symbol_alignment(struct ast_module* module, struct ast_node* node)
+{
+    switch (node->type)
+    {
+        case AST_NODE_TYPE_POINTER:
+        case AST_NODE_TYPE_REFERENCE:
+        case AST_NODE_TYPE_ARRAY: return sizeof(void*);
+        case AST_NODE_TYPE_STRUCT: {
+            // a struct that contains itself has no alignment yet
+            size_t alignment = type_layout_of(module, node)->alignment;
+            return alignment > 0 ? alignment : 1;
+        }
+        default: {
+            // scalars and vectors are aligned to their size
+            size_t size = ast_node_symbol_size(module, node);
+            return size > 0 ? size : 1;
+        }
+    }
+}
+
+struct ast_node* ast_node_struct_field(struct ast_module* module, struct ast_node* structure, struct token name,
+                                       size_t* offset) {
+    const struct type_layout* layout = type_layout_of(module, structure);
+    for (size_t i = 0; i < layout->field_count; i++) {
+        struct ast_node* field = layout->fields[i];
+        struct token symbol = field->children[0]->token;
+        if (symbol.length == name.length && memcmp(symbol.start, name.start, name.length) == 0) {
+            *offset = layout->offsets[i];
+            return field;
+        }
+    }
+    return NULL;
+}
+
+static bool is_named(struct ast_node* symbol, struct token name) {
+    struct token symbol_name = symbol->children[0]->token;
+    return symbol_name.length == name.length && memcmp(symbol_name.start, name.start, name.length) == 0;
+}
+
+struct ast_node* ast_node_struct_method(struct ast_node* structure, struct token name) {
+    struct ast_node* members = structure->children[STRUCT_LAYOUT_MEMBERS];
+    for (size_t i = 0; i < members->children_count; i++) {
+        if (members->children[i]->type == AST_NODE_TYPE_METHOD && is_named(members->children[i], name)) {
+            return members->children[i];
+        }
+    }
+    struct ast_node* statics = structure->children[STRUCT_LAYOUT_STATICS];
+    for (size_t i = 0; i < statics->children_count; i++) {
+        if (statics->children[i]->type == AST_NODE_TYPE_FUNCTION && is_named(statics->children[i], name)) {
+            return statics->children[i];
+        }
+    }
+    return NULL;
+}
+
+struct ast_node* ast_node_interface_method(struct ast_node* interface, struct token name, size_t* slot) {
+    struct ast_node* abstracts = interface->children[INTERFACE_LAYOUT_ABSTRACTS];
+    for (size_t i = 0; i < abstracts->children_count; i++) {
+        if (is_named(abstracts->children[i], name)) {
+            *slot = i;
+            return abstracts->children[i];
+        }
+    }
+    return NULL;
+}
+
+bool ast_node_same_symbol(struct ast_node* a, struct ast_node* b) {
+    return a == b || (a->type == b->type && is_named(a, b->children[0]->token));
+}
+
+bool ast_node_is_generic(struct ast_node* structure) {
+    return structure->children[STRUCT_LAYOUT_GENERICS]->children_count > 0;
+}
+
+bool ast_node_implements(struct ast_node* structure, struct ast_node* interface) {
+    struct ast_node* implements = structure->children[STRUCT_LAYOUT_IMPLEMENTS];
+    for (size_t i = 0; i < implements->children_count; i++) {
+        if (ast_node_same_symbol(implements->children[i], interface)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void mangle_text(char* text, size_t size, size_t* length, const char* part, size_t part_length) {
+    for (size_t i = 0; i < part_length; i++, (*length)++) {
+        if (*length + 1 < size) {
+            text[*length] = part[i];
+        }
+    }
+}
+
+static void mangle(struct ast_node* type, char* text, size_t size, size_t* length) {
+    switch (type->type) {
+        case AST_NODE_TYPE_STRUCT:
+        case AST_NODE_TYPE_INTERFACE:
+            mangle_text(text, size, length, type->children[0]->token.start, type->children[0]->token.length);
+            break;
+        case AST_NODE_TYPE_GENERIC:
+            mangle_text(text, size, length, type->token.start, type->token.length);
+            break;
+        case AST_NODE_TYPE_REFERENCE:
+            mangle(type->children[0], text, size, length);
+            mangle_text(text, size, length, "*", 1);
+            break;
+        case AST_NODE_TYPE_POINTER:
+            mangle(type->children[0], text, size, length);
+            mangle_text(text, size, length, "*?", 2);
+            break;
+        case AST_NODE_TYPE_ARRAY:
+            mangle(type->children[0], text, size, length);
+            mangle_text(text, size, length, type->children_count > 1 ? "[soa]" : "[]", type->children_count > 1 ? 5 : 2);
+            break;
+        case AST_NODE_TYPE_SIMD:
+            mangle(type->children[0], text, size, length);
+            mangle_text(text, size, length, "<", 1);
+            mangle_text(text, size, length, type->children[1]->token.start, type->children[1]->token.length);
+            mangle_text(text, size, length, ">", 1);
+            break;
+        default: {
+            const char* name = ast_node_get_name(type);
+            mangle_text(text, size, length, name, strlen(name));
+            break;
+        }
+    }
+}
+
+size_t ast_node_mangle(struct ast_node* type, char* text, size_t size) {
+    size_t length = 0;
+    mangle(type, text, size, &length);
+    if (size != 0) {
+        text[length < size ? length : size - 1] = '\0';
+    }
+    return length;
+}
+
+char* ast_node_mangle_parameters(struct ast_node** types, size_t count) {
+    size_t length = 2;
+    for (size_t i = 0; i < count; i++) {
+        length += ast_node_mangle(types[i], NULL, 0) + (i > 0);
+    }
+    char* text = malloc(length + 1);
+    assert(text);
+    size_t at = 0;
+    text[at++] = '(';
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            text[at++] = ',';
+        }
+        at += ast_node_mangle(types[i], text + at, length + 1 - at);
+    }
+    text[at++] = ')';
+    text[at] = '\0';
+    return text;
+}
@@ -47,6 +47,7 @@ enum ast_node_type
     AST_NODE_TYPE_MODULE_NAME,
     AST_NODE_TYPE_NAME,
     AST_NODE_TYPE_TYPE,
+    AST_NODE_TYPE_GENERIC, // a type parameter, stands in for the type a generic is instantiated with
 
     //declarations OR implementations, depending on context
     AST_NODE_TYPE_VARIABLE, // static
@@ -65,6 +66,8 @@ enum ast_node_type
     AST_NODE_TYPE_NEGATE,
     AST_NODE_TYPE_ADDRESS,
     AST_NODE_TYPE_LOCK,
+    AST_NODE_TYPE_MOVE, // gives the value of a variable away, it isn't destroyed
+    AST_NODE_TYPE_COPY, // a copy of a variable's value, even where it could be moved
     AST_NODE_TYPE_NOT,
     AST_NODE_TYPE_ADD,
     AST_NODE_TYPE_SUBTRACT,
@@ -83,6 +86,7 @@ enum ast_node_type
 
     AST_NODE_TYPE_GET_FIELD,
     AST_NODE_TYPE_SET_FIELD,
+    AST_NODE_TYPE_INDEX,
 
     AST_NODE_TYPE_EQUAL,
     AST_NODE_TYPE_NOT_EQUAL,
@@ -101,6 +105,7 @@ enum ast_node_type
     AST_NODE_TYPE_IF,
     AST_NODE_TYPE_WHILE,
     AST_NODE_TYPE_DO_WHILE,
+    AST_NODE_TYPE_REGION, // the definitions it starts with, then its body
 };
 
 struct ast_node
@@ -113,6 +118,13 @@ struct ast_node
     size_t children_capacity;
 };
 
+// what an array points at, its elements come right after it
+struct array_header
+{
+    size_t length;
+    size_t capacity;
+};
+
 struct ast_node* ast_node_new(enum ast_node_type type, struct token token);
 
 void ast_node_free(struct ast_node* node);
@@ -127,6 +139,36 @@ const char* ast_node_get_name(struct ast_node* node);
 
 size_t ast_node_symbol_size(struct ast_module* module, struct ast_node* node);
 
+// the alignment values of the type need in memory, in bytes
+size_t ast_node_symbol_alignment(struct ast_module* module, struct ast_node* node);
+
 struct ast_node* ast_node_symbol_sub(struct ast_node* parent_symbol, struct token name);
 
+// the field of a struct called name and its offset in bytes from the start of the struct, NULL if there is none
+struct ast_node* ast_node_struct_field(struct ast_module* module, struct ast_node* structure, struct token name,
+                                       size_t* offset);
+
+// the method of a struct called name, static ones included, NULL if there is none
+struct ast_node* ast_node_struct_method(struct ast_node* structure, struct token name);
+
+// the abstract method of an interface called name and its slot in the interface's vtables, NULL if there is none
+struct ast_node* ast_node_interface_method(struct ast_node* interface, struct token name, size_t* slot);
+
+// true if two struct or interface nodes stand for the same declaration. types are cloned along with the struct or
+// interface they name, so the nodes themselves may differ
+bool ast_node_same_symbol(struct ast_node* a, struct ast_node* b);
+
+// true if the struct declares it implements the interface
+bool ast_node_implements(struct ast_node* structure, struct ast_node* interface);
+
+// true if the struct has type parameters, only its instances are laid out and lowered
+bool ast_node_is_generic(struct ast_node* structure);
+
+// the type as it is written, "i32*" or "Pair<i32,f64>". writes as much of it as fits in size bytes to text, ending it
+// with a '\0' unless size is 0, and returns its whole length like snprintf
+size_t ast_node_mangle(struct ast_node* type, char* text, size_t size);
+
+// the types of a function's parameters as they are written, "(i32,f64*)". has to be freed
+char* ast_node_mangle_parameters(struct ast_node** types, size_t count);
+
 #endif //COMPILER_AST_H
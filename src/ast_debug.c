@@ -30,6 +30,7 @@ static const char* ast_node_type_names[] = {
     [AST_NODE_TYPE_MODULE_NAME] = "module-name",
     [AST_NODE_TYPE_NAME] = "name",
     [AST_NODE_TYPE_TYPE] = "type",
+    [AST_NODE_TYPE_GENERIC] = "generic",
     [AST_NODE_TYPE_FIELD] = "field",
     [AST_NODE_TYPE_VARIABLE] = "variable",
     [AST_NODE_TYPE_METHOD] = "method",
@@ -43,6 +44,8 @@ static const char* ast_node_type_names[] = {
     [AST_NODE_TYPE_NEGATE] = "negate",
     [AST_NODE_TYPE_ADDRESS] = "address",
     [AST_NODE_TYPE_LOCK] = "lock",
+    [AST_NODE_TYPE_MOVE] = "move",
+    [AST_NODE_TYPE_COPY] = "copy",
     [AST_NODE_TYPE_NOT] = "not",
     [AST_NODE_TYPE_ADD] = "add",
     [AST_NODE_TYPE_SUBTRACT] = "sub",
@@ -59,6 +62,7 @@ static const char* ast_node_type_names[] = {
     [AST_NODE_TYPE_CALL] = "call",
     [AST_NODE_TYPE_GET_FIELD] = "get",
     [AST_NODE_TYPE_SET_FIELD] = "set",
+    [AST_NODE_TYPE_INDEX] = "index",
     [AST_NODE_TYPE_EQUAL] = "equal",
     [AST_NODE_TYPE_NOT_EQUAL] = "not-equal",
     [AST_NODE_TYPE_GREATER_THAN] = "greater-than",
@@ -72,6 +76,7 @@ static const char* ast_node_type_names[] = {
     [AST_NODE_TYPE_IF] = "if",
     [AST_NODE_TYPE_WHILE] = "while",
     [AST_NODE_TYPE_DO_WHILE] = "do-while",
+    [AST_NODE_TYPE_REGION] = "region",
 };
 
 const char* ast_node_get_name(struct ast_node* node) {
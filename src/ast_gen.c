@@ -1,5 +1,8 @@
 #include "ast_gen.h"
 
+#include <assert.h>
+#include <stdlib.h>
+
 #include "dependency_graph_gen.h"
 #include "module_gen.h"
 #include "parser.h"
@@ -69,6 +72,8 @@ static struct ast_node* call(struct parser* parser, struct ast_node* left, bool
 
 static struct ast_node* field(struct parser* parser, struct ast_node* left, bool canAssign);
 
+static struct ast_node* subscript(struct parser* parser, struct ast_node* left, bool canAssign);
+
 struct parse_rule rules[] = {
     [TOKEN_TYPE_ERROR] = {NULL, NULL, PRECEDENCE_NONE},
     [TOKEN_TYPE_EOF] = {NULL, NULL, PRECEDENCE_NONE},
@@ -76,7 +81,7 @@ struct parse_rule rules[] = {
     [TOKEN_TYPE_RIGHT_PAREN] = {NULL, NULL, PRECEDENCE_NONE},
     [TOKEN_TYPE_LEFT_BRACE] = {NULL, NULL, PRECEDENCE_NONE},
     [TOKEN_TYPE_RIGHT_BRACE] = {NULL, NULL, PRECEDENCE_NONE},
-    [TOKEN_TYPE_LEFT_BRACKET] = {NULL, NULL, PRECEDENCE_NONE},
+    [TOKEN_TYPE_LEFT_BRACKET] = {NULL, subscript, PRECEDENCE_CALL},
     [TOKEN_TYPE_RIGHT_BRACKET] = {NULL, NULL, PRECEDENCE_NONE},
     [TOKEN_TYPE_SEMICOLON] = {NULL, NULL, PRECEDENCE_NONE},
     [TOKEN_TYPE_DOT] = {NULL, field, PRECEDENCE_CALL},
@@ -115,8 +120,8 @@ struct parse_rule rules[] = {
     [TOKEN_TYPE_CARET_EQUAL] = {NULL, NULL, PRECEDENCE_CALL},
     [TOKEN_TYPE_TILDE] = {unary, NULL, PRECEDENCE_UNARY},
     [TOKEN_TYPE_TILDE_EQUAL] = {NULL, NULL, PRECEDENCE_NONE},
-    [TOKEN_TYPE_MOVE] = {NULL, NULL, PRECEDENCE_NONE},
-    [TOKEN_TYPE_COPY] = {NULL, NULL, PRECEDENCE_NONE},
+    [TOKEN_TYPE_MOVE] = {unary, NULL, PRECEDENCE_UNARY},
+    [TOKEN_TYPE_COPY] = {unary, NULL, PRECEDENCE_UNARY},
     [TOKEN_TYPE_STRING_LITERAL] = {NULL, NULL, PRECEDENCE_NONE},
     [TOKEN_TYPE_INTEGER] = {number, NULL, PRECEDENCE_NONE},
     [TOKEN_TYPE_FLOATING] = {number, NULL, PRECEDENCE_NONE},
@@ -181,6 +186,19 @@ static struct ast_node* make_compound_assignment(struct parser* parser, enum ast
 static struct ast_node* variable(struct parser* parser, bool canAssign)
 {
     struct token token = parser->previous;
+    struct ast_node* symbol = ast_module_get_symbol(parser_scope(parser), token);
+    // a generic is named with its type arguments, the instance goes by that name
+    if (symbol != NULL && (symbol->type == AST_NODE_TYPE_FUNCTION || symbol->type == AST_NODE_TYPE_STRUCT) &&
+        generic_find(parser->module->generics, symbol) != NULL)
+    {
+        struct generic_instance* instance = parser_instantiate(parser, symbol);
+        return instance != NULL ? ast_node_new(AST_NODE_TYPE_NAME, instance->name) : NULL;
+    }
+    if (symbol != NULL && symbol->type == AST_NODE_TYPE_STRUCT &&
+        (parser_check(parser, TOKEN_TYPE_LEFT_PAREN) || parser_check(parser, TOKEN_TYPE_LEFT_BRACKET)))
+    {
+        return cast(parser, canAssign);
+    }
     struct ast_node* variable = ast_node_new(AST_NODE_TYPE_NAME, token);
 
     if (canAssign)
@@ -304,9 +322,27 @@ static struct ast_node* unary(struct parser* parser, bool canAssign)
                 ast_node_append_child(node, operand);
                 return node;
             }
+        case TOKEN_TYPE_MOVE:
+            {
+                struct ast_node* node = ast_node_new(AST_NODE_TYPE_MOVE, token);
+                ast_node_append_child(node, operand);
+                return node;
+            }
+        case TOKEN_TYPE_COPY:
+            {
+                struct ast_node* node = ast_node_new(AST_NODE_TYPE_COPY, token);
+                ast_node_append_child(node, operand);
+                return node;
+            }
         case TOKEN_TYPE_STAR: {
             struct ast_node* node = ast_node_new(AST_NODE_TYPE_LOCK, token);
             ast_node_append_child(node, operand);
+            if (canAssign && parser_match(parser, TOKEN_TYPE_EQUAL)) {
+                struct ast_node* assignment = ast_node_new(AST_NODE_TYPE_ASSIGN, parser->previous);
+                ast_node_append_child(assignment, node);
+                ast_node_append_child(assignment, expression(parser));
+                return assignment;
+            }
             return node;
         }
         default:
@@ -509,6 +545,7 @@ static struct ast_node* field(struct parser* parser, struct ast_node* left, bool
         {
             struct ast_node* node = ast_node_new(AST_NODE_TYPE_SET_FIELD, op_token);
             ast_node_append_child(node, left);
+            ast_node_append_child(node, ast_node_new(AST_NODE_TYPE_NAME, field_name));
             ast_node_append_child(node, expression(parser));
             return node;
         }
@@ -520,6 +557,23 @@ static struct ast_node* field(struct parser* parser, struct ast_node* left, bool
     return node;
 }
 
+static struct ast_node* subscript(struct parser* parser, struct ast_node* left, bool canAssign)
+{
+    struct token op_token = parser->previous;
+    struct ast_node* node = ast_node_new(AST_NODE_TYPE_INDEX, op_token);
+    ast_node_append_child(node, left);
+    ast_node_append_child(node, expression(parser));
+    parser_consume(parser, TOKEN_TYPE_RIGHT_BRACKET, "expected ']' after index");
+    if (canAssign && parser_match(parser, TOKEN_TYPE_EQUAL))
+    {
+        struct ast_node* assignment = ast_node_new(AST_NODE_TYPE_ASSIGN, parser->previous);
+        ast_node_append_child(assignment, node);
+        ast_node_append_child(assignment, expression(parser));
+        return assignment;
+    }
+    return node;
+}
+
 static struct ast_node* parse_precedence(struct parser* parser, enum precedence precedence)
 {
     parser_advance(parser);
@@ -701,7 +755,8 @@ static struct ast_node* for_statement(struct parser* parser)
     struct ast_node* incr = expression(parser);
     parser_consume(parser, TOKEN_TYPE_RIGHT_PAREN, "expected ')' after for");
     struct ast_node* body = declaration(parser);
-    struct ast_node* root = ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null);
+    // the variable the loop declares ends with it
+    struct ast_node* root = ast_node_new(AST_NODE_TYPE_SCOPE, token_null);
     ast_node_append_child(root, init);
     ast_node_append_child(root, loop);
     ast_node_append_child(loop, condition);
@@ -721,15 +776,18 @@ static struct ast_node* module_statement(struct parser* parser)
 
 static struct ast_node* region_statement(struct parser* parser) {
     struct token op_token = parser->previous;
-    parser_match(parser, TOKEN_TYPE_IDENTIFIER);
+    if (parser_match(parser, TOKEN_TYPE_IDENTIFIER))
+    {
+        op_token = parser->previous;
+    }
     parser_consume(parser, TOKEN_TYPE_LEFT_PAREN, "expected '(' after region");
-    struct ast_node* sequence = ast_node_new(AST_NODE_TYPE_SEQUENCE, op_token);
+    struct ast_node* region = ast_node_new(AST_NODE_TYPE_REGION, op_token);
     if (!parser_check(parser, TOKEN_TYPE_RIGHT_PAREN))
     {
         do
         {
             parser_advance(parser);
-            ast_node_append_child(sequence, definition(parser, false, false, false));
+            ast_node_append_child(region, definition(parser, false, true, false));
         }
         while (parser_match(parser, TOKEN_TYPE_COMMA));
     }
@@ -745,8 +803,8 @@ static struct ast_node* region_statement(struct parser* parser) {
     }
 
     parser_consume(parser, TOKEN_TYPE_RIGHT_BRACE, "expected '}' after region");
-    ast_node_append_child(sequence, body);
-    return sequence;
+    ast_node_append_child(region, body);
+    return region;
 }
 
 static struct ast_node* statement(struct parser* parser)
@@ -811,8 +869,18 @@ static struct ast_node* declaration(struct parser* parser)
     return statement(parser);
 }
 
+// frees a type the parser built, the structs and interfaces it names belong to the symbol tree
+static void free_type(struct ast_node* type) {
+    if (type->parent == NULL && type->type != AST_NODE_TYPE_STRUCT && type->type != AST_NODE_TYPE_INTERFACE) {
+        ast_node_free(type);
+    }
+}
+
 static struct ast_node* implementation(struct parser* parser) {
     struct ast_node* type = parser_build_type(parser);
+    if (type != NULL) {
+        free_type(type);
+    }
     parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected identifier after type");
     struct token name = parser->previous;
     //find the symbol
@@ -821,11 +889,17 @@ static struct ast_node* implementation(struct parser* parser) {
         parser_error(parser, parser->previous, "undefined symbol found at tree gen pass");
         return NULL;
     }
+    if (parser_match(parser, TOKEN_TYPE_LESS)) {
+        while (!parser_check(parser, TOKEN_TYPE_GREATER) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+            parser_advance(parser);
+        }
+        parser_close_generics(parser);
+    }
     struct ast_node* implementation = ast_node_new(AST_NODE_TYPE_IMPLEMENTATION, token_null);
-    ast_node_append_child(implementation, symbol);
     switch (symbol->type) {
         case AST_NODE_TYPE_VARIABLE:
         case AST_NODE_TYPE_FIELD: {
+            ast_node_append_child(implementation, symbol);
             if (parser_match(parser, TOKEN_TYPE_EQUAL)) {
                 ast_node_append_child(implementation, expression(parser));
             }
@@ -836,13 +910,37 @@ static struct ast_node* implementation(struct parser* parser) {
         case AST_NODE_TYPE_FUNCTION:
         case AST_NODE_TYPE_METHOD: {
             parser_consume(parser, TOKEN_TYPE_LEFT_PAREN, "expected '(' after function definition");
+            // the variants of a function are told apart by the types of their parameters, the one implemented is the
+            // only declaration the implementation takes
+            struct ast_node** types = malloc(sizeof(struct ast_node*));
+            assert(types);
+            size_t type_count = 0;
             if (!parser_check(parser, TOKEN_TYPE_RIGHT_PAREN)) {
                 do {
-                    //TODO: function variants will make this hack fail
-                    ast_node_free(parser_build_type(parser));
-                    parser_advance(parser); 
+                    struct ast_node* type = parser_match_type(parser) ? parser_build_type(parser) : NULL;
+                    if (type == NULL) {
+                        parser_error(parser, parser->current, "expected type");
+                        break;
+                    }
+                    types = realloc(types, sizeof(struct ast_node*) * (type_count + 1));
+                    assert(types);
+                    types[type_count++] = type;
+                    parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected parameter name");
                 } while (parser_match(parser, TOKEN_TYPE_COMMA));
             }
+            char* parameters = ast_node_mangle_parameters(types, type_count);
+            for (size_t i = 0; i < type_count; i++) {
+                free_type(types[i]);
+            }
+            free(types);
+            struct ast_node* variant = ast_module_get_variant(parser_scope(parser), name, parameters);
+            free(parameters);
+            if (variant == NULL) {
+                parser_error(parser, name, "no variant of the function has these parameters");
+                ast_node_free(implementation);
+                return NULL;
+            }
+            ast_node_append_child(implementation, variant);
             
             parser_consume(parser, TOKEN_TYPE_RIGHT_PAREN, "expected ')' after function arguments");
             ast_node_append_child(implementation, declaration(parser));
@@ -851,19 +949,103 @@ static struct ast_node* implementation(struct parser* parser) {
             
         default:
             parser_error(parser, parser->previous, "unimplementable symbol type");
+            ast_node_free(implementation);
             return NULL;
     }
     
     return implementation;
 }
 
+// the bodies of the methods of a struct, the earlier passes already declared the struct and its members
+static bool struct_implementations(struct parser* parser, struct ast_module* module) {
+    parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected struct name");
+    struct ast_node* structure = ast_module_get_symbol(parser_scope(parser), parser->previous);
+    while (!parser_match(parser, TOKEN_TYPE_LEFT_BRACE) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+        parser_advance(parser);
+    }
+    struct generic* generic = generic_find(module->generics, structure);
+    struct ast_node* outer_generics = parser->generics;
+    if (generic != NULL) {
+        parser->generics = generic->parameters;
+    }
+    
+    while (!parser_match(parser, TOKEN_TYPE_RIGHT_BRACE) && !parser->error) {
+        if (parser_check(parser, TOKEN_TYPE_EOF)) {
+            parser_error(parser, parser->current, "expected '}' after struct");
+            return false;
+        }
+        if (parser_match(parser, TOKEN_TYPE_LEFT_BRACE)) {
+            skip_block(parser);
+            continue;
+        }
+        if (parser_match(parser, TOKEN_TYPE_STRUCT)) {
+            if (!struct_implementations(parser, module)) {
+                return false;
+            }
+            continue;
+        }
+        
+        // fields end at their ';', methods have their name right before the '('
+        while (!parser_check(parser, TOKEN_TYPE_LEFT_PAREN) && !parser_check(parser, TOKEN_TYPE_SEMICOLON) &&
+               !parser_check(parser, TOKEN_TYPE_EQUAL) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+            parser_advance(parser);
+        }
+        if (!parser_check(parser, TOKEN_TYPE_LEFT_PAREN)) {
+            while (!parser_match(parser, TOKEN_TYPE_SEMICOLON) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+                parser_advance(parser);
+            }
+            continue;
+        }
+        
+        struct ast_node* method = ast_node_struct_method(structure, parser->previous);
+        if (!method) {
+            parser_error(parser, parser->previous, "undefined method found at tree gen pass");
+            return false;
+        }
+        parser_advance(parser);
+        while (!parser_match(parser, TOKEN_TYPE_RIGHT_PAREN) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+            parser_advance(parser);
+        }
+        struct ast_node* implementation = ast_node_new(AST_NODE_TYPE_IMPLEMENTATION, token_null);
+        ast_node_append_child(implementation, method);
+        ast_node_append_child(implementation, declaration(parser));
+        // only the instances of a generic struct are lowered, they take their bodies from here
+        ast_node_append_child(generic != NULL ? generic->bodies : module->root, implementation);
+    }
+    parser->generics = outer_generics;
+    return !parser->error;
+}
+
 static bool ast_gen(struct ast_module* module) {
     for (int i = 0; i < module->lexer_count; i++) {
         struct lexer* lexer = module->lexers[i];
         struct parser* parser = parser_new(PARSER_STAGE_TREE_GENERATION, module, lexer);
             
         while (!parser_match(parser, TOKEN_TYPE_EOF)) {
-            if (parser_match_type(parser)) {
+            if (parser_match(parser, TOKEN_TYPE_STRUCT)) {
+                if (!struct_implementations(parser, module)) {
+                    goto fail;
+                }
+            }
+            else if (parser_match(parser, TOKEN_TYPE_INTERFACE)) {
+                // the earlier passes already declared the interface and its methods
+                while (!parser_match(parser, TOKEN_TYPE_LEFT_BRACE) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+                    parser_advance(parser);
+                }
+                skip_block(parser);
+            }
+            else if ((parser->generics = parser_generic_function_ahead(parser)) != NULL) {
+                // the body of a generic function is kept for its instances, it names the type parameters
+                struct ast_node* impl = parser_match_type(parser) ? implementation(parser) : NULL;
+                ast_node_free(parser->generics);
+                parser->generics = NULL;
+                struct generic* generic = impl != NULL ? generic_find(module->generics, impl->children[0]) : NULL;
+                if (!generic) {
+                    goto fail;
+                }
+                ast_node_append_child(generic->bodies, impl);
+            }
+            else if (parser_match_type(parser)) {
                 struct ast_node* impl = implementation(parser);
                 if (!impl) {
                     goto fail;
@@ -924,6 +1106,9 @@ struct ast_module_list* parse(struct lexer** lexers, uint32_t count)
         }
     }
     
+    // every instance of a generic, wherever it was used, is added to the module of the generic once
+    generic_cache_lower(modules->generics);
+    
     return modules;
 
 fail:
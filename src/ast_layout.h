@@ -17,7 +17,8 @@ enum struct_layout {
     STRUCT_LAYOUT_NAME,
     STRUCT_LAYOUT_IMPLEMENTS,
     STRUCT_LAYOUT_MEMBERS,
-    STRUCT_LAYOUT_STATICS
+    STRUCT_LAYOUT_STATICS,
+    STRUCT_LAYOUT_GENERICS
 };
 
 enum interface_layout {
@@ -4,6 +4,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "ast_layout.h"
+#include "generic.h"
+#include "type_layout.h"
+
 struct ast_module* ast_module_new(struct token name) {
     struct ast_module* module = malloc(sizeof(struct ast_module));
     assert(module);
@@ -25,12 +29,17 @@ struct ast_module* ast_module_new(struct token name) {
     
     module->lexer_count = 0;
     module->lexer_capacity = 1;
+
+    module->layouts = NULL;
+    module->reorder_fields = false;
+    module->generics = NULL;
     return module;
 }
 
 void ast_module_free(struct ast_module* module) {
     free(module->lexers);
     free(module->name);
+    type_layout_cache_free(module->layouts);
     ast_node_free(module->symbols);
     ast_node_free(module->root);
     free(module);
@@ -90,6 +99,65 @@ struct ast_node* ast_module_get_symbol(struct ast_node* scope, struct token name
     return scope->parent ? ast_module_get_symbol(scope->parent, name) : NULL;
 }
 
+char* ast_module_function_parameters(struct ast_node* function) {
+    struct ast_node* args = function->children[2];
+    struct ast_node** types = malloc(sizeof(struct ast_node*) * (args->children_count + 1));
+    assert(types);
+    for (size_t i = 0; i < args->children_count; i++) {
+        types[i] = args->children[i]->children[1];
+    }
+    char* parameters = ast_node_mangle_parameters(types, args->children_count);
+    free(types);
+    return parameters;
+}
+
+struct ast_node* ast_module_get_variant(struct ast_node* scope, struct token name, const char* parameters) {
+    for (size_t i = 0; i < scope->children_count; i++) {
+        struct ast_node* child = scope->children[i];
+        if (child->type != AST_NODE_TYPE_FUNCTION && child->type != AST_NODE_TYPE_METHOD) {
+            continue;
+        }
+        struct token symbol_name = child->children[0]->token;
+        if (name.length != symbol_name.length || memcmp(name.start, symbol_name.start, symbol_name.length) != 0) {
+            continue;
+        }
+        char* child_parameters = ast_module_function_parameters(child);
+        bool same = strcmp(child_parameters, parameters) == 0;
+        free(child_parameters);
+        if (same) {
+            return child;
+        }
+    }
+    return scope->parent ? ast_module_get_variant(scope->parent, name, parameters) : NULL;
+}
+
+struct ast_node* ast_module_get_owner(struct ast_node* scope, struct ast_node* symbol) {
+    for (size_t i = 0; i < scope->children_count; i++) {
+        struct ast_node* child = scope->children[i];
+        if (child->type != AST_NODE_TYPE_STRUCT) {
+            continue;
+        }
+        struct ast_node* members = child->children[STRUCT_LAYOUT_MEMBERS];
+        struct ast_node* statics = child->children[STRUCT_LAYOUT_STATICS];
+        for (size_t j = 0; j < members->children_count; j++) {
+            if (members->children[j] == symbol) {
+                return child;
+            }
+        }
+        for (size_t j = 0; j < statics->children_count; j++) {
+            if (statics->children[j] == symbol) {
+                return child;
+            }
+        }
+        // nested structs come after the statics
+        struct ast_node* nested = ast_module_get_owner(child, symbol);
+        if (nested != NULL) {
+            return nested;
+        }
+    }
+    return NULL;
+}
+
 struct ast_module_list* ast_module_list_new() {
     struct ast_module_list* list = malloc(sizeof(struct ast_module_list));
     assert(list);
@@ -97,6 +165,7 @@ struct ast_module_list* ast_module_list_new() {
     assert(list->modules);
     list->module_count = 0;
     list->module_capacity = 1;
+    list->generics = generic_cache_new();
     return list;
 }
 
@@ -107,6 +176,7 @@ void ast_module_list_add(struct ast_module_list* list, struct ast_module* module
         assert(list->modules);
     }
     list->modules[list->module_count++] = module;
+    module->generics = list->generics;
 }
 
 void ast_module_list_free(struct ast_module_list* list) {
@@ -114,6 +184,7 @@ void ast_module_list_free(struct ast_module_list* list) {
         ast_module_free(list->modules[i]);
     }
     free(list->modules);
+    generic_cache_free(list->generics);
     free(list);
 }
 
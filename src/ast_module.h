@@ -18,6 +18,13 @@ struct ast_module {
     struct lexer** lexers;
     size_t lexer_count;
     size_t lexer_capacity;
+
+    // the layout of every struct asked for so far
+    struct type_layout_cache* layouts;
+    // lets private fields move to fill padding, has to be set before any layout is asked for
+    bool reorder_fields;
+    // the generics of every module and their instances, shared by the modules of a list
+    struct generic_cache* generics;
 };
 
 struct ast_module* ast_module_new(struct token name);
@@ -32,10 +39,23 @@ bool ast_module_add_dependency(struct ast_module* module, struct ast_module* dep
 
 struct ast_node* ast_module_get_symbol(struct ast_node* scope, struct token name);
 
+// the function called name whose parameters are of the types as they are written, see ast_node_mangle_parameters. a
+// function can have variants told apart by their parameters. NULL if there is none
+struct ast_node* ast_module_get_variant(struct ast_node* scope, struct token name, const char* parameters);
+
+// the types of the parameters of a function as they are written, has to be freed
+char* ast_module_function_parameters(struct ast_node* function);
+
+// the struct a method, static or field belongs to, searching the structs of scope and the structs nested in them. NULL
+// for the symbols of the module itself
+struct ast_node* ast_module_get_owner(struct ast_node* scope, struct ast_node* symbol);
+
 struct ast_module_list {
     struct ast_module** modules;
     uint32_t module_count;
     uint32_t module_capacity;
+
+    struct generic_cache* generics;
 };
 
 struct ast_module_list* ast_module_list_new();
@@ -28,6 +28,7 @@ struct block* block_new(bool entry, struct register_table* symbol_table) {
     node->instructions_capacity = 1;
 
     node->exit = NULL;
+    node->align = false;
     
     return node;
 }
@@ -58,6 +59,24 @@ void block_link(struct block* parent, struct block* child) {
     child->parents[child->parents_count++] = parent;
 }
 
+void block_unlink(struct block* parent, struct block* child) {
+    assert(parent);
+    assert(child);
+
+    for (uint32_t i = 0; i < parent->children_count; i++) {
+        if (parent->children[i] == child) {
+            parent->children[i] = parent->children[--parent->children_count];
+            break;
+        }
+    }
+    for (uint32_t i = 0; i < child->parents_count; i++) {
+        if (child->parents[i] == parent) {
+            child->parents[i] = child->parents[--child->parents_count];
+            break;
+        }
+    }
+}
+
 void block_add(struct block* block, struct ssa_instruction instruction) {
     assert(block);
 
@@ -71,3 +90,25 @@ void block_add(struct block* block, struct ssa_instruction instruction) {
     block->branches = instruction.result.type == OPERAND_TYPE_END;
 }
 
+
+void block_copy(struct block* target, struct ssa_instruction* first, struct ssa_instruction* last,
+                struct operand* renames, uint32_t* next_register) {
+    assert(target);
+    assert(renames);
+    assert(next_register);
+
+    for (struct ssa_instruction* instruction = first; instruction != last; instruction++) {
+        struct ssa_instruction copy = *instruction;
+        for (int i = 0; i < MAX_OPERANDS; i++) {
+            struct operand operand = copy.operands[i];
+            if (operand.type == OPERAND_TYPE_REGISTER && renames[operand.value.integer].type != OPERAND_TYPE_NONE) {
+                copy.operands[i] = renames[operand.value.integer];
+            }
+        }
+        if (copy.result.type == OPERAND_TYPE_REGISTER) {
+            copy.result = operand_reg((*next_register)++, instruction->result.typename);
+            renames[instruction->result.value.integer] = copy.result;
+        }
+        block_add(target, copy);
+    }
+}
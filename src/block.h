@@ -25,6 +25,9 @@ struct block {
 
     struct ssa_instruction* exit;
     bool branches;
+
+    // hot loop header, set by the layout pass so the backend can align it
+    bool align;
 };
 
 struct block* block_new(bool entry, struct register_table* symbol_table);
@@ -33,6 +36,14 @@ void block_free(struct block* node);
 
 void block_link(struct block* parent, struct block* child);
 
+void block_unlink(struct block* parent, struct block* child);
+
 void block_add(struct block* block, struct ssa_instruction instruction);
 
+// appends copies of the instructions from first up to last to target. every register a copy defines gets a fresh
+// number from next_register and is recorded in renames, which later copies read their operands through. renames needs
+// an entry for every register of the unit, none for registers that keep their number
+void block_copy(struct block* target, struct ssa_instruction* first, struct ssa_instruction* last,
+                struct operand* renames, uint32_t* next_register);
+
 #endif //COMPILER_CFG_H
\ No newline at end of file
@@ -0,0 +1,367 @@
+#include "block_layout.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "block.h"
+
+#define NONE UINT32_MAX
+
+struct layout {
+    struct unit* unit;
+    uint32_t count;
+
+    // successors by block index, an if lists its then block first
+    uint32_t (*successors)[2];
+    uint32_t* successor_count;
+    // blocks without a terminator run straight into the next block, the entry block does this
+    bool* falls_through;
+    bool* returns;
+
+    // loops by header index, NULL for blocks that aren't a loop header
+    bool** loops;
+    uint32_t* depth;
+
+    bool* reachable;
+    bool* cold;
+    bool* placed;
+    bool* deferred;
+
+    uint32_t* order;
+    uint32_t order_count;
+};
+
+static uint32_t block_index(struct layout* layout, struct operand operand) {
+    assert(operand.type == OPERAND_TYPE_BLOCK);
+    uint32_t index = operand.value.block->id - 1;
+    assert(index < layout->count && layout->unit->blocks[index] == operand.value.block);
+    return index;
+}
+
+static void find_successors(struct layout* layout) {
+    for (uint32_t i = 0; i < layout->count; i++) {
+        struct block* block = layout->unit->blocks[i];
+        layout->successor_count[i] = 0;
+        layout->falls_through[i] = true;
+        layout->returns[i] = false;
+
+        // anything after the first terminator is never run
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator == OP_GOTO) {
+                layout->successors[i][0] = block_index(layout, instruction->operands[0]);
+                layout->successor_count[i] = 1;
+            } else if (instruction->operator == OP_IF) {
+                layout->successors[i][0] = block_index(layout, instruction->operands[1]);
+                layout->successors[i][1] = block_index(layout, instruction->operands[2]);
+                layout->successor_count[i] = 2;
+            } else if (instruction->operator == OP_RETURN) {
+                layout->returns[i] = true;
+            } else {
+                continue;
+            }
+            layout->falls_through[i] = false;
+            break;
+        }
+
+        if (layout->falls_through[i] && i + 1 < layout->count) {
+            layout->successors[i][0] = i + 1;
+            layout->successor_count[i] = 1;
+        }
+    }
+}
+
+static bool in_loop(struct layout* layout, uint32_t block, uint32_t header) {
+    return header == NONE || layout->loops[header][block];
+}
+
+// marks everything that reaches the latch without going through the header
+static void natural_loop(struct layout* layout, uint32_t header, uint32_t latch) {
+    if (layout->loops[header] == NULL) {
+        layout->loops[header] = calloc(layout->count, sizeof(bool));
+        assert(layout->loops[header]);
+        layout->loops[header][header] = true;
+    }
+    bool* body = layout->loops[header];
+
+    uint32_t* stack = malloc(sizeof(uint32_t) * layout->count);
+    assert(stack);
+    uint32_t top = 0;
+    if (!body[latch]) {
+        body[latch] = true;
+        stack[top++] = latch;
+    }
+    while (top > 0) {
+        uint32_t block = stack[--top];
+        for (uint32_t i = 0; i < layout->count; i++) {
+            if (body[i] || !layout->reachable[i]) {
+                continue;
+            }
+            for (uint32_t j = 0; j < layout->successor_count[i]; j++) {
+                if (layout->successors[i][j] == block) {
+                    body[i] = true;
+                    stack[top++] = i;
+                    break;
+                }
+            }
+        }
+    }
+    free(stack);
+}
+
+// depth first search from the entry, an edge back to a block still on the stack closes a loop
+static void find_loops(struct layout* layout) {
+    enum { WHITE, GREY, BLACK };
+    uint8_t* color = calloc(layout->count, sizeof(uint8_t));
+    uint32_t* stack = malloc(sizeof(uint32_t) * layout->count);
+    uint32_t* next = calloc(layout->count, sizeof(uint32_t));
+    assert(color && stack && next);
+
+    uint32_t (*back_edges)[2] = malloc(sizeof(uint32_t[2]) * layout->count * 2);
+    assert(back_edges);
+    uint32_t back_edge_count = 0;
+
+    uint32_t top = 0;
+    stack[top++] = 0;
+    color[0] = GREY;
+    layout->reachable[0] = true;
+    while (top > 0) {
+        uint32_t block = stack[top - 1];
+        if (next[block] == layout->successor_count[block]) {
+            color[block] = BLACK;
+            top--;
+            continue;
+        }
+        uint32_t successor = layout->successors[block][next[block]++];
+        if (color[successor] == GREY) {
+            back_edges[back_edge_count][0] = successor;
+            back_edges[back_edge_count][1] = block;
+            back_edge_count++;
+        } else if (color[successor] == WHITE) {
+            color[successor] = GREY;
+            layout->reachable[successor] = true;
+            stack[top++] = successor;
+        }
+    }
+
+    for (uint32_t i = 0; i < back_edge_count; i++) {
+        natural_loop(layout, back_edges[i][0], back_edges[i][1]);
+    }
+    for (uint32_t header = 0; header < layout->count; header++) {
+        for (uint32_t i = 0; layout->loops[header] != NULL && i < layout->count; i++) {
+            layout->depth[i] += layout->loops[header][i];
+        }
+    }
+
+    free(back_edges);
+    free(next);
+    free(stack);
+    free(color);
+}
+
+// unreachable blocks, and returns out of the middle of a loop
+static void find_cold(struct layout* layout) {
+    for (uint32_t i = 0; i < layout->count; i++) {
+        layout->cold[i] = !layout->reachable[i];
+    }
+
+    for (uint32_t i = 0; i < layout->count; i++) {
+        if (layout->successor_count[i] != 1 || layout->falls_through[i]) {
+            continue;
+        }
+        uint32_t target = layout->successors[i][0];
+        if (!layout->returns[target] || target == 0) {
+            continue;
+        }
+        for (uint32_t from = 0; from < layout->count; from++) {
+            for (uint32_t j = 0; j < layout->successor_count[from]; j++) {
+                // the normal way out of a loop is the else of its header
+                bool leaves_loop = layout->successors[from][j] == i && layout->depth[from] > layout->depth[i];
+                bool header_exit = layout->loops[from] != NULL && j == 1;
+                if (leaves_loop && !header_exit) {
+                    layout->cold[i] = true;
+                }
+            }
+        }
+    }
+}
+
+static bool available(struct layout* layout, uint32_t block) {
+    return !layout->placed[block] && !layout->deferred[block] && !layout->cold[block] &&
+           !(layout->returns[block] && block != 0);
+}
+
+static void place(struct layout* layout, uint32_t block) {
+    assert(!layout->placed[block]);
+    layout->placed[block] = true;
+    layout->order[layout->order_count++] = block;
+}
+
+// the successor that should follow a block directly, staying inside the loop being laid out
+static uint32_t next_in_chain(struct layout* layout, uint32_t block, uint32_t loop) {
+    if (layout->falls_through[block]) {
+        uint32_t next = block + 1;
+        return next < layout->count && !layout->placed[next] ? next : NONE;
+    }
+
+    uint32_t best = NONE;
+    for (uint32_t i = 0; i < layout->successor_count[block]; i++) {
+        uint32_t successor = layout->successors[block][i];
+        if (!available(layout, successor) || !in_loop(layout, successor, loop)) {
+            continue;
+        }
+        // going deeper into loops beats leaving them, otherwise the then block goes first
+        if (best == NONE || layout->depth[successor] > layout->depth[best]) {
+            best = successor;
+        }
+    }
+    return best;
+}
+
+// a loop whose header is the only test can be placed with its header last, so each iteration ends in the one
+// conditional branch back to the top instead of a jump back to a test that branches out
+static uint32_t rotatable(struct layout* layout, uint32_t header, uint32_t loop) {
+    if (layout->loops[header] == NULL || layout->successor_count[header] != 2 || header == loop) {
+        return NONE;
+    }
+    for (uint32_t i = 0; i < layout->count; i++) {
+        if (layout->falls_through[i] && layout->successors[i][0] == header) {
+            return NONE;
+        }
+    }
+    uint32_t then = layout->successors[header][0];
+    uint32_t otherwise = layout->successors[header][1];
+    bool then_inside = layout->loops[header][then];
+    bool otherwise_inside = layout->loops[header][otherwise];
+    if (then_inside == otherwise_inside) {
+        return NONE;
+    }
+    uint32_t body = then_inside ? then : otherwise;
+    return body != header && available(layout, body) ? body : NONE;
+}
+
+static void place_loop_rest(struct layout* layout, uint32_t loop);
+
+static void place_chain(struct layout* layout, uint32_t block, uint32_t loop) {
+    while (block != NONE) {
+        uint32_t body = rotatable(layout, block, loop);
+        if (body != NONE) {
+            layout->deferred[block] = true;
+            place_chain(layout, body, block);
+            place_loop_rest(layout, block);
+            layout->deferred[block] = false;
+        }
+        place(layout, block);
+        if (layout->loops[block] != NULL) {
+            layout->unit->blocks[block]->align = true;
+        }
+        block = next_in_chain(layout, block, loop);
+    }
+}
+
+// whatever part of a loop the chain didn't reach, blocks with a placed predecessor go first
+static void place_loop_rest(struct layout* layout, uint32_t loop) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        uint32_t start = NONE;
+        for (uint32_t i = 0; i < layout->count && start == NONE; i++) {
+            if (!available(layout, i) || !in_loop(layout, i, loop)) {
+                continue;
+            }
+            for (uint32_t from = 0; from < layout->count && start == NONE; from++) {
+                for (uint32_t j = 0; j < layout->successor_count[from]; j++) {
+                    if (layout->placed[from] && layout->successors[from][j] == i) {
+                        start = i;
+                    }
+                }
+            }
+        }
+        for (uint32_t i = 0; i < layout->count && start == NONE; i++) {
+            if (available(layout, i) && in_loop(layout, i, loop)) {
+                start = i;
+            }
+        }
+        if (start != NONE) {
+            place_chain(layout, start, loop);
+            progress = true;
+        }
+    }
+}
+
+void unit_layout_blocks(struct unit* unit) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count < 2) {
+        return;
+    }
+
+    struct layout layout = {};
+    layout.unit = unit;
+    layout.count = unit->block_count;
+    for (uint32_t i = 0; i < layout.count; i++) {
+        assert(unit->blocks[i]->id == i + 1);
+        unit->blocks[i]->align = false;
+    }
+
+    layout.successors = malloc(sizeof(uint32_t[2]) * layout.count);
+    layout.successor_count = malloc(sizeof(uint32_t) * layout.count);
+    layout.falls_through = malloc(sizeof(bool) * layout.count);
+    layout.returns = malloc(sizeof(bool) * layout.count);
+    layout.loops = calloc(layout.count, sizeof(bool*));
+    layout.depth = calloc(layout.count, sizeof(uint32_t));
+    layout.reachable = calloc(layout.count, sizeof(bool));
+    layout.cold = calloc(layout.count, sizeof(bool));
+    layout.placed = calloc(layout.count, sizeof(bool));
+    layout.deferred = calloc(layout.count, sizeof(bool));
+    layout.order = malloc(sizeof(uint32_t) * layout.count);
+    assert(layout.successors && layout.successor_count && layout.falls_through && layout.returns && layout.loops &&
+           layout.depth && layout.reachable && layout.cold && layout.placed && layout.deferred && layout.order);
+
+    find_successors(&layout);
+    find_loops(&layout);
+    find_cold(&layout);
+
+    place_chain(&layout, 0, NONE);
+    place_loop_rest(&layout, NONE);
+    for (uint32_t i = 0; i < layout.count; i++) {
+        if (!layout.placed[i] && !layout.cold[i]) {
+            place(&layout, i);
+        }
+    }
+    for (uint32_t i = 0; i < layout.count; i++) {
+        if (!layout.placed[i]) {
+            place(&layout, i);
+        }
+    }
+    assert(layout.order_count == layout.count);
+
+    struct block** blocks = malloc(sizeof(struct block*) * layout.count);
+    assert(blocks);
+    memcpy(blocks, unit->blocks, sizeof(struct block*) * layout.count);
+    for (uint32_t i = 0; i < layout.count; i++) {
+        unit->blocks[i] = blocks[layout.order[i]];
+        unit->blocks[i]->id = i + 1;
+    }
+    free(blocks);
+
+    for (uint32_t i = 0; i < layout.count; i++) {
+        free(layout.loops[i]);
+    }
+    free(layout.successors);
+    free(layout.successor_count);
+    free(layout.falls_through);
+    free(layout.returns);
+    free(layout.loops);
+    free(layout.depth);
+    free(layout.reachable);
+    free(layout.cold);
+    free(layout.placed);
+    free(layout.deferred);
+    free(layout.order);
+}
+
+void unit_module_layout_blocks(struct unit_module* module) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_layout_blocks(module->units[i]);
+    }
+}
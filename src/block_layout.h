@@ -0,0 +1,12 @@
+#ifndef COMPILER_BLOCK_LAYOUT_H
+#define COMPILER_BLOCK_LAYOUT_H
+
+#include "unit.h"
+
+// reorders the blocks of a function so branches fall through where possible: successors are chained, loops are
+// kept contiguous with their header at the bottom, and the exit and rarely taken blocks are moved to the end
+void unit_layout_blocks(struct unit* unit);
+
+void unit_module_layout_blocks(struct unit_module* module);
+
+#endif //COMPILER_BLOCK_LAYOUT_H
@@ -0,0 +1,798 @@
+#include "bounds_check.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+#include "loop.h"
+
+// an index is below the length of no array, or of any array while the path to it hasn't been seen yet
+#define BELOW_NONE UINT32_MAX
+#define BELOW_ANY (UINT32_MAX - 1)
+
+// what is known about an integer at a point of the unit. below names the array, by the register holding it, whose
+// length the integer is smaller than. limited says it is smaller than some value of its own type, so adding one to it
+// can't overflow
+struct range {
+    bool non_negative;
+    bool limited;
+    uint32_t below;
+};
+
+// the first half of a state has a range per register for the value it holds, the second one per local for the integer
+// stored in it. only locals whose address never leaves their loads and stores are followed, nothing else can write to
+// those behind the pass' back. arrays are told apart by where they come from, looking through casts that keep the
+// value and through loads of locals that are only stored to once
+struct ranges {
+    struct unit* unit;
+    uint32_t register_count;
+    bool* tracked;
+    // the instruction defining each register, NULL for arguments
+    struct ssa_instruction** definitions;
+    // the value a local stored to exactly once holds, none for the others
+    struct operand* stored;
+};
+
+static bool same_register(struct operand a, struct operand b) {
+    return a.type == OPERAND_TYPE_REGISTER && b.type == OPERAND_TYPE_REGISTER && a.value.integer == b.value.integer;
+}
+
+static bool is_signed(struct ssa_type type) {
+    return type.type != NULL && type.type->type >= AST_NODE_TYPE_I8 && type.type->type <= AST_NODE_TYPE_I64;
+}
+
+static bool is_unsigned(struct ssa_type type) {
+    return type.type != NULL && type.type->type >= AST_NODE_TYPE_U8 && type.type->type <= AST_NODE_TYPE_U64;
+}
+
+static bool is_array(struct ssa_type type) {
+    return type.type != NULL && type.type->type == AST_NODE_TYPE_ARRAY;
+}
+
+// true if every value of type from is the same number in type to
+static bool keeps_value(struct ssa_type from, struct ssa_type to) {
+    if (is_array(from) && is_array(to)) {
+        return true;
+    }
+    if ((!is_signed(from) && !is_unsigned(from)) || (!is_signed(to) && !is_unsigned(to)) || to.size < from.size) {
+        return false;
+    }
+    if (to.size == from.size) {
+        return is_signed(from) == is_signed(to);
+    }
+    return is_unsigned(from) || is_signed(to);
+}
+
+static void find_tracked(struct ranges* ranges) {
+    struct unit* unit = ranges->unit;
+    bool* tracked = ranges->tracked;
+    memset(tracked, 0, sizeof(bool) * ranges->register_count);
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator == OP_ALLOC && instruction->result.type == OPERAND_TYPE_REGISTER) {
+                tracked[instruction->result.value.integer] = true;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            bool access = instruction->operator == OP_LOAD || instruction->operator == OP_STORE;
+            for (int k = access ? 1 : 0; k < MAX_OPERANDS; k++) {
+                if (instruction->operands[k].type == OPERAND_TYPE_REGISTER) {
+                    tracked[instruction->operands[k].value.integer] = false;
+                }
+            }
+        }
+    }
+}
+
+static bool tracked(struct ranges* ranges, struct operand pointer) {
+    return pointer.type == OPERAND_TYPE_REGISTER && ranges->tracked[pointer.value.integer];
+}
+
+static bool defined_in(struct block* block, struct ssa_instruction* definition) {
+    return definition >= block->instructions && definition < block->instructions + block->instructions_count;
+}
+
+// a local stored to once holds the value stored for the rest of its scope. that value is only the same one at every
+// load when it can't change in between: a constant, an argument or a register computed right before the store, which
+// runs again whenever the register does
+static void find_definitions(struct ranges* ranges) {
+    struct unit* unit = ranges->unit;
+    uint32_t* stores = calloc(ranges->register_count, sizeof(uint32_t));
+    assert(stores);
+    for (uint32_t i = 0; i < ranges->register_count; i++) {
+        ranges->definitions[i] = NULL;
+        ranges->stored[i] = operand_none();
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->result.type == OPERAND_TYPE_REGISTER) {
+                ranges->definitions[instruction->result.value.integer] = instruction;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator != OP_STORE || !tracked(ranges, instruction->operands[0])) {
+                continue;
+            }
+            uint32_t slot = instruction->operands[0].value.integer;
+            struct operand value = instruction->operands[1];
+            bool stable = value.type == OPERAND_TYPE_INTEGER;
+            if (value.type == OPERAND_TYPE_REGISTER) {
+                struct ssa_instruction* definition = ranges->definitions[value.value.integer];
+                stable = definition == NULL || (defined_in(block, definition) && definition < instruction);
+            }
+            ranges->stored[slot] = ++stores[slot] == 1 && stable ? value : operand_none();
+        }
+    }
+    free(stores);
+}
+
+// where a value comes from, looking through the casts and locals that pass it on unchanged
+static struct operand canonical(struct ranges* ranges, struct operand operand) {
+    for (uint32_t steps = 0; operand.type == OPERAND_TYPE_REGISTER && steps < ranges->register_count; steps++) {
+        struct ssa_instruction* definition = ranges->definitions[operand.value.integer];
+        if (definition == NULL) {
+            break;
+        }
+        if (definition->operator == OP_CAST &&
+            keeps_value(definition->operands[0].typename, definition->result.typename)) {
+            operand = definition->operands[0];
+        }
+        else if (definition->operator == OP_LOAD && tracked(ranges, definition->operands[0]) &&
+                 ranges->stored[definition->operands[0].value.integer].type != OPERAND_TYPE_NONE) {
+            operand = ranges->stored[definition->operands[0].value.integer];
+        }
+        else {
+            break;
+        }
+    }
+    return operand;
+}
+
+static uint32_t array_of(struct ranges* ranges, struct operand array) {
+    array = canonical(ranges, array);
+    return array.type == OPERAND_TYPE_REGISTER ? (uint32_t) array.value.integer : BELOW_NONE;
+}
+
+// the array whose length the value was loaded from, BELOW_NONE if it isn't a length
+static uint32_t length_of(struct ranges* ranges, struct operand value) {
+    value = canonical(ranges, value);
+    if (value.type != OPERAND_TYPE_REGISTER) {
+        return BELOW_NONE;
+    }
+    struct ssa_instruction* load = ranges->definitions[value.value.integer];
+    if (load == NULL || load->operator != OP_LOAD || load->result.typename.size != 8 ||
+        load->operands[0].type != OPERAND_TYPE_REGISTER) {
+        return BELOW_NONE;
+    }
+    struct ssa_instruction* field = ranges->definitions[load->operands[0].value.integer];
+    if (field == NULL || field->operator != OP_FIELD || !is_array(field->operands[0].typename) ||
+        field->operands[1].type != OPERAND_TYPE_INTEGER ||
+        field->operands[1].value.integer != offsetof(struct array_header, length)) {
+        return BELOW_NONE;
+    }
+    return array_of(ranges, field->operands[0]);
+}
+
+static struct range range_of(struct range* state, struct operand operand) {
+    struct range range = {false, false, BELOW_NONE};
+    if (operand.type == OPERAND_TYPE_INTEGER) {
+        range.non_negative = (int64_t) operand.value.integer >= 0;
+    }
+    else if (operand.type == OPERAND_TYPE_REGISTER) {
+        range = state[operand.value.integer];
+        range.non_negative |= is_unsigned(operand.typename) && operand.typename.size < 8;
+    }
+    return range;
+}
+
+static struct range meet(struct range a, struct range b) {
+    struct range met = {a.non_negative && b.non_negative, a.limited && b.limited, a.below};
+    if (a.below == BELOW_ANY) {
+        met.below = b.below;
+    }
+    else if (b.below != BELOW_ANY && b.below != a.below) {
+        met.below = BELOW_NONE;
+    }
+    return met;
+}
+
+static void narrow(struct range* known, struct range range) {
+    known->non_negative |= range.non_negative;
+    known->limited |= range.limited;
+    if (range.below != BELOW_NONE) {
+        known->below = range.below;
+    }
+}
+
+// the local a value was loaded from earlier in the block, if the local hasn't been stored to since. what is learned
+// about the value then holds for the local too. UINT32_MAX if there is no such local
+static uint32_t loaded_from(struct ranges* ranges, struct block* block, uint32_t index, struct operand value) {
+    for (uint32_t i = index; i-- > 0;) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        if (same_register(instruction->result, value)) {
+            if (instruction->operator != OP_LOAD || !tracked(ranges, instruction->operands[0])) {
+                return UINT32_MAX;
+            }
+            for (uint32_t j = i + 1; j < index; j++) {
+                struct ssa_instruction* store = &block->instructions[j];
+                if (store->operator == OP_STORE && same_register(store->operands[0], instruction->operands[0])) {
+                    return UINT32_MAX;
+                }
+            }
+            return instruction->operands[0].value.integer;
+        }
+    }
+    return UINT32_MAX;
+}
+
+// records what is now known about a value at index of the block, and about the values it was cast from and the locals
+// they were loaded from. a value below something of type bound, when there is one, is limited if its own type holds
+// every value of that type
+static void learn(struct ranges* ranges, struct range* state, struct block* block, uint32_t index,
+                  struct operand value, struct range range, struct ssa_type* bound) {
+    struct range* contents = state + ranges->register_count;
+    for (uint32_t steps = 0; value.type == OPERAND_TYPE_REGISTER && steps < ranges->register_count; steps++) {
+        struct range learned = range;
+        learned.limited = bound != NULL && keeps_value(*bound, value.typename);
+        narrow(&state[value.value.integer], learned);
+        uint32_t slot = loaded_from(ranges, block, index, value);
+        if (slot != UINT32_MAX) {
+            narrow(&contents[slot], learned);
+        }
+        struct ssa_instruction* definition = ranges->definitions[value.value.integer];
+        if (definition == NULL || definition->operator != OP_CAST ||
+            !keeps_value(definition->operands[0].typename, definition->result.typename)) {
+            break;
+        }
+        value = definition->operands[0];
+    }
+}
+
+// x + c for a small constant c. a value that can't be negative stays so when one is added and that can't overflow, and
+// one below a length, or a length itself, is below it when something is taken away
+static struct range offset(struct ranges* ranges, struct operand value, struct range x, struct operand constant,
+                           bool subtract) {
+    struct range result = {false, false, BELOW_NONE};
+    int64_t c = (int64_t) constant.value.integer;
+    if (constant.type != OPERAND_TYPE_INTEGER || c <= INT32_MIN || c > INT32_MAX) {
+        return result;
+    }
+    if (subtract) {
+        c = -c;
+    }
+    if (c == 0) {
+        return x;
+    }
+    if (c == 1) {
+        result.non_negative = x.non_negative && x.limited;
+    }
+    else if (c < 0 && x.non_negative) {
+        uint32_t length = length_of(ranges, value);
+        result.limited = x.limited || length != BELOW_NONE;
+        result.below = length != BELOW_NONE ? length : x.below;
+    }
+    return result;
+}
+
+// runs the block over a state, checks of indices already known to be inside their array become moves when rewrite is
+// set. returns how many did
+static uint32_t transfer(struct ranges* ranges, struct block* block, struct range* state, bool rewrite) {
+    struct range* contents = state + ranges->register_count;
+    uint32_t removed = 0;
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        struct operand* operands = instruction->operands;
+        struct range result = {false, false, BELOW_NONE};
+        switch (instruction->operator) {
+            case OP_CONST:
+                result = range_of(state, operands[0]);
+                break;
+            case OP_CAST:
+                if (keeps_value(operands[0].typename, instruction->result.typename)) {
+                    result = range_of(state, operands[0]);
+                }
+                break;
+            case OP_ADD:
+                result = offset(ranges, operands[0], range_of(state, operands[0]), operands[1], false);
+                if (operands[0].type == OPERAND_TYPE_INTEGER) {
+                    result = offset(ranges, operands[1], range_of(state, operands[1]), operands[0], false);
+                }
+                break;
+            case OP_SUB:
+                result = offset(ranges, operands[0], range_of(state, operands[0]), operands[1], true);
+                break;
+            case OP_BITWISE_AND:
+                // the result is no bigger than an operand that isn't negative
+                for (int side = 0; side < 2; side++) {
+                    struct range mask = range_of(state, operands[side]);
+                    if (mask.non_negative) {
+                        result = mask;
+                    }
+                }
+                break;
+            case OP_LOAD:
+                if (tracked(ranges, operands[0])) {
+                    result = contents[operands[0].value.integer];
+                }
+                else {
+                    result.non_negative = length_of(ranges, instruction->result) != BELOW_NONE;
+                }
+                break;
+            case OP_STORE:
+                if (tracked(ranges, operands[0])) {
+                    contents[operands[0].value.integer] = range_of(state, operands[1]);
+                }
+                break;
+            case OP_BOUNDS_CHECK: {
+                struct operand index = operands[1];
+                uint32_t array = array_of(ranges, operands[0]);
+                struct range known = range_of(state, index);
+                if (rewrite && array != BELOW_NONE && known.non_negative && known.below == array) {
+                    instruction->operator = OP_CAST;
+                    operands[0] = index;
+                    operands[1] = operand_none();
+                    removed++;
+                }
+                // past the check the index is inside the array, whose length is a 64 bit offset like the result
+                result = (struct range) {true, false, array};
+                learn(ranges, state, block, i, index, result, &instruction->result.typename);
+                result.limited = true;
+                break;
+            }
+            default:
+                break;
+        }
+        if (instruction->result.type == OPERAND_TYPE_REGISTER) {
+            uint32_t defined = instruction->result.value.integer;
+            state[defined] = result;
+            // an array made again in a loop is another one, nothing is below it yet
+            if (is_array(instruction->result.typename)) {
+                for (uint32_t k = 0; k < ranges->register_count * 2; k++) {
+                    if (state[k].below == defined) {
+                        state[k].below = BELOW_NONE;
+                    }
+                }
+            }
+        }
+    }
+    return removed;
+}
+
+// a branch on a compare of integers tells, on each of its edges, that left is below right or at most right. false if
+// the block doesn't end in one
+static bool branch_relation(struct ranges* ranges, struct block* block, uint32_t edge, struct operand* left,
+                            struct operand* right, bool* strict) {
+    struct ssa_instruction* terminator = block_terminator(block);
+    if (terminator == NULL || terminator->operator != OP_IF) {
+        return false;
+    }
+    if (terminator->operands[0].type != OPERAND_TYPE_REGISTER) {
+        return false;
+    }
+    struct ssa_instruction* compare = ranges->definitions[terminator->operands[0].value.integer];
+    if (compare == NULL || !defined_in(block, compare) || !is_signed(compare->operands[0].typename) ||
+        !is_signed(compare->operands[1].typename)) {
+        return false;
+    }
+    // the true edge of a < b has a below b, the false edge b at most a
+    bool taken = edge == 0;
+    struct operand a = compare->operands[0];
+    struct operand b = compare->operands[1];
+    switch (compare->operator) {
+        case OP_LESS:
+            *strict = taken;
+            break;
+        case OP_LESS_EQUAL:
+            *strict = !taken;
+            break;
+        case OP_GREATER:
+            *strict = taken;
+            a = compare->operands[1];
+            b = compare->operands[0];
+            break;
+        case OP_GREATER_EQUAL:
+            *strict = !taken;
+            a = compare->operands[1];
+            b = compare->operands[0];
+            break;
+        default:
+            return false;
+    }
+    *left = taken ? a : b;
+    *right = taken ? b : a;
+    return true;
+}
+
+static void learn_branch(struct ranges* ranges, struct block* block, uint32_t edge, struct range* state) {
+    struct operand left;
+    struct operand right;
+    bool strict;
+    if (!branch_relation(ranges, block, edge, &left, &right, &strict)) {
+        return;
+    }
+    uint32_t index = block_terminator(block) - block->instructions;
+    struct range smaller = range_of(state, left);
+    struct range bigger = range_of(state, right);
+
+    // left < length or left <= right < length
+    struct range below = {false, false, BELOW_NONE};
+    if (strict) {
+        below.below = length_of(ranges, right);
+    }
+    if (below.below == BELOW_NONE && bigger.below != BELOW_ANY) {
+        below.below = bigger.below;
+    }
+    struct ssa_type bound = canonical(ranges, right).typename;
+    learn(ranges, state, block, index, left, below, strict ? &bound : NULL);
+
+    // right >= left >= 0 or right > left >= -1
+    bool minus_one = left.type == OPERAND_TYPE_INTEGER && (int64_t) left.value.integer == -1;
+    if (smaller.non_negative || (strict && minus_one)) {
+        learn(ranges, state, block, index, right, (struct range) {true, false, BELOW_NONE}, NULL);
+    }
+}
+
+#pragma region hoisting
+
+static bool calls(struct block* block) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        if (block->instructions[i].operator == OP_CALL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool stored_in(struct block* block, struct operand slot) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        if (instruction->operator == OP_STORE && same_register(instruction->operands[0], slot)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// true if every value the operand can have fits the type
+static bool fits(struct operand operand, struct ssa_type type) {
+    if (operand.type != OPERAND_TYPE_INTEGER) {
+        return keeps_value(operand.typename, type);
+    }
+    int64_t value = (int64_t) operand.value.integer;
+    return type.size >= 8 || (value >= -((int64_t) 1 << (type.size * 8 - 1)) &&
+                              value < ((int64_t) 1 << (type.size * 8 - 1)));
+}
+
+static struct operand emit(struct block* block, struct ssa_instruction instruction, struct ssa_type type,
+                           uint32_t* next_register) {
+    instruction.result = operand_reg((*next_register)++, type);
+    block_add(block, instruction);
+    return instruction.result;
+}
+
+// the array a check in the loop indexes, as it can be had before the loop: the register itself when it is computed
+// outside the loop, or a load of the local holding it when the loop never stores to that. none if neither
+static struct operand invariant_array(struct ranges* ranges, struct loop* loop, struct operand array,
+                                      struct ssa_instruction** reload) {
+    array = canonical(ranges, array);
+    *reload = NULL;
+    if (array.type != OPERAND_TYPE_REGISTER) {
+        return operand_none();
+    }
+    struct ssa_instruction* definition = ranges->definitions[array.value.integer];
+    if (definition == NULL || (!defined_in(loop->header, definition) && !defined_in(loop->body, definition))) {
+        return array;
+    }
+    if (definition->operator == OP_LOAD && tracked(ranges, definition->operands[0]) &&
+        !stored_in(loop->header, definition->operands[0]) && !stored_in(loop->body, definition->operands[0])) {
+        *reload = definition;
+        return array;
+    }
+    return operand_none();
+}
+
+// a loop that counts up by one from first while below bound goes through every index from first to bound - 1, so when
+// both are inside an array every check of the induction variable against it passes. those checks become one test of
+// each end, made behind a copy of the loop condition so a loop that doesn't run checks nothing. the loop must not call
+// anything, a call could see the program stop before the iteration that would have failed. returns how many checks
+// the loop lost
+static uint32_t hoist(struct ranges* ranges, struct loop* loop, uint32_t* next_register) {
+    if (loop->step != 1 || loop->compare->operator != OP_LESS || !tracked(ranges, loop->induction) ||
+        !is_signed(loop->induction_type) || calls(loop->header) || calls(loop->body)) {
+        return 0;
+    }
+    // the induction variable wraps instead of reaching a bound its type can't hold, the negative index it wraps to
+    // fails its check. so a bound that may be that big is tested once before the loop, which traps when it is
+    bool limited = !fits(canonical(ranges, loop->bound), loop->induction_type);
+
+    struct block* body = loop->body;
+    uint32_t* hoisted = malloc(sizeof(uint32_t) * body->instructions_count);
+    struct operand* arrays = malloc(sizeof(struct operand) * body->instructions_count);
+    struct ssa_instruction** reloads = malloc(sizeof(struct ssa_instruction*) * body->instructions_count);
+    assert(hoisted && arrays && reloads);
+    uint32_t hoisted_count = 0;
+    uint32_t array_count = 0;
+    for (uint32_t i = 0; i < body->instructions_count; i++) {
+        struct ssa_instruction* check = &body->instructions[i];
+        if (check->operator != OP_BOUNDS_CHECK) {
+            continue;
+        }
+        struct operand index = check->operands[1];
+        while (index.type == OPERAND_TYPE_REGISTER && ranges->definitions[index.value.integer] != NULL &&
+               ranges->definitions[index.value.integer]->operator == OP_CAST &&
+               keeps_value(ranges->definitions[index.value.integer]->operands[0].typename, index.typename)) {
+            index = ranges->definitions[index.value.integer]->operands[0];
+        }
+        if (loaded_from(ranges, body, i, index) != loop->induction.value.integer) {
+            continue;
+        }
+        struct ssa_instruction* reload;
+        struct operand array = invariant_array(ranges, loop, check->operands[0], &reload);
+        if (array.type == OPERAND_TYPE_NONE) {
+            continue;
+        }
+        hoisted[hoisted_count++] = i;
+        uint32_t j = 0;
+        while (j < array_count && !same_register(arrays[j], array)) {
+            j++;
+        }
+        if (j == array_count) {
+            arrays[array_count] = array;
+            reloads[array_count++] = reload;
+        }
+    }
+
+    if (hoisted_count > 0) {
+        struct block* guard = block_new(false, loop->header->symbol_table);
+        struct block* checks = block_new(false, loop->header->symbol_table);
+        unit_add(ranges->unit, guard);
+        unit_add(ranges->unit, checks);
+
+        // the guard ends by comparing the first index against the bound, both widened to 64 bits
+        struct block* limit = checks;
+        if (limited) {
+            limit = block_new(false, loop->header->symbol_table);
+            unit_add(ranges->unit, limit);
+        }
+        loop_emit_guard(loop, guard, 0, limit, loop->exit, next_register);
+        struct ssa_instruction* compare = &guard->instructions[guard->instructions_count - 2];
+        struct operand first = compare->operands[0];
+
+        if (limited) {
+            // the bound past the largest index: the check of an index that can't be in any array
+            struct block* overflow = block_new(false, loop->header->symbol_table);
+            unit_add(ranges->unit, overflow);
+            struct ssa_instruction largest = {};
+            largest.operator = OP_LESS_EQUAL;
+            largest.type = first.typename;
+            largest.operands[0] = compare->operands[1];
+            largest.operands[1] = operand_const_i64(((int64_t) 1 << (loop->induction_type.size * 8 - 1)) - 1);
+            struct ssa_instruction branch = {};
+            branch.operator = OP_IF;
+            branch.result = operand_end();
+            branch.operands[0] = emit(limit, largest, first.typename, next_register);
+            branch.operands[1] = operand_block(checks);
+            branch.operands[2] = operand_block(overflow);
+            block_add(limit, branch);
+
+            struct operand array = arrays[0];
+            if (reloads[0] != NULL) {
+                array = emit(overflow, *reloads[0], reloads[0]->result.typename, next_register);
+            }
+            struct ssa_instruction check = {};
+            check.operator = OP_BOUNDS_CHECK;
+            check.type = first.typename;
+            check.operands[0] = array;
+            check.operands[1] = operand_const_i64(-1);
+            emit(overflow, check, first.typename, next_register);
+            struct ssa_instruction jump = {};
+            jump.operator = OP_GOTO;
+            jump.result = operand_end();
+            jump.operands[0] = operand_block(checks);
+            block_add(overflow, jump);
+
+            block_link(limit, checks);
+            block_link(limit, overflow);
+            block_link(overflow, checks);
+        }
+        struct ssa_instruction last = {};
+        last.operator = OP_SUB;
+        last.type = first.typename;
+        last.operands[0] = compare->operands[1];
+        last.operands[1] = operand_const_i64(1);
+        struct operand ends[2] = {first, emit(checks, last, first.typename, next_register)};
+
+        for (uint32_t i = 0; i < array_count; i++) {
+            struct operand array = arrays[i];
+            if (reloads[i] != NULL) {
+                array = emit(checks, *reloads[i], reloads[i]->result.typename, next_register);
+            }
+            for (int end = 0; end < 2; end++) {
+                struct ssa_instruction check = {};
+                check.operator = OP_BOUNDS_CHECK;
+                check.type = first.typename;
+                check.operands[0] = array;
+                check.operands[1] = ends[end];
+                emit(checks, check, first.typename, next_register);
+            }
+        }
+
+        // the checks block is the loop's preheader now, it stores the start again so later passes still know it
+        struct ssa_instruction* jump = block_terminator(loop->preheader);
+        for (struct ssa_instruction* store = jump; store-- > loop->preheader->instructions;) {
+            if (store->operator == OP_STORE && same_register(store->operands[0], loop->induction)) {
+                block_add(checks, *store);
+                break;
+            }
+        }
+        struct ssa_instruction enter = {};
+        enter.operator = OP_GOTO;
+        enter.result = operand_end();
+        enter.operands[0] = operand_block(loop->header);
+        block_add(checks, enter);
+
+        block_terminator(loop->preheader)->operands[0] = operand_block(guard);
+        block_unlink(loop->preheader, loop->header);
+        block_link(loop->preheader, guard);
+        block_link(guard, limit);
+        block_link(guard, loop->exit);
+        block_link(checks, loop->header);
+
+        for (uint32_t i = 0; i < hoisted_count; i++) {
+            struct ssa_instruction* check = &body->instructions[hoisted[i]];
+            check->operator = OP_CAST;
+            check->operands[0] = check->operands[1];
+            check->operands[1] = operand_none();
+        }
+    }
+
+    uint32_t count = hoisted_count;
+    free(hoisted);
+    free(arrays);
+    free(reloads);
+    return count;
+}
+
+#pragma endregion
+
+static uint32_t count_checks(struct unit* unit, uint32_t block_count) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < block_count; i++) {
+        for (uint32_t j = 0; j < unit->blocks[i]->instructions_count; j++) {
+            count += unit->blocks[i]->instructions[j].operator == OP_BOUNDS_CHECK;
+        }
+    }
+    return count;
+}
+
+static void resize(struct ranges* ranges, uint32_t register_count) {
+    ranges->register_count = register_count;
+    ranges->tracked = realloc(ranges->tracked, sizeof(bool) * register_count);
+    ranges->definitions = realloc(ranges->definitions, sizeof(struct ssa_instruction*) * register_count);
+    ranges->stored = realloc(ranges->stored, sizeof(struct operand) * register_count);
+    assert(ranges->tracked && ranges->definitions && ranges->stored);
+    find_tracked(ranges);
+    find_definitions(ranges);
+}
+
+void unit_eliminate_bounds_checks(struct unit* unit, FILE* remarks) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return;
+    }
+    // the blocks hoisting adds only hold the checks that replace the ones in loops
+    uint32_t block_count = unit->block_count;
+    uint32_t total = count_checks(unit, block_count);
+    if (total == 0) {
+        return;
+    }
+
+    struct ranges ranges = {};
+    ranges.unit = unit;
+    resize(&ranges, unit_register_count(unit));
+
+    struct block** headers = malloc(sizeof(struct block*) * unit->block_count);
+    assert(headers);
+    uint32_t header_count = unit_loop_headers(unit, headers);
+    uint32_t next_register = ranges.register_count;
+    uint32_t hoisted = 0;
+    for (uint32_t i = 0; i < header_count; i++) {
+        struct loop loop;
+        if (loop_match(unit, headers[i], &loop) == NULL) {
+            hoisted += hoist(&ranges, &loop, &next_register);
+        }
+    }
+    free(headers);
+    // the hoisted checks added blocks and registers
+    if (hoisted > 0) {
+        resize(&ranges, next_register);
+    }
+
+    // every block but the entry starts out knowing everything, and only loses facts as its predecessors are met
+    uint32_t width = ranges.register_count * 2;
+    struct range none = {false, false, BELOW_NONE};
+    struct range all = {true, true, BELOW_ANY};
+    struct range* states = malloc(sizeof(struct range) * width * unit->block_count);
+    bool* reached = calloc(unit->block_count, sizeof(bool));
+    struct range* state = malloc(sizeof(struct range) * width);
+    struct range* edge = malloc(sizeof(struct range) * width);
+    assert(states && reached && state && edge);
+    for (uint32_t i = 0; i < width * unit->block_count; i++) {
+        states[i] = i < width ? none : all;
+    }
+    reached[0] = true;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 0; i < unit->block_count; i++) {
+            if (!reached[i]) {
+                continue;
+            }
+            struct block* block = unit->blocks[i];
+            memcpy(state, states + i * width, sizeof(struct range) * width);
+            transfer(&ranges, block, state, false);
+
+            uint32_t successors[2];
+            uint32_t successor_count = block_successors(unit, block, successors);
+            for (uint32_t j = 0; j < successor_count; j++) {
+                memcpy(edge, state, sizeof(struct range) * width);
+                learn_branch(&ranges, block, j, edge);
+
+                struct range* in = states + successors[j] * width;
+                for (uint32_t k = 0; k < width; k++) {
+                    struct range met = meet(in[k], edge[k]);
+                    if (met.non_negative != in[k].non_negative || met.limited != in[k].limited ||
+                        met.below != in[k].below) {
+                        in[k] = met;
+                        changed = true;
+                    }
+                }
+                if (!reached[successors[j]]) {
+                    reached[successors[j]] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    uint32_t removed = hoisted;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        if (reached[i]) {
+            memcpy(state, states + i * width, sizeof(struct range) * width);
+            uint32_t count = transfer(&ranges, unit->blocks[i], state, true);
+            removed += i < block_count ? count : 0;
+        }
+    }
+    if (remarks != NULL) {
+        fprintf(remarks, "bounds: %s: %u of %u checks removed, %u of them by a test before their loop\n",
+                unit->symbol, removed, total, hoisted);
+    }
+
+    free(states);
+    free(reached);
+    free(state);
+    free(edge);
+    free(ranges.tracked);
+    free(ranges.definitions);
+    free(ranges.stored);
+}
+
+void unit_module_eliminate_bounds_checks(struct unit_module* module, FILE* remarks) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_eliminate_bounds_checks(module->units[i], remarks);
+    }
+}
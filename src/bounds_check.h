@@ -0,0 +1,16 @@
+#ifndef COMPILER_BOUNDS_CHECK_H
+#define COMPILER_BOUNDS_CHECK_H
+#include <stdio.h>
+
+#include "unit.h"
+
+// turns the bounds checks of indices already known to be inside their array into plain moves. an index is known to be
+// inside when it can't be negative and a branch that only goes on while it is below the array's length, or a check of
+// the same index, comes first on every path. a counted loop that counts up by one and indexes an array the loop doesn't
+// change with its induction variable checks the first and the last index once before the loop instead. says how many
+// checks each function lost on remarks, unless it's NULL
+void unit_eliminate_bounds_checks(struct unit* unit, FILE* remarks);
+
+void unit_module_eliminate_bounds_checks(struct unit_module* module, FILE* remarks);
+
+#endif //COMPILER_BOUNDS_CHECK_H
@@ -0,0 +1,351 @@
+#include "const_eval.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+#include "interpreter.h"
+
+// branches and calls a single evaluation may take before it is given up on
+#define CONST_EVAL_FUEL (1 << 24)
+
+static bool constant(struct ssa_type type, union slot value, struct operand* out) {
+    switch (type.type->type) {
+        case AST_NODE_TYPE_BOOL:
+        case AST_NODE_TYPE_I8:
+        case AST_NODE_TYPE_I16:
+        case AST_NODE_TYPE_I32:
+        case AST_NODE_TYPE_I64:
+        case AST_NODE_TYPE_U8:
+        case AST_NODE_TYPE_U16:
+        case AST_NODE_TYPE_U32:
+        case AST_NODE_TYPE_U64:
+            *out = (struct operand){OPERAND_TYPE_INTEGER, type, {.integer = value.u}};
+            return true;
+        case AST_NODE_TYPE_F32:
+            *out = (struct operand){OPERAND_TYPE_FLOAT, type, {.floating = value.f32}};
+            return true;
+        case AST_NODE_TYPE_F64:
+            *out = (struct operand){OPERAND_TYPE_FLOAT, type, {.floating = value.f64}};
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool local(bool* locals, struct operand pointer) {
+    return pointer.type == OPERAND_TYPE_REGISTER && locals[pointer.value.integer];
+}
+
+// true if the unit only touches memory it allocated itself, calls are checked separately
+static bool locally_pure(struct unit* unit) {
+    uint32_t count = unit_register_count(unit);
+    bool* locals = calloc(count + 1, sizeof(bool));
+    assert(locals);
+
+    bool pure = true;
+    for (uint32_t i = 0; i < unit->block_count && pure; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count && pure; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            switch (instruction->operator) {
+                case OP_ALLOC:
+                    locals[instruction->result.value.integer] = true;
+                    break;
+                case OP_CAST:
+                case OP_NULL_CHECK:
+                case OP_FIELD:
+                    if (local(locals, instruction->operands[0])) {
+                        locals[instruction->result.value.integer] = true;
+                    }
+                    break;
+                case OP_LOAD:
+                case OP_STORE:
+                case OP_BOUNDS_CHECK:
+                    pure = local(locals, instruction->operands[0]);
+                    break;
+                case OP_CALL:
+                    pure = instruction->operands[0].type == OPERAND_TYPE_IR;
+                    break;
+                case OP_HEAP_ALLOC:
+                case OP_HEAP_FREE:
+                case OP_HEAP_REALLOC:
+                case OP_REGION_ENTER:
+                case OP_REGION_LEAVE:
+                    pure = false;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    free(locals);
+    return pure;
+}
+
+void unit_module_infer_purity(struct unit_module* module) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        struct unit* unit = module->units[i];
+        unit->pure = unit->type == CHUNK_TYPE_FUNCTION && unit->block_count > 0 && locally_pure(unit);
+    }
+
+    // calling an impure function makes the caller impure, repeat until that stops spreading
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < module->unit_count; i++) {
+            struct unit* unit = module->units[i];
+            for (uint32_t j = 0; j < unit->block_count && unit->pure; j++) {
+                struct block* block = unit->blocks[j];
+                for (uint32_t k = 0; k < block->instructions_count; k++) {
+                    struct ssa_instruction* instruction = &block->instructions[k];
+                    if (instruction->operator == OP_CALL && (instruction->operands[0].type != OPERAND_TYPE_IR ||
+                                                             !instruction->operands[0].value.unit->pure)) {
+                        unit->pure = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+#pragma region folding
+
+struct fold {
+    struct interpreter* interpreter;
+
+    // one instruction units built for evaluation, they can only be freed with the interpreter
+    struct unit** scratch;
+    size_t scratch_count;
+    size_t scratch_capacity;
+};
+
+static bool foldable(struct ssa_instruction* instruction) {
+    switch (instruction->operator) {
+        case OP_CONST:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_BITWISE_AND:
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+        case OP_BITWISE_NOT:
+        case OP_BITWISE_LEFT:
+        case OP_BITWISE_RIGHT:
+        case OP_NEGATE:
+        case OP_NOT:
+        case OP_AND:
+        case OP_OR:
+        case OP_LESS:
+        case OP_LESS_EQUAL:
+        case OP_GREATER:
+        case OP_GREATER_EQUAL:
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_CAST:
+            break;
+        case OP_CALL:
+            if (instruction->operands[0].type != OPERAND_TYPE_IR || !instruction->operands[0].value.unit->pure) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+    }
+    if (instruction->result.type != OPERAND_TYPE_REGISTER) {
+        return false;
+    }
+    for (int i = instruction->operator == OP_CALL ? 1 : 0; i < MAX_OPERANDS; i++) {
+        if (instruction->operands[i].type == OPERAND_TYPE_REGISTER) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// runs a single instruction whose operands are all constant
+static bool fold_evaluate(struct fold* fold, struct ssa_instruction instruction, struct operand* out) {
+    struct unit* scratch = unit_new("_fold", false, CHUNK_TYPE_FUNCTION);
+    scratch->return_type = instruction.result.typename;
+    struct block* block = block_new(true, NULL);
+    unit_add(scratch, block);
+
+    instruction.result = operand_reg(0, instruction.result.typename);
+    block_add(block, instruction);
+
+    struct ssa_instruction ret = {};
+    ret.result = operand_end();
+    ret.operator = OP_RETURN;
+    ret.type = scratch->return_type;
+    ret.operands[0] = instruction.result;
+    block_add(block, ret);
+
+    if (fold->scratch_count >= fold->scratch_capacity) {
+        fold->scratch_capacity *= 2;
+        fold->scratch = realloc(fold->scratch, sizeof(struct unit*) * fold->scratch_capacity);
+        assert(fold->scratch);
+    }
+    fold->scratch[fold->scratch_count++] = scratch;
+
+    union slot result;
+    fold->interpreter->fuel = CONST_EVAL_FUEL;
+    return interpreter_call(fold->interpreter, scratch, NULL, 0, &result) &&
+           constant(scratch->return_type, result, out);
+}
+
+static void fold_unit(struct fold* fold, struct unit* unit) {
+    uint32_t count = unit_register_count(unit);
+    struct operand* known = malloc(sizeof(struct operand) * (count + 1));
+    assert(known);
+    for (uint32_t i = 0; i < count; i++) {
+        known[i] = operand_none();
+    }
+
+    // registers are assigned once, so a constant found for one holds for every later use
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                struct operand operand = instruction->operands[k];
+                if (operand.type == OPERAND_TYPE_REGISTER && known[operand.value.integer].type != OPERAND_TYPE_NONE) {
+                    instruction->operands[k] = known[operand.value.integer];
+                }
+            }
+
+            if (instruction->operator == OP_CONST && instruction->operands[0].type != OPERAND_TYPE_REGISTER) {
+                known[instruction->result.value.integer] = instruction->operands[0];
+                continue;
+            }
+
+            struct operand value;
+            if (!foldable(instruction) || !fold_evaluate(fold, *instruction, &value)) {
+                continue;
+            }
+
+            known[instruction->result.value.integer] = value;
+
+            struct ssa_instruction folded = {};
+            folded.operator = OP_CONST;
+            folded.type = instruction->result.typename;
+            folded.result = instruction->result;
+            folded.operands[0] = value;
+            *instruction = folded;
+        }
+    }
+
+    free(known);
+}
+
+void unit_module_fold(struct unit_module* module) {
+    struct fold fold;
+    fold.interpreter = interpreter_new();
+    fold.interpreter->evaluating = true;
+    fold.scratch = malloc(sizeof(struct unit*));
+    assert(fold.scratch);
+    fold.scratch_count = 0;
+    fold.scratch_capacity = 1;
+
+    for (size_t i = 0; i < module->unit_count; i++) {
+        if (module->units[i]->type == CHUNK_TYPE_FUNCTION) {
+            fold_unit(&fold, module->units[i]);
+        }
+    }
+
+    interpreter_free(fold.interpreter);
+    for (size_t i = 0; i < fold.scratch_count; i++) {
+        unit_free(fold.scratch[i]);
+    }
+    free(fold.scratch);
+}
+
+#pragma endregion
+
+// appends `global = initializer()` to the module initialization unit, creating it on first use
+static struct unit* defer(struct unit_module* module, struct unit* init, struct unit* global, uint32_t* registers) {
+    static struct ast_node void_node = {AST_NODE_TYPE_VOID, {}, NULL, NULL, 0, 0};
+
+    if (init == NULL) {
+        init = unit_new("_init", false, CHUNK_TYPE_FUNCTION);
+        init->return_type = ssa_type_from_ast(NULL, &void_node);
+        unit_add(init, block_new(true, NULL));
+    }
+    struct block* block = init->blocks[0];
+
+    struct ssa_instruction call = {};
+    call.operator = OP_CALL;
+    call.type = global->return_type;
+    call.operands[0] = operand_unit(global->initializer);
+    call.result = operand_reg((*registers)++, global->return_type);
+    block_add(block, call);
+
+    struct ssa_instruction store = {};
+    store.operator = OP_STORE;
+    store.operands[0] = unit_address(global);
+    store.operands[1] = call.result;
+    block_add(block, store);
+
+    // the initializer is now called at runtime so the module owns it
+    unit_module_append(module, global->initializer);
+    global->initializer = NULL;
+    return init;
+}
+
+void unit_module_evaluate(struct unit_module* module) {
+    struct interpreter* interpreter = interpreter_new();
+    interpreter->evaluating = true;
+
+    struct unit* init = NULL;
+    uint32_t registers = 0;
+
+    // initializers that were folded, freed once the interpreter no longer refers to them
+    struct unit** folded = malloc(sizeof(struct unit*) * (module->unit_count + 1));
+    assert(folded);
+    size_t folded_count = 0;
+
+    size_t unit_count = module->unit_count;
+    for (size_t i = 0; i < unit_count; i++) {
+        struct unit* global = module->units[i];
+        if (global->type != CHUNK_TYPE_VARIABLE) {
+            continue;
+        }
+
+        // ZII
+        if (global->initializer == NULL) {
+            constant(global->return_type, (union slot){.u = 0}, &global->value);
+            continue;
+        }
+
+        union slot result;
+        interpreter->fuel = CONST_EVAL_FUEL;
+        if (interpreter_call(interpreter, global->initializer, NULL, 0, &result) &&
+            constant(global->return_type, result, &global->value)) {
+            folded[folded_count++] = global->initializer;
+            global->initializer = NULL;
+            continue;
+        }
+
+        init = defer(module, init, global, &registers);
+    }
+
+    interpreter_free(interpreter);
+    for (size_t i = 0; i < folded_count; i++) {
+        unit_free(folded[i]);
+    }
+    free(folded);
+
+    if (init != NULL) {
+        struct ssa_instruction ret = {};
+        ret.result = operand_end();
+        ret.operator = OP_RETURN;
+        ret.type = init->return_type;
+        block_add(init->blocks[0], ret);
+        unit_module_append(module, init);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef COMPILER_CONST_EVAL_H
+#define COMPILER_CONST_EVAL_H
+
+#include "unit.h"
+
+// marks every function of the module that only reads its arguments and its own frame, and only calls pure functions
+void unit_module_infer_purity(struct unit_module* module);
+
+// replaces calls to pure functions and operators whose operands are all constant with their result
+void unit_module_fold(struct unit_module* module);
+
+// computes the initial value of every global at compile time, globals that can't be computed are
+// zero initialized and filled in by a generated _init unit instead, which has to run before the entry point
+void unit_module_evaluate(struct unit_module* module);
+
+#endif //COMPILER_CONST_EVAL_H
@@ -0,0 +1,368 @@
+#include "devirtualize.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_layout.h"
+#include "block.h"
+#include "loop.h"
+
+// a call through a vtable as ssa_gen lowers it, the method is loaded out of the vtable at its slot and called with the
+// data as this
+struct virtual_call {
+    struct ast_node* abstract;
+    struct ast_node* interface;
+    struct operand table;
+    uint32_t slot;
+    // the method and the address of its slot, dropped once nothing calls through them anymore
+    struct operand method;
+    struct operand address;
+};
+
+struct structs {
+    struct ast_node** items;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+// the interface declaring an abstract method at slot, in scope or the structs nested in it. types are cloned so the
+// abstract is matched by name, an interface found twice is ambiguous and leaves found at NULL
+static void declaring_interface(struct ast_node* scope, size_t first, struct ast_node* abstract, uint32_t slot,
+                                struct ast_node** found, uint32_t* count) {
+    for (size_t i = first; i < scope->children_count; i++) {
+        struct ast_node* child = scope->children[i];
+        if (child->type == AST_NODE_TYPE_INTERFACE) {
+            struct ast_node* abstracts = child->children[INTERFACE_LAYOUT_ABSTRACTS];
+            if (slot < abstracts->children_count && ast_node_same_symbol(abstracts->children[slot], abstract)) {
+                *found = ++*count == 1 ? child : NULL;
+            }
+        } else if (child->type == AST_NODE_TYPE_STRUCT) {
+            declaring_interface(child, STRUCT_LAYOUT_GENERICS + 1, abstract, slot, found, count);
+        }
+    }
+}
+
+static void find_implementors(struct structs* found, struct ast_node* scope, size_t first,
+                              struct ast_node* interface) {
+    for (size_t i = first; i < scope->children_count; i++) {
+        struct ast_node* child = scope->children[i];
+        if (child->type != AST_NODE_TYPE_STRUCT) {
+            continue;
+        }
+        if (!ast_node_is_generic(child) && ast_node_implements(child, interface)) {
+            if (found->count == found->capacity) {
+                found->capacity = found->capacity * 2 + 4;
+                found->items = realloc(found->items, sizeof(struct ast_node*) * found->capacity);
+                assert(found->items);
+            }
+            found->items[found->count++] = child;
+        }
+        find_implementors(found, child, STRUCT_LAYOUT_GENERICS + 1, interface);
+    }
+}
+
+// the instruction really giving operand its value, past the casts ssa_gen puts around words
+static struct ssa_instruction* definition_of(struct unit* unit, struct operand operand) {
+    struct ssa_instruction* definition = unit_definition(unit, operand, NULL);
+    while (definition != NULL && definition->operator == OP_CAST) {
+        definition = unit_definition(unit, definition->operands[0], NULL);
+    }
+    return definition;
+}
+
+static bool match(struct unit* unit, struct ssa_instruction* call, struct ast_module_list* program,
+                  struct virtual_call* out) {
+    if (call->operator != OP_CALL || call->operands[0].type != OPERAND_TYPE_REGISTER) {
+        return false;
+    }
+    struct ssa_instruction* load = unit_definition(unit, call->operands[0], NULL);
+    if (load == NULL || load->operator != OP_LOAD || load->type.type == NULL ||
+        load->type.type->type != AST_NODE_TYPE_ABSTRACT) {
+        return false;
+    }
+    struct ssa_instruction* field = unit_definition(unit, load->operands[0], NULL);
+    if (field == NULL || field->operator != OP_FIELD || field->operands[1].type != OPERAND_TYPE_INTEGER) {
+        return false;
+    }
+
+    out->abstract = load->type.type;
+    out->table = field->operands[0];
+    out->slot = (uint32_t) (field->operands[1].value.integer / sizeof(void*));
+    out->interface = NULL;
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < program->module_count; i++) {
+        declaring_interface(program->modules[i]->symbols, 0, out->abstract, out->slot, &out->interface, &found);
+    }
+    out->method = load->result;
+    out->address = field->result;
+    return out->interface != NULL;
+}
+
+// how many vtables of a struct for an interface the module makes
+static uint32_t vtable_uses(struct unit_module* module, struct ast_node* structure, struct ast_node* interface) {
+    uint32_t uses = 0;
+    for (size_t i = 0; i < module->unit_count; i++) {
+        struct unit* unit = module->units[i];
+        for (uint32_t j = 0; j < unit->block_count; j++) {
+            struct block* block = unit->blocks[j];
+            for (uint32_t k = 0; k < block->instructions_count; k++) {
+                struct ssa_instruction* instruction = &block->instructions[k];
+                if (instruction->operator == OP_VTABLE &&
+                    ast_node_same_symbol(instruction->operands[0].value.vtable->structure, structure) &&
+                    ast_node_same_symbol(instruction->operands[0].value.vtable->interface, interface)) {
+                    uses++;
+                }
+            }
+        }
+    }
+    return uses;
+}
+
+// the call with the struct's own method in place of the one out of the vtable
+static struct ssa_instruction direct(struct ssa_instruction call, struct unit* method) {
+    call.operands[0] = operand_unit(method);
+    call.operands[1].typename = method->arguments[0].typename;
+    return call;
+}
+
+static uint32_t count_uses(struct unit* unit, struct operand reg) {
+    uint32_t uses = 0;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                struct operand operand = block->instructions[j].operands[k];
+                uses += operand.type == OPERAND_TYPE_REGISTER && operand.value.integer == reg.value.integer;
+            }
+        }
+    }
+    return uses;
+}
+
+static void remove_unused(struct unit* unit, struct operand reg) {
+    struct block* block;
+    struct ssa_instruction* definition = unit_definition(unit, reg, &block);
+    if (definition == NULL || count_uses(unit, reg) > 0) {
+        return;
+    }
+    uint32_t index = definition - block->instructions;
+    memmove(definition, definition + 1, sizeof(struct ssa_instruction) * (block->instructions_count - index - 1));
+    block->instructions_count--;
+}
+
+static void prepend(struct block* block, struct ssa_instruction instruction) {
+    block_add(block, instruction);
+    memmove(block->instructions + 1, block->instructions,
+            sizeof(struct ssa_instruction) * (block->instructions_count - 1));
+    block->instructions[0] = instruction;
+}
+
+static void emit_jump(struct block* block, struct block* target) {
+    struct ssa_instruction jump = {};
+    jump.operator = OP_GOTO;
+    jump.result = operand_end();
+    jump.operands[0] = operand_block(target);
+    block_add(block, jump);
+}
+
+// splits the block at the call into a guard comparing the vtable against the struct's, a block calling the struct's
+// method directly, one calling through the vtable and the rest of the block both go on to. the result is passed on
+// through a local like ssa_gen does where paths meet. returns the block calling through the vtable
+static struct block* speculate(struct unit* unit, struct block* block, uint32_t index, struct virtual_call* virtual,
+                               struct unit_vtable* vtable, uint32_t* next_register) {
+    struct ssa_instruction call = block->instructions[index];
+    struct block* fast = block_new(false, block->symbol_table);
+    struct block* slow = block_new(false, block->symbol_table);
+    struct block* rest = block_new(false, block->symbol_table);
+    unit_add(unit, fast);
+    unit_add(unit, slow);
+    unit_add(unit, rest);
+
+    struct operand slot = operand_none();
+    bool value = call.result.type == OPERAND_TYPE_REGISTER && call.type.type != NULL &&
+                 call.type.type->type != AST_NODE_TYPE_VOID;
+    if (value) {
+        struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+        ast_node_append_child(reference, ast_node_clone(call.type.type));
+        struct ssa_instruction local = {};
+        local.operator = OP_ALLOC;
+        local.type = call.type;
+        local.result = operand_reg((*next_register)++, ssa_type_from_ast(call.type.module, reference));
+        local.operands[0] = operand_const_i64((int64_t) call.type.size);
+        prepend(unit->blocks[0], local);
+        slot = local.result;
+        if (unit->blocks[0] == block) {
+            index++;
+        }
+
+        struct ssa_instruction load = {};
+        load.operator = OP_LOAD;
+        load.type = call.type;
+        load.operands[0] = slot;
+        load.result = call.result;
+        block_add(rest, load);
+    }
+    for (uint32_t i = index + 1; i < block->instructions_count; i++) {
+        block_add(rest, block->instructions[i]);
+    }
+    block->instructions_count = index;
+    while (block->children_count > 0) {
+        struct block* child = block->children[0];
+        block_unlink(block, child);
+        block_link(rest, child);
+    }
+
+    struct ssa_instruction callees[2] = {direct(call, vtable->methods[virtual->slot]), call};
+    struct block* paths[2] = {fast, slow};
+    for (int i = 0; i < 2; i++) {
+        struct ssa_instruction path_call = callees[i];
+        if (value) {
+            path_call.result = operand_reg((*next_register)++, call.result.typename);
+            block_add(paths[i], path_call);
+            struct ssa_instruction store = {};
+            store.operator = OP_STORE;
+            store.type = call.type;
+            store.operands[0] = slot;
+            store.operands[1] = path_call.result;
+            block_add(paths[i], store);
+        } else {
+            block_add(paths[i], path_call);
+        }
+        emit_jump(paths[i], rest);
+        block_link(paths[i], rest);
+    }
+
+    struct ssa_instruction expected = {};
+    expected.operator = OP_VTABLE;
+    expected.type = virtual->table.typename;
+    expected.operands[0] = operand_vtable(vtable);
+    expected.result = operand_reg((*next_register)++, expected.type);
+    block_add(block, expected);
+
+    struct ssa_instruction compare = {};
+    compare.operator = OP_EQUAL;
+    compare.type = virtual->table.typename;
+    compare.operands[0] = virtual->table;
+    compare.operands[1] = expected.result;
+    compare.result = operand_reg((*next_register)++, compare.type);
+    block_add(block, compare);
+
+    struct ssa_instruction guard = {};
+    guard.operator = OP_IF;
+    guard.result = operand_end();
+    guard.operands[0] = compare.result;
+    guard.operands[1] = operand_block(fast);
+    guard.operands[2] = operand_block(slow);
+    block_add(block, guard);
+    block_link(block, fast);
+    block_link(block, slow);
+    return slow;
+}
+
+static void remark(FILE* remarks, struct unit* unit, struct virtual_call* virtual, const char* what,
+                   struct ast_node* structure) {
+    if (remarks == NULL) {
+        return;
+    }
+    struct token interface = virtual->interface->children[INTERFACE_LAYOUT_NAME]->token;
+    struct token method = virtual->abstract->children[0]->token;
+    fprintf(remarks, "devirtualize: %s: call of %.*s.%.*s %s", unit->symbol, (int) interface.length, interface.start,
+            (int) method.length, method.start, what);
+    if (structure != NULL) {
+        struct token name = structure->children[STRUCT_LAYOUT_NAME]->token;
+        fprintf(remarks, " %.*s", (int) name.length, name.start);
+    }
+    fprintf(remarks, "\n");
+}
+
+void unit_devirtualize(struct unit_module* module, struct unit* unit, struct ast_module_list* program, FILE* remarks) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return;
+    }
+    uint32_t next_register = unit_register_count(unit);
+    // the calls left going through the vtable behind a guard, they aren't looked at again
+    struct block** slow = malloc(sizeof(struct block*) * (unit->block_count + 1));
+    uint32_t slow_count = 0;
+    uint32_t slow_capacity = unit->block_count + 1;
+    assert(slow);
+
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        bool guarded = false;
+        for (uint32_t j = 0; j < slow_count && !guarded; j++) {
+            guarded = slow[j] == block;
+        }
+        for (uint32_t j = 0; j < block->instructions_count && !guarded; j++) {
+            struct ssa_instruction* call = &block->instructions[j];
+            struct virtual_call virtual;
+            if (!match(unit, call, program, &virtual)) {
+                continue;
+            }
+
+            // the vtable the unit made itself is the one it calls through
+            struct ssa_instruction* table = definition_of(unit, virtual.table);
+            if (table != NULL && table->operator == OP_VTABLE) {
+                struct unit_vtable* vtable = table->operands[0].value.vtable;
+                *call = direct(*call, vtable->methods[virtual.slot]);
+                remark(remarks, unit, &virtual, "made direct, the data is always a", vtable->structure);
+                remove_unused(unit, virtual.method);
+                remove_unused(unit, virtual.address);
+                j = UINT32_MAX;
+                continue;
+            }
+
+            struct structs implementors = {};
+            for (uint32_t k = 0; k < program->module_count; k++) {
+                find_implementors(&implementors, program->modules[k]->symbols, 0, virtual.interface);
+            }
+            struct ast_node* likely = NULL;
+            uint32_t likely_uses = 0;
+            for (uint32_t k = 0; k < implementors.count; k++) {
+                uint32_t uses = vtable_uses(module, implementors.items[k], virtual.interface);
+                if (likely == NULL || uses > likely_uses) {
+                    likely = implementors.items[k];
+                    likely_uses = uses;
+                }
+            }
+            uint32_t count = implementors.count;
+            free(implementors.items);
+
+            struct unit_vtable* vtable = likely != NULL ? unit_module_vtable(module, likely, virtual.interface) : NULL;
+            if (vtable == NULL || vtable->methods[virtual.slot] == NULL) {
+                remark(remarks, unit, &virtual, "left indirect, its implementations are outside of this module",
+                       NULL);
+                continue;
+            }
+            if (count == 1) {
+                *call = direct(*call, vtable->methods[virtual.slot]);
+                remark(remarks, unit, &virtual, "made direct, the only struct implementing it is", likely);
+                remove_unused(unit, virtual.method);
+                remove_unused(unit, virtual.address);
+                j = UINT32_MAX;
+                continue;
+            }
+            if (likely_uses == 0 || block_terminator(block) == NULL) {
+                remark(remarks, unit, &virtual, "left indirect, no struct is likelier than the others", NULL);
+                continue;
+            }
+
+            if (slow_count == slow_capacity) {
+                slow_capacity *= 2;
+                slow = realloc(slow, sizeof(struct block*) * slow_capacity);
+                assert(slow);
+            }
+            slow[slow_count++] = speculate(unit, block, j, &virtual, vtable, &next_register);
+            remark(remarks, unit, &virtual, "guarded on the most common vtable, of", likely);
+            // the rest of the block moved into a block of its own, which comes up later
+            break;
+        }
+    }
+    free(slow);
+}
+
+void unit_module_devirtualize(struct unit_module* module, struct ast_module_list* program, FILE* remarks) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_devirtualize(module, module->units[i], program, remarks);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef COMPILER_DEVIRTUALIZE_H
+#define COMPILER_DEVIRTUALIZE_H
+#include <stdio.h>
+
+#include "ast_module.h"
+#include "unit.h"
+
+// turns calls through vtables into calls of the struct's own method. when the vtable is one the unit made itself, or
+// only one struct of the whole program implements the interface, the call is made direct. otherwise the call is
+// guarded on the struct whose vtable the module makes the most, calling its method directly when the vtable is that
+// one and through the vtable when it isn't. says what happened to each call on remarks, unless it's NULL
+void unit_devirtualize(struct unit_module* module, struct unit* unit, struct ast_module_list* program, FILE* remarks);
+
+void unit_module_devirtualize(struct unit_module* module, struct ast_module_list* program, FILE* remarks);
+
+#endif //COMPILER_DEVIRTUALIZE_H
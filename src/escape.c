@@ -0,0 +1,290 @@
+#include "escape.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alias.h"
+#include "ast.h"
+#include "block.h"
+#include "loop.h"
+
+// what the functions of a module do with the pointers they are passed. starts out assuming no argument escapes, each
+// one found can only make more escape through the calls passing it on, until none does
+struct escape {
+    struct unit_module* module;
+    // per unit, NULL for units that aren't functions with a body
+    struct alias_analysis** aliases;
+    // per unit, true for each argument whose pointer may outlive the call
+    bool** arguments;
+};
+
+static bool is_pointer(struct ssa_type type) {
+    return type.type != NULL &&
+           (type.type->type == AST_NODE_TYPE_POINTER || type.type->type == AST_NODE_TYPE_REFERENCE);
+}
+
+static bool same_base(struct alias_base a, struct alias_base b) {
+    return a.kind == b.kind && a.index == b.index && a.offset == b.offset;
+}
+
+static bool call_captures(struct escape* escape, struct ssa_instruction* call, uint32_t argument) {
+    if (call->operands[0].type != OPERAND_TYPE_IR) {
+        return true;
+    }
+    struct unit* callee = call->operands[0].value.unit;
+    for (size_t i = 0; i < escape->module->unit_count; i++) {
+        if (escape->module->units[i] == callee) {
+            return argument >= callee->argument_count || escape->arguments[i][argument];
+        }
+    }
+    return true;
+}
+
+// true if the pointer in an operand of the instruction may outlive the call because of it
+static bool captures(struct escape* escape, struct alias_analysis* aliases, struct ssa_instruction* instruction,
+                     int operand) {
+    struct alias_base base = alias_base(aliases, instruction->operands[operand]);
+    switch (instruction->operator) {
+        case OP_LOAD:
+        case OP_NULL_CHECK:
+        case OP_BOUNDS_CHECK:
+        case OP_FIELD:
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+            return false;
+        case OP_CAST:
+            return !is_pointer(instruction->result.typename);
+        case OP_HEAP_FREE:
+            // only memory the unit allocated itself can have its free removed along with it
+            return base.kind != ALIAS_BASE_HEAP;
+        case OP_STORE: {
+            if (operand == 0) {
+                return false;
+            }
+            // kept in a local the analysis follows, whatever loads it again gets the same base and is checked too
+            struct alias_base target = alias_base(aliases, instruction->operands[0]);
+            return target.kind != ALIAS_BASE_LOCAL || aliases->escaped[target.index] ||
+                   !same_base(aliases->contents[target.index], base);
+        }
+        case OP_CALL:
+            return operand > 0 && call_captures(escape, instruction, operand - 1);
+        default:
+            return true;
+    }
+}
+
+// marks the heap allocs and arguments that have a pointer derived from them escape, one entry per register
+static void find_captured(struct escape* escape, size_t index, bool* captured) {
+    struct unit* unit = escape->module->units[index];
+    struct alias_analysis* aliases = escape->aliases[index];
+    memset(captured, 0, sizeof(bool) * aliases->register_count);
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                if (instruction->operands[k].type != OPERAND_TYPE_REGISTER) {
+                    continue;
+                }
+                struct alias_base base = alias_base(aliases, instruction->operands[k]);
+                if ((base.kind == ALIAS_BASE_HEAP || base.kind == ALIAS_BASE_ARGUMENT) &&
+                    captures(escape, aliases, instruction, k)) {
+                    captured[base.index] = true;
+                }
+            }
+        }
+    }
+}
+
+static bool summarize(struct escape* escape, size_t index) {
+    struct unit* unit = escape->module->units[index];
+    if (escape->aliases[index] == NULL) {
+        return false;
+    }
+    bool* captured = calloc(escape->aliases[index]->register_count + 1, sizeof(bool));
+    assert(captured);
+    find_captured(escape, index, captured);
+
+    bool changed = false;
+    for (uint32_t i = 0; i < unit->argument_count; i++) {
+        struct operand argument = unit->arguments[i];
+        if (!escape->arguments[index][i] && argument.type == OPERAND_TYPE_REGISTER &&
+            argument.value.integer < escape->aliases[index]->register_count && captured[argument.value.integer]) {
+            escape->arguments[index][i] = true;
+            changed = true;
+        }
+    }
+    free(captured);
+    return changed;
+}
+
+// true if control can come back to a block after leaving it
+static bool in_cycle(struct unit* unit, uint32_t start) {
+    bool* visited = calloc(unit->block_count, sizeof(bool));
+    uint32_t* stack = malloc(sizeof(uint32_t) * (unit->block_count + 2));
+    assert(visited && stack);
+
+    uint32_t top = 0;
+    uint32_t successors[2];
+    uint32_t count = block_successors(unit, unit->blocks[start], successors);
+    for (uint32_t i = 0; i < count; i++) {
+        stack[top++] = successors[i];
+    }
+    bool cycle = false;
+    while (top > 0 && !cycle) {
+        uint32_t current = stack[--top];
+        if (visited[current]) {
+            continue;
+        }
+        visited[current] = true;
+        cycle = current == start;
+        count = block_successors(unit, unit->blocks[current], successors);
+        for (uint32_t i = 0; i < count; i++) {
+            if (!visited[successors[i]]) {
+                stack[top++] = successors[i];
+            }
+        }
+    }
+
+    free(stack);
+    free(visited);
+    return cycle;
+}
+
+static const char* promotable(struct unit* unit, uint32_t block, struct ssa_instruction* instruction, bool* captured) {
+    struct operand size = instruction->operands[0];
+    if (size.type != OPERAND_TYPE_INTEGER) {
+        return "its size isn't constant";
+    }
+    if (size.value.integer > PROMOTE_LIMIT) {
+        return "it is too large";
+    }
+    if (captured[instruction->result.value.integer]) {
+        return "its address escapes";
+    }
+    if (in_cycle(unit, block)) {
+        return "it is in a loop";
+    }
+    return NULL;
+}
+
+static void prepend(struct block* block, struct ssa_instruction instruction) {
+    block_add(block, instruction);
+    memmove(block->instructions + 1, block->instructions,
+            sizeof(struct ssa_instruction) * (block->instructions_count - 1));
+    block->instructions[0] = instruction;
+}
+
+static void promote(struct escape* escape, size_t index, FILE* remarks) {
+    struct unit* unit = escape->module->units[index];
+    struct alias_analysis* aliases = escape->aliases[index];
+    bool* captured = calloc(aliases->register_count + 1, sizeof(bool));
+    bool* promoted = calloc(aliases->register_count + 1, sizeof(bool));
+    assert(captured && promoted);
+    find_captured(escape, index, captured);
+
+    uint32_t promotions = 0;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator != OP_HEAP_ALLOC) {
+                continue;
+            }
+            const char* reason = promotable(unit, i, instruction, captured);
+            if (reason == NULL) {
+                promoted[instruction->result.value.integer] = true;
+                promotions++;
+            }
+            if (remarks == NULL) {
+                continue;
+            }
+            fprintf(remarks, "escape: %s: heap alloc at block %u ", unit->symbol, block->id);
+            if (reason != NULL) {
+                fprintf(remarks, "not promoted: %s\n", reason);
+            } else {
+                fprintf(remarks, "promoted to the stack\n");
+            }
+        }
+    }
+
+    // the alloc moves to the entry block with the unit's other locals, the memory is zeroed just the same. decided
+    // against the analysis of the unit as it was, so every free is looked at before the unit changes
+    struct ssa_instruction* locals = malloc(sizeof(struct ssa_instruction) * (promotions + 1));
+    assert(locals);
+    uint32_t local_count = 0;
+    for (uint32_t i = 0; i < unit->block_count && promotions > 0; i++) {
+        struct block* block = unit->blocks[i];
+        uint32_t kept = 0;
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction instruction = block->instructions[j];
+            if (instruction.operator == OP_HEAP_ALLOC && promoted[instruction.result.value.integer]) {
+                instruction.operator = OP_ALLOC;
+                instruction.operands[1] = operand_none();
+                if (is_pointer(instruction.type)) {
+                    instruction.type = ssa_type_from_ast(instruction.type.module, instruction.type.type->children[0]);
+                }
+                locals[local_count++] = instruction;
+                continue;
+            }
+            if (instruction.operator == OP_HEAP_FREE) {
+                struct alias_base base = alias_base(aliases, instruction.operands[0]);
+                if (base.kind == ALIAS_BASE_HEAP && promoted[base.index]) {
+                    continue;
+                }
+            }
+            block->instructions[kept++] = instruction;
+        }
+        block->instructions_count = kept;
+    }
+    for (uint32_t i = 0; i < local_count; i++) {
+        prepend(unit->blocks[0], locals[i]);
+    }
+
+    free(locals);
+    free(promoted);
+    free(captured);
+}
+
+void unit_module_promote_allocations(struct unit_module* module, FILE* remarks) {
+    struct escape escape = {};
+    escape.module = module;
+    escape.aliases = calloc(module->unit_count + 1, sizeof(struct alias_analysis*));
+    escape.arguments = malloc(sizeof(bool*) * (module->unit_count + 1));
+    assert(escape.aliases && escape.arguments);
+
+    for (size_t i = 0; i < module->unit_count; i++) {
+        struct unit* unit = module->units[i];
+        escape.arguments[i] = calloc(unit->argument_count + 1, sizeof(bool));
+        assert(escape.arguments[i]);
+        if (unit->type == CHUNK_TYPE_FUNCTION && unit->block_count > 0) {
+            escape.aliases[i] = alias_analysis_new(unit);
+        } else {
+            // nothing is known about what a function without a body does with its arguments
+            memset(escape.arguments[i], true, sizeof(bool) * unit->argument_count);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < module->unit_count; i++) {
+            changed |= summarize(&escape, i);
+        }
+    }
+
+    for (size_t i = 0; i < module->unit_count; i++) {
+        if (escape.aliases[i] != NULL) {
+            promote(&escape, i, remarks);
+        }
+    }
+    for (size_t i = 0; i < module->unit_count; i++) {
+        if (escape.aliases[i] != NULL) {
+            alias_analysis_free(escape.aliases[i]);
+        }
+        free(escape.arguments[i]);
+    }
+    free(escape.aliases);
+    free(escape.arguments);
+}
@@ -0,0 +1,17 @@
+#ifndef COMPILER_ESCAPE_H
+#define COMPILER_ESCAPE_H
+#include <stdio.h>
+
+#include "unit.h"
+
+// largest heap alloc that is moved to the frame, in bytes
+#define PROMOTE_LIMIT 4096
+
+// finds the heap allocs whose memory can't outlive the call that made them and gives them a local instead, their frees
+// go away with them. memory escapes when a pointer to it is returned, stored anywhere but a local the unit follows,
+// freed by someone else or passed to a function that lets its argument escape, which is worked out for every function
+// of the module first. allocs in a loop stay on the heap, every trip would need its own local. says what happened to
+// each heap alloc on remarks, unless it's NULL
+void unit_module_promote_allocations(struct unit_module* module, FILE* remarks);
+
+#endif //COMPILER_ESCAPE_H
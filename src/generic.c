@@ -0,0 +1,380 @@
+#include "generic.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_layout.h"
+
+#pragma region keys
+
+struct buffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+static void buffer_append(struct buffer* buffer, const char* text, size_t length) {
+    if (buffer->length + length + 1 > buffer->capacity) {
+        buffer->capacity = (buffer->length + length + 1) * 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        assert(buffer->data);
+    }
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void buffer_append_token(struct buffer* buffer, struct token token) {
+    buffer_append(buffer, token.start, token.length);
+}
+
+// the type as it is written, struct instances are named after their arguments already
+static void mangle(struct buffer* buffer, struct ast_node* type) {
+    size_t length = ast_node_mangle(type, NULL, 0);
+    char* text = malloc(length + 1);
+    assert(text);
+    ast_node_mangle(type, text, length + 1);
+    buffer_append(buffer, text, length);
+    free(text);
+}
+
+static uint64_t hash(const char* key) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (; *key != '\0'; key++) {
+        hash = (hash ^ (uint8_t) *key) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static size_t slot_of(struct generic_cache* cache, const char* key) {
+    size_t slot = hash(key) & (cache->entry_capacity - 1);
+    while (cache->entries[slot] != NULL && strcmp(cache->entries[slot]->key, key) != 0) {
+        slot = (slot + 1) & (cache->entry_capacity - 1);
+    }
+    return slot;
+}
+
+static void cache_add(struct generic_cache* cache, struct generic_instance* instance) {
+    if ((cache->entry_count + 1) * 4 > cache->entry_capacity * 3) {
+        struct generic_instance** old = cache->entries;
+        size_t old_capacity = cache->entry_capacity;
+        cache->entry_capacity = old_capacity * 2;
+        cache->entries = calloc(cache->entry_capacity, sizeof(struct generic_instance*));
+        assert(cache->entries);
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i] != NULL) {
+                cache->entries[slot_of(cache, old[i]->key)] = old[i];
+            }
+        }
+        free(old);
+    }
+    cache->entries[slot_of(cache, instance->key)] = instance;
+    cache->entry_count++;
+
+    if (cache->instance_count == cache->instance_capacity) {
+        cache->instance_capacity *= 2;
+        cache->instances = realloc(cache->instances, sizeof(struct generic_instance*) * cache->instance_capacity);
+        assert(cache->instances);
+    }
+    cache->instances[cache->instance_count++] = instance;
+}
+
+// the instance going by name in the module, generics are only seen from the module they are declared in
+static struct generic_instance* named_instance(struct generic_cache* cache, struct ast_module* module,
+                                               struct token name) {
+    if (name.length == 0 || memchr(name.start, '<', name.length) == NULL) {
+        return NULL;
+    }
+    struct buffer key = {};
+    buffer_append(&key, module->name, strlen(module->name));
+    buffer_append(&key, ".", 1);
+    buffer_append_token(&key, name);
+    struct generic_instance* instance = cache->entries[slot_of(cache, key.data)];
+    free(key.data);
+    return instance;
+}
+
+#pragma endregion
+
+struct generic_cache* generic_cache_new(void) {
+    struct generic_cache* cache = malloc(sizeof(struct generic_cache));
+    assert(cache);
+    cache->generic_count = 0;
+    cache->generic_capacity = 1;
+    cache->generics = malloc(sizeof(struct generic*));
+    assert(cache->generics);
+    cache->entry_count = 0;
+    cache->entry_capacity = 16;
+    cache->entries = calloc(cache->entry_capacity, sizeof(struct generic_instance*));
+    assert(cache->entries);
+    cache->instance_count = 0;
+    cache->instance_capacity = 1;
+    cache->instances = malloc(sizeof(struct generic_instance*));
+    assert(cache->instances);
+    return cache;
+}
+
+void generic_cache_free(struct generic_cache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cache->instance_count; i++) {
+        free(cache->instances[i]->key);
+        free(cache->instances[i]->arguments);
+        free(cache->instances[i]);
+    }
+    for (size_t i = 0; i < cache->generic_count; i++) {
+        free(cache->generics[i]);
+    }
+    free(cache->instances);
+    free(cache->entries);
+    free(cache->generics);
+    free(cache);
+}
+
+struct generic* generic_declare(struct generic_cache* cache, struct ast_module* module, struct ast_node* symbol,
+                                struct ast_node* parameters) {
+    struct generic* generic = malloc(sizeof(struct generic));
+    assert(generic);
+    generic->module = module;
+    generic->symbol = symbol;
+    generic->parameters = parameters;
+    generic->bodies = ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null);
+
+    if (cache->generic_count == cache->generic_capacity) {
+        cache->generic_capacity *= 2;
+        cache->generics = realloc(cache->generics, sizeof(struct generic*) * cache->generic_capacity);
+        assert(cache->generics);
+    }
+    cache->generics[cache->generic_count++] = generic;
+    return generic;
+}
+
+struct generic* generic_find(struct generic_cache* cache, struct ast_node* symbol) {
+    for (size_t i = 0; i < cache->generic_count; i++) {
+        if (cache->generics[i]->symbol == symbol) {
+            return cache->generics[i];
+        }
+    }
+    return NULL;
+}
+
+struct ast_node* generic_parameter(struct ast_node* parameters, struct token name) {
+    for (size_t i = 0; i < parameters->children_count; i++) {
+        struct token parameter = parameters->children[i]->token;
+        if (parameter.length == name.length && memcmp(parameter.start, name.start, name.length) == 0) {
+            return parameters->children[i];
+        }
+    }
+    return NULL;
+}
+
+static bool is_dependent(struct generic_cache* cache, struct ast_module* module, struct ast_node* type) {
+    if (type->type == AST_NODE_TYPE_GENERIC) {
+        return true;
+    }
+    if (type->type == AST_NODE_TYPE_STRUCT || type->type == AST_NODE_TYPE_INTERFACE) {
+        struct generic_instance* instance = named_instance(cache, module, type->children[0]->token);
+        return instance != NULL && instance->dependent;
+    }
+    for (size_t i = 0; i < type->children_count; i++) {
+        if (is_dependent(cache, module, type->children[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static struct ast_node* new_symbol(enum ast_node_type type, struct token token, struct token name) {
+    struct ast_node* symbol = ast_node_new(type, token);
+    ast_node_append_child(symbol, ast_node_new(AST_NODE_TYPE_NAME, name));
+    return symbol;
+}
+
+struct generic_instance* generic_instantiate(struct generic_cache* cache, struct generic* generic,
+                                             struct ast_node** arguments, size_t argument_count) {
+    if (argument_count != generic->parameters->children_count) {
+        return NULL;
+    }
+    struct buffer key = {};
+    buffer_append(&key, generic->module->name, strlen(generic->module->name));
+    buffer_append(&key, ".", 1);
+    size_t name_start = key.length;
+    buffer_append_token(&key, generic->symbol->children[0]->token);
+    buffer_append(&key, "<", 1);
+    for (size_t i = 0; i < argument_count; i++) {
+        if (i > 0) {
+            buffer_append(&key, ",", 1);
+        }
+        mangle(&key, arguments[i]);
+    }
+    buffer_append(&key, ">", 1);
+
+    struct generic_instance* cached = cache->entries[slot_of(cache, key.data)];
+    if (cached != NULL) {
+        free(key.data);
+        return cached;
+    }
+
+    struct generic_instance* instance = calloc(1, sizeof(struct generic_instance));
+    assert(instance);
+    instance->key = key.data;
+    instance->name = (struct token) {TOKEN_TYPE_IDENTIFIER, key.data + name_start, key.length - name_start,
+                                     generic->symbol->children[0]->token.line};
+    instance->generic = generic;
+    instance->arguments = malloc(sizeof(struct ast_node*) * (argument_count + 1));
+    assert(instance->arguments);
+    instance->argument_count = argument_count;
+    for (size_t i = 0; i < argument_count; i++) {
+        instance->arguments[i] = arguments[i];
+        instance->dependent |= is_dependent(cache, generic->module, arguments[i]);
+    }
+
+    if (generic->symbol->type == AST_NODE_TYPE_STRUCT) {
+        struct ast_node* structure = new_symbol(AST_NODE_TYPE_STRUCT, generic->symbol->token, instance->name);
+        ast_node_append_child(structure, ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null));
+        ast_node_append_child(structure, ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null));
+        ast_node_append_child(structure, ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null));
+        ast_node_append_child(structure, ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null));
+        instance->symbol = structure;
+        if (!instance->dependent) {
+            ast_module_add_symbol(generic->module, structure);
+        }
+    }
+    cache_add(cache, instance);
+    return instance;
+}
+
+#pragma region lowering
+
+static struct ast_node* substitute(struct generic_cache* cache, struct generic_instance* instance,
+                                   struct ast_node* node);
+
+// a copy of a type, the structs and interfaces it names are the symbols themselves like the parser makes them
+static struct ast_node* copy_type(struct ast_node* type) {
+    if (type->type == AST_NODE_TYPE_STRUCT || type->type == AST_NODE_TYPE_INTERFACE) {
+        return type;
+    }
+    struct ast_node* copy = ast_node_new(type->type, type->token);
+    for (size_t i = 0; i < type->children_count; i++) {
+        ast_node_append_child(copy, copy_type(type->children[i]));
+    }
+    return copy;
+}
+
+// a dependent instance used inside the generic being instantiated, with its parameters replaced by the arguments
+static struct generic_instance* resolve(struct generic_cache* cache, struct generic_instance* instance,
+                                        struct generic_instance* dependent) {
+    struct ast_node** arguments = malloc(sizeof(struct ast_node*) * (dependent->argument_count + 1));
+    assert(arguments);
+    for (size_t i = 0; i < dependent->argument_count; i++) {
+        arguments[i] = substitute(cache, instance, dependent->arguments[i]);
+    }
+    struct generic_instance* resolved = generic_instantiate(cache, dependent->generic, arguments,
+                                                            dependent->argument_count);
+    free(arguments);
+    return resolved;
+}
+
+// a copy of a declaration or body of the generic with its type parameters replaced by the instance's arguments
+static struct ast_node* substitute(struct generic_cache* cache, struct generic_instance* instance,
+                                   struct ast_node* node) {
+    struct ast_module* module = instance->generic->module;
+    switch (node->type) {
+        case AST_NODE_TYPE_GENERIC: {
+            struct ast_node* parameters = instance->generic->parameters;
+            for (size_t i = 0; i < parameters->children_count; i++) {
+                struct token name = parameters->children[i]->token;
+                if (name.length == node->token.length && memcmp(name.start, node->token.start, name.length) == 0) {
+                    return copy_type(instance->arguments[i]);
+                }
+            }
+            return ast_node_clone(node);
+        }
+        case AST_NODE_TYPE_STRUCT:
+        case AST_NODE_TYPE_INTERFACE: {
+            struct generic_instance* dependent = named_instance(cache, module, node->children[0]->token);
+            if (dependent != NULL && dependent->dependent) {
+                return resolve(cache, instance, dependent)->symbol;
+            }
+            return node;
+        }
+        case AST_NODE_TYPE_NAME: {
+            // the name of a generic function or struct used with the parameters as arguments
+            struct generic_instance* dependent = named_instance(cache, module, node->token);
+            if (dependent != NULL && dependent->dependent) {
+                return ast_node_new(AST_NODE_TYPE_NAME, resolve(cache, instance, dependent)->name);
+            }
+            return ast_node_new(AST_NODE_TYPE_NAME, node->token);
+        }
+        default: {
+            struct ast_node* copy = ast_node_new(node->type, node->token);
+            for (size_t i = 0; i < node->children_count; i++) {
+                ast_node_append_child(copy, substitute(cache, instance, node->children[i]));
+            }
+            return copy;
+        }
+    }
+}
+
+static void implement(struct generic_instance* instance, struct ast_node* symbol, struct ast_node* body) {
+    struct ast_node* implementation = ast_node_new(AST_NODE_TYPE_IMPLEMENTATION, token_null);
+    ast_node_append_child(implementation, symbol);
+    ast_node_append_child(implementation, body);
+    ast_node_append_child(instance->generic->module->root, implementation);
+}
+
+static void lower_function(struct generic_cache* cache, struct generic_instance* instance) {
+    struct generic* generic = instance->generic;
+    struct ast_node* function = new_symbol(generic->symbol->type, generic->symbol->token, instance->name);
+    ast_node_append_child(function, substitute(cache, instance, generic->symbol->children[FUNCTION_LAYOUT_RETURN]));
+    ast_node_append_child(function, substitute(cache, instance, generic->symbol->children[FUNCTION_LAYOUT_ARGS]));
+    instance->symbol = function;
+    ast_module_add_symbol(generic->module, function);
+
+    for (size_t i = 0; i < generic->bodies->children_count; i++) {
+        implement(instance, function, substitute(cache, instance, generic->bodies->children[i]->children[1]));
+    }
+}
+
+static void lower_struct(struct generic_cache* cache, struct generic_instance* instance) {
+    struct generic* generic = instance->generic;
+    struct ast_node* structure = instance->symbol;
+    struct ast_node* implements = generic->symbol->children[STRUCT_LAYOUT_IMPLEMENTS];
+    for (size_t i = 0; i < implements->children_count; i++) {
+        ast_node_append_child(structure->children[STRUCT_LAYOUT_IMPLEMENTS], implements->children[i]);
+    }
+    enum struct_layout sections[] = {STRUCT_LAYOUT_MEMBERS, STRUCT_LAYOUT_STATICS};
+    for (size_t i = 0; i < 2; i++) {
+        struct ast_node* members = generic->symbol->children[sections[i]];
+        for (size_t j = 0; j < members->children_count; j++) {
+            ast_node_append_child(structure->children[sections[i]], substitute(cache, instance, members->children[j]));
+        }
+    }
+
+    for (size_t i = 0; i < generic->bodies->children_count; i++) {
+        struct ast_node* implementation = generic->bodies->children[i];
+        struct ast_node* method = ast_node_struct_method(structure, implementation->children[0]->children[0]->token);
+        implement(instance, method, substitute(cache, instance, implementation->children[1]));
+    }
+}
+
+void generic_cache_lower(struct generic_cache* cache) {
+    // lowering an instance can add the ones its body uses to the end
+    for (size_t i = 0; i < cache->instance_count; i++) {
+        struct generic_instance* instance = cache->instances[i];
+        if (instance->dependent || instance->lowered) {
+            continue;
+        }
+        instance->lowered = true;
+        if (instance->generic->symbol->type == AST_NODE_TYPE_STRUCT) {
+            lower_struct(cache, instance);
+        } else {
+            lower_function(cache, instance);
+        }
+    }
+}
+
+#pragma endregion
@@ -0,0 +1,77 @@
+#ifndef COMPILER_GENERIC_H
+#define COMPILER_GENERIC_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ast.h"
+#include "ast_module.h"
+
+// a generic struct or function as it is declared, its types name its parameters
+struct generic {
+    struct ast_module* module;
+    struct ast_node* symbol;
+    // the GENERIC nodes standing in for its type arguments
+    struct ast_node* parameters;
+    // the implementations of the function or of the struct's methods, kept out of the module's tree since only the
+    // instances are lowered
+    struct ast_node* bodies;
+};
+
+// a generic with its type arguments. there is one for the whole program however many modules and places use it, and
+// it is lowered once, into the module the generic is declared in
+struct generic_instance {
+    // the module of the generic, its name and its arguments, interned so an instance is looked up by it alone
+    char* key;
+    // the name the instance goes by, the key without the module
+    struct token name;
+    struct generic* generic;
+    struct ast_node** arguments;
+    size_t argument_count;
+    // the struct or function the instance declares. a struct's is there from the start for types to point at, its
+    // members are filled in once it is lowered
+    struct ast_node* symbol;
+    // an argument is still a type parameter, of the generic the instance is used in. only the instances it turns into
+    // once that one is instantiated are lowered
+    bool dependent;
+    bool lowered;
+};
+
+// open addressing on the key, the capacity is a power of two
+struct generic_cache {
+    struct generic** generics;
+    size_t generic_count;
+    size_t generic_capacity;
+
+    struct generic_instance** entries;
+    size_t entry_count;
+    size_t entry_capacity;
+
+    // the instances in the order they were made, lowering one can make more
+    struct generic_instance** instances;
+    size_t instance_count;
+    size_t instance_capacity;
+};
+
+struct generic_cache* generic_cache_new(void);
+
+void generic_cache_free(struct generic_cache* cache);
+
+struct generic* generic_declare(struct generic_cache* cache, struct ast_module* module, struct ast_node* symbol,
+                                struct ast_node* parameters);
+
+// the generic a struct or function was declared as, NULL if it isn't one
+struct generic* generic_find(struct generic_cache* cache, struct ast_node* symbol);
+
+// the type parameter of the generic called name, NULL if there is none
+struct ast_node* generic_parameter(struct ast_node* parameters, struct token name);
+
+// the instance of a generic for its type arguments, made the first time it is asked for. NULL if there are more or
+// fewer arguments than the generic has parameters
+struct generic_instance* generic_instantiate(struct generic_cache* cache, struct generic* generic,
+                                             struct ast_node** arguments, size_t argument_count);
+
+// gives every instance that isn't dependent its members and the implementations of its functions, adding them to the
+// module the generic is declared in. the instances those use are lowered as well
+void generic_cache_lower(struct generic_cache* cache);
+
+#endif //COMPILER_GENERIC_H
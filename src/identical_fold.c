@@ -0,0 +1,236 @@
+#include "identical_fold.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+
+// what the instructions do with a value, beyond its size
+enum value_class {
+    VALUE_CLASS_OTHER,
+    VALUE_CLASS_SIGNED,
+    VALUE_CLASS_UNSIGNED,
+    VALUE_CLASS_FLOAT,
+    VALUE_CLASS_ADDRESS,
+};
+
+static enum value_class value_class(struct ast_node* type) {
+    switch (type->type) {
+        case AST_NODE_TYPE_I8:
+        case AST_NODE_TYPE_I16:
+        case AST_NODE_TYPE_I32:
+        case AST_NODE_TYPE_I64:
+            return VALUE_CLASS_SIGNED;
+        case AST_NODE_TYPE_BOOL:
+        case AST_NODE_TYPE_U8:
+        case AST_NODE_TYPE_U16:
+        case AST_NODE_TYPE_U32:
+        case AST_NODE_TYPE_U64:
+            return VALUE_CLASS_UNSIGNED;
+        case AST_NODE_TYPE_F32:
+        case AST_NODE_TYPE_F64:
+            return VALUE_CLASS_FLOAT;
+        case AST_NODE_TYPE_POINTER:
+        case AST_NODE_TYPE_REFERENCE:
+            return VALUE_CLASS_ADDRESS;
+        default:
+            return VALUE_CLASS_OTHER;
+    }
+}
+
+static bool same_tree(struct ast_node* a, struct ast_node* b) {
+    if (a->type != b->type || a->children_count != b->children_count) {
+        return false;
+    }
+    if (a->type == AST_NODE_TYPE_STRUCT || a->type == AST_NODE_TYPE_INTERFACE) {
+        return ast_node_same_symbol(a, b);
+    }
+    if (a->children_count == 0) {
+        return a->token.length == b->token.length && memcmp(a->token.start, b->token.start, a->token.length) == 0;
+    }
+    for (size_t i = 0; i < a->children_count; i++) {
+        if (!same_tree(a->children[i], b->children[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// an address is the same whatever it points to, only a store through it is sized by that
+static bool same_type(struct ssa_type a, struct ssa_type b) {
+    if (a.size != b.size) {
+        return false;
+    }
+    if (a.type == NULL || b.type == NULL) {
+        return a.type == b.type;
+    }
+    enum value_class class = value_class(a.type);
+    if (class != value_class(b.type)) {
+        return false;
+    }
+    return class != VALUE_CLASS_OTHER || same_tree(a.type, b.type);
+}
+
+static size_t pointee_size(struct ssa_type address) {
+    struct ast_node* type = address.type;
+    if (type != NULL && value_class(type) == VALUE_CLASS_ADDRESS) {
+        return ast_node_symbol_size(address.module, type->children[0]);
+    }
+    return 0;
+}
+
+static bool same_operand(struct unit* a, struct unit* b, struct operand x, struct operand y) {
+    if (x.type != y.type) {
+        return false;
+    }
+    switch (x.type) {
+        case OPERAND_TYPE_NONE:
+        case OPERAND_TYPE_END:
+            return true;
+        case OPERAND_TYPE_REGISTER:
+        case OPERAND_TYPE_INTEGER:
+            return x.value.integer == y.value.integer && same_type(x.typename, y.typename);
+        case OPERAND_TYPE_FLOAT:
+            return memcmp(&x.value.floating, &y.value.floating, sizeof(double)) == 0 &&
+                   same_type(x.typename, y.typename);
+        case OPERAND_TYPE_BLOCK:
+            return x.value.block->id == y.value.block->id;
+        case OPERAND_TYPE_IR:
+            return x.value.unit == y.value.unit || (x.value.unit == a && y.value.unit == b);
+        case OPERAND_TYPE_VTABLE:
+            return x.value.vtable == y.value.vtable;
+    }
+    return false;
+}
+
+static bool same_instruction(struct unit* a, struct unit* b, struct ssa_instruction* x, struct ssa_instruction* y) {
+    if (x->operator != y->operator || !same_type(x->type, y->type) || !same_operand(a, b, x->result, y->result)) {
+        return false;
+    }
+    for (int i = 0; i < MAX_OPERANDS; i++) {
+        if (!same_operand(a, b, x->operands[i], y->operands[i])) {
+            return false;
+        }
+    }
+    if (x->operator == OP_STORE &&
+        pointee_size(x->operands[0].typename) != pointee_size(y->operands[0].typename)) {
+        return false;
+    }
+    return true;
+}
+
+bool unit_identical(struct unit* a, struct unit* b) {
+    if (a->type != CHUNK_TYPE_FUNCTION || b->type != CHUNK_TYPE_FUNCTION ||
+        a->argument_count != b->argument_count || a->block_count != b->block_count ||
+        !same_type(a->return_type, b->return_type)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a->argument_count; i++) {
+        if (!same_operand(a, b, a->arguments[i], b->arguments[i])) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < a->block_count; i++) {
+        struct block* x = a->blocks[i];
+        struct block* y = b->blocks[i];
+        if (x->entry != y->entry || x->instructions_count != y->instructions_count) {
+            return false;
+        }
+        for (uint32_t j = 0; j < x->instructions_count; j++) {
+            if (!same_instruction(a, b, &x->instructions[j], &y->instructions[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// the shape of a function's code, only functions with the same one are compared instruction by instruction
+static uint64_t fingerprint(struct unit* unit) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = (hash ^ unit->argument_count) * 1099511628211ull;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        hash = (hash ^ block->instructions_count) * 1099511628211ull;
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            hash = (hash ^ block->instructions[j].operator) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// the units generics are instantiated into have their type arguments in their symbol, before the parameters of a
+// variant
+static bool is_instance(struct unit* unit) {
+    return unit->type == CHUNK_TYPE_FUNCTION && memchr(unit->symbol, '<', strcspn(unit->symbol, "(")) != NULL;
+}
+
+static void redirect_unit(struct unit* unit, struct unit* from, struct unit* to) {
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                if (instruction->operands[k].type == OPERAND_TYPE_IR && instruction->operands[k].value.unit == from) {
+                    instruction->operands[k].value.unit = to;
+                }
+            }
+        }
+    }
+    if (unit->initializer != NULL) {
+        redirect_unit(unit->initializer, from, to);
+    }
+}
+
+static void redirect(struct unit_module* module, struct unit* from, struct unit* to) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        redirect_unit(module->units[i], from, to);
+    }
+    for (size_t i = 0; i < module->vtable_count; i++) {
+        struct unit_vtable* vtable = module->vtables[i];
+        for (uint32_t j = 0; j < vtable->method_count; j++) {
+            if (vtable->methods[j] == from) {
+                vtable->methods[j] = to;
+            }
+        }
+    }
+}
+
+void unit_module_fold_identical(struct unit_module* module, FILE* remarks) {
+    uint64_t* hashes = malloc(sizeof(uint64_t) * (module->unit_count + 1));
+    assert(hashes);
+
+    // folding two instances makes the ones calling them identical too, so this goes until nothing folds
+    bool folded = true;
+    while (folded) {
+        folded = false;
+        for (size_t i = 0; i < module->unit_count; i++) {
+            hashes[i] = is_instance(module->units[i]) ? fingerprint(module->units[i]) : 0;
+        }
+        for (size_t i = 0; i < module->unit_count; i++) {
+            struct unit* kept = module->units[i];
+            if (!is_instance(kept)) {
+                continue;
+            }
+            for (size_t j = i + 1; j < module->unit_count; j++) {
+                struct unit* duplicate = module->units[j];
+                if (!is_instance(duplicate) || hashes[j] != hashes[i] || !unit_identical(kept, duplicate)) {
+                    continue;
+                }
+                if (remarks != NULL) {
+                    fprintf(remarks, "identical: %s: folded into %s\n", duplicate->symbol, kept->symbol);
+                }
+                redirect(module, duplicate, kept);
+                unit_module_remove(module, duplicate);
+                memmove(&hashes[j], &hashes[j + 1], sizeof(uint64_t) * (module->unit_count - j));
+                unit_free(duplicate);
+                folded = true;
+                j--;
+            }
+        }
+    }
+
+    free(hashes);
+}
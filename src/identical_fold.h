@@ -0,0 +1,16 @@
+#ifndef COMPILER_IDENTICAL_FOLD_H
+#define COMPILER_IDENTICAL_FOLD_H
+#include <stdio.h>
+
+#include "unit.h"
+
+// true if the two functions run the same instructions on values of the same size and kind, calling themselves counts
+// as the same call
+bool unit_identical(struct unit* a, struct unit* b);
+
+// instances of generics often come out the same, every pointer argument is an address whatever it points to. keeps the
+// first of each set of identical instances and makes every call and vtable use it, the others are removed from the
+// module. says which instance was folded into which on remarks, unless it's NULL
+void unit_module_fold_identical(struct unit_module* module, FILE* remarks);
+
+#endif //COMPILER_IDENTICAL_FOLD_H
@@ -0,0 +1,2341 @@
+#include "interpreter.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+
+#define INTERPRETER_SLOTS (1 << 18)
+#define INTERPRETER_ARENA (1 << 20)
+#define INTERPRETER_HEAP (1 << 22)
+// ends the heap's free list, and marks a block that is still allocated
+#define HEAP_NONE SIZE_MAX
+#define HEAP_IN_USE (SIZE_MAX - 1)
+// marks a block handed out by a region, it goes back with the region instead
+#define HEAP_IN_REGION (SIZE_MAX - 2)
+// the least a region takes from the heap at once
+#define REGION_CHUNK 4096
+// small heap blocks come in sizes this many bytes apart, up to the largest class
+#define HEAP_CLASS_SIZE 16
+#define HEAP_SMALL_LIMIT (HEAP_CLASS_SIZE * INTERPRETER_HEAP_CLASSES)
+// how much a size class takes off the top of the heap once its free list runs dry
+#define HEAP_SLAB 4096
+#define INTERPRETER_DEPTH 4096
+
+// every decoded operation and how it uses its operands, the ssa operators are specialised by type so no type checks
+// happen while running
+#define CODE_LIST(X) \
+    X(NOP, NONE) X(FALL_OFF, NONE) \
+    X(ADD_S, ABC) X(ADD_U, ABC) X(SUB_S, ABC) X(SUB_U, ABC) X(MUL_S, ABC) X(MUL_U, ABC) X(DIV_S, ABC) X(DIV_U, ABC) \
+    X(AND, ABC) X(OR, ABC) X(XOR, ABC) X(SHL_S, ABC) X(SHL_U, ABC) X(SHR_S, ABC) X(SHR_U, ABC) \
+    X(NEG_S, AB) X(NEG_U, AB) X(BNOT_S, AB) X(BNOT_U, AB) X(NOT, AB) X(LAND, ABC) X(LOR, ABC) \
+    X(LT_S, ABC) X(LT_U, ABC) X(LE_S, ABC) X(LE_U, ABC) X(GT_S, ABC) X(GT_U, ABC) X(GE_S, ABC) X(GE_U, ABC) \
+    X(EQ, ABC) X(NE, ABC) \
+    X(ADD_F32, ABC) X(SUB_F32, ABC) X(MUL_F32, ABC) X(DIV_F32, ABC) X(NEG_F32, AB) \
+    X(LT_F32, ABC) X(LE_F32, ABC) X(GT_F32, ABC) X(GE_F32, ABC) X(EQ_F32, ABC) X(NE_F32, ABC) \
+    X(ADD_F64, ABC) X(SUB_F64, ABC) X(MUL_F64, ABC) X(DIV_F64, ABC) X(NEG_F64, AB) \
+    X(LT_F64, ABC) X(LE_F64, ABC) X(GT_F64, ABC) X(GE_F64, ABC) X(EQ_F64, ABC) X(NE_F64, ABC) \
+    X(MOVE, AB) X(NORM_S, AB) X(NORM_U, AB) X(NULL_CHECK, AB) X(BOUNDS_CHECK, ABC) \
+    X(S_TO_F32, AB) X(U_TO_F32, AB) X(S_TO_F64, AB) X(U_TO_F64, AB) \
+    X(F32_TO_S, AB) X(F32_TO_U, AB) X(F64_TO_S, AB) X(F64_TO_U, AB) X(F32_TO_F64, AB) X(F64_TO_F32, AB) \
+    X(JMP, JUMP) X(BR, BRANCH) X(RET, RETURN) X(RET_VOID, NONE) X(CALL, CALL) X(TAIL_CALL, CALL) \
+    X(CALL_INDIRECT, CALL) \
+    X(BLT_S, COMPARE_BRANCH) X(BLT_U, COMPARE_BRANCH) X(BLE_S, COMPARE_BRANCH) X(BLE_U, COMPARE_BRANCH) \
+    X(BGT_S, COMPARE_BRANCH) X(BGT_U, COMPARE_BRANCH) X(BGE_S, COMPARE_BRANCH) X(BGE_U, COMPARE_BRANCH) \
+    X(BEQ, COMPARE_BRANCH) X(BNE, COMPARE_BRANCH) \
+    X(BLT_F32, COMPARE_BRANCH) X(BLE_F32, COMPARE_BRANCH) X(BGT_F32, COMPARE_BRANCH) X(BGE_F32, COMPARE_BRANCH) \
+    X(BEQ_F32, COMPARE_BRANCH) X(BNE_F32, COMPARE_BRANCH) \
+    X(BLT_F64, COMPARE_BRANCH) X(BLE_F64, COMPARE_BRANCH) X(BGT_F64, COMPARE_BRANCH) X(BGE_F64, COMPARE_BRANCH) \
+    X(BEQ_F64, COMPARE_BRANCH) X(BNE_F64, COMPARE_BRANCH) \
+    X(ALLOC, ALLOC) X(HEAP_ALLOC, AB) X(HEAP_FREE, FREE) X(HEAP_REALLOC, ABC) X(REGION_NEW, ALLOC) X(REGION_ALLOC, ABC) \
+    X(REGION_FREE, FREE) \
+    X(LOAD_S8, AB) X(LOAD_S16, AB) X(LOAD_S32, AB) X(LOAD_U8, AB) X(LOAD_U16, AB) X(LOAD_U32, AB) \
+    X(LOAD_64, AB) X(LOAD_F32, AB) \
+    X(STORE_8, STORE) X(STORE_16, STORE) X(STORE_32, STORE) X(STORE_64, STORE) \
+    X(VADD, ABC) X(VSUB, ABC) X(VMUL, ABC) X(VDIV, ABC) X(VAND, ABC) X(VOR, ABC) X(VXOR, ABC) X(VNEG, AB) \
+    X(VBNOT, AB) X(VLT, ABC) X(VLE, ABC) X(VGT, ABC) X(VGE, ABC) X(VEQ, ABC) X(VNE, ABC) \
+    X(VCAST, AB) X(VSPLAT, AB) X(VEXTRACT, AB) X(VINSERT, ABC) X(VLOAD, AB) X(VSTORE, STORE) \
+    X(RET_VECTOR, RETURN)
+
+enum code_op {
+#define CODE_ENUM(name, format) CODE_##name,
+    CODE_LIST(CODE_ENUM)
+#undef CODE_ENUM
+    CODE_COUNT,
+};
+
+// which of a, b and c a code writes, reads or jumps to
+enum code_format {
+    CODE_FORMAT_NONE,
+    CODE_FORMAT_ABC,            // a = b op c
+    CODE_FORMAT_AB,             // a = op b
+    CODE_FORMAT_JUMP,           // goto a
+    CODE_FORMAT_BRANCH,         // goto a ? b : c
+    CODE_FORMAT_COMPARE_BRANCH, // if (a op b) goto c
+    CODE_FORMAT_RETURN,         // return a
+    CODE_FORMAT_CALL,           // a = call b, arguments start at call_args[c]. CALL_INDIRECT calls the function
+                                // register b holds the index of
+    CODE_FORMAT_ALLOC,          // a = alloc b bytes
+    CODE_FORMAT_STORE,          // *a = b
+    CODE_FORMAT_FREE,           // free a
+};
+
+static const uint8_t code_formats[CODE_COUNT] = {
+#define CODE_FORMAT(name, format) [CODE_##name] = CODE_FORMAT_##format,
+    CODE_LIST(CODE_FORMAT)
+#undef CODE_FORMAT
+};
+
+// vector codes keep their lane type in shift and their lane count in lanes, VEXTRACT and VINSERT keep the lane they
+// touch in lanes instead, VCAST keeps the lane type it converts from in c and VLOAD and VSTORE keep the size in c
+struct code {
+    uint16_t op;
+    // 64 - width of the result, used to wrap sub 64-bit integers back into their range
+    uint8_t shift;
+    uint8_t lanes;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+struct interpreter_function {
+    struct unit* unit;
+    bool decoded;
+
+    struct code* code;
+    uint32_t code_count;
+    uint32_t code_capacity;
+
+    // registers come first in a frame, followed by the constants the unit uses, vector registers take several slots
+    // so every ssa register maps to the first slot it uses
+    uint32_t register_count;
+    uint32_t* register_slots;
+    uint32_t* argument_slots;
+    uint8_t* argument_widths;
+    union slot* constants;
+    uint32_t constant_count;
+    uint32_t constant_capacity;
+
+    // argument count followed by the argument slots for every call site
+    uint32_t* call_args;
+    uint32_t call_args_count;
+    uint32_t call_args_capacity;
+};
+
+struct interpreter_vtable {
+    struct unit_vtable* source;
+    // on the interpreter's heap, it goes away with it
+    uint64_t* functions;
+};
+
+struct interpreter_global {
+    struct unit* source;
+    // on the interpreter's heap, it goes away with it
+    uint8_t* memory;
+};
+
+struct frame {
+    struct interpreter_function* function;
+    struct code* ip;
+    union slot* base;
+    size_t arena_mark;
+    uint32_t result;
+};
+
+enum value_kind {
+    VALUE_KIND_NONE,
+    VALUE_KIND_SIGNED,
+    VALUE_KIND_UNSIGNED,
+    VALUE_KIND_F32,
+    VALUE_KIND_F64,
+};
+
+struct value_type {
+    enum value_kind kind;
+    uint8_t size;
+};
+
+static struct value_type value_type(struct ssa_type type) {
+    if (type.type == NULL) {
+        return (struct value_type){VALUE_KIND_NONE, 0};
+    }
+    switch (type.type->type) {
+        case AST_NODE_TYPE_I8: return (struct value_type){VALUE_KIND_SIGNED, 1};
+        case AST_NODE_TYPE_I16: return (struct value_type){VALUE_KIND_SIGNED, 2};
+        case AST_NODE_TYPE_I32: return (struct value_type){VALUE_KIND_SIGNED, 4};
+        case AST_NODE_TYPE_I64: return (struct value_type){VALUE_KIND_SIGNED, 8};
+        case AST_NODE_TYPE_BOOL:
+        case AST_NODE_TYPE_U8: return (struct value_type){VALUE_KIND_UNSIGNED, 1};
+        case AST_NODE_TYPE_U16: return (struct value_type){VALUE_KIND_UNSIGNED, 2};
+        case AST_NODE_TYPE_U32: return (struct value_type){VALUE_KIND_UNSIGNED, 4};
+        case AST_NODE_TYPE_U64:
+        case AST_NODE_TYPE_POINTER:
+        case AST_NODE_TYPE_REFERENCE:
+        case AST_NODE_TYPE_ARRAY:
+        // a method out of a vtable is the index of its function
+        case AST_NODE_TYPE_ABSTRACT: return (struct value_type){VALUE_KIND_UNSIGNED, 8};
+        case AST_NODE_TYPE_F32: return (struct value_type){VALUE_KIND_F32, 4};
+        case AST_NODE_TYPE_F64: return (struct value_type){VALUE_KIND_F64, 8};
+        default: return (struct value_type){VALUE_KIND_NONE, 0};
+    }
+}
+
+static uint8_t value_shift(struct value_type type) {
+    return type.size >= 8 ? 0 : 64 - type.size * 8;
+}
+
+#pragma region vectors
+
+// a vector register spans this many slots, lanes are packed at their natural width so lane-wise codes map straight
+// onto the host's simd instructions
+#define VECTOR_SLOTS 4
+#define VECTOR_SIZE (VECTOR_SLOTS * sizeof(union slot))
+
+enum lane_type {
+    LANE_S8,
+    LANE_S16,
+    LANE_S32,
+    LANE_S64,
+    LANE_U8,
+    LANE_U16,
+    LANE_U32,
+    LANE_U64,
+    LANE_F32,
+    LANE_F64,
+};
+
+typedef int8_t vector_s8 __attribute__((vector_size(VECTOR_SIZE)));
+typedef int16_t vector_s16 __attribute__((vector_size(VECTOR_SIZE)));
+typedef int32_t vector_s32 __attribute__((vector_size(VECTOR_SIZE)));
+typedef int64_t vector_s64 __attribute__((vector_size(VECTOR_SIZE)));
+typedef uint8_t vector_u8 __attribute__((vector_size(VECTOR_SIZE)));
+typedef uint16_t vector_u16 __attribute__((vector_size(VECTOR_SIZE)));
+typedef uint32_t vector_u32 __attribute__((vector_size(VECTOR_SIZE)));
+typedef uint64_t vector_u64 __attribute__((vector_size(VECTOR_SIZE)));
+typedef float vector_f32 __attribute__((vector_size(VECTOR_SIZE)));
+typedef double vector_f64 __attribute__((vector_size(VECTOR_SIZE)));
+
+union vector {
+    vector_s8 s8;
+    vector_s16 s16;
+    vector_s32 s32;
+    vector_s64 s64;
+    vector_u8 u8;
+    vector_u16 u16;
+    vector_u32 u32;
+    vector_u64 u64;
+    vector_f32 f32;
+    vector_f64 f64;
+};
+
+static bool is_vector(struct ssa_type type) {
+    return type.type != NULL && type.type->type == AST_NODE_TYPE_SIMD;
+}
+
+// lane type and count of a simd type, false if its lanes aren't interpretable
+static bool vector_shape(struct ssa_type type, uint8_t* lane, uint8_t* lanes) {
+    if (!is_vector(type) || type.size > VECTOR_SIZE) {
+        return false;
+    }
+    struct value_type element = value_type((struct ssa_type){.type = type.type->children[0]});
+    int size_index = element.size == 1 ? 0 : element.size == 2 ? 1 : element.size == 4 ? 2 : 3;
+    switch (element.kind) {
+        case VALUE_KIND_SIGNED: *lane = LANE_S8 + size_index; break;
+        case VALUE_KIND_UNSIGNED: *lane = LANE_U8 + size_index; break;
+        case VALUE_KIND_F32: *lane = LANE_F32; break;
+        case VALUE_KIND_F64: *lane = LANE_F64; break;
+        default: return false;
+    }
+    *lanes = (uint8_t) strtol(type.type->children[1]->token.start, NULL, 10);
+    return true;
+}
+
+static bool lane_signed(uint8_t lane) {
+    return lane <= LANE_S64;
+}
+
+// reads a lane into the same form a scalar register of the lane type would hold
+static union slot vector_get(const union vector* vector, uint8_t lane, uint32_t i) {
+    union slot value = {.u = 0};
+    switch (lane) {
+        case LANE_S8: value.i = vector->s8[i]; break;
+        case LANE_S16: value.i = vector->s16[i]; break;
+        case LANE_S32: value.i = vector->s32[i]; break;
+        case LANE_S64: value.i = vector->s64[i]; break;
+        case LANE_U8: value.u = vector->u8[i]; break;
+        case LANE_U16: value.u = vector->u16[i]; break;
+        case LANE_U32: value.u = vector->u32[i]; break;
+        case LANE_U64: value.u = vector->u64[i]; break;
+        case LANE_F32: value.f32 = vector->f32[i]; break;
+        case LANE_F64: value.f64 = vector->f64[i]; break;
+        default: break;
+    }
+    return value;
+}
+
+static void vector_set(union vector* vector, uint8_t lane, uint32_t i, union slot value) {
+    switch (lane) {
+        case LANE_S8:
+        case LANE_U8: vector->u8[i] = (uint8_t) value.u; break;
+        case LANE_S16:
+        case LANE_U16: vector->u16[i] = (uint16_t) value.u; break;
+        case LANE_S32:
+        case LANE_U32: vector->u32[i] = (uint32_t) value.u; break;
+        case LANE_S64:
+        case LANE_U64: vector->u64[i] = value.u; break;
+        case LANE_F32: vector->f32[i] = value.f32; break;
+        case LANE_F64: vector->f64[i] = value.f64; break;
+        default: break;
+    }
+}
+
+// integer lanes wrap, so signed lanes do their arithmetic through the unsigned view
+#define VECTOR_ARITHMETIC(name, op) \
+    static void name(uint8_t lane, union vector* a, const union vector* b, const union vector* c) { \
+        switch (lane) { \
+            case LANE_S8: case LANE_U8: a->u8 = b->u8 op c->u8; break; \
+            case LANE_S16: case LANE_U16: a->u16 = b->u16 op c->u16; break; \
+            case LANE_S32: case LANE_U32: a->u32 = b->u32 op c->u32; break; \
+            case LANE_S64: case LANE_U64: a->u64 = b->u64 op c->u64; break; \
+            case LANE_F32: a->f32 = b->f32 op c->f32; break; \
+            case LANE_F64: a->f64 = b->f64 op c->f64; break; \
+            default: break; \
+        } \
+    }
+
+// compares give a mask per lane, all ones where the compare holds
+#define VECTOR_COMPARE(name, op) \
+    static void name(uint8_t lane, union vector* a, const union vector* b, const union vector* c) { \
+        switch (lane) { \
+            case LANE_S8: a->s8 = b->s8 op c->s8; break; \
+            case LANE_S16: a->s16 = b->s16 op c->s16; break; \
+            case LANE_S32: a->s32 = b->s32 op c->s32; break; \
+            case LANE_S64: a->s64 = b->s64 op c->s64; break; \
+            case LANE_U8: a->s8 = b->u8 op c->u8; break; \
+            case LANE_U16: a->s16 = b->u16 op c->u16; break; \
+            case LANE_U32: a->s32 = b->u32 op c->u32; break; \
+            case LANE_U64: a->s64 = b->u64 op c->u64; break; \
+            case LANE_F32: a->s32 = b->f32 op c->f32; break; \
+            case LANE_F64: a->s64 = b->f64 op c->f64; break; \
+            default: break; \
+        } \
+    }
+
+VECTOR_ARITHMETIC(vector_add, +)
+VECTOR_ARITHMETIC(vector_sub, -)
+VECTOR_ARITHMETIC(vector_mul, *)
+VECTOR_COMPARE(vector_lt, <)
+VECTOR_COMPARE(vector_le, <=)
+VECTOR_COMPARE(vector_gt, >)
+VECTOR_COMPARE(vector_ge, >=)
+VECTOR_COMPARE(vector_eq, ==)
+VECTOR_COMPARE(vector_ne, !=)
+
+#undef VECTOR_ARITHMETIC
+#undef VECTOR_COMPARE
+
+static void vector_negate(uint8_t lane, union vector* a, const union vector* b) {
+    union vector zero = {};
+    switch (lane) {
+        case LANE_F32: a->f32 = -b->f32; break;
+        case LANE_F64: a->f64 = -b->f64; break;
+        default: vector_sub(lane, a, &zero, b); break;
+    }
+}
+
+// there's no simd integer division, so it goes lane by lane and only the lanes in use are checked for zero
+static bool vector_divide(uint8_t lane, uint8_t lanes, union vector* a, const union vector* b, const union vector* c) {
+    for (uint32_t i = 0; i < lanes; i++) {
+        union slot x = vector_get(b, lane, i);
+        union slot y = vector_get(c, lane, i);
+        if (lane == LANE_F32) {
+            x.f32 /= y.f32;
+        } else if (lane == LANE_F64) {
+            x.f64 /= y.f64;
+        } else if (y.u == 0) {
+            return false;
+        } else if (lane_signed(lane)) {
+            x.i = y.i == -1 ? (int64_t) (0 - x.u) : x.i / y.i;
+        } else {
+            x.u /= y.u;
+        }
+        vector_set(a, lane, i, x);
+    }
+    return true;
+}
+
+static union slot lane_convert(union slot value, uint8_t from, uint8_t to) {
+    union slot result = {.u = 0};
+    if (to == LANE_F32) {
+        result.f32 = from == LANE_F32 ? value.f32 : from == LANE_F64 ? (float) value.f64 :
+                     lane_signed(from) ? (float) value.i : (float) value.u;
+    } else if (to == LANE_F64) {
+        result.f64 = from == LANE_F32 ? (double) value.f32 : from == LANE_F64 ? value.f64 :
+                     lane_signed(from) ? (double) value.i : (double) value.u;
+    } else if (from == LANE_F32) {
+        result.i = (int64_t) value.f32;
+    } else if (from == LANE_F64) {
+        result.i = (int64_t) value.f64;
+    } else {
+        result = value;
+    }
+    return result;
+}
+
+#pragma endregion
+
+static struct interpreter_function* function_new(struct unit* unit) {
+    struct interpreter_function* function = malloc(sizeof(struct interpreter_function));
+    assert(function);
+    function->unit = unit;
+    function->decoded = false;
+
+    function->code = malloc(sizeof(struct code));
+    assert(function->code);
+    function->code_count = 0;
+    function->code_capacity = 1;
+
+    function->register_count = 0;
+    function->register_slots = NULL;
+    function->argument_slots = NULL;
+    function->argument_widths = NULL;
+    function->constants = malloc(sizeof(union slot));
+    assert(function->constants);
+    function->constant_count = 0;
+    function->constant_capacity = 1;
+
+    function->call_args = malloc(sizeof(uint32_t));
+    assert(function->call_args);
+    function->call_args_count = 0;
+    function->call_args_capacity = 1;
+    return function;
+}
+
+static void function_free(struct interpreter_function* function) {
+    free(function->code);
+    free(function->register_slots);
+    free(function->argument_slots);
+    free(function->argument_widths);
+    free(function->constants);
+    free(function->call_args);
+    free(function);
+}
+
+static void function_emit(struct interpreter_function* function, struct code code) {
+    if (function->code_count >= function->code_capacity) {
+        function->code_capacity *= 2;
+        function->code = realloc(function->code, function->code_capacity * sizeof(struct code));
+        assert(function->code);
+    }
+    function->code[function->code_count++] = code;
+}
+
+static uint32_t function_constant(struct interpreter_function* function, union slot value) {
+    if (function->constant_count >= function->constant_capacity) {
+        function->constant_capacity *= 2;
+        function->constants = realloc(function->constants, function->constant_capacity * sizeof(union slot));
+        assert(function->constants);
+    }
+    function->constants[function->constant_count] = value;
+    return function->register_count + function->constant_count++;
+}
+
+static void function_call_arg(struct interpreter_function* function, uint32_t value) {
+    if (function->call_args_count >= function->call_args_capacity) {
+        function->call_args_capacity *= 2;
+        function->call_args = realloc(function->call_args, function->call_args_capacity * sizeof(uint32_t));
+        assert(function->call_args);
+    }
+    function->call_args[function->call_args_count++] = value;
+}
+
+struct interpreter* interpreter_new() {
+    struct interpreter* interpreter = malloc(sizeof(struct interpreter));
+    assert(interpreter);
+    interpreter->functions = malloc(sizeof(struct interpreter_function*));
+    assert(interpreter->functions);
+    interpreter->function_count = 0;
+    interpreter->function_capacity = 1;
+    interpreter->vtables = malloc(sizeof(struct interpreter_vtable));
+    assert(interpreter->vtables);
+    interpreter->vtable_count = 0;
+    interpreter->vtable_capacity = 1;
+    interpreter->globals = malloc(sizeof(struct interpreter_global));
+    assert(interpreter->globals);
+    interpreter->global_count = 0;
+    interpreter->global_capacity = 1;
+
+    interpreter->slot_capacity = INTERPRETER_SLOTS;
+    interpreter->slots = malloc(interpreter->slot_capacity * sizeof(union slot));
+    assert(interpreter->slots);
+
+    interpreter->arena_capacity = INTERPRETER_ARENA;
+    interpreter->arena = malloc(interpreter->arena_capacity);
+    assert(interpreter->arena);
+
+    interpreter->heap_capacity = INTERPRETER_HEAP;
+    interpreter->heap = malloc(interpreter->heap_capacity);
+    assert(interpreter->heap);
+    interpreter->heap_top = 0;
+    interpreter->heap_free = HEAP_NONE;
+    for (int i = 0; i < INTERPRETER_HEAP_CLASSES; i++) {
+        interpreter->heap_classes[i] = HEAP_NONE;
+    }
+    interpreter->heap_stats = (struct interpreter_heap_stats){};
+
+    interpreter->max_depth = INTERPRETER_DEPTH;
+    interpreter->fuel = UINT64_MAX;
+    interpreter->optimize = true;
+    interpreter->evaluating = false;
+    interpreter->stats = (struct interpreter_stats){};
+    interpreter->error = NULL;
+    return interpreter;
+}
+
+void interpreter_free(struct interpreter* interpreter) {
+    for (uint32_t i = 0; i < interpreter->function_count; i++) {
+        function_free(interpreter->functions[i]);
+    }
+    free(interpreter->functions);
+    free(interpreter->vtables);
+    free(interpreter->globals);
+    free(interpreter->slots);
+    free(interpreter->arena);
+    free(interpreter->heap);
+    free(interpreter);
+}
+
+static uint32_t interpreter_function_index(struct interpreter* interpreter, struct unit* unit) {
+    for (uint32_t i = 0; i < interpreter->function_count; i++) {
+        if (interpreter->functions[i]->unit == unit) {
+            return i;
+        }
+    }
+    if (interpreter->function_count >= interpreter->function_capacity) {
+        interpreter->function_capacity *= 2;
+        interpreter->functions = realloc(interpreter->functions,
+                                         interpreter->function_capacity * sizeof(struct interpreter_function*));
+        assert(interpreter->functions);
+    }
+    interpreter->functions[interpreter->function_count] = function_new(unit);
+    return interpreter->function_count++;
+}
+
+static uint8_t* heap_alloc(struct interpreter* interpreter, uint64_t size);
+
+// the index of the function of each method of a vtable, made once per interpreter. it is kept on the heap so the
+// program can load from it, NULL if there's no room left. a method the struct doesn't have is left as 0, ssa_gen
+// never makes such a vtable
+static uint64_t* interpreter_vtable(struct interpreter* interpreter, struct unit_vtable* source) {
+    for (uint32_t i = 0; i < interpreter->vtable_count; i++) {
+        if (interpreter->vtables[i].source == source) {
+            return interpreter->vtables[i].functions;
+        }
+    }
+    uint64_t* functions = (uint64_t*) heap_alloc(interpreter, (source->method_count + 1) * sizeof(uint64_t));
+    if (functions == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < source->method_count; i++) {
+        if (source->methods[i] != NULL) {
+            functions[i] = interpreter_function_index(interpreter, source->methods[i]);
+        }
+    }
+    if (interpreter->vtable_count >= interpreter->vtable_capacity) {
+        interpreter->vtable_capacity *= 2;
+        interpreter->vtables = realloc(interpreter->vtables,
+                                       interpreter->vtable_capacity * sizeof(struct interpreter_vtable));
+        assert(interpreter->vtables);
+    }
+    interpreter->vtables[interpreter->vtable_count++] = (struct interpreter_vtable){source, functions};
+    return functions;
+}
+
+// the memory of a global, made once per interpreter and holding the value the global was evaluated to, zero if it is
+// only known at runtime. NULL if there's no room left on the heap
+static uint8_t* interpreter_global(struct interpreter* interpreter, struct unit* source) {
+    for (uint32_t i = 0; i < interpreter->global_count; i++) {
+        if (interpreter->globals[i].source == source) {
+            return interpreter->globals[i].memory;
+        }
+    }
+    // a scalar's value is copied in as a whole slot
+    size_t size = ast_node_symbol_size(source->return_type.module, source->return_type.type);
+    size = size < sizeof(union slot) ? sizeof(union slot) : size;
+    uint8_t* memory = heap_alloc(interpreter, size);
+    if (memory == NULL) {
+        return NULL;
+    }
+    memset(memory, 0, size);
+    union slot value = {.u = 0};
+    if (source->value.type == OPERAND_TYPE_INTEGER) {
+        value.u = source->value.value.integer;
+    } else if (source->value.type == OPERAND_TYPE_FLOAT && value_type(source->return_type).kind == VALUE_KIND_F32) {
+        value.f32 = (float) source->value.value.floating;
+    } else if (source->value.type == OPERAND_TYPE_FLOAT) {
+        value.f64 = source->value.value.floating;
+    }
+    memcpy(memory, &value, sizeof(union slot));
+
+    if (interpreter->global_count >= interpreter->global_capacity) {
+        interpreter->global_capacity *= 2;
+        interpreter->globals = realloc(interpreter->globals,
+                                       interpreter->global_capacity * sizeof(struct interpreter_global));
+        assert(interpreter->globals);
+    }
+    interpreter->globals[interpreter->global_count++] = (struct interpreter_global){source, memory};
+    return memory;
+}
+
+#pragma region peephole
+
+// the conditional branch a compare fuses into, and the one testing the opposite condition
+struct fused_compare {
+    uint16_t branch;
+    uint16_t inverse;
+};
+
+// ordered float compares have no inverse since a NaN makes both the compare and its opposite false
+static const struct fused_compare fused_compares[CODE_COUNT] = {
+    [CODE_LT_S] = {CODE_BLT_S, CODE_BGE_S},
+    [CODE_LT_U] = {CODE_BLT_U, CODE_BGE_U},
+    [CODE_LE_S] = {CODE_BLE_S, CODE_BGT_S},
+    [CODE_LE_U] = {CODE_BLE_U, CODE_BGT_U},
+    [CODE_GT_S] = {CODE_BGT_S, CODE_BLE_S},
+    [CODE_GT_U] = {CODE_BGT_U, CODE_BLE_U},
+    [CODE_GE_S] = {CODE_BGE_S, CODE_BLT_S},
+    [CODE_GE_U] = {CODE_BGE_U, CODE_BLT_U},
+    [CODE_EQ] = {CODE_BEQ, CODE_BNE},
+    [CODE_NE] = {CODE_BNE, CODE_BEQ},
+    [CODE_LT_F32] = {CODE_BLT_F32, CODE_NOP},
+    [CODE_LE_F32] = {CODE_BLE_F32, CODE_NOP},
+    [CODE_GT_F32] = {CODE_BGT_F32, CODE_NOP},
+    [CODE_GE_F32] = {CODE_BGE_F32, CODE_NOP},
+    [CODE_EQ_F32] = {CODE_BEQ_F32, CODE_BNE_F32},
+    [CODE_NE_F32] = {CODE_BNE_F32, CODE_BEQ_F32},
+    [CODE_LT_F64] = {CODE_BLT_F64, CODE_NOP},
+    [CODE_LE_F64] = {CODE_BLE_F64, CODE_NOP},
+    [CODE_GT_F64] = {CODE_BGT_F64, CODE_NOP},
+    [CODE_GE_F64] = {CODE_BGE_F64, CODE_NOP},
+    [CODE_EQ_F64] = {CODE_BEQ_F64, CODE_BNE_F64},
+    [CODE_NE_F64] = {CODE_BNE_F64, CODE_BEQ_F64},
+};
+
+static const uint8_t store_widths[CODE_COUNT] = {
+    [CODE_STORE_8] = 1,
+    [CODE_STORE_16] = 2,
+    [CODE_STORE_32] = 4,
+    [CODE_STORE_64] = 8,
+};
+
+// what a load becomes when the value it reads was just stored, the stored register only needs rewrapping
+struct forwarded_load {
+    uint8_t width;
+    uint16_t op;
+    uint8_t shift;
+};
+
+static const struct forwarded_load forwarded_loads[CODE_COUNT] = {
+    [CODE_LOAD_S8] = {1, CODE_NORM_S, 56},
+    [CODE_LOAD_S16] = {2, CODE_NORM_S, 48},
+    [CODE_LOAD_S32] = {4, CODE_NORM_S, 32},
+    [CODE_LOAD_U8] = {1, CODE_NORM_U, 56},
+    [CODE_LOAD_U16] = {2, CODE_NORM_U, 48},
+    [CODE_LOAD_U32] = {4, CODE_NORM_U, 32},
+    [CODE_LOAD_64] = {8, CODE_MOVE, 0},
+    [CODE_LOAD_F32] = {4, CODE_MOVE, 0},
+};
+
+static bool code_writes(struct code* code, uint32_t slot) {
+    switch (code_formats[code->op]) {
+        case CODE_FORMAT_ABC:
+        case CODE_FORMAT_AB:
+        case CODE_FORMAT_CALL:
+        case CODE_FORMAT_ALLOC:
+            return code->a == slot;
+        default:
+            return false;
+    }
+}
+
+// codes that only compute a register, and can be dropped when nothing reads it
+static bool code_removable(struct code* code) {
+    switch (code->op) {
+        case CODE_DIV_S:
+        case CODE_DIV_U:
+        case CODE_LOAD_S8:
+        case CODE_LOAD_S16:
+        case CODE_LOAD_S32:
+        case CODE_LOAD_U8:
+        case CODE_LOAD_U16:
+        case CODE_LOAD_U32:
+        case CODE_LOAD_64:
+        case CODE_LOAD_F32:
+        case CODE_VDIV:
+        case CODE_VLOAD:
+        case CODE_NULL_CHECK:
+        case CODE_BOUNDS_CHECK:
+        case CODE_HEAP_ALLOC:
+        case CODE_HEAP_REALLOC:
+        case CODE_REGION_ALLOC:
+            return false;
+        default:
+            return code_formats[code->op] == CODE_FORMAT_ABC || code_formats[code->op] == CODE_FORMAT_AB;
+    }
+}
+
+static void count_reads(struct interpreter_function* function, uint32_t* reads) {
+    memset(reads, 0, sizeof(uint32_t) * (function->register_count + function->constant_count));
+    for (uint32_t i = 0; i < function->code_count; i++) {
+        struct code* code = &function->code[i];
+        switch (code_formats[code->op]) {
+            case CODE_FORMAT_ABC:
+                reads[code->b]++;
+                reads[code->c]++;
+                break;
+            case CODE_FORMAT_AB:
+                reads[code->b]++;
+                break;
+            case CODE_FORMAT_BRANCH:
+            case CODE_FORMAT_RETURN:
+            case CODE_FORMAT_FREE:
+                reads[code->a]++;
+                break;
+            case CODE_FORMAT_COMPARE_BRANCH:
+            case CODE_FORMAT_STORE:
+                reads[code->a]++;
+                reads[code->b]++;
+                break;
+            case CODE_FORMAT_CALL: {
+                uint32_t* args = function->call_args + code->c;
+                for (uint32_t j = 0; j < args[0]; j++) {
+                    reads[args[j + 1]]++;
+                }
+                if (code->op == CODE_CALL_INDIRECT) {
+                    reads[code->b]++;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+static void mark_targets(struct interpreter_function* function, bool* targets) {
+    memset(targets, 0, sizeof(bool) * function->code_count);
+    for (uint32_t i = 0; i < function->code_count; i++) {
+        struct code* code = &function->code[i];
+        switch (code_formats[code->op]) {
+            case CODE_FORMAT_JUMP:
+                targets[code->a] = true;
+                break;
+            case CODE_FORMAT_BRANCH:
+                targets[code->b] = true;
+                targets[code->c] = true;
+                break;
+            case CODE_FORMAT_COMPARE_BRANCH:
+                targets[code->c] = true;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// where control really ends up when going to a code, past removed codes and chains of jumps
+static uint32_t destination(struct interpreter_function* function, uint32_t target) {
+    for (uint32_t hops = 0; hops < function->code_count; hops++) {
+        struct code* code = &function->code[target];
+        if (code->op == CODE_NOP) {
+            target++;
+        } else if (code->op == CODE_JMP) {
+            target = code->a;
+        } else {
+            break;
+        }
+    }
+    return target;
+}
+
+// passes the value of a store on to loads of the same pointer that follow it in straight line code
+static void forward_store(struct interpreter* interpreter, struct interpreter_function* function, bool* targets,
+                          uint32_t store) {
+    uint32_t pointer = function->code[store].a;
+    uint32_t value = function->code[store].b;
+    uint8_t width = store_widths[function->code[store].op];
+
+    for (uint32_t i = store + 1; i < function->code_count && !targets[i]; i++) {
+        struct code* code = &function->code[i];
+        struct forwarded_load load = forwarded_loads[code->op];
+        if (load.width != 0 && code->b == pointer) {
+            if (load.width == width) {
+                *code = (struct code){load.op, load.shift, 0, code->a, value};
+                interpreter->stats.forwarded_loads++;
+            }
+            continue;
+        }
+        if (code->op != CODE_NOP && code_formats[code->op] != CODE_FORMAT_AB &&
+            code_formats[code->op] != CODE_FORMAT_ABC && code_formats[code->op] != CODE_FORMAT_ALLOC) {
+            break;
+        }
+        if (code_writes(code, pointer) || code_writes(code, value)) {
+            break;
+        }
+    }
+}
+
+// rewrites freshly selected codes using the tables above, then squeezes out everything that was removed
+static void peephole(struct interpreter* interpreter, struct interpreter_function* function) {
+    struct interpreter_stats* stats = &interpreter->stats;
+    struct code* code = function->code;
+    uint32_t count = function->code_count;
+    stats->decoded += count;
+
+    uint32_t* reads = malloc(sizeof(uint32_t) * (function->register_count + function->constant_count + 1));
+    bool* targets = malloc(sizeof(bool) * count);
+    assert(reads && targets);
+    mark_targets(function, targets);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (store_widths[code[i].op] != 0) {
+            forward_store(interpreter, function, targets, i);
+        }
+    }
+
+    count_reads(function, reads);
+    for (uint32_t i = 0; i < count; i++) {
+        struct code* current = &code[i];
+        if ((current->op == CODE_MOVE || ((current->op == CODE_NORM_S || current->op == CODE_NORM_U) &&
+                                          current->shift == 0)) && current->a == current->b) {
+            current->op = CODE_NOP;
+            stats->removed_moves++;
+            continue;
+        }
+
+        // the compare result only feeds the branch, so the flag itself never has to be materialised
+        struct fused_compare fused = fused_compares[current->op];
+        if (fused.branch == CODE_NOP || i + 1 >= count || targets[i + 1]) {
+            continue;
+        }
+        struct code branch = code[i + 1];
+        if (branch.op != CODE_BR || branch.a != current->a || reads[current->a] != 1) {
+            continue;
+        }
+        if (destination(function, branch.b) == destination(function, i + 2) && fused.inverse != CODE_NOP) {
+            code[i] = (struct code){fused.inverse, 0, 0, current->b, current->c, branch.c};
+            code[i + 1] = (struct code){CODE_NOP};
+        } else {
+            code[i] = (struct code){fused.branch, 0, 0, current->b, current->c, branch.b};
+            code[i + 1] = (struct code){CODE_JMP, 0, 0, branch.c};
+        }
+        stats->fused_branches++;
+        i++;
+    }
+
+    // dead computations, dropping one can leave the computations feeding it dead too
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        count_reads(function, reads);
+        for (uint32_t i = 0; i < count; i++) {
+            if (code_removable(&code[i]) && reads[code[i].a] == 0) {
+                code[i].op = CODE_NOP;
+                stats->removed_dead++;
+                changed = true;
+            }
+        }
+    }
+
+    // thread jumps through other jumps, then drop the ones that land on the next code anyway
+    for (uint32_t i = 0; i < count; i++) {
+        switch (code_formats[code[i].op]) {
+            case CODE_FORMAT_JUMP:
+                code[i].a = destination(function, code[i].a);
+                break;
+            case CODE_FORMAT_BRANCH:
+                code[i].b = destination(function, code[i].b);
+                code[i].c = destination(function, code[i].c);
+                break;
+            case CODE_FORMAT_COMPARE_BRANCH:
+                code[i].c = destination(function, code[i].c);
+                break;
+            default:
+                break;
+        }
+    }
+    for (uint32_t i = count; i-- > 0;) {
+        if (code[i].op == CODE_JMP && destination(function, i + 1) == code[i].a) {
+            code[i].op = CODE_NOP;
+            stats->removed_jumps++;
+        }
+    }
+
+    // a removed code maps to the next code that is kept, the trailing FALL_OFF always is
+    uint32_t* remap = reads;
+    if (function->register_count + function->constant_count + 1 < count) {
+        remap = realloc(reads, sizeof(uint32_t) * count);
+        assert(remap);
+    }
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        remap[i] = kept;
+        if (code[i].op != CODE_NOP) {
+            code[kept++] = code[i];
+        }
+    }
+    for (uint32_t i = 0; i < kept; i++) {
+        switch (code_formats[code[i].op]) {
+            case CODE_FORMAT_JUMP:
+                code[i].a = remap[code[i].a];
+                break;
+            case CODE_FORMAT_BRANCH:
+                code[i].b = remap[code[i].b];
+                code[i].c = remap[code[i].c];
+                break;
+            case CODE_FORMAT_COMPARE_BRANCH:
+                code[i].c = remap[code[i].c];
+                break;
+            default:
+                break;
+        }
+    }
+    function->code_count = kept;
+    stats->emitted += kept;
+
+    free(remap);
+    free(targets);
+}
+
+#pragma endregion
+
+#pragma region decoding
+
+static bool decode_error(struct interpreter* interpreter, const char* message) {
+    interpreter->error = message;
+    return false;
+}
+
+static void count_register(struct interpreter_function* function, struct operand operand) {
+    if (operand.type == OPERAND_TYPE_REGISTER && operand.value.integer >= function->register_count) {
+        function->register_count = operand.value.integer + 1;
+    }
+}
+
+// vector registers need more than one slot
+static void width_register(uint8_t* widths, struct operand operand) {
+    if (operand.type == OPERAND_TYPE_REGISTER && is_vector(operand.typename)) {
+        widths[operand.value.integer] = VECTOR_SLOTS;
+    }
+}
+
+static uint32_t register_slot(struct interpreter_function* function, struct operand operand) {
+    return function->register_slots[operand.value.integer];
+}
+
+// the address of a global as a constant. only a load may read through it while evaluating, and only once the global's
+// value is known, a global computed at runtime would read as zero and writes would be lost with the interpreter
+static bool decode_global(struct interpreter* interpreter, struct interpreter_function* function,
+                          struct operand operand, bool load, uint32_t* out) {
+    struct unit* global = operand.value.unit;
+    if (global->type != CHUNK_TYPE_VARIABLE) {
+        return decode_error(interpreter, "only a global has an address");
+    }
+    if (global->initializer != NULL ||
+        (interpreter->evaluating && (!load || global->value.type == OPERAND_TYPE_NONE))) {
+        return decode_error(interpreter, "global isn't known at compile time");
+    }
+    union slot value = {.ptr = interpreter_global(interpreter, global)};
+    if (value.ptr == NULL) {
+        return decode_error(interpreter, "heap has no room for a global");
+    }
+    *out = function_constant(function, value);
+    return true;
+}
+
+static bool decode_operand(struct interpreter* interpreter, struct interpreter_function* function,
+                           struct operand operand, uint32_t* out) {
+    switch (operand.type) {
+        case OPERAND_TYPE_REGISTER:
+            *out = register_slot(function, operand);
+            return true;
+        case OPERAND_TYPE_INTEGER: {
+            // constants are already sign extended by operand_const_*
+            union slot value = {.u = operand.value.integer};
+            *out = function_constant(function, value);
+            return true;
+        }
+        case OPERAND_TYPE_IR:
+            return decode_global(interpreter, function, operand, false, out);
+        case OPERAND_TYPE_VTABLE: {
+            union slot value = {.ptr = (uint8_t*) interpreter_vtable(interpreter, operand.value.vtable)};
+            if (value.ptr == NULL) {
+                return decode_error(interpreter, "heap has no room for a vtable");
+            }
+            *out = function_constant(function, value);
+            return true;
+        }
+        case OPERAND_TYPE_FLOAT: {
+            union slot value = {.u = 0};
+            if (value_type(operand.typename).kind == VALUE_KIND_F32) {
+                value.f32 = (float) operand.value.floating;
+            } else {
+                value.f64 = operand.value.floating;
+            }
+            *out = function_constant(function, value);
+            return true;
+        }
+        default:
+            return decode_error(interpreter, "operand cannot be interpreted");
+    }
+}
+
+static bool decode_block(struct interpreter* interpreter, struct unit* unit, struct operand operand,
+                         uint32_t* offsets, uint32_t* out) {
+    if (operand.type != OPERAND_TYPE_BLOCK) {
+        return decode_error(interpreter, "expected a block operand");
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        if (unit->blocks[i] == operand.value.block) {
+            *out = offsets[i];
+            return true;
+        }
+    }
+    return decode_error(interpreter, "branch to a block outside of the unit");
+}
+
+// picks the integer, float or double variant of an operator
+static bool pick(struct interpreter* interpreter, struct value_type type, enum code_op s, enum code_op u,
+                 enum code_op f32, enum code_op f64, uint16_t* out) {
+    switch (type.kind) {
+        case VALUE_KIND_SIGNED: *out = s; return true;
+        case VALUE_KIND_UNSIGNED: *out = u; return true;
+        case VALUE_KIND_F32: *out = f32; return f32 != CODE_NOP || decode_error(interpreter, "operator needs integers");
+        case VALUE_KIND_F64: *out = f64; return f64 != CODE_NOP || decode_error(interpreter, "operator needs integers");
+        default: return decode_error(interpreter, "operator has no interpretable type");
+    }
+}
+
+static bool decode_cast(struct interpreter* interpreter, struct value_type from, struct value_type to, uint16_t* out) {
+    bool from_int = from.kind == VALUE_KIND_SIGNED || from.kind == VALUE_KIND_UNSIGNED;
+    bool to_int = to.kind == VALUE_KIND_SIGNED || to.kind == VALUE_KIND_UNSIGNED;
+    if (from.kind == VALUE_KIND_NONE || to.kind == VALUE_KIND_NONE) {
+        return decode_error(interpreter, "cast has no interpretable type");
+    }
+    if (from_int && to_int) {
+        *out = to.kind == VALUE_KIND_SIGNED ? CODE_NORM_S : CODE_NORM_U;
+    } else if (from_int) {
+        bool s = from.kind == VALUE_KIND_SIGNED;
+        *out = to.kind == VALUE_KIND_F32 ? (s ? CODE_S_TO_F32 : CODE_U_TO_F32) : (s ? CODE_S_TO_F64 : CODE_U_TO_F64);
+    } else if (to_int) {
+        bool s = to.kind == VALUE_KIND_SIGNED;
+        *out = from.kind == VALUE_KIND_F32 ? (s ? CODE_F32_TO_S : CODE_F32_TO_U) : (s ? CODE_F64_TO_S : CODE_F64_TO_U);
+    } else if (from.kind != to.kind) {
+        *out = from.kind == VALUE_KIND_F32 ? CODE_F32_TO_F64 : CODE_F64_TO_F32;
+    } else {
+        *out = CODE_MOVE;
+    }
+    return true;
+}
+
+// size of the memory a pointer operand refers to
+static size_t pointee_size(struct operand pointer, struct operand value) {
+    struct ast_node* type = pointer.typename.type;
+    if (type != NULL && (type->type == AST_NODE_TYPE_REFERENCE || type->type == AST_NODE_TYPE_POINTER)) {
+        return ast_node_symbol_size(pointer.typename.module, type->children[0]);
+    }
+    return value.typename.size;
+}
+
+// instructions working on whole vectors or on their lanes, calls, returns and allocations of vectors are decoded
+// with the scalar ones
+static bool vector_instruction(struct ssa_instruction* instruction) {
+    switch (instruction->operator) {
+        case OP_BROADCAST:
+        case OP_EXTRACT:
+        case OP_INSERT:
+            return true;
+        case OP_ALLOC:
+        case OP_CALL:
+        case OP_RETURN:
+            return false;
+        case OP_LOAD:
+            return is_vector(instruction->result.typename);
+        case OP_STORE:
+            return is_vector(instruction->operands[1].typename);
+        default:
+            return is_vector(instruction->type);
+    }
+}
+
+static bool decode_vector(struct interpreter* interpreter, struct interpreter_function* function,
+                          struct ssa_instruction* instruction) {
+    struct code code = {};
+    struct ssa_type shape = instruction->type;
+    if (instruction->operator == OP_EXTRACT || instruction->operator == OP_STORE) {
+        shape = instruction->operator == OP_EXTRACT ? instruction->operands[0].typename : instruction->operands[1].typename;
+    } else if (instruction->operator == OP_LOAD) {
+        shape = instruction->result.typename;
+    }
+    if (!vector_shape(shape, &code.shift, &code.lanes)) {
+        return decode_error(interpreter, "vector has no interpretable lanes");
+    }
+    bool integer = code.shift < LANE_F32;
+
+    switch (instruction->operator) {
+        case OP_ADD: code.op = CODE_VADD; break;
+        case OP_SUB: code.op = CODE_VSUB; break;
+        case OP_MUL: code.op = CODE_VMUL; break;
+        case OP_DIV: code.op = CODE_VDIV; break;
+        case OP_BITWISE_AND: code.op = CODE_VAND; break;
+        case OP_BITWISE_OR: code.op = CODE_VOR; break;
+        case OP_BITWISE_XOR: code.op = CODE_VXOR; break;
+        case OP_LESS: code.op = CODE_VLT; break;
+        case OP_LESS_EQUAL: code.op = CODE_VLE; break;
+        case OP_GREATER: code.op = CODE_VGT; break;
+        case OP_GREATER_EQUAL: code.op = CODE_VGE; break;
+        case OP_EQUAL: code.op = CODE_VEQ; break;
+        case OP_NOT_EQUAL: code.op = CODE_VNE; break;
+        case OP_NEGATE: code.op = CODE_VNEG; break;
+        case OP_BITWISE_NOT: code.op = CODE_VBNOT; break;
+        case OP_CAST: code.op = CODE_VCAST; break;
+        case OP_BROADCAST: code.op = CODE_VSPLAT; break;
+        case OP_EXTRACT: code.op = CODE_VEXTRACT; break;
+        case OP_INSERT: code.op = CODE_VINSERT; break;
+        case OP_LOAD: code.op = CODE_VLOAD; break;
+        case OP_STORE: code.op = CODE_VSTORE; break;
+        default: return decode_error(interpreter, "operator has no vector form");
+    }
+    if (!integer && (code.op == CODE_VAND || code.op == CODE_VOR || code.op == CODE_VXOR || code.op == CODE_VBNOT)) {
+        return decode_error(interpreter, "operator needs integers");
+    }
+
+    switch (code_formats[code.op]) {
+        case CODE_FORMAT_ABC: {
+            code.a = register_slot(function, instruction->result);
+            uint32_t value = instruction->operator == OP_INSERT ? 2 : 1;
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b) ||
+                !decode_operand(interpreter, function, instruction->operands[value], &code.c)) {
+                return false;
+            }
+            break;
+        }
+        case CODE_FORMAT_AB:
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b)) {
+                return false;
+            }
+            break;
+        case CODE_FORMAT_STORE:
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.a) ||
+                !decode_operand(interpreter, function, instruction->operands[1], &code.b)) {
+                return false;
+            }
+            break;
+        default:
+            break;
+    }
+
+    switch (code.op) {
+        case CODE_VCAST: {
+            uint8_t from, lanes;
+            if (!vector_shape(instruction->operands[0].typename, &from, &lanes) || lanes != code.lanes) {
+                return decode_error(interpreter, "vector cast needs vectors with the same lanes");
+            }
+            code.c = from;
+            break;
+        }
+        case CODE_VEXTRACT:
+        case CODE_VINSERT:
+            if (instruction->operands[1].type != OPERAND_TYPE_INTEGER ||
+                instruction->operands[1].value.integer >= code.lanes) {
+                return decode_error(interpreter, "vector lane must be a constant in range");
+            }
+            code.lanes = (uint8_t) instruction->operands[1].value.integer;
+            break;
+        case CODE_VLOAD:
+        case CODE_VSTORE:
+            code.c = (uint32_t) shape.size;
+            break;
+        default:
+            break;
+    }
+
+    function_emit(function, code);
+    return true;
+}
+
+static bool decode_instruction(struct interpreter* interpreter, struct interpreter_function* function,
+                               uint32_t* offsets, struct ssa_instruction* instruction) {
+    struct unit* unit = function->unit;
+    struct code code = {};
+    struct value_type type = value_type(instruction->type.type ? instruction->type : instruction->result.typename);
+    code.shift = value_shift(type);
+
+    if (vector_instruction(instruction)) {
+        return decode_vector(interpreter, function, instruction);
+    }
+
+    switch (instruction->operator) {
+        case OP_NONE:
+            code.op = CODE_NOP;
+            break;
+        case OP_CONST: {
+            code.op = CODE_MOVE;
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b)) {
+                return false;
+            }
+            break;
+        }
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_BITWISE_AND:
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+        case OP_BITWISE_LEFT:
+        case OP_BITWISE_RIGHT:
+        case OP_AND:
+        case OP_OR:
+        case OP_LESS:
+        case OP_LESS_EQUAL:
+        case OP_GREATER:
+        case OP_GREATER_EQUAL:
+        case OP_EQUAL:
+        case OP_NOT_EQUAL: {
+            bool ok;
+            switch (instruction->operator) {
+                case OP_ADD: ok = pick(interpreter, type, CODE_ADD_S, CODE_ADD_U, CODE_ADD_F32, CODE_ADD_F64, &code.op); break;
+                case OP_SUB: ok = pick(interpreter, type, CODE_SUB_S, CODE_SUB_U, CODE_SUB_F32, CODE_SUB_F64, &code.op); break;
+                case OP_MUL: ok = pick(interpreter, type, CODE_MUL_S, CODE_MUL_U, CODE_MUL_F32, CODE_MUL_F64, &code.op); break;
+                case OP_DIV: ok = pick(interpreter, type, CODE_DIV_S, CODE_DIV_U, CODE_DIV_F32, CODE_DIV_F64, &code.op); break;
+                case OP_BITWISE_AND: ok = pick(interpreter, type, CODE_AND, CODE_AND, CODE_NOP, CODE_NOP, &code.op); break;
+                case OP_BITWISE_OR: ok = pick(interpreter, type, CODE_OR, CODE_OR, CODE_NOP, CODE_NOP, &code.op); break;
+                case OP_BITWISE_XOR: ok = pick(interpreter, type, CODE_XOR, CODE_XOR, CODE_NOP, CODE_NOP, &code.op); break;
+                case OP_BITWISE_LEFT: ok = pick(interpreter, type, CODE_SHL_S, CODE_SHL_U, CODE_NOP, CODE_NOP, &code.op); break;
+                case OP_BITWISE_RIGHT: ok = pick(interpreter, type, CODE_SHR_S, CODE_SHR_U, CODE_NOP, CODE_NOP, &code.op); break;
+                case OP_AND: ok = pick(interpreter, type, CODE_LAND, CODE_LAND, CODE_LAND, CODE_LAND, &code.op); break;
+                case OP_OR: ok = pick(interpreter, type, CODE_LOR, CODE_LOR, CODE_LOR, CODE_LOR, &code.op); break;
+                case OP_LESS: ok = pick(interpreter, type, CODE_LT_S, CODE_LT_U, CODE_LT_F32, CODE_LT_F64, &code.op); break;
+                case OP_LESS_EQUAL: ok = pick(interpreter, type, CODE_LE_S, CODE_LE_U, CODE_LE_F32, CODE_LE_F64, &code.op); break;
+                case OP_GREATER: ok = pick(interpreter, type, CODE_GT_S, CODE_GT_U, CODE_GT_F32, CODE_GT_F64, &code.op); break;
+                case OP_GREATER_EQUAL: ok = pick(interpreter, type, CODE_GE_S, CODE_GE_U, CODE_GE_F32, CODE_GE_F64, &code.op); break;
+                case OP_EQUAL: ok = pick(interpreter, type, CODE_EQ, CODE_EQ, CODE_EQ_F32, CODE_EQ_F64, &code.op); break;
+                case OP_NOT_EQUAL: ok = pick(interpreter, type, CODE_NE, CODE_NE, CODE_NE_F32, CODE_NE_F64, &code.op); break;
+                default: ok = decode_error(interpreter, "unsupported operator"); break;
+            }
+            if (!ok) {
+                return false;
+            }
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b) ||
+                !decode_operand(interpreter, function, instruction->operands[1], &code.c)) {
+                return false;
+            }
+            break;
+        }
+        case OP_NEGATE:
+        case OP_BITWISE_NOT:
+        case OP_NOT: {
+            bool ok;
+            if (instruction->operator == OP_NEGATE) {
+                ok = pick(interpreter, type, CODE_NEG_S, CODE_NEG_U, CODE_NEG_F32, CODE_NEG_F64, &code.op);
+            } else if (instruction->operator == OP_BITWISE_NOT) {
+                ok = pick(interpreter, type, CODE_BNOT_S, CODE_BNOT_U, CODE_NOP, CODE_NOP, &code.op);
+            } else {
+                ok = pick(interpreter, type, CODE_NOT, CODE_NOT, CODE_NOT, CODE_NOT, &code.op);
+            }
+            if (!ok) {
+                return false;
+            }
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b)) {
+                return false;
+            }
+            break;
+        }
+        case OP_CAST: {
+            struct value_type from = value_type(instruction->operands[0].typename);
+            if (!decode_cast(interpreter, from, type, &code.op)) {
+                return false;
+            }
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b)) {
+                return false;
+            }
+            break;
+        }
+        case OP_NULL_CHECK: {
+            code.op = CODE_NULL_CHECK;
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b)) {
+                return false;
+            }
+            break;
+        }
+        case OP_BOUNDS_CHECK: {
+            code.op = CODE_BOUNDS_CHECK;
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b) ||
+                !decode_operand(interpreter, function, instruction->operands[1], &code.c)) {
+                return false;
+            }
+            break;
+        }
+        case OP_GOTO: {
+            code.op = CODE_JMP;
+            if (!decode_block(interpreter, unit, instruction->operands[0], offsets, &code.a)) {
+                return false;
+            }
+            break;
+        }
+        case OP_IF: {
+            code.op = CODE_BR;
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.a) ||
+                !decode_block(interpreter, unit, instruction->operands[1], offsets, &code.b) ||
+                !decode_block(interpreter, unit, instruction->operands[2], offsets, &code.c)) {
+                return false;
+            }
+            break;
+        }
+        case OP_RETURN: {
+            if (instruction->operands[0].type == OPERAND_TYPE_NONE) {
+                code.op = CODE_RET_VOID;
+                break;
+            }
+            code.op = is_vector(instruction->operands[0].typename) ? CODE_RET_VECTOR : CODE_RET;
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.a)) {
+                return false;
+            }
+            break;
+        }
+        case OP_CALL: {
+            if (instruction->operands[0].type == OPERAND_TYPE_REGISTER) {
+                // a method out of a vtable, its arguments are every operand up to the first missing one
+                code.op = CODE_CALL_INDIRECT;
+                code.a = register_slot(function, instruction->result);
+                code.b = register_slot(function, instruction->operands[0]);
+                code.c = function->call_args_count;
+                uint32_t count = 0;
+                while (count + 1 < MAX_OPERANDS && instruction->operands[count + 1].type != OPERAND_TYPE_NONE) {
+                    count++;
+                }
+                function_call_arg(function, count);
+                for (uint32_t i = 0; i < count; i++) {
+                    uint32_t slot;
+                    if (!decode_operand(interpreter, function, instruction->operands[i + 1], &slot)) {
+                        return false;
+                    }
+                    function_call_arg(function, slot);
+                }
+                break;
+            }
+            if (instruction->operands[0].type != OPERAND_TYPE_IR) {
+                return decode_error(interpreter, "call target must be a unit or a method out of a vtable");
+            }
+            struct unit* callee = instruction->operands[0].value.unit;
+            code.op = CODE_CALL;
+            code.a = register_slot(function, instruction->result);
+            code.b = interpreter_function_index(interpreter, callee);
+            code.c = function->call_args_count;
+            function_call_arg(function, callee->argument_count);
+            for (uint32_t i = 0; i < callee->argument_count; i++) {
+                uint32_t slot;
+                if (!decode_operand(interpreter, function, instruction->operands[i + 1], &slot)) {
+                    return false;
+                }
+                function_call_arg(function, slot);
+            }
+            break;
+        }
+        case OP_FIELD: {
+            code.op = CODE_ADD_U;
+            code.shift = 0;
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b) ||
+                !decode_operand(interpreter, function, instruction->operands[1], &code.c)) {
+                return false;
+            }
+            break;
+        }
+        case OP_HEAP_ALLOC: {
+            code.a = register_slot(function, instruction->result);
+            if (instruction->operands[1].type == OPERAND_TYPE_REGISTER) {
+                code.op = CODE_REGION_ALLOC;
+                if (!decode_operand(interpreter, function, instruction->operands[1], &code.b) ||
+                    !decode_operand(interpreter, function, instruction->operands[0], &code.c)) {
+                    return false;
+                }
+                break;
+            }
+            code.op = CODE_HEAP_ALLOC;
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b)) {
+                return false;
+            }
+            break;
+        }
+        case OP_HEAP_FREE: {
+            code.op = CODE_HEAP_FREE;
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.a)) {
+                return false;
+            }
+            break;
+        }
+        case OP_HEAP_REALLOC: {
+            code.op = CODE_HEAP_REALLOC;
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b) ||
+                !decode_operand(interpreter, function, instruction->operands[1], &code.c)) {
+                return false;
+            }
+            break;
+        }
+        case OP_REGION_ENTER: {
+            code.op = CODE_REGION_NEW;
+            code.a = register_slot(function, instruction->result);
+            code.b = REGION_CHUNK;
+            break;
+        }
+        case OP_VTABLE: {
+            code.op = CODE_MOVE;
+            code.a = register_slot(function, instruction->result);
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.b)) {
+                return false;
+            }
+            break;
+        }
+        case OP_REGION_LEAVE: {
+            code.op = CODE_REGION_FREE;
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.a)) {
+                return false;
+            }
+            break;
+        }
+        case OP_ALLOC: {
+            size_t size = instruction->operands[0].type == OPERAND_TYPE_INTEGER
+                              ? instruction->operands[0].value.integer
+                              : instruction->type.size;
+            code.op = CODE_ALLOC;
+            code.a = register_slot(function, instruction->result);
+            code.b = size == 0 ? 8 : (size + 7) & ~(size_t) 7;
+            break;
+        }
+        case OP_LOAD: {
+            struct value_type loaded = value_type(instruction->result.typename);
+            switch (loaded.kind) {
+                case VALUE_KIND_SIGNED:
+                    code.op = loaded.size == 1 ? CODE_LOAD_S8 : loaded.size == 2 ? CODE_LOAD_S16 :
+                              loaded.size == 4 ? CODE_LOAD_S32 : CODE_LOAD_64;
+                    break;
+                case VALUE_KIND_UNSIGNED:
+                    code.op = loaded.size == 1 ? CODE_LOAD_U8 : loaded.size == 2 ? CODE_LOAD_U16 :
+                              loaded.size == 4 ? CODE_LOAD_U32 : CODE_LOAD_64;
+                    break;
+                case VALUE_KIND_F32:
+                    code.op = CODE_LOAD_F32;
+                    break;
+                case VALUE_KIND_F64:
+                    code.op = CODE_LOAD_64;
+                    break;
+                default:
+                    return decode_error(interpreter, "load has no interpretable type");
+            }
+            code.a = register_slot(function, instruction->result);
+            struct operand address = instruction->operands[0];
+            if (address.type == OPERAND_TYPE_IR ? !decode_global(interpreter, function, address, true, &code.b)
+                                                : !decode_operand(interpreter, function, address, &code.b)) {
+                return false;
+            }
+            break;
+        }
+        case OP_STORE: {
+            size_t size = pointee_size(instruction->operands[0], instruction->operands[1]);
+            switch (size) {
+                case 1: code.op = CODE_STORE_8; break;
+                case 2: code.op = CODE_STORE_16; break;
+                case 4: code.op = CODE_STORE_32; break;
+                case 8: code.op = CODE_STORE_64; break;
+                default: return decode_error(interpreter, "store has no interpretable size");
+            }
+            if (!decode_operand(interpreter, function, instruction->operands[0], &code.a) ||
+                !decode_operand(interpreter, function, instruction->operands[1], &code.b)) {
+                return false;
+            }
+            break;
+        }
+        default:
+            return decode_error(interpreter, "unsupported operator");
+    }
+
+    function_emit(function, code);
+    return true;
+}
+
+// true if the address of a local is used for more than loading and storing, a callee could then still be reading
+// this frame's memory
+static bool frame_escapes(struct unit* unit) {
+    uint32_t count = unit_register_count(unit);
+    bool* local = calloc(count + 1, sizeof(bool));
+    assert(local);
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            if (block->instructions[j].operator == OP_ALLOC) {
+                local[block->instructions[j].result.value.integer] = true;
+            }
+        }
+    }
+
+    bool escapes = false;
+    for (uint32_t i = 0; i < unit->block_count && !escapes; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count && !escapes; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            bool access = instruction->operator == OP_LOAD || instruction->operator == OP_STORE;
+            for (int k = access ? 1 : 0; k < MAX_OPERANDS; k++) {
+                struct operand operand = instruction->operands[k];
+                if (operand.type == OPERAND_TYPE_REGISTER && operand.value.integer < count && local[operand.value.integer]) {
+                    escapes = true;
+                }
+            }
+        }
+    }
+    free(local);
+    return escapes;
+}
+
+// a call whose result is returned right away doesn't need its caller's frame, the callee takes it over so deep chains
+// of such calls run in constant stack
+static void mark_tail_calls(struct interpreter* interpreter, struct interpreter_function* function) {
+    for (uint32_t i = 0; i + 1 < function->code_count; i++) {
+        struct code* call = &function->code[i];
+        struct code* ret = &function->code[i + 1];
+        if (call->op == CODE_CALL && (ret->op == CODE_RET || ret->op == CODE_RET_VECTOR) && ret->a == call->a) {
+            call->op = CODE_TAIL_CALL;
+            interpreter->stats.tail_calls++;
+        }
+    }
+}
+
+static bool decode(struct interpreter* interpreter, struct interpreter_function* function) {
+    struct unit* unit = function->unit;
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return decode_error(interpreter, "unit is not a function");
+    }
+
+    for (uint32_t i = 0; i < unit->argument_count; i++) {
+        count_register(function, unit->arguments[i]);
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            count_register(function, instruction->result);
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                count_register(function, instruction->operands[k]);
+            }
+        }
+    }
+
+    // vector registers take several slots, so registers are laid out by a running sum of their widths
+    uint32_t registers = function->register_count;
+    uint8_t* widths = malloc(registers + 1);
+    assert(widths);
+    memset(widths, 1, registers + 1);
+    for (uint32_t i = 0; i < unit->argument_count; i++) {
+        width_register(widths, unit->arguments[i]);
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            width_register(widths, block->instructions[j].result);
+        }
+    }
+    function->register_slots = realloc(function->register_slots, sizeof(uint32_t) * (registers + 1));
+    function->argument_slots = realloc(function->argument_slots, sizeof(uint32_t) * (unit->argument_count + 1));
+    function->argument_widths = realloc(function->argument_widths, unit->argument_count + 1);
+    assert(function->register_slots && function->argument_slots && function->argument_widths);
+    uint32_t slot = 0;
+    for (uint32_t i = 0; i < registers; i++) {
+        function->register_slots[i] = slot;
+        slot += widths[i];
+    }
+    function->register_count = slot;
+    for (uint32_t i = 0; i < unit->argument_count; i++) {
+        function->argument_slots[i] = register_slot(function, unit->arguments[i]);
+        function->argument_widths[i] = widths[unit->arguments[i].value.integer];
+    }
+    free(widths);
+
+    // every ssa instruction becomes exactly one code, so block offsets are known up front
+    uint32_t* offsets = malloc(sizeof(uint32_t) * unit->block_count);
+    assert(offsets);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        offsets[i] = offset;
+        offset += unit->blocks[i]->instructions_count;
+    }
+
+    bool ok = true;
+    for (uint32_t i = 0; i < unit->block_count && ok; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count && ok; j++) {
+            ok = decode_instruction(interpreter, function, offsets, &block->instructions[j]);
+        }
+    }
+    free(offsets);
+
+    if (!ok) {
+        // start over cleanly if this unit is asked for again
+        function->code_count = 0;
+        function->register_count = 0;
+        function->constant_count = 0;
+        function->call_args_count = 0;
+        return false;
+    }
+
+    if (!frame_escapes(unit)) {
+        mark_tail_calls(interpreter, function);
+    }
+    function_emit(function, (struct code){CODE_FALL_OFF});
+    if (interpreter->optimize) {
+        peephole(interpreter, function);
+    }
+    function->decoded = true;
+    return true;
+}
+
+bool interpreter_load(struct interpreter* interpreter, struct unit* unit) {
+    interpreter->error = NULL;
+
+    // only the units reachable from this one need to decode, others may have failed on an earlier load
+    uint32_t entry = interpreter_function_index(interpreter, unit);
+    uint32_t capacity = interpreter->function_capacity;
+    bool* visited = calloc(capacity, sizeof(bool));
+    uint32_t stack_capacity = capacity;
+    uint32_t* stack = malloc(sizeof(uint32_t) * stack_capacity);
+    assert(visited && stack);
+    uint32_t top = 0;
+    stack[top++] = entry;
+
+    bool ok = true;
+    while (top > 0 && ok) {
+        uint32_t index = stack[--top];
+        if (visited[index]) {
+            continue;
+        }
+        visited[index] = true;
+
+        struct interpreter_function* function = interpreter->functions[index];
+        if (!function->decoded && !decode(interpreter, function)) {
+            ok = false;
+            break;
+        }
+
+        // decoding may discover new callees, so the function list can grow while walking it
+        if (interpreter->function_capacity > capacity) {
+            visited = realloc(visited, sizeof(bool) * interpreter->function_capacity);
+            assert(visited);
+            memset(visited + capacity, 0, sizeof(bool) * (interpreter->function_capacity - capacity));
+            capacity = interpreter->function_capacity;
+        }
+        for (uint32_t i = 0; i < function->code_count; i++) {
+            bool call = function->code[i].op == CODE_CALL || function->code[i].op == CODE_TAIL_CALL;
+            if (!call || visited[function->code[i].b]) {
+                continue;
+            }
+            if (top >= stack_capacity) {
+                stack_capacity *= 2;
+                stack = realloc(stack, sizeof(uint32_t) * stack_capacity);
+                assert(stack);
+            }
+            stack[top++] = function->code[i].b;
+        }
+        // and the methods of any vtable decoding made, any of them can be called through it
+        for (uint32_t i = 0; i < interpreter->vtable_count; i++) {
+            struct interpreter_vtable* vtable = &interpreter->vtables[i];
+            for (uint32_t j = 0; j < vtable->source->method_count; j++) {
+                uint64_t callee = vtable->functions[j];
+                if (vtable->source->methods[j] == NULL || visited[callee]) {
+                    continue;
+                }
+                if (top >= stack_capacity) {
+                    stack_capacity *= 2;
+                    stack = realloc(stack, sizeof(uint32_t) * stack_capacity);
+                    assert(stack);
+                }
+                stack[top++] = (uint32_t) callee;
+            }
+        }
+    }
+
+    free(visited);
+    free(stack);
+    return ok;
+}
+
+#pragma endregion
+
+#pragma region heap
+
+// a heap block's header, the payload follows it
+struct heap_header {
+    size_t size;
+    // offset of the next freed block's header, or HEAP_IN_USE while the block is allocated
+    size_t next;
+};
+
+static size_t heap_class(uint64_t size) {
+    return size == 0 ? 0 : (size - 1) / HEAP_CLASS_SIZE;
+}
+
+// carves a slab of blocks of a size class off the top of the heap into the class's free list, false if there's no
+// room left for even one
+static bool heap_refill(struct interpreter* interpreter, size_t class) {
+    size_t block = sizeof(struct heap_header) + (class + 1) * HEAP_CLASS_SIZE;
+    size_t count = HEAP_SLAB / block;
+    size_t room = (interpreter->heap_capacity - interpreter->heap_top) / block;
+    if (room < count) {
+        count = room;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    // threaded in address order, so blocks handed out one after another sit next to each other
+    uint8_t* heap = interpreter->heap;
+    size_t first = interpreter->heap_top;
+    for (size_t i = 0; i < count; i++) {
+        struct heap_header* header = (struct heap_header*) (heap + first + i * block);
+        header->size = block - sizeof(struct heap_header);
+        header->next = i + 1 < count ? first + (i + 1) * block : interpreter->heap_classes[class];
+    }
+    interpreter->heap_classes[class] = first;
+    interpreter->heap_top += count * block;
+    interpreter->heap_stats.slabs++;
+    return true;
+}
+
+static struct heap_header* small_alloc(struct interpreter* interpreter, uint64_t size) {
+    size_t class = heap_class(size);
+    size_t* list = &interpreter->heap_classes[class];
+    if (*list == HEAP_NONE && !heap_refill(interpreter, class)) {
+        return NULL;
+    }
+    struct heap_header* header = (struct heap_header*) (interpreter->heap + *list);
+    *list = header->next;
+    return header;
+}
+
+static struct heap_header* large_alloc(struct interpreter* interpreter, uint64_t size) {
+    size = (size + 7) & ~(uint64_t) 7;
+    uint8_t* heap = interpreter->heap;
+
+    size_t* link = &interpreter->heap_free;
+    while (*link != HEAP_NONE) {
+        struct heap_header* header = (struct heap_header*) (heap + *link);
+        if (header->size >= size) {
+            *link = header->next;
+            return header;
+        }
+        link = &header->next;
+    }
+
+    if (size > interpreter->heap_capacity - interpreter->heap_top - sizeof(struct heap_header)) {
+        return NULL;
+    }
+    struct heap_header* header = (struct heap_header*) (heap + interpreter->heap_top);
+    header->size = size;
+    interpreter->heap_top += sizeof(struct heap_header) + size;
+    return header;
+}
+
+static void heap_count(struct interpreter_heap_stats* stats, int64_t bytes) {
+    stats->bytes_in_use += bytes;
+    if (stats->bytes_in_use > stats->peak_bytes) {
+        stats->peak_bytes = stats->bytes_in_use;
+    }
+}
+
+// zeroed memory for size bytes, NULL if the heap has no room left
+static uint8_t* heap_alloc(struct interpreter* interpreter, uint64_t size) {
+    if (size > interpreter->heap_capacity) {
+        return NULL;
+    }
+    struct heap_header* header = size <= HEAP_SMALL_LIMIT ? small_alloc(interpreter, size)
+                                                          : large_alloc(interpreter, size);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->next = HEAP_IN_USE;
+    memset(header + 1, 0, header->size);
+    interpreter->heap_stats.allocations++;
+    heap_count(&interpreter->heap_stats, (int64_t) header->size);
+    return (uint8_t*) (header + 1);
+}
+
+// the header of the block a pointer the heap gave starts, NULL if the pointer can't be one
+static struct heap_header* heap_block(struct interpreter* interpreter, uint8_t* pointer) {
+    uint8_t* heap = interpreter->heap;
+    if (pointer < heap + sizeof(struct heap_header) || pointer >= heap + interpreter->heap_top ||
+        (pointer - heap) % 8 != 0) {
+        return NULL;
+    }
+    return (struct heap_header*) pointer - 1;
+}
+
+// false if the pointer isn't an allocated block, freeing null does nothing
+static bool heap_free(struct interpreter* interpreter, uint8_t* pointer) {
+    if (pointer == NULL) {
+        return true;
+    }
+    struct heap_header* header = heap_block(interpreter, pointer);
+    if (header == NULL) {
+        return false;
+    }
+    if (header->next == HEAP_IN_REGION) {
+        return true;
+    }
+    if (header->next != HEAP_IN_USE) {
+        return false;
+    }
+    size_t* list = header->size <= HEAP_SMALL_LIMIT ? &interpreter->heap_classes[heap_class(header->size)]
+                                                    : &interpreter->heap_free;
+    header->next = *list;
+    *list = (uint8_t*) header - interpreter->heap;
+    interpreter->heap_stats.frees++;
+    heap_count(&interpreter->heap_stats, -(int64_t) header->size);
+    return true;
+}
+
+// grows a large block into the free large block right after it, or the room after the top of the heap if it is the
+// last one. false if neither has room for size bytes
+static bool heap_grow(struct interpreter* interpreter, struct heap_header* header, uint64_t size) {
+    uint8_t* heap = interpreter->heap;
+    size_t end = (uint8_t*) (header + 1) - heap + header->size;
+    size = (size + 7) & ~(uint64_t) 7;
+    if (end == interpreter->heap_top) {
+        if (size - header->size > interpreter->heap_capacity - interpreter->heap_top) {
+            return false;
+        }
+        interpreter->heap_top += size - header->size;
+        header->size = size;
+        return true;
+    }
+
+    struct heap_header* next = (struct heap_header*) (heap + end);
+    if (next->size <= HEAP_SMALL_LIMIT || next->next == HEAP_IN_USE || next->next == HEAP_IN_REGION ||
+        header->size + sizeof(struct heap_header) + next->size < size) {
+        return false;
+    }
+    size_t* link = &interpreter->heap_free;
+    while (*link != end) {
+        link = &((struct heap_header*) (heap + *link))->next;
+    }
+    *link = next->next;
+    header->size += sizeof(struct heap_header) + next->size;
+    return true;
+}
+
+// the block resized to size bytes, the bytes it gains are zeroed. it stays where it is when it fits already or can
+// grow in place, otherwise it moves and the old block is freed. result is NULL and the block is left alone if the heap
+// has no room left, false if the pointer isn't an allocated block. a block a region gave can't grow
+static bool heap_realloc(struct interpreter* interpreter, uint8_t* pointer, uint64_t size, uint8_t** result) {
+    if (pointer == NULL) {
+        *result = heap_alloc(interpreter, size);
+        return true;
+    }
+    struct heap_header* header = heap_block(interpreter, pointer);
+    if (header == NULL || (header->next != HEAP_IN_USE && header->next != HEAP_IN_REGION)) {
+        return false;
+    }
+    interpreter->heap_stats.reallocations++;
+    size_t old_size = header->size;
+    if (size <= old_size) {
+        memset(pointer + size, 0, old_size - size);
+        interpreter->heap_stats.in_place++;
+        *result = pointer;
+        return true;
+    }
+    if (header->next == HEAP_IN_REGION) {
+        return false;
+    }
+    if (old_size > HEAP_SMALL_LIMIT && size <= interpreter->heap_capacity && heap_grow(interpreter, header, size)) {
+        memset(pointer + old_size, 0, header->size - old_size);
+        interpreter->heap_stats.in_place++;
+        heap_count(&interpreter->heap_stats, (int64_t) (header->size - old_size));
+        *result = pointer;
+        return true;
+    }
+
+    *result = heap_alloc(interpreter, size);
+    if (*result != NULL) {
+        memcpy(*result, pointer, old_size);
+        heap_free(interpreter, pointer);
+    }
+    return true;
+}
+
+// a region bumps through chunks it takes from the heap, every chunk starts with a pointer to the one taken before it
+struct region {
+    uint8_t* chunk;
+    size_t top;
+    size_t end;
+    // the least taken at once
+    size_t chunk_size;
+};
+
+// NULL if the heap has no room left for the region
+static uint8_t* region_new(struct interpreter* interpreter, uint64_t chunk_size) {
+    uint8_t* pointer = heap_alloc(interpreter, sizeof(struct region));
+    if (pointer != NULL) {
+        ((struct region*) pointer)->chunk_size = chunk_size;
+    }
+    return pointer;
+}
+
+// zeroed memory for size bytes that stays until the region is freed, NULL if the heap has no room left. every block
+// has a heap header like the heap's own so freeing one on its own is told apart and does nothing
+static uint8_t* region_alloc(struct interpreter* interpreter, uint8_t* pointer, uint64_t size) {
+    if (pointer == NULL || size > interpreter->heap_capacity) {
+        return NULL;
+    }
+    struct region* region = (struct region*) pointer;
+    size = size == 0 ? 8 : (size + 7) & ~(uint64_t) 7;
+    size_t needed = sizeof(struct heap_header) + size;
+
+    if (region->chunk == NULL || needed > region->end - region->top) {
+        size_t capacity = sizeof(uint8_t*) + needed;
+        if (capacity < region->chunk_size) {
+            capacity = region->chunk_size;
+        }
+        uint8_t* chunk = heap_alloc(interpreter, capacity);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        memcpy(chunk, &region->chunk, sizeof(uint8_t*));
+        region->chunk = chunk;
+        region->top = sizeof(uint8_t*);
+        region->end = capacity;
+    }
+    // chunks come zeroed from the heap and nothing in them is handed out twice
+    struct heap_header* header = (struct heap_header*) (region->chunk + region->top);
+    *header = (struct heap_header){size, HEAP_IN_REGION};
+    region->top += needed;
+    return (uint8_t*) (header + 1);
+}
+
+// gives every chunk back to the heap and then the region itself
+static bool region_free(struct interpreter* interpreter, uint8_t* pointer) {
+    if (pointer == NULL) {
+        return true;
+    }
+    uint8_t* chunk = ((struct region*) pointer)->chunk;
+    while (chunk != NULL) {
+        uint8_t* previous;
+        memcpy(&previous, chunk, sizeof(uint8_t*));
+        if (!heap_free(interpreter, chunk)) {
+            return false;
+        }
+        chunk = previous;
+    }
+    return heap_free(interpreter, pointer);
+}
+
+#pragma endregion
+
+#pragma region execution
+
+static bool run(struct interpreter* interpreter, struct interpreter_function* entry, union slot* result) {
+    static const void* labels[] = {
+#define CODE_LABEL(name, format) [CODE_##name] = &&target_##name,
+        CODE_LIST(CODE_LABEL)
+#undef CODE_LABEL
+    };
+
+    struct interpreter_function** functions = interpreter->functions;
+    struct frame* frames = malloc(sizeof(struct frame) * interpreter->max_depth);
+    assert(frames);
+    uint32_t depth = 0;
+
+    union slot* slots_end = interpreter->slots + interpreter->slot_capacity;
+    uint8_t* arena = interpreter->arena;
+    size_t arena_top = 0;
+    uint64_t fuel = interpreter->fuel;
+
+    struct interpreter_function* function = entry;
+    union slot* base = interpreter->slots;
+    struct code* ip = function->code;
+    bool ok = true;
+
+#define R(x) base[ip->x]
+#define DISPATCH() goto *labels[ip->op]
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+#define FAIL(message) do { interpreter->error = message; ok = false; goto done; } while (0)
+#define NORMALIZE_S(v) ((int64_t)((uint64_t)(v) << ip->shift) >> ip->shift)
+#define NORMALIZE_U(v) (((uint64_t)(v) << ip->shift) >> ip->shift)
+#define CHECK_ACCESS(p, n) \
+    if (((p) < arena || (p) + (n) > arena + arena_top) && \
+        ((p) < interpreter->heap || (p) + (n) > interpreter->heap + interpreter->heap_top)) FAIL("invalid memory access")
+#define BURN() if (--fuel == 0) FAIL("out of fuel")
+
+    DISPATCH();
+
+target_NOP:
+    NEXT();
+target_FALL_OFF:
+    FAIL("control fell off the end of a unit");
+
+target_ADD_S: R(a).i = NORMALIZE_S(R(b).u + R(c).u); NEXT();
+target_ADD_U: R(a).u = NORMALIZE_U(R(b).u + R(c).u); NEXT();
+target_SUB_S: R(a).i = NORMALIZE_S(R(b).u - R(c).u); NEXT();
+target_SUB_U: R(a).u = NORMALIZE_U(R(b).u - R(c).u); NEXT();
+target_MUL_S: R(a).i = NORMALIZE_S(R(b).u * R(c).u); NEXT();
+target_MUL_U: R(a).u = NORMALIZE_U(R(b).u * R(c).u); NEXT();
+target_DIV_S:
+    if (R(c).i == 0) FAIL("division by zero");
+    R(a).i = R(c).i == -1 ? NORMALIZE_S(0 - R(b).u) : R(b).i / R(c).i;
+    NEXT();
+target_DIV_U:
+    if (R(c).u == 0) FAIL("division by zero");
+    R(a).u = R(b).u / R(c).u;
+    NEXT();
+target_AND: R(a).u = R(b).u & R(c).u; NEXT();
+target_OR: R(a).u = R(b).u | R(c).u; NEXT();
+target_XOR: R(a).u = R(b).u ^ R(c).u; NEXT();
+target_SHL_S: R(a).i = NORMALIZE_S(R(b).u << (R(c).u & 63)); NEXT();
+target_SHL_U: R(a).u = NORMALIZE_U(R(b).u << (R(c).u & 63)); NEXT();
+target_SHR_S: R(a).i = R(b).i >> (R(c).u & 63); NEXT();
+target_SHR_U: R(a).u = R(b).u >> (R(c).u & 63); NEXT();
+target_NEG_S: R(a).i = NORMALIZE_S(0 - R(b).u); NEXT();
+target_NEG_U: R(a).u = NORMALIZE_U(0 - R(b).u); NEXT();
+target_BNOT_S: R(a).i = NORMALIZE_S(~R(b).u); NEXT();
+target_BNOT_U: R(a).u = NORMALIZE_U(~R(b).u); NEXT();
+target_NOT: R(a).u = R(b).u == 0; NEXT();
+target_LAND: R(a).u = R(b).u != 0 && R(c).u != 0; NEXT();
+target_LOR: R(a).u = R(b).u != 0 || R(c).u != 0; NEXT();
+
+target_LT_S: R(a).u = R(b).i < R(c).i; NEXT();
+target_LT_U: R(a).u = R(b).u < R(c).u; NEXT();
+target_LE_S: R(a).u = R(b).i <= R(c).i; NEXT();
+target_LE_U: R(a).u = R(b).u <= R(c).u; NEXT();
+target_GT_S: R(a).u = R(b).i > R(c).i; NEXT();
+target_GT_U: R(a).u = R(b).u > R(c).u; NEXT();
+target_GE_S: R(a).u = R(b).i >= R(c).i; NEXT();
+target_GE_U: R(a).u = R(b).u >= R(c).u; NEXT();
+target_EQ: R(a).u = R(b).u == R(c).u; NEXT();
+target_NE: R(a).u = R(b).u != R(c).u; NEXT();
+
+target_ADD_F32: R(a).f32 = R(b).f32 + R(c).f32; NEXT();
+target_SUB_F32: R(a).f32 = R(b).f32 - R(c).f32; NEXT();
+target_MUL_F32: R(a).f32 = R(b).f32 * R(c).f32; NEXT();
+target_DIV_F32: R(a).f32 = R(b).f32 / R(c).f32; NEXT();
+target_NEG_F32: R(a).f32 = -R(b).f32; NEXT();
+target_LT_F32: R(a).u = R(b).f32 < R(c).f32; NEXT();
+target_LE_F32: R(a).u = R(b).f32 <= R(c).f32; NEXT();
+target_GT_F32: R(a).u = R(b).f32 > R(c).f32; NEXT();
+target_GE_F32: R(a).u = R(b).f32 >= R(c).f32; NEXT();
+target_EQ_F32: R(a).u = R(b).f32 == R(c).f32; NEXT();
+target_NE_F32: R(a).u = R(b).f32 != R(c).f32; NEXT();
+
+target_ADD_F64: R(a).f64 = R(b).f64 + R(c).f64; NEXT();
+target_SUB_F64: R(a).f64 = R(b).f64 - R(c).f64; NEXT();
+target_MUL_F64: R(a).f64 = R(b).f64 * R(c).f64; NEXT();
+target_DIV_F64: R(a).f64 = R(b).f64 / R(c).f64; NEXT();
+target_NEG_F64: R(a).f64 = -R(b).f64; NEXT();
+target_LT_F64: R(a).u = R(b).f64 < R(c).f64; NEXT();
+target_LE_F64: R(a).u = R(b).f64 <= R(c).f64; NEXT();
+target_GT_F64: R(a).u = R(b).f64 > R(c).f64; NEXT();
+target_GE_F64: R(a).u = R(b).f64 >= R(c).f64; NEXT();
+target_EQ_F64: R(a).u = R(b).f64 == R(c).f64; NEXT();
+target_NE_F64: R(a).u = R(b).f64 != R(c).f64; NEXT();
+
+target_MOVE: R(a) = R(b); NEXT();
+target_NULL_CHECK:
+    if (R(b).ptr == NULL) FAIL("null pointer dereference");
+    R(a) = R(b);
+    NEXT();
+target_BOUNDS_CHECK:
+    // a negative index is a huge one unsigned
+    if (R(b).ptr == NULL || R(c).u >= ((struct array_header*) R(b).ptr)->length) FAIL("array index out of bounds");
+    R(a) = R(c);
+    NEXT();
+target_NORM_S: R(a).i = NORMALIZE_S(R(b).u); NEXT();
+target_NORM_U: R(a).u = NORMALIZE_U(R(b).u); NEXT();
+target_S_TO_F32: { float v = (float) R(b).i; R(a).u = 0; R(a).f32 = v; } NEXT();
+target_U_TO_F32: { float v = (float) R(b).u; R(a).u = 0; R(a).f32 = v; } NEXT();
+target_S_TO_F64: R(a).f64 = (double) R(b).i; NEXT();
+target_U_TO_F64: R(a).f64 = (double) R(b).u; NEXT();
+target_F32_TO_S: R(a).i = NORMALIZE_S((int64_t) R(b).f32); NEXT();
+target_F32_TO_U: R(a).u = NORMALIZE_U((int64_t) R(b).f32); NEXT();
+target_F64_TO_S: R(a).i = NORMALIZE_S((int64_t) R(b).f64); NEXT();
+target_F64_TO_U: R(a).u = NORMALIZE_U((int64_t) R(b).f64); NEXT();
+target_F32_TO_F64: R(a).f64 = (double) R(b).f32; NEXT();
+target_F64_TO_F32: { float v = (float) R(b).f64; R(a).u = 0; R(a).f32 = v; } NEXT();
+
+target_JMP:
+    BURN();
+    ip = function->code + ip->a;
+    DISPATCH();
+target_BR:
+    BURN();
+    ip = function->code + (R(a).u != 0 ? ip->b : ip->c);
+    DISPATCH();
+
+#define BRANCH_IF(condition) BURN(); ip = (condition) ? function->code + ip->c : ip + 1; DISPATCH()
+target_BLT_S: BRANCH_IF(R(a).i < R(b).i);
+target_BLT_U: BRANCH_IF(R(a).u < R(b).u);
+target_BLE_S: BRANCH_IF(R(a).i <= R(b).i);
+target_BLE_U: BRANCH_IF(R(a).u <= R(b).u);
+target_BGT_S: BRANCH_IF(R(a).i > R(b).i);
+target_BGT_U: BRANCH_IF(R(a).u > R(b).u);
+target_BGE_S: BRANCH_IF(R(a).i >= R(b).i);
+target_BGE_U: BRANCH_IF(R(a).u >= R(b).u);
+target_BEQ: BRANCH_IF(R(a).u == R(b).u);
+target_BNE: BRANCH_IF(R(a).u != R(b).u);
+target_BLT_F32: BRANCH_IF(R(a).f32 < R(b).f32);
+target_BLE_F32: BRANCH_IF(R(a).f32 <= R(b).f32);
+target_BGT_F32: BRANCH_IF(R(a).f32 > R(b).f32);
+target_BGE_F32: BRANCH_IF(R(a).f32 >= R(b).f32);
+target_BEQ_F32: BRANCH_IF(R(a).f32 == R(b).f32);
+target_BNE_F32: BRANCH_IF(R(a).f32 != R(b).f32);
+target_BLT_F64: BRANCH_IF(R(a).f64 < R(b).f64);
+target_BLE_F64: BRANCH_IF(R(a).f64 <= R(b).f64);
+target_BGT_F64: BRANCH_IF(R(a).f64 > R(b).f64);
+target_BGE_F64: BRANCH_IF(R(a).f64 >= R(b).f64);
+target_BEQ_F64: BRANCH_IF(R(a).f64 == R(b).f64);
+target_BNE_F64: BRANCH_IF(R(a).f64 != R(b).f64);
+#undef BRANCH_IF
+
+target_CALL:
+target_CALL_INDIRECT: {
+    BURN();
+    struct interpreter_function* callee = functions[ip->op == CODE_CALL ? ip->b : R(b).u];
+    uint32_t* args = function->call_args + ip->c;
+    union slot* callee_base = base + function->register_count + function->constant_count;
+    if (depth + 1 >= interpreter->max_depth ||
+        callee_base + callee->register_count + callee->constant_count > slots_end) {
+        FAIL("stack overflow");
+    }
+    memcpy(callee_base + callee->register_count, callee->constants, callee->constant_count * sizeof(union slot));
+    for (uint32_t i = 0; i < args[0]; i++) {
+        if (callee->argument_widths[i] == 1) {
+            callee_base[callee->argument_slots[i]] = base[args[i + 1]];
+        } else {
+            memcpy(callee_base + callee->argument_slots[i], base + args[i + 1], VECTOR_SIZE);
+        }
+    }
+    frames[depth++] = (struct frame){function, ip + 1, base, arena_top, ip->a};
+    function = callee;
+    base = callee_base;
+    ip = callee->code;
+    DISPATCH();
+}
+target_TAIL_CALL: {
+    BURN();
+    struct interpreter_function* callee = functions[ip->b];
+    uint32_t* args = function->call_args + ip->c;
+    if (base + callee->register_count + callee->constant_count > slots_end) {
+        FAIL("stack overflow");
+    }
+
+    // the callee's registers overlay this frame's, so the arguments are gathered before any are written
+    union slot staged[(MAX_OPERANDS - 1) * VECTOR_SLOTS];
+    uint32_t staged_count = 0;
+    for (uint32_t i = 0; i < args[0]; i++) {
+        memcpy(staged + staged_count, base + args[i + 1], callee->argument_widths[i] * sizeof(union slot));
+        staged_count += callee->argument_widths[i];
+    }
+    memcpy(base + callee->register_count, callee->constants, callee->constant_count * sizeof(union slot));
+    staged_count = 0;
+    for (uint32_t i = 0; i < args[0]; i++) {
+        memcpy(base + callee->argument_slots[i], staged + staged_count, callee->argument_widths[i] * sizeof(union slot));
+        staged_count += callee->argument_widths[i];
+    }
+    arena_top = depth > 0 ? frames[depth - 1].arena_mark : 0;
+    function = callee;
+    ip = callee->code;
+    DISPATCH();
+}
+target_RET:
+target_RET_VOID: {
+    union slot value = ip->op == CODE_RET ? R(a) : (union slot){.u = 0};
+    if (depth == 0) {
+        *result = value;
+        goto done;
+    }
+    struct frame* frame = &frames[--depth];
+    function = frame->function;
+    ip = frame->ip;
+    base = frame->base;
+    arena_top = frame->arena_mark;
+    base[frame->result] = value;
+    DISPATCH();
+}
+target_RET_VECTOR: {
+    if (depth == 0) FAIL("vectors cannot be returned out of the interpreter");
+    union slot* value = &R(a);
+    struct frame* frame = &frames[--depth];
+    function = frame->function;
+    ip = frame->ip;
+    base = frame->base;
+    arena_top = frame->arena_mark;
+    memcpy(base + frame->result, value, VECTOR_SIZE);
+    DISPATCH();
+}
+
+target_ALLOC:
+    if (arena_top + ip->b > interpreter->arena_capacity) FAIL("out of frame memory");
+    memset(arena + arena_top, 0, ip->b);
+    R(a).ptr = arena + arena_top;
+    arena_top += ip->b;
+    NEXT();
+target_HEAP_ALLOC: R(a).ptr = heap_alloc(interpreter, R(b).u); NEXT();
+target_HEAP_FREE: if (!heap_free(interpreter, R(a).ptr)) FAIL("invalid free"); NEXT();
+target_HEAP_REALLOC: {
+    uint8_t* pointer;
+    if (!heap_realloc(interpreter, R(b).ptr, R(c).u, &pointer)) FAIL("invalid realloc");
+    R(a).ptr = pointer;
+    NEXT();
+}
+target_REGION_NEW: R(a).ptr = region_new(interpreter, ip->b); NEXT();
+target_REGION_ALLOC: R(a).ptr = region_alloc(interpreter, R(b).ptr, R(c).u); NEXT();
+target_REGION_FREE: if (!region_free(interpreter, R(a).ptr)) FAIL("invalid region"); NEXT();
+target_LOAD_S8: CHECK_ACCESS(R(b).ptr, 1); { int8_t v; memcpy(&v, R(b).ptr, 1); R(a).i = v; } NEXT();
+target_LOAD_S16: CHECK_ACCESS(R(b).ptr, 2); { int16_t v; memcpy(&v, R(b).ptr, 2); R(a).i = v; } NEXT();
+target_LOAD_S32: CHECK_ACCESS(R(b).ptr, 4); { int32_t v; memcpy(&v, R(b).ptr, 4); R(a).i = v; } NEXT();
+target_LOAD_U8: CHECK_ACCESS(R(b).ptr, 1); { uint8_t v; memcpy(&v, R(b).ptr, 1); R(a).u = v; } NEXT();
+target_LOAD_U16: CHECK_ACCESS(R(b).ptr, 2); { uint16_t v; memcpy(&v, R(b).ptr, 2); R(a).u = v; } NEXT();
+target_LOAD_U32: CHECK_ACCESS(R(b).ptr, 4); { uint32_t v; memcpy(&v, R(b).ptr, 4); R(a).u = v; } NEXT();
+target_LOAD_64: CHECK_ACCESS(R(b).ptr, 8); memcpy(&R(a), R(b).ptr, 8); NEXT();
+target_LOAD_F32: CHECK_ACCESS(R(b).ptr, 4); { float v; memcpy(&v, R(b).ptr, 4); R(a).u = 0; R(a).f32 = v; } NEXT();
+target_STORE_8: CHECK_ACCESS(R(a).ptr, 1); { uint8_t v = R(b).u; memcpy(R(a).ptr, &v, 1); } NEXT();
+target_STORE_16: CHECK_ACCESS(R(a).ptr, 2); { uint16_t v = R(b).u; memcpy(R(a).ptr, &v, 2); } NEXT();
+target_STORE_32: CHECK_ACCESS(R(a).ptr, 4); memcpy(R(a).ptr, &R(b), 4); NEXT();
+target_STORE_64: CHECK_ACCESS(R(a).ptr, 8); memcpy(R(a).ptr, &R(b), 8); NEXT();
+
+    // vectors are copied out of the register file and back since slots are only 8 byte aligned
+#define VECTOR_BINARY(function) \
+    { union vector x, y, z; memcpy(&y, &R(b), VECTOR_SIZE); memcpy(&z, &R(c), VECTOR_SIZE); \
+      function(ip->shift, &x, &y, &z); memcpy(&R(a), &x, VECTOR_SIZE); } NEXT()
+#define VECTOR_BITWISE(op) \
+    { union vector x, y, z; memcpy(&y, &R(b), VECTOR_SIZE); memcpy(&z, &R(c), VECTOR_SIZE); \
+      x.u64 = y.u64 op z.u64; memcpy(&R(a), &x, VECTOR_SIZE); } NEXT()
+target_VADD: VECTOR_BINARY(vector_add);
+target_VSUB: VECTOR_BINARY(vector_sub);
+target_VMUL: VECTOR_BINARY(vector_mul);
+target_VDIV: {
+    union vector x = {}, y, z;
+    memcpy(&y, &R(b), VECTOR_SIZE);
+    memcpy(&z, &R(c), VECTOR_SIZE);
+    if (!vector_divide(ip->shift, ip->lanes, &x, &y, &z)) FAIL("division by zero");
+    memcpy(&R(a), &x, VECTOR_SIZE);
+    NEXT();
+}
+target_VAND: VECTOR_BITWISE(&);
+target_VOR: VECTOR_BITWISE(|);
+target_VXOR: VECTOR_BITWISE(^);
+target_VLT: VECTOR_BINARY(vector_lt);
+target_VLE: VECTOR_BINARY(vector_le);
+target_VGT: VECTOR_BINARY(vector_gt);
+target_VGE: VECTOR_BINARY(vector_ge);
+target_VEQ: VECTOR_BINARY(vector_eq);
+target_VNE: VECTOR_BINARY(vector_ne);
+#undef VECTOR_BINARY
+#undef VECTOR_BITWISE
+target_VNEG: {
+    union vector x, y;
+    memcpy(&y, &R(b), VECTOR_SIZE);
+    vector_negate(ip->shift, &x, &y);
+    memcpy(&R(a), &x, VECTOR_SIZE);
+    NEXT();
+}
+target_VBNOT: {
+    union vector x, y;
+    memcpy(&y, &R(b), VECTOR_SIZE);
+    x.u64 = ~y.u64;
+    memcpy(&R(a), &x, VECTOR_SIZE);
+    NEXT();
+}
+target_VCAST: {
+    union vector x = {}, y;
+    memcpy(&y, &R(b), VECTOR_SIZE);
+    for (uint32_t i = 0; i < ip->lanes; i++) {
+        vector_set(&x, ip->shift, i, lane_convert(vector_get(&y, ip->c, i), ip->c, ip->shift));
+    }
+    memcpy(&R(a), &x, VECTOR_SIZE);
+    NEXT();
+}
+target_VSPLAT: {
+    union vector x = {};
+    for (uint32_t i = 0; i < ip->lanes; i++) {
+        vector_set(&x, ip->shift, i, R(b));
+    }
+    memcpy(&R(a), &x, VECTOR_SIZE);
+    NEXT();
+}
+target_VEXTRACT: {
+    union vector y;
+    memcpy(&y, &R(b), VECTOR_SIZE);
+    R(a) = vector_get(&y, ip->shift, ip->lanes);
+    NEXT();
+}
+target_VINSERT: {
+    union vector x;
+    memcpy(&x, &R(b), VECTOR_SIZE);
+    vector_set(&x, ip->shift, ip->lanes, R(c));
+    memcpy(&R(a), &x, VECTOR_SIZE);
+    NEXT();
+}
+target_VLOAD: {
+    CHECK_ACCESS(R(b).ptr, ip->c);
+    union vector x = {};
+    memcpy(&x, R(b).ptr, ip->c);
+    memcpy(&R(a), &x, VECTOR_SIZE);
+    NEXT();
+}
+target_VSTORE: CHECK_ACCESS(R(a).ptr, ip->c); memcpy(R(a).ptr, &R(b), ip->c); NEXT();
+
+#undef R
+#undef DISPATCH
+#undef NEXT
+#undef FAIL
+#undef NORMALIZE_S
+#undef NORMALIZE_U
+#undef CHECK_ACCESS
+#undef BURN
+
+done:
+    interpreter->fuel = fuel;
+    free(frames);
+    return ok;
+}
+
+bool interpreter_call(struct interpreter* interpreter, struct unit* unit, union slot* args, uint32_t arg_count,
+                      union slot* result) {
+    if (!interpreter_load(interpreter, unit)) {
+        return false;
+    }
+    struct interpreter_function* function = interpreter->functions[interpreter_function_index(interpreter, unit)];
+    if (arg_count != unit->argument_count) {
+        interpreter->error = "wrong number of arguments";
+        return false;
+    }
+
+    union slot* base = interpreter->slots;
+    memcpy(base + function->register_count, function->constants, function->constant_count * sizeof(union slot));
+    for (uint32_t i = 0; i < arg_count; i++) {
+        if (function->argument_widths[i] != 1) {
+            interpreter->error = "vectors cannot be passed into the interpreter";
+            return false;
+        }
+        base[function->argument_slots[i]] = args[i];
+    }
+    return run(interpreter, function, result);
+}
+
+#pragma endregion
@@ -0,0 +1,111 @@
+#ifndef COMPILER_INTERPRETER_H
+#define COMPILER_INTERPRETER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "unit.h"
+
+// a single register slot, integers are kept sign/zero extended to 64 bits
+union slot {
+    int64_t i;
+    uint64_t u;
+    float f32;
+    double f64;
+    uint8_t* ptr;
+};
+
+struct interpreter_function;
+struct interpreter_vtable;
+struct interpreter_global;
+
+// code counts over every decoded unit, before and after the peephole pass
+struct interpreter_stats {
+    size_t decoded;
+    size_t emitted;
+    size_t fused_branches;
+    size_t forwarded_loads;
+    size_t removed_moves;
+    size_t removed_dead;
+    size_t removed_jumps;
+    size_t tail_calls;
+};
+
+// how many sizes small heap blocks come in, each a multiple of 16 bytes
+#define INTERPRETER_HEAP_CLASSES 16
+
+// what the heap has done so far
+struct interpreter_heap_stats {
+    size_t allocations;
+    size_t frees;
+    size_t reallocations;
+    // reallocations that kept their block, by fitting already or growing into the free block after it
+    size_t in_place;
+    // runs of small blocks carved off the top of the heap at once
+    size_t slabs;
+    size_t bytes_in_use;
+    size_t peak_bytes;
+};
+
+struct interpreter {
+    // every unit that has been decoded, calls refer to these by index
+    struct interpreter_function** functions;
+    uint32_t function_count;
+    uint32_t function_capacity;
+
+    // the vtables decoded units take the address of, each is the index of the function for every method of its
+    // interface so calling through one only takes a load
+    struct interpreter_vtable* vtables;
+    uint32_t vtable_count;
+    uint32_t vtable_capacity;
+
+    // the memory of every global decoded units refer to
+    struct interpreter_global* globals;
+    uint32_t global_count;
+    uint32_t global_capacity;
+
+    // register file shared by all frames
+    union slot* slots;
+    size_t slot_capacity;
+
+    // OP_ALLOC memory, reset when the frame that allocated it returns
+    uint8_t* arena;
+    size_t arena_capacity;
+
+    // OP_HEAP_ALLOC memory, kept until it is freed. every block starts with a header holding its size. small blocks
+    // come from slabs of blocks of one size class and go back to that class's free list, larger freed blocks are
+    // threaded into a list through their headers and reused by the first allocation they fit. regions take their
+    // memory from the heap a chunk at a time. an interpreter runs on one thread, so none of this takes a lock
+    uint8_t* heap;
+    size_t heap_capacity;
+    size_t heap_top;
+    size_t heap_free;
+    size_t heap_classes[INTERPRETER_HEAP_CLASSES];
+    struct interpreter_heap_stats heap_stats;
+
+    uint32_t max_depth;
+
+    // branches and calls left before execution gives up, keeps compile time evaluation from hanging
+    uint64_t fuel;
+
+    // run the peephole pass over decoded units
+    bool optimize;
+
+    // set while evaluating at compile time, globals can only be read then and only once their value is known
+    bool evaluating;
+    struct interpreter_stats stats;
+
+    const char* error;
+};
+
+struct interpreter* interpreter_new();
+
+void interpreter_free(struct interpreter* interpreter);
+
+// decodes the unit (and every unit it can call) into bytecode, returns false if it can't be interpreted
+bool interpreter_load(struct interpreter* interpreter, struct unit* unit);
+
+bool interpreter_call(struct interpreter* interpreter, struct unit* unit, union slot* args, uint32_t arg_count,
+                      union slot* result);
+
+#endif //COMPILER_INTERPRETER_H
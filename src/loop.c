@@ -0,0 +1,427 @@
+#include "loop.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+
+struct ssa_instruction* block_terminator(struct block* block) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        enum ssa_instruction_code operator = block->instructions[i].operator;
+        if (operator == OP_GOTO || operator == OP_IF || operator == OP_RETURN) {
+            return &block->instructions[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t block_index(struct unit* unit, struct block* block) {
+    uint32_t index = block->id - 1;
+    assert(index < unit->block_count && unit->blocks[index] == block);
+    return index;
+}
+
+uint32_t block_successors(struct unit* unit, struct block* block, uint32_t successors[2]) {
+    struct ssa_instruction* terminator = block_terminator(block);
+    if (terminator == NULL) {
+        uint32_t next = block_index(unit, block) + 1;
+        successors[0] = next;
+        return next < unit->block_count ? 1 : 0;
+    }
+    switch (terminator->operator) {
+        case OP_GOTO:
+            successors[0] = block_index(unit, terminator->operands[0].value.block);
+            return 1;
+        case OP_IF:
+            successors[0] = block_index(unit, terminator->operands[1].value.block);
+            successors[1] = block_index(unit, terminator->operands[2].value.block);
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+struct ssa_instruction* unit_definition(struct unit* unit, struct operand operand, struct block** block) {
+    if (operand.type != OPERAND_TYPE_REGISTER) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        for (uint32_t j = 0; j < unit->blocks[i]->instructions_count; j++) {
+            struct ssa_instruction* instruction = &unit->blocks[i]->instructions[j];
+            if (instruction->result.type == OPERAND_TYPE_REGISTER &&
+                instruction->result.value.integer == operand.value.integer) {
+                if (block != NULL) {
+                    *block = unit->blocks[i];
+                }
+                return instruction;
+            }
+        }
+    }
+    return NULL;
+}
+
+bool unit_is_local(struct unit* unit, struct operand pointer) {
+    struct ssa_instruction* definition = unit_definition(unit, pointer, NULL);
+    return definition != NULL && definition->operator == OP_ALLOC;
+}
+
+uint32_t unit_loop_headers(struct unit* unit, struct block** headers) {
+    uint32_t count = unit->block_count;
+    if (count == 0) {
+        return 0;
+    }
+
+    // 0 unvisited, 1 on the walk, 2 finished, an edge to a block still on the walk goes back to a loop header
+    uint8_t* state = calloc(count, sizeof(uint8_t));
+    bool* header = calloc(count, sizeof(bool));
+    uint32_t* stack = malloc(sizeof(uint32_t) * count);
+    uint32_t* edge = malloc(sizeof(uint32_t) * count);
+    assert(state && header && stack && edge);
+
+    uint32_t top = 0;
+    stack[top] = 0;
+    edge[top++] = 0;
+    state[0] = 1;
+    while (top > 0) {
+        uint32_t index = stack[top - 1];
+        uint32_t successors[2];
+        uint32_t successor_count = block_successors(unit, unit->blocks[index], successors);
+        if (edge[top - 1] >= successor_count) {
+            state[index] = 2;
+            top--;
+            continue;
+        }
+        uint32_t next = successors[edge[top - 1]++];
+        if (state[next] == 1) {
+            header[next] = true;
+        } else if (state[next] == 0) {
+            state[next] = 1;
+            stack[top] = next;
+            edge[top++] = 0;
+        }
+    }
+
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (header[i]) {
+            headers[found++] = unit->blocks[i];
+        }
+    }
+
+    free(state);
+    free(header);
+    free(stack);
+    free(edge);
+    return found;
+}
+
+static bool same_register(struct operand a, struct operand b) {
+    return a.type == OPERAND_TYPE_REGISTER && b.type == OPERAND_TYPE_REGISTER && a.value.integer == b.value.integer;
+}
+
+// true if the body stores to the slot
+static bool stored_in(struct block* block, struct operand pointer) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        if (instruction->operator == OP_STORE && same_register(instruction->operands[0], pointer)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// true if the operand has the same value on every iteration
+static bool invariant(struct unit* unit, struct loop* loop, struct operand operand) {
+    struct block* block;
+    struct ssa_instruction* definition = unit_definition(unit, operand, &block);
+    if (definition == NULL || (block != loop->header && block != loop->body)) {
+        return true;
+    }
+    if (block == loop->body) {
+        return false;
+    }
+    switch (definition->operator) {
+        case OP_LOAD:
+            if (unit_is_local(unit, definition->operands[0])) {
+                return !stored_in(loop->body, definition->operands[0]);
+            }
+            // an array gets its length when it is made and keeps it
+            struct ssa_instruction* field = unit_definition(unit, definition->operands[0], NULL);
+            return field != NULL && field->operator == OP_FIELD && field->operands[0].typename.type != NULL &&
+                   field->operands[0].typename.type->type == AST_NODE_TYPE_ARRAY &&
+                   field->operands[1].type == OPERAND_TYPE_INTEGER &&
+                   field->operands[1].value.integer == offsetof(struct array_header, length) &&
+                   invariant(unit, loop, field->operands[0]);
+        case OP_CALL:
+        case OP_ALLOC:
+            return false;
+        default:
+            for (int i = 0; i < MAX_OPERANDS; i++) {
+                if (definition->operands[i].type == OPERAND_TYPE_REGISTER &&
+                    !invariant(unit, loop, definition->operands[i])) {
+                    return false;
+                }
+            }
+            return true;
+    }
+}
+
+static bool is_integer(struct ssa_type type) {
+    return type.type != NULL && type.type->type >= AST_NODE_TYPE_I8 && type.type->type <= AST_NODE_TYPE_U64;
+}
+
+// true if every value of the narrower integer type is also one of the wider one
+static bool widens(struct ssa_type from, struct ssa_type to) {
+    if (!is_integer(from) || !is_integer(to) || to.size <= from.size) {
+        return false;
+    }
+    return from.type->type >= AST_NODE_TYPE_U8 || to.type->type <= AST_NODE_TYPE_I64;
+}
+
+// the integer an operand holds, either as an immediate or from a const instruction or a literal cast before folding
+static bool integer_constant(struct unit* unit, struct operand operand, int64_t* value) {
+    struct ssa_instruction* definition = unit_definition(unit, operand, NULL);
+    if (definition != NULL && (definition->operator == OP_CONST ||
+                               (definition->operator == OP_CAST && is_integer(definition->result.typename)))) {
+        operand = definition->operands[0];
+    }
+    *value = (int64_t) operand.value.integer;
+    return operand.type == OPERAND_TYPE_INTEGER;
+}
+
+const char* loop_match(struct unit* unit, struct block* header, struct loop* loop) {
+    memset(loop, 0, sizeof(struct loop));
+    loop->unit = unit;
+    loop->header = header;
+
+    struct ssa_instruction* branch = block_terminator(header);
+    if (branch == NULL || branch->operator != OP_IF) {
+        return "loop header doesn't end in a branch";
+    }
+    struct block* block;
+    loop->compare = unit_definition(unit, branch->operands[0], &block);
+    if (loop->compare == NULL || block != header ||
+        (loop->compare->operator != OP_LESS && loop->compare->operator != OP_LESS_EQUAL)) {
+        return "loop condition is not a < or <= compare";
+    }
+    // a narrow induction variable compared against a wider bound is widened first, which keeps its value
+    struct ssa_instruction* load = unit_definition(unit, loop->compare->operands[0], &block);
+    if (load != NULL && block == header && load->operator == OP_CAST && widens(load->operands[0].typename,
+                                                                               load->result.typename)) {
+        load = unit_definition(unit, load->operands[0], &block);
+    }
+    if (load == NULL || block != header || load->operator != OP_LOAD || !unit_is_local(unit, load->operands[0])) {
+        return "loop condition doesn't test a local variable";
+    }
+    loop->induction = load->operands[0];
+    loop->induction_type = load->result.typename;
+    loop->bound = loop->compare->operands[1];
+    if (!is_integer(loop->induction_type)) {
+        return "induction variable is not an integer";
+    }
+
+    loop->body = branch->operands[1].value.block;
+    loop->exit = branch->operands[2].value.block;
+    struct ssa_instruction* back = block_terminator(loop->body);
+    if (loop->body == header || back == NULL || back->operator != OP_GOTO || back->operands[0].value.block != header) {
+        return "loop body has control flow";
+    }
+    if (loop->exit == header || loop->exit == loop->body) {
+        return "loop never exits";
+    }
+
+    // the body and exactly one other block may enter the header
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* predecessor = unit->blocks[i];
+        uint32_t successors[2];
+        uint32_t count = block_successors(unit, predecessor, successors);
+        for (uint32_t j = 0; j < count; j++) {
+            if (unit->blocks[successors[j]] != header || predecessor == loop->body) {
+                continue;
+            }
+            struct ssa_instruction* jump = block_terminator(predecessor);
+            if (loop->preheader != NULL || jump == NULL || jump->operator != OP_GOTO) {
+                return "loop is entered from more than one place";
+            }
+            loop->preheader = predecessor;
+        }
+    }
+    if (loop->preheader == NULL) {
+        return "loop is never entered";
+    }
+
+    for (uint32_t i = 0; &header->instructions[i] != branch; i++) {
+        enum ssa_instruction_code operator = header->instructions[i].operator;
+        if (operator == OP_STORE || operator == OP_CALL || operator == OP_ALLOC) {
+            return "loop header has side effects";
+        }
+    }
+    if (!invariant(unit, loop, loop->bound)) {
+        return "loop bound changes inside the loop";
+    }
+
+    // a single store advances the induction variable, and nothing reads it afterwards
+    for (uint32_t i = 0; &loop->body->instructions[i] != back; i++) {
+        struct ssa_instruction* instruction = &loop->body->instructions[i];
+        if (instruction->operator == OP_LOAD && same_register(instruction->operands[0], loop->induction) &&
+            loop->increment != NULL) {
+            return "induction variable is read after it is incremented";
+        }
+        if (instruction->operator != OP_STORE || !same_register(instruction->operands[0], loop->induction)) {
+            continue;
+        }
+        if (loop->increment != NULL) {
+            return "induction variable is stored more than once";
+        }
+        loop->increment = instruction;
+    }
+    if (loop->increment == NULL) {
+        return "induction variable isn't advanced in the loop body";
+    }
+    struct ssa_instruction* add = unit_definition(unit, loop->increment->operands[1], &block);
+    if (add == NULL || block != loop->body || add->operator != OP_ADD) {
+        return "induction variable doesn't advance by a constant step";
+    }
+    int step_operand = integer_constant(unit, add->operands[1], &loop->step) ? 1 : 0;
+    struct ssa_instruction* current = unit_definition(unit, add->operands[1 - step_operand], &block);
+    if (!integer_constant(unit, add->operands[step_operand], &loop->step) || current == NULL || block != loop->body ||
+        current->operator != OP_LOAD || !same_register(current->operands[0], loop->induction)) {
+        return "induction variable doesn't advance by a constant step";
+    }
+    if (loop->step <= 0) {
+        return "induction variable doesn't count up";
+    }
+    return NULL;
+}
+
+// true if a local's address is used for anything but loading from and storing to it, it could be written through then
+static bool escapes(struct unit* unit, struct operand slot) {
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            bool access = instruction->operator == OP_LOAD || instruction->operator == OP_STORE;
+            for (int k = access ? 1 : 0; k < MAX_OPERANDS; k++) {
+                if (same_register(instruction->operands[k], slot)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// a local that is only ever stored to once, with a constant in the preheader, holds that constant inside the loop
+static bool preheader_constant(struct loop* loop, struct operand operand, int64_t* value) {
+    struct unit* unit = loop->unit;
+    struct ssa_instruction* load = unit_definition(unit, operand, NULL);
+    if (load == NULL || load->operator != OP_LOAD || !unit_is_local(unit, load->operands[0]) ||
+        escapes(unit, load->operands[0])) {
+        return false;
+    }
+
+    struct ssa_instruction* store = NULL;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator != OP_STORE || !same_register(instruction->operands[0], load->operands[0])) {
+                continue;
+            }
+            if (store != NULL || block != loop->preheader) {
+                return false;
+            }
+            store = instruction;
+        }
+    }
+    return store != NULL && integer_constant(unit, store->operands[1], value);
+}
+
+bool loop_start(struct loop* loop, int64_t* start) {
+    if (escapes(loop->unit, loop->induction)) {
+        return false;
+    }
+    bool found = false;
+    struct ssa_instruction* jump = block_terminator(loop->preheader);
+    for (struct ssa_instruction* instruction = loop->preheader->instructions; instruction != jump; instruction++) {
+        if (instruction->operator == OP_STORE && same_register(instruction->operands[0], loop->induction)) {
+            found = integer_constant(loop->unit, instruction->operands[1], start);
+        }
+    }
+    return found;
+}
+
+bool loop_trip_count(struct loop* loop, int64_t* count) {
+    int64_t start;
+    int64_t bound;
+    if (!loop_start(loop, &start) ||
+        (!integer_constant(loop->unit, loop->bound, &bound) && !preheader_constant(loop, loop->bound, &bound))) {
+        return false;
+    }
+
+    // keep well inside 64 bits so none of the arithmetic below can overflow
+    int64_t limit = (int64_t) 1 << 40;
+    if (start < -limit || start > limit || bound < -limit || bound > limit || loop->step > limit) {
+        return false;
+    }
+    if (loop->compare->operator == OP_LESS_EQUAL) {
+        bound++;
+    }
+    *count = bound > start ? (bound - start + loop->step - 1) / loop->step : 0;
+
+    // the induction variable must not wrap before the compare fails
+    size_t size = loop->induction_type.size;
+    bool is_signed = loop->induction_type.type->type <= AST_NODE_TYPE_I64;
+    int64_t max = size >= 8 ? INT64_MAX : is_signed ? ((int64_t) 1 << (size * 8 - 1)) - 1 : ((int64_t) 1 << size * 8) - 1;
+    int64_t min = is_signed ? (size >= 8 ? INT64_MIN : -((int64_t) 1 << (size * 8 - 1))) : 0;
+    int64_t end = start + *count * loop->step;
+    return start >= min && end <= max;
+}
+
+static struct operand emit(struct block* block, enum ssa_instruction_code operator, struct ssa_type type,
+                           struct operand a, struct operand b, uint32_t* next_register) {
+    struct ssa_instruction instruction = {};
+    instruction.operator = operator;
+    instruction.type = type;
+    instruction.result = operand_reg((*next_register)++, type);
+    instruction.operands[0] = a;
+    instruction.operands[1] = b;
+    block_add(block, instruction);
+    return instruction.result;
+}
+
+void loop_emit_guard(struct loop* loop, struct block* block, int64_t ahead, struct block* taken,
+                     struct block* otherwise, uint32_t* next_register) {
+    uint32_t register_count = *next_register;
+    struct operand* renames = malloc(sizeof(struct operand) * register_count);
+    assert(renames);
+    for (uint32_t i = 0; i < register_count; i++) {
+        renames[i] = operand_none();
+    }
+
+    // the bound is computed as the header does, the compare itself is replaced
+    struct ssa_instruction* branch = block_terminator(loop->header);
+    block_copy(block, loop->header->instructions, loop->compare, renames, next_register);
+    block_copy(block, loop->compare + 1, branch, renames, next_register);
+    struct operand current = renames[loop->compare->operands[0].value.integer];
+    struct operand bound = loop->bound;
+    if (bound.type == OPERAND_TYPE_REGISTER && renames[bound.value.integer].type != OPERAND_TYPE_NONE) {
+        bound = renames[bound.value.integer];
+    }
+    free(renames);
+
+    struct ssa_type wide = ssa_type_from_ast(loop->induction_type.module, ast_node_new(AST_NODE_TYPE_I64, token_null));
+    struct operand last = emit(block, OP_CAST, wide, current, operand_none(), next_register);
+    last = emit(block, OP_ADD, wide, last, operand_const_i64(ahead * loop->step), next_register);
+    bound = emit(block, OP_CAST, wide, bound, operand_none(), next_register);
+
+    struct ssa_instruction guard = {};
+    guard.operator = OP_IF;
+    guard.result = operand_end();
+    guard.operands[0] = emit(block, loop->compare->operator, wide, last, bound, next_register);
+    guard.operands[1] = operand_block(taken);
+    guard.operands[2] = operand_block(otherwise);
+    block_add(block, guard);
+}
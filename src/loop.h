@@ -0,0 +1,60 @@
+#ifndef COMPILER_LOOP_H
+#define COMPILER_LOOP_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "unit.h"
+
+// a counted loop in the shape ssa_gen lowers a for statement to: the preheader jumps to the header, the header loads
+// the induction variable, compares it against a bound that doesn't change in the loop and branches to the body or the
+// exit, and the body is a single block that ends by adding a constant step to the induction variable and jumping back
+struct loop {
+    struct unit* unit;
+    struct block* preheader;
+    struct block* header;
+    struct block* body;
+    struct block* exit;
+
+    // the compare in the header, its first operand is the loaded induction variable and its second the bound
+    struct ssa_instruction* compare;
+    struct operand bound;
+
+    // pointer to the induction variable's slot and the store in the body that advances it
+    struct operand induction;
+    struct ssa_type induction_type;
+    struct ssa_instruction* increment;
+    int64_t step;
+};
+
+// the first goto, if or return of a block, NULL if it falls through to the next block
+struct ssa_instruction* block_terminator(struct block* block);
+
+// indices of the blocks control can go to from a block, returns how many there are
+uint32_t block_successors(struct unit* unit, struct block* block, uint32_t successors[2]);
+
+// the instruction defining a register, and the block it is in
+struct ssa_instruction* unit_definition(struct unit* unit, struct operand operand, struct block** block);
+
+// true if the operand is a register holding the address of one of the unit's own allocations
+bool unit_is_local(struct unit* unit, struct operand pointer);
+
+// every loop header of the unit in block order, found as the targets of back edges while walking from the entry block.
+// headers must have room for a pointer per block, returns how many were found
+uint32_t unit_loop_headers(struct unit* unit, struct block** headers);
+
+// matches the counted loop starting at header, returns NULL on success and why it doesn't match otherwise
+const char* loop_match(struct unit* unit, struct block* header, struct loop* loop);
+
+// the constant value the induction variable starts at, false if it isn't known when the loop is entered
+bool loop_start(struct loop* loop, int64_t* start);
+
+// the constant number of times the body runs, false if the start or the bound aren't known
+bool loop_trip_count(struct loop* loop, int64_t* count);
+
+// fills block with a copy of the header that goes on to taken while the induction variable will still pass the loop
+// condition ahead steps from now and to otherwise when it won't. the compare is done in 64 bits so looking ahead can't
+// overflow the induction variable's type
+void loop_emit_guard(struct loop* loop, struct block* block, int64_t ahead, struct block* taken,
+                     struct block* otherwise, uint32_t* next_register);
+
+#endif //COMPILER_LOOP_H
@@ -0,0 +1,174 @@
+#include "loop_invariant.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alias.h"
+#include "block.h"
+#include "loop.h"
+
+struct hoister {
+    struct unit* unit;
+    struct alias_analysis* aliases;
+    struct loop loop;
+
+    // registers defined in the header or body that are still there
+    bool* inside;
+    // true once the body has passed something that may stop the program, code after it may not run on the first
+    // trip even though the loop does
+    bool trapped;
+    // true if the body runs at least once whenever the preheader does
+    bool entered;
+};
+
+// true if anything in the block may write the memory pointer refers to
+static bool clobbered_in(struct hoister* hoister, struct block* block, struct operand pointer) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        if (alias_clobbers(hoister->aliases, &block->instructions[i], pointer)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// a load moved in front of the loop runs even if the body wouldn't have, the memory has to be there regardless
+static bool safe_to_load(struct hoister* hoister, struct operand pointer) {
+    if (alias_base(hoister->aliases, pointer).kind == ALIAS_BASE_LOCAL) {
+        return true;
+    }
+    return hoister->entered && !hoister->trapped;
+}
+
+static bool invariant(struct hoister* hoister, struct ssa_instruction* instruction) {
+    switch (instruction->operator) {
+        case OP_CONST:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_BITWISE_AND:
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+        case OP_BITWISE_NOT:
+        case OP_BITWISE_LEFT:
+        case OP_BITWISE_RIGHT:
+        case OP_NEGATE:
+        case OP_NOT:
+        case OP_AND:
+        case OP_OR:
+        case OP_LESS:
+        case OP_LESS_EQUAL:
+        case OP_GREATER:
+        case OP_GREATER_EQUAL:
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_CAST:
+        case OP_BROADCAST:
+        case OP_EXTRACT:
+        case OP_INSERT:
+        case OP_LOAD:
+            break;
+        default:
+            return false;
+    }
+    for (int i = 0; i < MAX_OPERANDS; i++) {
+        struct operand operand = instruction->operands[i];
+        if (operand.type == OPERAND_TYPE_REGISTER && hoister->inside[operand.value.integer]) {
+            return false;
+        }
+    }
+    if (instruction->operator == OP_LOAD) {
+        struct operand pointer = instruction->operands[0];
+        return safe_to_load(hoister, pointer) && !clobbered_in(hoister, hoister->loop.header, pointer) &&
+               !clobbered_in(hoister, hoister->loop.body, pointer);
+    }
+    return true;
+}
+
+static void mark_inside(struct hoister* hoister, struct block* block) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct operand result = block->instructions[i].result;
+        if (result.type == OPERAND_TYPE_REGISTER) {
+            hoister->inside[result.value.integer] = true;
+        }
+    }
+}
+
+// moves every invariant instruction of the body to the end of the preheader in order, so whatever they read from
+// each other is still computed first. returns how many moved
+static uint32_t hoist(struct hoister* hoister) {
+    struct loop* loop = &hoister->loop;
+    struct block* body = loop->body;
+    int64_t trip_count;
+    hoister->entered = loop_trip_count(loop, &trip_count) && trip_count > 0;
+    hoister->trapped = false;
+    memset(hoister->inside, 0, sizeof(bool) * hoister->aliases->register_count);
+    mark_inside(hoister, loop->header);
+    mark_inside(hoister, body);
+
+    struct ssa_instruction* terminator = block_terminator(loop->preheader);
+    struct ssa_instruction jump = *terminator;
+    loop->preheader->instructions_count = terminator - loop->preheader->instructions;
+
+    uint32_t kept = 0;
+    uint32_t hoisted = 0;
+    for (uint32_t i = 0; i < body->instructions_count; i++) {
+        struct ssa_instruction instruction = body->instructions[i];
+        if (invariant(hoister, &instruction)) {
+            block_add(loop->preheader, instruction);
+            hoister->inside[instruction.result.value.integer] = false;
+            hoisted++;
+            continue;
+        }
+        if (instruction.operator == OP_DIV || instruction.operator == OP_NULL_CHECK ||
+            instruction.operator == OP_BOUNDS_CHECK || instruction.operator == OP_CALL) {
+            hoister->trapped = true;
+        }
+        body->instructions[kept++] = instruction;
+    }
+    body->instructions_count = kept;
+    block_add(loop->preheader, jump);
+    return hoisted;
+}
+
+void unit_hoist_loop_invariants(struct unit* unit, FILE* remarks) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return;
+    }
+
+    struct hoister hoister = {};
+    hoister.unit = unit;
+    hoister.aliases = alias_analysis_new(unit);
+    hoister.inside = calloc(hoister.aliases->register_count + 1, sizeof(bool));
+    struct block** headers = malloc(sizeof(struct block*) * unit->block_count);
+    assert(hoister.inside && headers);
+
+    uint32_t header_count = unit_loop_headers(unit, headers);
+    for (uint32_t i = 0; i < header_count; i++) {
+        uint32_t hoisted = 0;
+        const char* reason = loop_match(unit, headers[i], &hoister.loop);
+        if (reason == NULL) {
+            hoisted = hoist(&hoister);
+        }
+
+        if (remarks == NULL) {
+            continue;
+        }
+        fprintf(remarks, "licm: %s: loop at block %u ", unit->symbol, headers[i]->id);
+        if (reason != NULL) {
+            fprintf(remarks, "not hoisted from: %s\n", reason);
+        } else {
+            fprintf(remarks, "hoisted %u instructions\n", hoisted);
+        }
+    }
+
+    free(headers);
+    free(hoister.inside);
+    alias_analysis_free(hoister.aliases);
+}
+
+void unit_module_hoist_loop_invariants(struct unit_module* module, FILE* remarks) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_hoist_loop_invariants(module->units[i], remarks);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef COMPILER_LOOP_INVARIANT_H
+#define COMPILER_LOOP_INVARIANT_H
+#include <stdio.h>
+
+#include "unit.h"
+
+// moves the instructions of counted loop bodies that compute the same value on every trip into the preheader. loads
+// move when alias analysis shows nothing in the loop writes the memory they read. says what moved out of each loop
+// and why nothing did on remarks, unless it's NULL
+void unit_hoist_loop_invariants(struct unit* unit, FILE* remarks);
+
+void unit_module_hoist_loop_invariants(struct unit_module* module, FILE* remarks);
+
+#endif //COMPILER_LOOP_INVARIANT_H
@@ -0,0 +1,248 @@
+#include "loop_unroll.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "block.h"
+#include "loop.h"
+
+struct unroller {
+    struct unit* unit;
+    struct loop loop;
+    uint32_t budget;
+    uint32_t next_register;
+
+    enum unroll_mode mode;
+    uint32_t factor;
+    int64_t trip_count;
+    bool counted;
+
+    // renames for copying the body, one entry per register the unit had before unrolling
+    struct operand* renames;
+    uint32_t register_count;
+};
+
+static bool same_register(struct operand a, struct operand b) {
+    return a.type == OPERAND_TYPE_REGISTER && b.type == OPERAND_TYPE_REGISTER && a.value.integer == b.value.integer;
+}
+
+// true if a register defined in block is read by any other block
+static bool used_outside(struct unit* unit, struct block* block) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct operand result = block->instructions[i].result;
+        if (result.type != OPERAND_TYPE_REGISTER) {
+            continue;
+        }
+        for (uint32_t j = 0; j < unit->block_count; j++) {
+            struct block* other = unit->blocks[j];
+            for (uint32_t k = 0; k < other->instructions_count && other != block; k++) {
+                for (int l = 0; l < MAX_OPERANDS; l++) {
+                    if (same_register(other->instructions[k].operands[l], result)) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// picks the mode and factor, full unrolling when the whole loop fits the budget and the largest factor that does
+// otherwise, preferring one that divides the trip count so no remainder loop is needed
+static const char* analyze(struct unroller* unroller) {
+    struct unit* unit = unroller->unit;
+    struct loop* loop = &unroller->loop;
+    if (used_outside(unit, loop->header) || used_outside(unit, loop->body)) {
+        return "value computed in the loop is used outside of it";
+    }
+
+    uint32_t size = block_terminator(loop->body) - loop->body->instructions;
+    unroller->counted = loop_trip_count(loop, &unroller->trip_count);
+    if (unroller->counted && (uint64_t) unroller->trip_count * size <= unroller->budget) {
+        unroller->mode = UNROLL_FULL;
+        return NULL;
+    }
+
+    uint32_t factor = UNROLL_FACTOR;
+    while (factor >= 2 && factor * size > unroller->budget) {
+        factor--;
+    }
+    if (factor < 2) {
+        return "loop body is too large to unroll within the budget";
+    }
+    if (unroller->counted && unroller->trip_count < factor) {
+        return "loop runs too few times to unroll";
+    }
+
+    unroller->mode = UNROLL_RUNTIME;
+    unroller->factor = factor;
+    for (uint32_t divisor = factor; unroller->counted && divisor >= 2; divisor--) {
+        if (unroller->trip_count % divisor == 0) {
+            unroller->mode = UNROLL_PARTIAL;
+            unroller->factor = divisor;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void emit_jump(struct block* block, struct block* target) {
+    struct ssa_instruction jump = {};
+    jump.operator = OP_GOTO;
+    jump.result = operand_end();
+    jump.operands[0] = operand_block(target);
+    block_add(block, jump);
+}
+
+// appends a copy of the body without its jump back to the header, each copy gets fresh registers
+static void copy_body(struct unroller* unroller, struct block* target) {
+    for (uint32_t i = 0; i < unroller->register_count; i++) {
+        unroller->renames[i] = operand_none();
+    }
+    struct block* body = unroller->loop.body;
+    block_copy(target, body->instructions, block_terminator(body), unroller->renames, &unroller->next_register);
+}
+
+// the induction variable is known in every copy of a fully unrolled loop, so its loads become constants
+static void substitute_induction(struct unroller* unroller, struct block* block, uint32_t first, int64_t value) {
+    struct loop* loop = &unroller->loop;
+    for (uint32_t i = first; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        if (instruction->operator != OP_LOAD || !same_register(instruction->operands[0], loop->induction)) {
+            continue;
+        }
+        struct ssa_instruction constant = {};
+        constant.operator = OP_CONST;
+        constant.type = instruction->result.typename;
+        constant.result = instruction->result;
+        constant.operands[0] = (struct operand){OPERAND_TYPE_INTEGER, loop->induction_type, {.integer = (uint64_t) value}};
+        *instruction = constant;
+    }
+}
+
+// the preheader jumps straight into trip count copies of the body, then on to the exit
+static void unroll_full(struct unroller* unroller) {
+    struct loop* loop = &unroller->loop;
+    struct block* unrolled = block_new(false, loop->body->symbol_table);
+    unit_add(unroller->unit, unrolled);
+
+    int64_t start;
+    loop_start(loop, &start);
+    for (int64_t i = 0; i < unroller->trip_count; i++) {
+        uint32_t first = unrolled->instructions_count;
+        copy_body(unroller, unrolled);
+        substitute_induction(unroller, unrolled, first, start + i * loop->step);
+    }
+    emit_jump(unrolled, loop->exit);
+
+    block_terminator(loop->preheader)->operands[0] = operand_block(unrolled);
+    block_unlink(loop->preheader, loop->header);
+    block_link(loop->preheader, unrolled);
+    block_link(unrolled, loop->exit);
+}
+
+// the header enters a body made of factor copies of the old one, the trip count being a multiple of the factor means
+// the copies in between never need to test the condition
+static void unroll_partial(struct unroller* unroller) {
+    struct loop* loop = &unroller->loop;
+    struct block* unrolled = block_new(false, loop->body->symbol_table);
+    unit_add(unroller->unit, unrolled);
+
+    for (uint32_t i = 0; i < unroller->factor; i++) {
+        copy_body(unroller, unrolled);
+    }
+    emit_jump(unrolled, loop->header);
+
+    block_terminator(loop->header)->operands[1] = operand_block(unrolled);
+    block_unlink(loop->header, loop->body);
+    block_unlink(loop->body, loop->header);
+    block_link(loop->header, unrolled);
+    block_link(unrolled, loop->header);
+}
+
+// the preheader enters a guarded copy of the loop that runs factor iterations per trip, when fewer are left the
+// original loop runs the rest
+static void unroll_runtime(struct unroller* unroller) {
+    struct loop* loop = &unroller->loop;
+    struct block* guard = block_new(false, loop->header->symbol_table);
+    struct block* unrolled = block_new(false, loop->body->symbol_table);
+    unit_add(unroller->unit, guard);
+    unit_add(unroller->unit, unrolled);
+
+    loop_emit_guard(loop, guard, unroller->factor - 1, unrolled, loop->header, &unroller->next_register);
+    for (uint32_t i = 0; i < unroller->factor; i++) {
+        copy_body(unroller, unrolled);
+    }
+    emit_jump(unrolled, guard);
+
+    block_terminator(loop->preheader)->operands[0] = operand_block(guard);
+    block_unlink(loop->preheader, loop->header);
+    block_link(loop->preheader, guard);
+    block_link(guard, unrolled);
+    block_link(guard, loop->header);
+    block_link(unrolled, guard);
+}
+
+void unit_unroll_loops(struct unit* unit, uint32_t budget, FILE* remarks) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return;
+    }
+
+    struct block** headers = malloc(sizeof(struct block*) * unit->block_count);
+    assert(headers);
+    uint32_t header_count = unit_loop_headers(unit, headers);
+    for (uint32_t i = 0; i < header_count; i++) {
+        struct unroller unroller = {};
+        unroller.unit = unit;
+        unroller.budget = budget;
+        unroller.next_register = unit_register_count(unit);
+        unroller.register_count = unroller.next_register;
+
+        const char* reason = loop_match(unit, headers[i], &unroller.loop);
+        if (reason == NULL) {
+            reason = analyze(&unroller);
+        }
+        if (reason == NULL) {
+            unroller.renames = malloc(sizeof(struct operand) * unroller.register_count);
+            assert(unroller.renames);
+            switch (unroller.mode) {
+                case UNROLL_FULL:
+                    unroll_full(&unroller);
+                    break;
+                case UNROLL_PARTIAL:
+                    unroll_partial(&unroller);
+                    break;
+                default:
+                    unroll_runtime(&unroller);
+                    break;
+            }
+            free(unroller.renames);
+        }
+
+        if (remarks == NULL) {
+            continue;
+        }
+        fprintf(remarks, "unroll: %s: loop at block %u ", unit->symbol, headers[i]->id);
+        switch (reason == NULL ? unroller.mode : UNROLL_NONE) {
+            case UNROLL_FULL:
+                fprintf(remarks, "fully unrolled, %lld iterations\n", (long long) unroller.trip_count);
+                break;
+            case UNROLL_PARTIAL:
+                fprintf(remarks, "unrolled %u times\n", unroller.factor);
+                break;
+            case UNROLL_RUNTIME:
+                fprintf(remarks, "unrolled %u times with a remainder loop\n", unroller.factor);
+                break;
+            default:
+                fprintf(remarks, "not unrolled: %s\n", reason);
+                break;
+        }
+    }
+    free(headers);
+}
+
+void unit_module_unroll_loops(struct unit_module* module, uint32_t budget, FILE* remarks) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_unroll_loops(module->units[i], budget, remarks);
+    }
+}
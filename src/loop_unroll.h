@@ -0,0 +1,31 @@
+#ifndef COMPILER_LOOP_UNROLL_H
+#define COMPILER_LOOP_UNROLL_H
+#include <stdint.h>
+#include <stdio.h>
+
+#include "unit.h"
+
+// instructions an unrolled loop body may grow to
+#define UNROLL_BUDGET 256
+
+// most copies of the body a partially unrolled loop runs per trip
+#define UNROLL_FACTOR 4
+
+enum unroll_mode {
+    UNROLL_NONE,
+    // the trip count is known and small, the loop is replaced by that many copies of its body
+    UNROLL_FULL,
+    // the trip count is known and a multiple of the factor, the body is repeated and only every factor'th trip tests
+    UNROLL_PARTIAL,
+    // the trip count isn't known, an unrolled copy of the loop runs while enough iterations are left and the original
+    // loop finishes the rest
+    UNROLL_RUNTIME,
+};
+
+// unrolls the counted loops of a unit, keeping each one within budget instructions. says how each loop was unrolled
+// and why the others weren't on remarks, unless it's NULL
+void unit_unroll_loops(struct unit* unit, uint32_t budget, FILE* remarks);
+
+void unit_module_unroll_loops(struct unit_module* module, uint32_t budget, FILE* remarks);
+
+#endif //COMPILER_LOOP_UNROLL_H
@@ -0,0 +1,487 @@
+#include "loop_vectorize.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+#include "loop.h"
+#include "loop_unroll.h"
+
+// bytes in a vector register, as wide as an avx2 register and the interpreter's vector registers
+#define VECTOR_WIDTH 32
+
+// lane counts by their log2, simd types spell their lane count out as a token
+static char* lane_counts[] = {"1", "2", "4", "8", "16", "32"};
+
+// a local the loop body only ever updates as `x = x op value`, each lane keeps a partial result in its accumulator
+struct reduction {
+    struct operand slot;
+    struct operand accumulator;
+    struct ssa_instruction* update;
+};
+
+struct vectorizer {
+    struct unit* unit;
+    struct loop loop;
+    uint32_t lanes;
+    uint32_t next_register;
+
+    // the load and add advancing the induction variable, they stay scalar
+    struct ssa_instruction* advance;
+    bool uses_induction;
+
+    struct reduction* reductions;
+    uint32_t reduction_count;
+
+    // vector standing in for each scalar register of the body, none until it has one
+    struct operand* vectors;
+    uint32_t vector_count;
+    struct ssa_type types[AST_NODE_TYPE_TYPE_COUNT];
+};
+
+static bool lane_type(struct ssa_type type) {
+    return type.type != NULL && type.type->type >= AST_NODE_TYPE_I8 && type.type->type <= AST_NODE_TYPE_F64;
+}
+
+static bool is_float(struct ssa_type type) {
+    return type.type->type == AST_NODE_TYPE_F32 || type.type->type == AST_NODE_TYPE_F64;
+}
+
+static bool same_register(struct operand a, struct operand b) {
+    return a.type == OPERAND_TYPE_REGISTER && b.type == OPERAND_TYPE_REGISTER && a.value.integer == b.value.integer;
+}
+
+// uses of a register in every block but skip
+static uint32_t count_uses(struct unit* unit, struct operand value, struct block* skip) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count && block != skip; j++) {
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                count += same_register(block->instructions[j].operands[k], value);
+            }
+        }
+    }
+    return count;
+}
+
+static uint32_t count_accesses(struct block* block, enum ssa_instruction_code operator, struct operand pointer) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        count += instruction->operator == operator && same_register(instruction->operands[0], pointer);
+    }
+    return count;
+}
+
+static const char* add_reduction(struct vectorizer* vectorizer, struct ssa_instruction* store) {
+    struct unit* unit = vectorizer->unit;
+    struct block* body = vectorizer->loop.body;
+    struct block* block;
+    struct ssa_instruction* update = unit_definition(unit, store->operands[1], &block);
+    if (update == NULL || block != body) {
+        return "local is assigned a value that doesn't depend on itself";
+    }
+    switch (update->operator) {
+        case OP_ADD:
+        case OP_MUL:
+        case OP_BITWISE_AND:
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+            break;
+        default:
+            return "local isn't updated by an associative operator";
+    }
+
+    struct ssa_instruction* load = NULL;
+    for (int i = 0; i < 2 && load == NULL; i++) {
+        struct ssa_instruction* operand = unit_definition(unit, update->operands[i], &block);
+        if (operand != NULL && block == body && operand->operator == OP_LOAD &&
+            same_register(operand->operands[0], store->operands[0])) {
+            load = operand;
+        }
+    }
+    if (load == NULL) {
+        return "local isn't updated from its previous value";
+    }
+    if (count_accesses(body, OP_LOAD, store->operands[0]) != 1 || count_accesses(body, OP_STORE, store->operands[0]) != 1 ||
+        count_uses(unit, load->result, NULL) != 1 || count_uses(unit, update->result, NULL) != 1 ||
+        update->result.typename.type->type != load->result.typename.type->type) {
+        return "local is used for more than its reduction";
+    }
+    if (is_float(update->result.typename)) {
+        return "reordering a floating point reduction would change its rounding";
+    }
+
+    vectorizer->reductions = realloc(vectorizer->reductions, sizeof(struct reduction) * (vectorizer->reduction_count + 1));
+    assert(vectorizer->reductions);
+    vectorizer->reductions[vectorizer->reduction_count++] = (struct reduction){store->operands[0], operand_none(), update};
+    return NULL;
+}
+
+static struct reduction* find_reduction(struct vectorizer* vectorizer, struct operand slot) {
+    for (uint32_t i = 0; i < vectorizer->reduction_count; i++) {
+        if (same_register(vectorizer->reductions[i].slot, slot)) {
+            return &vectorizer->reductions[i];
+        }
+    }
+    return NULL;
+}
+
+// checks every instruction of the body has a lane-wise form and every local it writes is a reduction
+static const char* analyze(struct vectorizer* vectorizer) {
+    struct unit* unit = vectorizer->unit;
+    struct loop* loop = &vectorizer->loop;
+    struct ssa_instruction* back = block_terminator(loop->body);
+    vectorizer->advance = unit_definition(unit, loop->increment->operands[1], NULL);
+    size_t widest = loop->induction_type.size;
+
+    for (struct ssa_instruction* instruction = loop->body->instructions; instruction != back; instruction++) {
+        switch (instruction->operator) {
+            case OP_LOAD:
+            case OP_STORE:
+                if (!unit_is_local(unit, instruction->operands[0])) {
+                    return "loop body accesses memory through a pointer";
+                }
+                break;
+            case OP_CALL:
+                return "loop body calls a function";
+            case OP_CONST:
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+            case OP_BITWISE_AND:
+            case OP_BITWISE_OR:
+            case OP_BITWISE_XOR:
+            case OP_NEGATE:
+            case OP_BITWISE_NOT:
+            case OP_CAST:
+                break;
+            default:
+                return "loop body has an operator without a vector form";
+        }
+
+        struct ssa_type type = instruction->operator == OP_STORE ? instruction->operands[1].typename
+                                                                  : instruction->result.typename;
+        if (!lane_type(type) || (instruction->operator == OP_CAST && !lane_type(instruction->operands[0].typename))) {
+            return "loop body works on values that don't fit in vector lanes";
+        }
+        if (type.size > widest) {
+            widest = type.size;
+        }
+        if (instruction->result.type == OPERAND_TYPE_REGISTER && count_uses(unit, instruction->result, loop->body) > 0) {
+            return "value computed in the loop body is used outside of it";
+        }
+
+        if (instruction->operator == OP_LOAD && same_register(instruction->operands[0], loop->induction)) {
+            uint32_t uses = count_uses(unit, instruction->result, NULL);
+            for (int i = 0; i < 2; i++) {
+                uses -= same_register(vectorizer->advance->operands[i], instruction->result);
+            }
+            vectorizer->uses_induction |= uses > 0;
+        }
+        if (instruction->operator == OP_STORE && instruction != loop->increment) {
+            const char* reason = add_reduction(vectorizer, instruction);
+            if (reason != NULL) {
+                return reason;
+            }
+        }
+    }
+    if (vectorizer->reduction_count == 0) {
+        return "loop body doesn't accumulate anything";
+    }
+
+    vectorizer->lanes = VECTOR_WIDTH / widest;
+
+    // a loop too short for the unrolled vector loop to go around even once is better unrolled whole
+    int64_t trip_count;
+    if (loop_trip_count(loop, &trip_count) && trip_count < (int64_t) vectorizer->lanes * UNROLL_FACTOR) {
+        return "loop runs too few times to vectorize";
+    }
+    return NULL;
+}
+
+#pragma region emitting
+
+static struct ssa_type vector_of(struct vectorizer* vectorizer, struct ssa_type element) {
+    struct ssa_type* type = &vectorizer->types[element.type->type];
+    if (type->type == NULL) {
+        char* count = lane_counts[__builtin_ctz(vectorizer->lanes)];
+        struct ast_node* simd = ast_node_new(AST_NODE_TYPE_SIMD, token_null);
+        ast_node_append_child(simd, ast_node_clone(element.type));
+        ast_node_append_child(simd, ast_node_new(AST_NODE_TYPE_INTEGER,
+                                                 (struct token){TOKEN_TYPE_INTEGER, count, strlen(count), 0}));
+        *type = ssa_type_from_ast(element.module, simd);
+    }
+    return *type;
+}
+
+static struct operand constant(struct ssa_type type, int64_t value) {
+    return (struct operand){OPERAND_TYPE_INTEGER, type, {.integer = (uint64_t) value}};
+}
+
+static struct operand emit(struct vectorizer* vectorizer, struct block* block, enum ssa_instruction_code operator,
+                           struct ssa_type type, struct operand a, struct operand b, struct operand c) {
+    struct ssa_instruction instruction = {};
+    instruction.operator = operator;
+    instruction.type = type;
+    instruction.result = operator == OP_STORE ? operand_none() : operand_reg(vectorizer->next_register++, type);
+    instruction.operands[0] = a;
+    instruction.operands[1] = b;
+    instruction.operands[2] = c;
+    block_add(block, instruction);
+    return instruction.result;
+}
+
+static void emit_jump(struct block* block, struct block* target) {
+    struct ssa_instruction jump = {};
+    jump.operator = OP_GOTO;
+    jump.result = operand_end();
+    jump.operands[0] = operand_block(target);
+    block_add(block, jump);
+}
+
+// takes the terminator off a block so code can be added before it, dropping anything after it since that never runs
+static struct ssa_instruction detach_terminator(struct block* block) {
+    struct ssa_instruction* terminator = block_terminator(block);
+    struct ssa_instruction detached = *terminator;
+    block->instructions_count = terminator - block->instructions;
+    return detached;
+}
+
+// a new local in the entry block, where ssa_gen puts every other allocation
+static struct operand allocate(struct vectorizer* vectorizer, struct ssa_type type) {
+    struct block* entry = vectorizer->unit->blocks[0];
+    struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+    ast_node_append_child(reference, ast_node_clone(type.type));
+
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_ALLOC;
+    instruction.type = type;
+    instruction.result = operand_reg(vectorizer->next_register++, ssa_type_from_ast(type.module, reference));
+    instruction.operands[0] = operand_const_i64((int64_t) type.size);
+
+    if (block_terminator(entry) != NULL) {
+        struct ssa_instruction terminator = detach_terminator(entry);
+        block_add(entry, instruction);
+        block_add(entry, terminator);
+    } else {
+        block_add(entry, instruction);
+    }
+    return instruction.result;
+}
+
+static struct operand widen(struct vectorizer* vectorizer, struct block* block, struct operand operand,
+                            struct ssa_type element) {
+    if (operand.type == OPERAND_TYPE_REGISTER && operand.value.integer < vectorizer->vector_count &&
+        vectorizer->vectors[operand.value.integer].type != OPERAND_TYPE_NONE) {
+        return vectorizer->vectors[operand.value.integer];
+    }
+    return emit(vectorizer, block, OP_BROADCAST, vector_of(vectorizer, element), operand, operand_none(),
+                operand_none());
+}
+
+// the step the induction variable advances by may be a separate const, it has no use in the vector loop
+static bool feeds_only_advance(struct vectorizer* vectorizer, struct operand value) {
+    uint32_t uses = 0;
+    for (int i = 0; i < 2; i++) {
+        uses += same_register(vectorizer->advance->operands[i], value);
+    }
+    return uses > 0 && uses == count_uses(vectorizer->unit, value, NULL);
+}
+
+static int64_t identity(enum ssa_instruction_code operator) {
+    switch (operator) {
+        case OP_MUL: return 1;
+        case OP_BITWISE_AND: return -1;
+        default: return 0;
+    }
+}
+
+#pragma endregion
+
+// the preheader now enters a copy of the loop that runs lanes iterations per trip, when fewer are left the
+// accumulators are folded back into their locals and the original loop runs the rest
+static void vectorize(struct vectorizer* vectorizer) {
+    struct unit* unit = vectorizer->unit;
+    struct loop* loop = &vectorizer->loop;
+    struct ssa_type induction_type = loop->induction_type;
+    struct ssa_type induction_vector = vector_of(vectorizer, induction_type);
+    uint32_t lanes = vectorizer->lanes;
+    uint32_t register_count = vectorizer->next_register;
+
+    struct block* vector_header = block_new(false, loop->header->symbol_table);
+    struct block* vector_body = block_new(false, loop->body->symbol_table);
+    struct block* reduce = block_new(false, loop->header->symbol_table);
+    unit_add(unit, vector_header);
+    unit_add(unit, vector_body);
+    unit_add(unit, reduce);
+
+    // every lane of an accumulator starts at the operator's identity, the induction variable gets an offset per lane
+    struct ssa_instruction jump = detach_terminator(loop->preheader);
+    for (uint32_t i = 0; i < vectorizer->reduction_count; i++) {
+        struct reduction* reduction = &vectorizer->reductions[i];
+        struct ssa_type type = reduction->update->result.typename;
+        struct ssa_type vector = vector_of(vectorizer, type);
+        reduction->accumulator = allocate(vectorizer, vector);
+        struct operand start = emit(vectorizer, loop->preheader, OP_BROADCAST, vector,
+                                    constant(type, identity(reduction->update->operator)), operand_none(), operand_none());
+        emit(vectorizer, loop->preheader, OP_STORE, vector, reduction->accumulator, start, operand_none());
+    }
+    struct operand lane_offsets = operand_none();
+    if (vectorizer->uses_induction) {
+        lane_offsets = allocate(vectorizer, induction_vector);
+        struct operand offsets = emit(vectorizer, loop->preheader, OP_BROADCAST, induction_vector,
+                                      constant(induction_type, 0), operand_none(), operand_none());
+        for (uint32_t i = 1; i < lanes; i++) {
+            offsets = emit(vectorizer, loop->preheader, OP_INSERT, induction_vector, offsets, operand_const_i32(i),
+                           constant(induction_type, i * loop->step));
+        }
+        emit(vectorizer, loop->preheader, OP_STORE, induction_vector, lane_offsets, offsets, operand_none());
+    }
+    jump.operands[0] = operand_block(vector_header);
+    block_add(loop->preheader, jump);
+
+    loop_emit_guard(loop, vector_header, lanes - 1, vector_body, reduce, &vectorizer->next_register);
+
+    // the body again with every value widened to a vector, values from outside the loop are broadcast
+    vectorizer->vectors = malloc(sizeof(struct operand) * register_count);
+    vectorizer->vector_count = register_count;
+    assert(vectorizer->vectors);
+    for (uint32_t i = 0; i < register_count; i++) {
+        vectorizer->vectors[i] = operand_none();
+    }
+    struct operand index = emit(vectorizer, vector_body, OP_LOAD, induction_type, loop->induction, operand_none(),
+                                operand_none());
+    struct operand induction = operand_none();
+    if (vectorizer->uses_induction) {
+        struct operand offsets = emit(vectorizer, vector_body, OP_LOAD, induction_vector, lane_offsets, operand_none(),
+                                      operand_none());
+        induction = emit(vectorizer, vector_body, OP_ADD, induction_vector,
+                         widen(vectorizer, vector_body, index, induction_type), offsets, operand_none());
+    }
+
+    struct ssa_instruction* back = block_terminator(loop->body);
+    for (struct ssa_instruction* instruction = loop->body->instructions; instruction != back; instruction++) {
+        struct ssa_type type = instruction->result.typename;
+        struct operand* vector = instruction->result.type == OPERAND_TYPE_REGISTER
+                                     ? &vectorizer->vectors[instruction->result.value.integer] : NULL;
+        if (instruction == vectorizer->advance || (vector != NULL && feeds_only_advance(vectorizer, instruction->result))) {
+            continue;
+        }
+        if (instruction == loop->increment) {
+            struct operand next = emit(vectorizer, vector_body, OP_ADD, induction_type, index,
+                                       constant(induction_type, lanes * loop->step), operand_none());
+            emit(vectorizer, vector_body, OP_STORE, induction_type, loop->induction, next, operand_none());
+            continue;
+        }
+
+        struct reduction* reduction = find_reduction(vectorizer, instruction->operands[0]);
+        switch (instruction->operator) {
+            case OP_LOAD:
+                if (same_register(instruction->operands[0], loop->induction)) {
+                    *vector = induction;
+                } else if (reduction != NULL) {
+                    *vector = emit(vectorizer, vector_body, OP_LOAD, vector_of(vectorizer, type), reduction->accumulator,
+                                   operand_none(), operand_none());
+                } else {
+                    struct operand scalar = emit(vectorizer, vector_body, OP_LOAD, type, instruction->operands[0],
+                                                 operand_none(), operand_none());
+                    *vector = widen(vectorizer, vector_body, scalar, type);
+                }
+                break;
+            case OP_STORE: {
+                struct ssa_type stored = instruction->operands[1].typename;
+                emit(vectorizer, vector_body, OP_STORE, vector_of(vectorizer, stored), reduction->accumulator,
+                     widen(vectorizer, vector_body, instruction->operands[1], stored), operand_none());
+                break;
+            }
+            case OP_CONST:
+                *vector = widen(vectorizer, vector_body, instruction->operands[0], type);
+                break;
+            case OP_CAST:
+                *vector = emit(vectorizer, vector_body, OP_CAST, vector_of(vectorizer, type),
+                               widen(vectorizer, vector_body, instruction->operands[0], instruction->operands[0].typename),
+                               operand_none(), operand_none());
+                break;
+            case OP_NEGATE:
+            case OP_BITWISE_NOT:
+                *vector = emit(vectorizer, vector_body, instruction->operator, vector_of(vectorizer, type),
+                               widen(vectorizer, vector_body, instruction->operands[0], type), operand_none(),
+                               operand_none());
+                break;
+            default:
+                *vector = emit(vectorizer, vector_body, instruction->operator, vector_of(vectorizer, type),
+                               widen(vectorizer, vector_body, instruction->operands[0], type),
+                               widen(vectorizer, vector_body, instruction->operands[1], type), operand_none());
+                break;
+        }
+    }
+    emit_jump(vector_body, vector_header);
+    free(vectorizer->vectors);
+    vectorizer->vectors = NULL;
+
+    // fold the lanes of each accumulator into its local before the scalar loop takes over
+    for (uint32_t i = 0; i < vectorizer->reduction_count; i++) {
+        struct reduction* reduction = &vectorizer->reductions[i];
+        struct ssa_type type = reduction->update->result.typename;
+        struct operand accumulator = emit(vectorizer, reduce, OP_LOAD, vector_of(vectorizer, type),
+                                          reduction->accumulator, operand_none(), operand_none());
+        struct operand total = emit(vectorizer, reduce, OP_LOAD, type, reduction->slot, operand_none(), operand_none());
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            struct operand value = emit(vectorizer, reduce, OP_EXTRACT, type, accumulator, operand_const_i32(lane),
+                                        operand_none());
+            total = emit(vectorizer, reduce, reduction->update->operator, type, total, value, operand_none());
+        }
+        emit(vectorizer, reduce, OP_STORE, type, reduction->slot, total, operand_none());
+    }
+    emit_jump(reduce, loop->header);
+
+    block_unlink(loop->preheader, loop->header);
+    block_link(loop->preheader, vector_header);
+    block_link(vector_header, vector_body);
+    block_link(vector_header, reduce);
+    block_link(vector_body, vector_header);
+    block_link(reduce, loop->header);
+}
+
+void unit_vectorize_loops(struct unit* unit, FILE* remarks) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return;
+    }
+
+    struct block** headers = malloc(sizeof(struct block*) * unit->block_count);
+    assert(headers);
+    uint32_t header_count = unit_loop_headers(unit, headers);
+    for (uint32_t i = 0; i < header_count; i++) {
+        struct vectorizer vectorizer = {};
+        vectorizer.unit = unit;
+        vectorizer.next_register = unit_register_count(unit);
+
+        const char* reason = loop_match(unit, headers[i], &vectorizer.loop);
+        if (reason == NULL) {
+            reason = analyze(&vectorizer);
+        }
+        if (reason == NULL) {
+            vectorize(&vectorizer);
+        }
+        if (remarks != NULL && reason == NULL) {
+            fprintf(remarks, "vectorize: %s: loop at block %u vectorized with %u lanes\n", unit->symbol,
+                    headers[i]->id, vectorizer.lanes);
+        } else if (remarks != NULL) {
+            fprintf(remarks, "vectorize: %s: loop at block %u not vectorized: %s\n", unit->symbol, headers[i]->id,
+                    reason);
+        }
+        free(vectorizer.reductions);
+    }
+    free(headers);
+}
+
+void unit_module_vectorize_loops(struct unit_module* module, FILE* remarks) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_vectorize_loops(module->units[i], remarks);
+    }
+}
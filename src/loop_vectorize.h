@@ -0,0 +1,14 @@
+#ifndef COMPILER_LOOP_VECTORIZE_H
+#define COMPILER_LOOP_VECTORIZE_H
+#include <stdio.h>
+
+#include "unit.h"
+
+// rewrites counted loops that only accumulate into local variables so they run a vector register's worth of
+// iterations at a time, the original loop is kept after the vector one to finish the remaining iterations.
+// says which loops were vectorized and why the others weren't on remarks, unless it's NULL
+void unit_vectorize_loops(struct unit* unit, FILE* remarks);
+
+void unit_module_vectorize_loops(struct unit_module* module, FILE* remarks);
+
+#endif //COMPILER_LOOP_VECTORIZE_H
@@ -1,9 +1,24 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "ast_debug.h"
+#include "block_layout.h"
+#include "bounds_check.h"
+#include "const_eval.h"
+#include "devirtualize.h"
+#include "escape.h"
+#include "identical_fold.h"
+#include "interpreter.h"
+#include "loop_invariant.h"
+#include "loop_unroll.h"
+#include "loop_vectorize.h"
+#include "null_check.h"
+#include "scalar_replace.h"
+#include "store_forward.h"
+#include "type_layout.h"
 #include "unit.h"
 #include "unit_module_gen.h"
 #include "lexer.h"
@@ -20,17 +35,32 @@ static double get_time_seconds() {
 
 int main(int argc, char** argv) {
     double start = get_time_seconds();
-    struct file** files = malloc(sizeof(struct file*) * (argc - 1));
+
+    // options come before the files
+    int first = 1;
+    bool reorder_fields = false;
+    while (first < argc && strncmp(argv[first], "--", 2) == 0) {
+        if (strcmp(argv[first], "--reorder-fields") == 0) {
+            reorder_fields = true;
+        }
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[first]);
+        }
+        first++;
+    }
+    int file_count = argc - first;
+
+    struct file** files = malloc(sizeof(struct file*) * file_count);
 
     printf("compiling... ");
     
 #pragma region lexing
     
-    struct lexer** lexers = malloc(sizeof(struct lexer*) * (argc - 1));
+    struct lexer** lexers = malloc(sizeof(struct lexer*) * file_count);
     
-    for (int i = 0; i < argc - 1; i++) {
-        printf("%s ", argv[i + 1]);
-        files[i] = file_read(argv[i + 1]);
+    for (int i = 0; i < file_count; i++) {
+        printf("%s ", argv[first + i]);
+        files[i] = file_read(argv[first + i]);
         lexers[i] = lexer_new(files[i]->contents);
     }
 
@@ -40,7 +70,7 @@ int main(int argc, char** argv) {
     
     printf("\nbuilding ast...\n\n");
     
-    struct ast_module_list* modules = parse(lexers, argc - 1);
+    struct ast_module_list* modules = parse(lexers, file_count);
 
     if (modules == NULL) {
         goto cleanup;
@@ -52,9 +82,12 @@ int main(int argc, char** argv) {
     
     for (int i = 0; i < modules->module_count; i++) {
         struct ast_module* module = modules->modules[i];
+        module->reorder_fields = reorder_fields;
         printf("--- MODULE %s ---\n", module->name);
         printf("\nSYMBOLS ---\n");
         ast_node_debug(stdout, module->symbols);
+        printf("\nLAYOUTS ---\n");
+        type_layout_debug_module(stdout, module);
         printf("\nAST ---\n");
         ast_node_debug(stdout, module->root);
         printf("\n");
@@ -73,6 +106,27 @@ int main(int argc, char** argv) {
         struct unit_module* unit_module = unit_module_forward(module);
 
         unit_module_build(unit_module);
+        unit_module_infer_purity(unit_module);
+        unit_module_fold(unit_module);
+        unit_module_promote_allocations(unit_module, stdout);
+        // promoted allocs are locals like any other, struct ones split into a local per field
+        unit_module_scalar_replace(unit_module, stdout);
+        unit_module_eliminate_null_checks(unit_module);
+        // a check left in a loop body keeps licm from hoisting the loads after it
+        unit_module_eliminate_bounds_checks(unit_module, stdout);
+        unit_module_vectorize_loops(unit_module, stdout);
+        unit_module_hoist_loop_invariants(unit_module, stdout);
+        unit_module_unroll_loops(unit_module, UNROLL_BUDGET, stdout);
+        unit_module_forward_stores(unit_module);
+        // forwarded stores put the vtable a unit made right in front of the calls through it
+        unit_module_devirtualize(unit_module, modules, stdout);
+        // fully unrolled loops have a constant induction variable in every copy of their body, and forwarded stores
+        // turn loads of locals into the constants that were stored
+        unit_module_fold(unit_module);
+        unit_module_layout_blocks(unit_module);
+        // instances are only compared once their blocks are in the same order
+        unit_module_fold_identical(unit_module, stdout);
+        unit_module_evaluate(unit_module);
 
         char buffer[100];
         snprintf(buffer, sizeof(buffer), "%s.dot", module->name);
@@ -86,6 +140,35 @@ int main(int argc, char** argv) {
         for (int n = 0; n < unit_module->unit_count; n++) {
             unit_compile(unit_module->units[n], stdout);
         }
+
+        // run the entry point through the interpreter until there is a native backend
+        struct token main_token = {TOKEN_TYPE_IDENTIFIER, "main", 4, 0};
+        struct unit* entry = unit_module_find(unit_module, main_token);
+        if (entry != NULL) {
+            struct interpreter* interpreter = interpreter_new();
+            union slot result;
+            double run_start = get_time_seconds();
+            // the globals that couldn't be evaluated at compile time are set before anything reads them
+            struct token init_token = {TOKEN_TYPE_IDENTIFIER, "_init", 5, 0};
+            struct unit* init = unit_module_find(unit_module, init_token);
+            if ((init == NULL || interpreter_call(interpreter, init, NULL, 0, &result)) &&
+                interpreter_call(interpreter, entry, NULL, 0, &result)) {
+                printf("--- INTERPRETED ---\nmain() = %lld (%fs)\n", (long long)result.i, get_time_seconds() - run_start);
+                struct interpreter_stats* stats = &interpreter->stats;
+                printf("peephole: %zu -> %zu codes (%zu fused branches, %zu forwarded loads, %zu moves, %zu dead, "
+                       "%zu jumps removed, %zu tail calls)\n", stats->decoded, stats->emitted, stats->fused_branches,
+                       stats->forwarded_loads, stats->removed_moves, stats->removed_dead, stats->removed_jumps,
+                       stats->tail_calls);
+                struct interpreter_heap_stats* heap = &interpreter->heap_stats;
+                printf("heap: %zu allocations, %zu frees, %zu reallocations (%zu in place), %zu slabs, %zu bytes in "
+                       "use, %zu peak\n", heap->allocations, heap->frees, heap->reallocations, heap->in_place,
+                       heap->slabs, heap->bytes_in_use, heap->peak_bytes);
+            }
+            else {
+                fprintf(stderr, "interpreter: %s\n", interpreter->error);
+            }
+            interpreter_free(interpreter);
+        }
         unit_module_free(unit_module);
         
         fclose(cfgdot);
@@ -103,7 +186,7 @@ int main(int argc, char** argv) {
     cleanup:
     
     //close files
-    for (int i = 0; i < argc - 1; i++) {
+    for (int i = 0; i < file_count; i++) {
         file_close(files[i]);
         lexer_free(lexers[i]);
     }
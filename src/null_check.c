@@ -0,0 +1,331 @@
+#include "null_check.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+#include "loop.h"
+
+// what is known not to be null at a point of the unit. the first half of a state has an entry per register for the
+// value it holds, the second an entry per local for the pointer stored in it. only locals whose address never leaves
+// their loads and stores are followed, nothing else can write to those behind the pass' back
+struct nullness {
+    struct unit* unit;
+    uint32_t register_count;
+    bool* tracked;
+};
+
+static bool same_register(struct operand a, struct operand b) {
+    return a.type == OPERAND_TYPE_REGISTER && b.type == OPERAND_TYPE_REGISTER && a.value.integer == b.value.integer;
+}
+
+static bool is_pointer(struct ssa_type type) {
+    return type.type != NULL &&
+           (type.type->type == AST_NODE_TYPE_POINTER || type.type->type == AST_NODE_TYPE_REFERENCE);
+}
+
+static void find_tracked(struct nullness* nullness) {
+    struct unit* unit = nullness->unit;
+    bool* tracked = nullness->tracked;
+    memset(tracked, 0, sizeof(bool) * nullness->register_count);
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator == OP_ALLOC && instruction->result.type == OPERAND_TYPE_REGISTER) {
+                tracked[instruction->result.value.integer] = true;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            bool access = instruction->operator == OP_LOAD || instruction->operator == OP_STORE;
+            for (int k = access ? 1 : 0; k < MAX_OPERANDS; k++) {
+                if (instruction->operands[k].type == OPERAND_TYPE_REGISTER) {
+                    tracked[instruction->operands[k].value.integer] = false;
+                }
+            }
+        }
+    }
+}
+
+static bool tracked(struct nullness* nullness, struct operand pointer) {
+    return pointer.type == OPERAND_TYPE_REGISTER && nullness->tracked[pointer.value.integer];
+}
+
+static bool known(struct nullness* nullness, bool* state, struct operand operand) {
+    switch (operand.type) {
+        case OPERAND_TYPE_REGISTER:
+            if (operand.typename.type != NULL && operand.typename.type->type == AST_NODE_TYPE_REFERENCE) {
+                return true;
+            }
+            return state[operand.value.integer];
+        case OPERAND_TYPE_INTEGER:
+            return operand.value.integer != 0;
+        default:
+            return false;
+    }
+}
+
+// the local a value was loaded from earlier in the block, if the local hasn't been stored to since. knowing the value
+// isn't null then means the local doesn't hold null either. UINT32_MAX if there is no such local
+static uint32_t loaded_from(struct nullness* nullness, struct block* block, uint32_t index, struct operand value) {
+    for (uint32_t i = index; i-- > 0;) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        if (same_register(instruction->result, value)) {
+            if (instruction->operator != OP_LOAD || !tracked(nullness, instruction->operands[0])) {
+                return UINT32_MAX;
+            }
+            uint32_t slot = instruction->operands[0].value.integer;
+            for (uint32_t j = i + 1; j < index; j++) {
+                struct ssa_instruction* store = &block->instructions[j];
+                if (store->operator == OP_STORE && same_register(store->operands[0], instruction->operands[0])) {
+                    return UINT32_MAX;
+                }
+            }
+            return slot;
+        }
+    }
+    return UINT32_MAX;
+}
+
+// runs the block over a state, checks of values already known not to be null become moves when rewrite is set
+static void transfer(struct nullness* nullness, struct block* block, bool* state, bool rewrite) {
+    bool* contents = state + nullness->register_count;
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        struct operand* operands = instruction->operands;
+        bool result = false;
+        switch (instruction->operator) {
+            case OP_ALLOC:
+                result = true;
+                break;
+            case OP_NULL_CHECK: {
+                if (rewrite && known(nullness, state, operands[0])) {
+                    instruction->operator = OP_CAST;
+                }
+                if (operands[0].type == OPERAND_TYPE_REGISTER) {
+                    state[operands[0].value.integer] = true;
+                }
+                uint32_t slot = loaded_from(nullness, block, i, operands[0]);
+                if (slot != UINT32_MAX) {
+                    contents[slot] = true;
+                }
+                result = true;
+                break;
+            }
+            case OP_LOAD:
+                result = tracked(nullness, operands[0]) && contents[operands[0].value.integer];
+                break;
+            case OP_CAST:
+                result = is_pointer(instruction->type) && known(nullness, state, operands[0]);
+                break;
+            case OP_STORE:
+                if (tracked(nullness, operands[0])) {
+                    contents[operands[0].value.integer] = known(nullness, state, operands[1]);
+                }
+                break;
+            default:
+                break;
+        }
+        if (instruction->result.type == OPERAND_TYPE_REGISTER) {
+            state[instruction->result.value.integer] = result;
+        }
+    }
+}
+
+// a branch on `p != null` or `p == null` tells which of its targets is only reached when p isn't null. gives the
+// successor index that is and sets pointer to p, or returns UINT32_MAX
+static uint32_t branch_fact(struct nullness* nullness, struct block* block, struct operand* pointer) {
+    struct ssa_instruction* terminator = block_terminator(block);
+    if (terminator == NULL || terminator->operator != OP_IF) {
+        return UINT32_MAX;
+    }
+    for (uint32_t i = terminator - block->instructions; i-- > 0;) {
+        struct ssa_instruction* compare = &block->instructions[i];
+        if (!same_register(compare->result, terminator->operands[0])) {
+            continue;
+        }
+        if (compare->operator != OP_EQUAL && compare->operator != OP_NOT_EQUAL) {
+            return UINT32_MAX;
+        }
+        for (int side = 0; side < 2; side++) {
+            struct operand null = compare->operands[1 - side];
+            if (null.type == OPERAND_TYPE_INTEGER && null.value.integer == 0 &&
+                compare->operands[side].type == OPERAND_TYPE_REGISTER && is_pointer(compare->operands[side].typename)) {
+                *pointer = compare->operands[side];
+                return compare->operator == OP_NOT_EQUAL ? 0 : 1;
+            }
+        }
+        return UINT32_MAX;
+    }
+    return UINT32_MAX;
+}
+
+static bool stored_in(struct block* block, struct operand slot) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+        if (instruction->operator == OP_STORE && same_register(instruction->operands[0], slot)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static struct operand emit(struct block* block, struct ssa_instruction instruction, struct ssa_type type,
+                           uint32_t* next_register) {
+    instruction.result = operand_reg((*next_register)++, type);
+    block_add(block, instruction);
+    return instruction.result;
+}
+
+// a loop that is known to run its body checks the pointers held by locals the loop never stores to on its first trip,
+// so the check can be made once at the end of the preheader. the first check of the body is then redundant and goes
+// away with the rest. only checks before the body's first call move, so a call can't see the program stop early
+static void hoist(struct nullness* nullness, struct loop* loop, uint32_t* next_register) {
+    int64_t trip_count;
+    if (!loop_trip_count(loop, &trip_count) || trip_count <= 0) {
+        return;
+    }
+    struct block* body = loop->body;
+    bool* hoisted = calloc(nullness->register_count, sizeof(bool));
+    assert(hoisted);
+    for (uint32_t i = 0; i < body->instructions_count; i++) {
+        struct ssa_instruction check = body->instructions[i];
+        if (check.operator == OP_CALL || check.operator == OP_GOTO || check.operator == OP_IF ||
+            check.operator == OP_RETURN) {
+            break;
+        }
+        if (check.operator != OP_NULL_CHECK) {
+            continue;
+        }
+        uint32_t slot = loaded_from(nullness, body, i, check.operands[0]);
+        if (slot == UINT32_MAX || hoisted[slot]) {
+            continue;
+        }
+        struct ssa_instruction* load = unit_definition(nullness->unit, check.operands[0], NULL);
+        if (stored_in(loop->header, load->operands[0]) || stored_in(body, load->operands[0])) {
+            continue;
+        }
+
+        struct ssa_instruction* terminator = block_terminator(loop->preheader);
+        struct ssa_instruction jump = *terminator;
+        loop->preheader->instructions_count = terminator - loop->preheader->instructions;
+        struct operand pointer = emit(loop->preheader, *load, load->result.typename, next_register);
+        check.operands[0] = pointer;
+        emit(loop->preheader, check, check.result.typename, next_register);
+        block_add(loop->preheader, jump);
+        hoisted[slot] = true;
+    }
+    free(hoisted);
+}
+
+void unit_eliminate_null_checks(struct unit* unit) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return;
+    }
+
+    struct nullness nullness = {};
+    nullness.unit = unit;
+    nullness.register_count = unit_register_count(unit);
+    // a check has a result, a unit without registers has none to remove
+    if (nullness.register_count == 0) {
+        return;
+    }
+    nullness.tracked = malloc(sizeof(bool) * nullness.register_count);
+    assert(nullness.tracked);
+    find_tracked(&nullness);
+
+    struct block** headers = malloc(sizeof(struct block*) * unit->block_count);
+    assert(headers);
+    uint32_t header_count = unit_loop_headers(unit, headers);
+    uint32_t next_register = nullness.register_count;
+    for (uint32_t i = 0; i < header_count; i++) {
+        struct loop loop;
+        if (loop_match(unit, headers[i], &loop) == NULL) {
+            hoist(&nullness, &loop, &next_register);
+        }
+    }
+    free(headers);
+
+    // the hoisted checks added registers, none of them is a local
+    nullness.tracked = realloc(nullness.tracked, sizeof(bool) * next_register);
+    assert(nullness.tracked);
+    memset(nullness.tracked + nullness.register_count, 0, sizeof(bool) * (next_register - nullness.register_count));
+    nullness.register_count = next_register;
+
+    // every block but the entry starts out knowing everything, and only loses facts as its predecessors are met
+    uint32_t width = nullness.register_count * 2;
+    bool* states = malloc(sizeof(bool) * width * unit->block_count);
+    bool* reached = calloc(unit->block_count, sizeof(bool));
+    bool* state = malloc(sizeof(bool) * width);
+    bool* edge = malloc(sizeof(bool) * width);
+    assert(states && reached && state && edge);
+    memset(states, 0, sizeof(bool) * width);
+    memset(states + width, 1, sizeof(bool) * width * (unit->block_count - 1));
+    reached[0] = true;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 0; i < unit->block_count; i++) {
+            if (!reached[i]) {
+                continue;
+            }
+            struct block* block = unit->blocks[i];
+            memcpy(state, states + i * width, sizeof(bool) * width);
+            transfer(&nullness, block, state, false);
+
+            struct operand pointer = operand_none();
+            uint32_t fact = branch_fact(&nullness, block, &pointer);
+            uint32_t successors[2];
+            uint32_t successor_count = block_successors(unit, block, successors);
+            for (uint32_t j = 0; j < successor_count; j++) {
+                memcpy(edge, state, sizeof(bool) * width);
+                if (j == fact) {
+                    edge[pointer.value.integer] = true;
+                    uint32_t slot = loaded_from(&nullness, block, block_terminator(block) - block->instructions,
+                                                pointer);
+                    if (slot != UINT32_MAX) {
+                        edge[nullness.register_count + slot] = true;
+                    }
+                }
+
+                bool* in = states + successors[j] * width;
+                for (uint32_t k = 0; k < width; k++) {
+                    if (in[k] && !edge[k]) {
+                        in[k] = false;
+                        changed = true;
+                    }
+                }
+                if (!reached[successors[j]]) {
+                    reached[successors[j]] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        if (reached[i]) {
+            memcpy(state, states + i * width, sizeof(bool) * width);
+            transfer(&nullness, unit->blocks[i], state, true);
+        }
+    }
+
+    free(states);
+    free(reached);
+    free(state);
+    free(edge);
+    free(nullness.tracked);
+}
+
+void unit_module_eliminate_null_checks(struct unit_module* module) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_eliminate_null_checks(module->units[i]);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef COMPILER_NULL_CHECK_H
+#define COMPILER_NULL_CHECK_H
+
+#include "unit.h"
+
+// turns the null checks of pointers already known not to be null into plain moves. a pointer is known not to be null
+// when it is the address of a local, has a reference type, has been checked before on every path to the check or was
+// compared against null by a branch that only goes on when it isn't. checks in a counted loop that runs at least once
+// on a pointer the loop doesn't change are done once before the loop instead
+void unit_eliminate_null_checks(struct unit* unit);
+
+void unit_module_eliminate_null_checks(struct unit_module* module);
+
+#endif //COMPILER_NULL_CHECK_H
@@ -19,6 +19,7 @@ struct parser* parser_new(enum parser_stage stage, struct ast_module* module, st
     parser_advance(self);
     if (module)
         parser_push_scope(self, module->symbols);
+    self->generics = NULL;
     self->error = false;
     return self;
 }
@@ -141,6 +142,11 @@ bool parser_match_type(struct parser* parser) {
     if (t) {
         return true;
     }
+    if (parser->generics != NULL && parser->current.type == TOKEN_TYPE_IDENTIFIER &&
+        generic_parameter(parser->generics, parser->current) != NULL) {
+        parser_advance(parser);
+        return true;
+    }
     struct ast_node* symbol = ast_module_get_symbol(parser_scope(parser), parser->current);
     if (symbol &&
         (symbol->type == AST_NODE_TYPE_STRUCT ||
@@ -194,8 +200,13 @@ static struct ast_node* get_type_node(struct parser* parser, struct token token)
             return ast_node_new(AST_NODE_TYPE_F64, token);
         case TOKEN_TYPE_VOID:
             return ast_node_new(AST_NODE_TYPE_VOID, token);
-        case TOKEN_TYPE_IDENTIFIER:
+        case TOKEN_TYPE_IDENTIFIER: {
+            struct ast_node* parameter = parser->generics != NULL ? generic_parameter(parser->generics, token) : NULL;
+            if (parameter != NULL) {
+                return ast_node_clone(parameter);
+            }
             return ast_module_get_symbol(parser_scope(parser), token);
+        }
         default:
             return NULL;
     }
@@ -233,11 +244,19 @@ static struct ast_node* append_type_attribute(struct parser* parser, struct ast_
         struct ast_node* array = ast_node_new(AST_NODE_TYPE_ARRAY, parser->previous);
 
         ast_node_append_child(array, current);
-        struct ast_node* node = append_type_attribute(parser, array);
-        // add initial size option
+        // T[soa] keeps each field of its struct elements in a column of its own
+        if (parser_match(parser, TOKEN_TYPE_IDENTIFIER))
+        {
+            struct token layout = parser->previous;
+            if (layout.length != 3 || memcmp(layout.start, "soa", 3) != 0)
+            {
+                parser_error(parser, layout, "unknown array layout");
+            }
+            ast_node_append_child(array, ast_node_new(AST_NODE_TYPE_NAME, layout));
+        }
 
         parser_consume(parser, TOKEN_TYPE_RIGHT_BRACKET, "forgotten closing bracket ']'");
-        return node;
+        return append_type_attribute(parser, array);
     }
     if (parser_match(parser, TOKEN_TYPE_LESS))
     {
@@ -255,10 +274,143 @@ static struct ast_node* append_type_attribute(struct parser* parser, struct ast_
 struct ast_node* parser_build_type(struct parser* parser) {
     struct token type = parser->previous;
     struct ast_node* type_node = get_type_node(parser, type);
+    if (type_node != NULL && type_node->type == AST_NODE_TYPE_STRUCT && ast_node_is_generic(type_node))
+    {
+        struct generic_instance* instance = parser_instantiate(parser, type_node);
+        type_node = instance != NULL ? instance->symbol : NULL;
+    }
     while (parser_match(parser, TOKEN_TYPE_DOT))
     {
         parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected sub type after '.'"); //move the dot out of the way
         type_node = ast_node_symbol_sub(type_node, parser->previous);
     }
     return append_type_attribute(parser, type_node);
-}
\ No newline at end of file
+}
+void parser_close_generics(struct parser* parser)
+{
+    // the '>>' closing two lists at once is split, the first '>' is taken off it
+    if (parser_check(parser, TOKEN_TYPE_GREATER_GREATER))
+    {
+        parser->current.type = TOKEN_TYPE_GREATER;
+        parser->current.start++;
+        parser->current.length--;
+        return;
+    }
+    parser_consume(parser, TOKEN_TYPE_GREATER, "expected '>' after type arguments");
+}
+
+struct ast_node* parser_generic_parameters(struct parser* parser)
+{
+    struct ast_node* parameters = ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null);
+    do
+    {
+        parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected type parameter name");
+        if (parser->error)
+        {
+            break;
+        }
+        ast_node_append_child(parameters, ast_node_new(AST_NODE_TYPE_GENERIC, parser->previous));
+        if (parser_check(parser, TOKEN_TYPE_LEFT_BRACKET))
+        {
+            parser_error(parser, parser->current, "variadic generics aren't supported yet");
+            break;
+        }
+    }
+    while (parser_match(parser, TOKEN_TYPE_COMMA));
+    parser_close_generics(parser);
+    return parameters;
+}
+
+struct ast_node* parser_generic_function_ahead(struct parser* parser)
+{
+    // a declaration is a generic function when a name followed by '<' and the matching '>' is followed by '('. the
+    // return type can be an instance of a generic struct itself, its arguments are stepped over
+    for (uint32_t i = 0;; i++)
+    {
+        struct token token = parser_peek(parser, i);
+        if (token.type == TOKEN_TYPE_LEFT_PAREN || token.type == TOKEN_TYPE_SEMICOLON ||
+            token.type == TOKEN_TYPE_LEFT_BRACE || token.type == TOKEN_TYPE_RIGHT_BRACE ||
+            token.type == TOKEN_TYPE_EQUAL || token.type == TOKEN_TYPE_EOF)
+        {
+            return NULL;
+        }
+        if (token.type != TOKEN_TYPE_IDENTIFIER || parser_peek(parser, i + 1).type != TOKEN_TYPE_LESS)
+        {
+            continue;
+        }
+        uint32_t end = i + 1;
+        int depth = 0;
+        do
+        {
+            enum token_type type = parser_peek(parser, end).type;
+            depth += type == TOKEN_TYPE_LESS;
+            depth -= type == TOKEN_TYPE_GREATER;
+            depth -= 2 * (type == TOKEN_TYPE_GREATER_GREATER);
+            if (type == TOKEN_TYPE_EOF || type == TOKEN_TYPE_SEMICOLON || type == TOKEN_TYPE_LEFT_BRACE)
+            {
+                return NULL;
+            }
+            end++;
+        }
+        while (depth > 0);
+        if (parser_peek(parser, end).type != TOKEN_TYPE_LEFT_PAREN)
+        {
+            i = end - 1;
+            continue;
+        }
+        struct ast_node* parameters = ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null);
+        for (uint32_t j = i + 2; j < end - 1; j++)
+        {
+            struct token parameter = parser_peek(parser, j);
+            if (parameter.type == TOKEN_TYPE_IDENTIFIER)
+            {
+                ast_node_append_child(parameters, ast_node_new(AST_NODE_TYPE_GENERIC, parameter));
+            }
+        }
+        return parameters;
+    }
+}
+
+struct generic_instance* parser_instantiate(struct parser* parser, struct ast_node* symbol)
+{
+    struct generic* generic = generic_find(parser->module->generics, symbol);
+    if (generic == NULL || !parser_match(parser, TOKEN_TYPE_LESS))
+    {
+        parser_error(parser, parser->previous, "expected type arguments after generic");
+        return NULL;
+    }
+    size_t count = 0;
+    size_t capacity = 1;
+    struct ast_node** arguments = malloc(sizeof(struct ast_node*) * capacity);
+    assert(arguments);
+    do
+    {
+        if (!parser_match_type(parser))
+        {
+            parser_error(parser, parser->current, "expected type argument");
+            free(arguments);
+            return NULL;
+        }
+        if (count == capacity)
+        {
+            capacity *= 2;
+            arguments = realloc(arguments, sizeof(struct ast_node*) * capacity);
+            assert(arguments);
+        }
+        arguments[count++] = parser_build_type(parser);
+    }
+    while (parser_match(parser, TOKEN_TYPE_COMMA));
+    parser_close_generics(parser);
+
+    struct generic_instance* instance = NULL;
+    if (!parser->error)
+    {
+        instance = generic_instantiate(parser->module->generics, generic, arguments, count);
+        if (instance == NULL)
+        {
+            parser_error(parser, parser->previous, "wrong number of type arguments");
+        }
+    }
+    free(arguments);
+    return instance;
+}
@@ -3,6 +3,7 @@
 
 #include "lexer.h"
 #include "ast_module.h"
+#include "generic.h"
 
 enum parser_stage {
     PARSER_STAGE_MODULE_GENERATION,
@@ -25,6 +26,9 @@ struct parser {
     size_t scope_stack_count;
     size_t scope_stack_capacity;
 
+    // the type parameters of the generic being parsed, NULL outside of one
+    struct ast_node* generics;
+
     bool error;
 };
 
@@ -60,5 +64,18 @@ void skip_block(struct parser* parser);
 
 struct ast_node* parser_build_type(struct parser* parser);
 
+// the '>' closing a list of type parameters or arguments
+void parser_close_generics(struct parser* parser);
+
+// the type parameters after the name of a generic, the '<' has been matched already
+struct ast_node* parser_generic_parameters(struct parser* parser);
+
+// the type parameters of the generic function declared from the current token on, without moving past anything. NULL
+// if it isn't a generic function
+struct ast_node* parser_generic_function_ahead(struct parser* parser);
+
+// the instance of a generic struct or function for the type arguments that follow its name, NULL on error
+struct generic_instance* parser_instantiate(struct parser* parser, struct ast_node* symbol);
+
 
 #endif //COMPILER_PARSER_H
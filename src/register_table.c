@@ -32,27 +32,28 @@ void register_table_begin(struct register_table* table)
     table->current_scope++;
 }
 
+// the names declared in the scope end with it, they are the last ones added since scopes nest
 void register_table_end(struct register_table* table)
 {
     table->current_scope--;
+    while (table->symbol_count > 0 && table->symbols[table->symbol_count - 1].scope > table->current_scope)
+    {
+        table->symbol_count--;
+    }
 }
 
+// the latest declaration of the name still in scope shadows the ones before it
 struct variable* register_table_lookup(struct register_table* table, struct token name)
 {
-    struct variable* result = NULL;
-    for (int i = 0; i < table->symbol_count; i++)
+    for (uint32_t i = table->symbol_count; i-- > 0;)
     {
         struct variable* symbol = &table->symbols[i];
-        if (name.length == symbol->name.length &&
-            memcmp(name.start, symbol->name.start, name.length) == 0 &&
-            symbol->scope <= table->current_scope)
+        if (name.length == symbol->name.length && memcmp(name.start, symbol->name.start, name.length) == 0)
         {
-            if (result != NULL && symbol->scope <= result->scope)
-                continue;
-            result = symbol;
+            return symbol;
         }
     }
-    return result;
+    return NULL;
 }
 
 struct variable* register_table_add(struct register_table* table, struct token name, struct ssa_type type)
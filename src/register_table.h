@@ -12,6 +12,10 @@ struct variable {
     uint32_t scope;
     struct ssa_type type;
     struct operand pointer;
+    // the region it was defined in, 0 outside of any
+    uint32_t region;
+    // how many scopes were around its declaration
+    uint32_t depth;
 };
 
 struct register_table {
@@ -0,0 +1,274 @@
+#include "scalar_replace.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "block.h"
+
+#define NO_LOCAL UINT32_MAX
+
+// one field of a local, as it is loaded and stored
+struct piece {
+    uint32_t local;
+    uint64_t offset;
+    struct ssa_type type;
+    // the local that replaces it
+    struct operand slot;
+};
+
+// what every register points into, the local and how far into it, for the pointers derived from a local by fields
+struct scalar_replace {
+    struct unit* unit;
+    uint32_t register_count;
+    uint32_t* locals;
+    uint64_t* offsets;
+    // per local, why it can't be split, NULL if it can
+    const char** reasons;
+    // per local, true if any field of it is taken
+    bool* aggregate;
+    struct piece* pieces;
+    uint32_t piece_count;
+    uint32_t piece_capacity;
+};
+
+static bool is_pointer(struct ssa_type type) {
+    return type.type != NULL &&
+           (type.type->type == AST_NODE_TYPE_POINTER || type.type->type == AST_NODE_TYPE_REFERENCE);
+}
+
+static uint32_t local_of(struct scalar_replace* replace, struct operand operand) {
+    if (operand.type != OPERAND_TYPE_REGISTER || operand.value.integer >= replace->register_count) {
+        return NO_LOCAL;
+    }
+    return replace->locals[operand.value.integer];
+}
+
+// the type of the value an access moves through the pointer
+static struct ssa_type accessed_type(struct ssa_instruction* instruction) {
+    struct ssa_type pointer = instruction->operands[0].typename;
+    if (is_pointer(pointer)) {
+        return ssa_type_from_ast(pointer.module, pointer.type->children[0]);
+    }
+    return instruction->type;
+}
+
+static bool same_type(struct ssa_type a, struct ssa_type b) {
+    if (a.size != b.size) {
+        return false;
+    }
+    if (a.type == NULL || b.type == NULL) {
+        return a.type == b.type;
+    }
+    return a.type->type == b.type->type;
+}
+
+// follows the fields taken of every local, until no new pointer into one turns up
+static void trace_fields(struct scalar_replace* replace) {
+    struct unit* unit = replace->unit;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator == OP_ALLOC && instruction->result.type == OPERAND_TYPE_REGISTER) {
+                uint32_t reg = instruction->result.value.integer;
+                replace->locals[reg] = reg;
+                replace->offsets[reg] = 0;
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 0; i < unit->block_count; i++) {
+            struct block* block = unit->blocks[i];
+            for (uint32_t j = 0; j < block->instructions_count; j++) {
+                struct ssa_instruction* instruction = &block->instructions[j];
+                if (instruction->operator != OP_FIELD || instruction->result.type != OPERAND_TYPE_REGISTER ||
+                    instruction->operands[1].type != OPERAND_TYPE_INTEGER) {
+                    continue;
+                }
+                uint32_t local = local_of(replace, instruction->operands[0]);
+                uint32_t reg = instruction->result.value.integer;
+                if (local == NO_LOCAL || replace->locals[reg] != NO_LOCAL) {
+                    continue;
+                }
+                replace->locals[reg] = local;
+                replace->offsets[reg] =
+                        replace->offsets[instruction->operands[0].value.integer] + instruction->operands[1].value.integer;
+                replace->aggregate[local] = true;
+                changed = true;
+            }
+        }
+    }
+}
+
+static void add_access(struct scalar_replace* replace, uint32_t local, uint64_t offset, struct ssa_type type) {
+    for (uint32_t i = 0; i < replace->piece_count; i++) {
+        struct piece* piece = &replace->pieces[i];
+        if (piece->local != local) {
+            continue;
+        }
+        if (piece->offset == offset) {
+            if (!same_type(piece->type, type)) {
+                replace->reasons[local] = "a field is accessed as different types";
+            }
+            return;
+        }
+        if (piece->offset < offset + type.size && offset < piece->offset + piece->type.size) {
+            replace->reasons[local] = "its fields are accessed overlapping";
+            return;
+        }
+    }
+    if (replace->piece_count == replace->piece_capacity) {
+        replace->piece_capacity = replace->piece_capacity * 2 + 8;
+        replace->pieces = realloc(replace->pieces, sizeof(struct piece) * replace->piece_capacity);
+        assert(replace->pieces);
+    }
+    replace->pieces[replace->piece_count++] = (struct piece) {local, offset, type, operand_none()};
+}
+
+// every pointer into a local may only be loaded from, stored to or have a field taken at a known offset
+static void find_accesses(struct scalar_replace* replace) {
+    struct unit* unit = replace->unit;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                uint32_t local = local_of(replace, instruction->operands[k]);
+                if (local == NO_LOCAL) {
+                    continue;
+                }
+                bool access = k == 0 && (instruction->operator == OP_LOAD || instruction->operator == OP_STORE);
+                bool field = k == 0 && instruction->operator == OP_FIELD &&
+                             instruction->operands[1].type == OPERAND_TYPE_INTEGER;
+                if (access) {
+                    add_access(replace, local, replace->offsets[instruction->operands[k].value.integer],
+                               accessed_type(instruction));
+                } else if (!field) {
+                    replace->reasons[local] = "its address escapes";
+                }
+            }
+        }
+    }
+}
+
+static struct piece* piece_at(struct scalar_replace* replace, uint32_t local, uint64_t offset) {
+    for (uint32_t i = 0; i < replace->piece_count; i++) {
+        if (replace->pieces[i].local == local && replace->pieces[i].offset == offset) {
+            return &replace->pieces[i];
+        }
+    }
+    return NULL;
+}
+
+static bool split(struct scalar_replace* replace, uint32_t local) {
+    return replace->aggregate[local] && replace->reasons[local] == NULL;
+}
+
+static void prepend(struct block* block, struct ssa_instruction instruction) {
+    block_add(block, instruction);
+    memmove(block->instructions + 1, block->instructions,
+            sizeof(struct ssa_instruction) * (block->instructions_count - 1));
+    block->instructions[0] = instruction;
+}
+
+static void rewrite(struct scalar_replace* replace) {
+    struct unit* unit = replace->unit;
+    uint32_t next = replace->register_count;
+    for (uint32_t i = 0; i < replace->piece_count; i++) {
+        struct piece* piece = &replace->pieces[i];
+        if (!split(replace, piece->local)) {
+            continue;
+        }
+        struct ssa_instruction slot = {};
+        slot.operator = OP_ALLOC;
+        slot.type = piece->type;
+        slot.result = operand_reg(next++, piece->type);
+        slot.operands[0] = operand_const_i64((int64_t) piece->type.size);
+        piece->slot = slot.result;
+        prepend(unit->blocks[0], slot);
+    }
+
+    // the fields and the local they were taken of go away, each access goes to its field's own local
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        uint32_t kept = 0;
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction instruction = block->instructions[j];
+            if (instruction.operator == OP_ALLOC || instruction.operator == OP_FIELD) {
+                uint32_t local = local_of(replace, instruction.result);
+                if (local != NO_LOCAL && split(replace, local)) {
+                    continue;
+                }
+            }
+            if (instruction.operator == OP_LOAD || instruction.operator == OP_STORE) {
+                struct operand pointer = instruction.operands[0];
+                uint32_t local = local_of(replace, pointer);
+                if (local != NO_LOCAL && split(replace, local)) {
+                    struct piece* piece = piece_at(replace, local, replace->offsets[pointer.value.integer]);
+                    assert(piece);
+                    instruction.operands[0] = operand_reg(piece->slot.value.integer, pointer.typename);
+                }
+            }
+            block->instructions[kept++] = instruction;
+        }
+        block->instructions_count = kept;
+    }
+}
+
+void unit_scalar_replace(struct unit* unit, FILE* remarks) {
+    if (unit->block_count == 0) {
+        return;
+    }
+    struct scalar_replace replace = {};
+    replace.unit = unit;
+    replace.register_count = unit_register_count(unit);
+    replace.locals = malloc(sizeof(uint32_t) * (replace.register_count + 1));
+    replace.offsets = calloc(replace.register_count + 1, sizeof(uint64_t));
+    replace.reasons = calloc(replace.register_count + 1, sizeof(const char*));
+    replace.aggregate = calloc(replace.register_count + 1, sizeof(bool));
+    assert(replace.locals && replace.offsets && replace.reasons && replace.aggregate);
+    for (uint32_t i = 0; i <= replace.register_count; i++) {
+        replace.locals[i] = NO_LOCAL;
+    }
+
+    trace_fields(&replace);
+    find_accesses(&replace);
+
+    if (remarks != NULL) {
+        for (uint32_t i = 0; i < replace.register_count; i++) {
+            if (replace.locals[i] != i || !replace.aggregate[i]) {
+                continue;
+            }
+            fprintf(remarks, "sroa: %s: local %%%u ", unit->symbol, i);
+            if (replace.reasons[i] != NULL) {
+                fprintf(remarks, "not split: %s\n", replace.reasons[i]);
+                continue;
+            }
+            uint32_t fields = 0;
+            for (uint32_t j = 0; j < replace.piece_count; j++) {
+                fields += replace.pieces[j].local == i;
+            }
+            fprintf(remarks, "split into %u fields\n", fields);
+        }
+    }
+    rewrite(&replace);
+
+    free(replace.pieces);
+    free(replace.aggregate);
+    free(replace.reasons);
+    free(replace.offsets);
+    free(replace.locals);
+}
+
+void unit_module_scalar_replace(struct unit_module* module, FILE* remarks) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        if (module->units[i]->type == CHUNK_TYPE_FUNCTION) {
+            unit_scalar_replace(module->units[i], remarks);
+        }
+    }
+}
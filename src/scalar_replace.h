@@ -0,0 +1,15 @@
+#ifndef COMPILER_SCALAR_REPLACE_H
+#define COMPILER_SCALAR_REPLACE_H
+#include <stdio.h>
+
+#include "unit.h"
+
+// splits locals only ever read and written a field at a time into a local per field, which store forwarding can then
+// keep in registers. a local is split when every pointer into it is a field at a known offset that is only loaded and
+// stored through, and the fields it is accessed as don't overlap. says what happened to each struct local on remarks,
+// unless it's NULL
+void unit_scalar_replace(struct unit* unit, FILE* remarks);
+
+void unit_module_scalar_replace(struct unit_module* module, FILE* remarks);
+
+#endif //COMPILER_SCALAR_REPLACE_H
@@ -1,4 +1,7 @@
 #include "signature_gen.h"
+
+#include <stdlib.h>
+
 #include "parser.h"
 #include "ast_layout.h"
 
@@ -32,6 +35,11 @@ static bool struct_symbol_signature(struct parser* parser, bool is_static) {
     if (parser->error)
         return false;
     
+    if (parser_check(parser, TOKEN_TYPE_LESS)) {
+        parser_error(parser, parser->current, "generic methods aren't supported yet, the struct can be generic instead");
+        return false;
+    }
+    
     if (parser_match(parser, TOKEN_TYPE_LEFT_PAREN)) {
         // it's a method
         struct ast_node* function = ast_node_new(is_static ? AST_NODE_TYPE_FUNCTION : AST_NODE_TYPE_METHOD, token_null);
@@ -82,6 +90,32 @@ static bool struct_symbol_signature(struct parser* parser, bool is_static) {
     return true;
 }
 
+// `~()`, a method without parameters or a result that is called when a value of the struct goes out of scope
+static bool struct_destructor_signature(struct parser* parser) {
+    struct token identifier = parser->previous;
+    if (ast_node_struct_method(parser_scope(parser), identifier) != NULL) {
+        parser_error(parser, identifier, "a struct can only have one destructor");
+        return false;
+    }
+    
+    parser_consume(parser, TOKEN_TYPE_LEFT_PAREN, "expected '(' after '~'");
+    parser_consume(parser, TOKEN_TYPE_RIGHT_PAREN, "a destructor takes no arguments");
+    parser_consume(parser, TOKEN_TYPE_LEFT_BRACE, "expected '{' after destructor declaration");
+    if (parser->error)
+        return false;
+    
+    skip_block(parser);
+    
+    struct ast_node* function = ast_node_new(AST_NODE_TYPE_METHOD, token_null);
+    ast_node_append_child(function, ast_node_new(AST_NODE_TYPE_NAME, identifier));
+    ast_node_append_child(function, ast_node_new(AST_NODE_TYPE_VOID, identifier)); // return
+    ast_node_append_child(function, ast_node_new(AST_NODE_TYPE_SEQUENCE, identifier));
+    
+    ast_node_append_child(parser_scope(parser)->children[STRUCT_LAYOUT_MEMBERS], function);
+    
+    return true;
+}
+
 static bool signature_struct(struct parser* parser) {
     parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected struct name");
     if (parser->error)
@@ -89,6 +123,16 @@ static bool signature_struct(struct parser* parser) {
     struct ast_node* symbol = ast_module_get_symbol(parser_scope(parser), parser->previous);
     parser_push_scope(parser, symbol);
     
+    // the type parameters were declared with the struct, its members name them
+    struct ast_node* outer_generics = parser->generics;
+    if (parser_match(parser, TOKEN_TYPE_LESS)) {
+        while (!parser_check(parser, TOKEN_TYPE_GREATER) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+            parser_advance(parser);
+        }
+        parser_close_generics(parser);
+        parser->generics = symbol->children[STRUCT_LAYOUT_GENERICS];
+    }
+    
     if (parser_match(parser, TOKEN_TYPE_COLON)) {
         do {
             parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected interface name");
@@ -110,6 +154,11 @@ static bool signature_struct(struct parser* parser) {
                 return false;
             }
         }
+        else if (parser_match(parser, TOKEN_TYPE_TILDE)) {
+            if (!struct_destructor_signature(parser)) {
+                return false;
+            }
+        }
         else if (parser_match_type(parser)) {
             if (!struct_symbol_signature(parser, false)) {
                 return false;
@@ -132,6 +181,7 @@ static bool signature_struct(struct parser* parser) {
         }
     }
     parser_pop_scope(parser);
+    parser->generics = outer_generics;
     
     return true;
 }
@@ -243,6 +293,14 @@ static bool module_symbol_signature(struct parser* parser, bool is_static) {
     if (parser->error)
         return false;
     
+    // the type parameters of a generic function were found ahead of its return type
+    if (parser_match(parser, TOKEN_TYPE_LESS)) {
+        while (!parser_check(parser, TOKEN_TYPE_GREATER) && !parser_check(parser, TOKEN_TYPE_EOF)) {
+            parser_advance(parser);
+        }
+        parser_close_generics(parser);
+    }
+    
     if (parser_match(parser, TOKEN_TYPE_LEFT_PAREN)) {
         //NOTE: is_static actually means the INVERSE here. interesting.
         struct ast_node* function = ast_node_new(is_static ? AST_NODE_TYPE_METHOD : AST_NODE_TYPE_FUNCTION, token_null);
@@ -274,7 +332,19 @@ static bool module_symbol_signature(struct parser* parser, bool is_static) {
         
         skip_block(parser);
         
+        // the variants of a function have to differ in their parameters
+        char* parameters = ast_module_function_parameters(function);
+        bool declared = ast_module_get_variant(parser_scope(parser), identifier, parameters) != NULL;
+        free(parameters);
+        if (declared) {
+            parser_error(parser, identifier, "a function with these parameters is already declared");
+            return false;
+        }
+        
         ast_node_append_child(parser_scope(parser), function);
+        if (parser->generics != NULL) {
+            generic_declare(parser->module->generics, parser->module, function, parser->generics);
+        }
         
         return true;
     }
@@ -306,6 +376,15 @@ bool signature_gen(struct ast_module* module) {
                     goto fail;
                 }
             }
+            else if ((parser->generics = parser_generic_function_ahead(parser)) != NULL) {
+                // the return type and arguments can name the type parameters
+                bool declared = parser_match_type(parser) && module_symbol_signature(parser, false);
+                parser->generics = NULL;
+                if (!declared) {
+                    parser_error(parser, parser->current, "expected generic function");
+                    goto fail;
+                }
+            }
             else if (parser_match_type(parser)) {
                 if (!module_symbol_signature(parser, false)) {
                     return false;
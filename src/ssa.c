@@ -32,6 +32,12 @@ struct operand operand_unit(struct unit* unit)
 {
     return (struct operand){OPERAND_TYPE_IR, {}, {.unit = unit}};
 }
+
+struct operand operand_vtable(struct unit_vtable* vtable)
+{
+    return (struct operand){OPERAND_TYPE_VTABLE, {}, {.vtable = vtable}};
+}
+
 struct operand operand_const_i8(int8_t value)
 {
     static struct ast_node integer_node = {AST_NODE_TYPE_I8, {}, NULL, NULL, 0, 0};
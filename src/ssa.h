@@ -45,6 +45,22 @@ enum ssa_instruction_code
     OP_LOAD,
     OP_STORE,
     OP_CAST,
+    OP_NULL_CHECK, // traps if the pointer is null, otherwise gives the same address as a reference
+    OP_BOUNDS_CHECK, // array, index, traps if the index is outside the array, otherwise gives the index
+    OP_HEAP_ALLOC, // size, zeroed memory that outlives the frame or null if there is none left. from the region in
+                   // the second operand if there is one
+    OP_HEAP_FREE, // pointer, gives memory from OP_HEAP_ALLOC back
+    OP_HEAP_REALLOC, // pointer, size, the memory resized, where it was if it fits or null if there is none left
+    OP_FIELD, // pointer, offset, the address offset bytes into what the pointer refers to
+    OP_REGION_ENTER, // a new region, memory allocated from it is given back all at once
+    OP_REGION_LEAVE, // region, gives back everything allocated from the region and the region itself
+    OP_VTABLE, // vtable, its address. calls through it take the method out of its slot first, they are OP_CALL with
+               // a register instead of a unit, typed as the interface's abstract method
+
+    //vectors, the other operators work lane-wise on simd types
+    OP_BROADCAST, // every lane set to a scalar
+    OP_EXTRACT, // vector, lane
+    OP_INSERT, // vector, lane, scalar
 };
 
 
@@ -66,6 +82,7 @@ enum operand_type
     OPERAND_TYPE_FLOAT,
     OPERAND_TYPE_BLOCK,
     OPERAND_TYPE_IR,
+    OPERAND_TYPE_VTABLE,
 };
 
 struct operand
@@ -79,6 +96,7 @@ struct operand
         double floating;
         struct block* block;
         struct unit* unit;
+        struct unit_vtable* vtable;
     } value;
 };
 
@@ -104,6 +122,8 @@ struct operand operand_end();
 
 struct operand operand_unit(struct unit* unit);
 
+struct operand operand_vtable(struct unit_vtable* vtable);
+
 #define MAX_OPERANDS 16
 
 struct ssa_instruction
@@ -2,9 +2,12 @@
 
 #include <assert.h>
 #include <float.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "ast_layout.h"
 #include "block.h"
 #include "parser.h"
 
@@ -69,6 +72,34 @@ void scope_update_local(struct scope* scope, struct token token, int new_reg) {
     }
 }
 
+static bool same_name(struct token a, struct token b) {
+    return a.length == b.length && memcmp(a.start, b.start, a.length) == 0;
+}
+
+// a region block, its memory is given back when control leaves it
+struct region_scope {
+    // the region around it, 0 if there is none
+    uint32_t parent;
+    struct operand handle;
+    bool open;
+};
+
+// a local of a struct with a destructor, it is destroyed when control leaves the scope it was declared in
+struct owned_local {
+    struct token name;
+    // the struct's address
+    struct operand value;
+    // the region it was declared in
+    uint32_t region;
+    // how many scopes deep it was declared, it can only be moved away at that depth
+    uint32_t depth;
+    // its value was given away, it isn't destroyed any more
+    bool moved;
+    // destroys it and the locals declared before it and leaves the function, shared by every return that needs it.
+    // NULL until the first one does
+    struct block* cleanup;
+};
+
 struct compiler {
     struct ast_module* ast_module;
     struct unit_module* unit_module;
@@ -80,6 +111,8 @@ struct compiler {
     uint32_t stack_capacity;
 
     struct register_table* regs;
+    // every global of the module, their pointer is the global's address
+    struct register_table* globals;
 
     struct ssa_type return_type;
     struct operand return_value_ptr;
@@ -89,6 +122,30 @@ struct compiler {
     struct block* body;
     //clean up
     struct block* exit;
+    //where self tail calls go back to once the new arguments are in their locals, NULL if the function has none
+    struct block* start;
+    struct operand* argument_slots;
+
+    // every region of the function so far, the first entry stands for being outside of any
+    struct region_scope* regions;
+    uint32_t region_count;
+    uint32_t region_capacity;
+    // the innermost region around the statement being compiled
+    uint32_t region;
+
+    // the locals to destroy on the way out of the scopes around the statement being compiled, innermost last
+    struct owned_local* owned;
+    uint32_t owned_count;
+    uint32_t owned_capacity;
+    // the struct locals without a destructor that were moved away. they have nothing to destroy so they aren't owned,
+    // this only keeps them from being used after the move
+    struct variable* moved;
+    uint32_t moved_count;
+    uint32_t moved_capacity;
+    // how many scopes are around the statement being compiled
+    uint32_t depth;
+    // the local every return gives back, it is constructed right in the memory of the result. empty if there is none
+    struct token returned;
 };
 
 static struct compiler* compiler_new(struct ast_module* ast_module, struct unit_module* unit_module, struct unit* unit,
@@ -99,6 +156,14 @@ static struct compiler* compiler_new(struct ast_module* ast_module, struct unit_
     compiler->unit_module = unit_module;
     compiler->regs = register_table_new();
     assert(compiler->regs);
+    compiler->globals = register_table_new();
+    for (size_t i = 0; i < unit_module->unit_count; i++) {
+        struct unit* global = unit_module->units[i];
+        if (global->type == CHUNK_TYPE_VARIABLE) {
+            struct token name = {TOKEN_TYPE_IDENTIFIER, global->symbol, strlen(global->symbol), 0};
+            register_table_add(compiler->globals, name, global->return_type)->pointer = unit_address(global);
+        }
+    }
     compiler->unit = unit;
     compiler->return_type = return_type;
     compiler->entry = block_new(true, compiler->regs);
@@ -108,6 +173,8 @@ static struct compiler* compiler_new(struct ast_module* ast_module, struct unit_
     block_link(compiler->entry, compiler->body);
 
     compiler->return_value_ptr = operand_none();
+    compiler->start = NULL;
+    compiler->argument_slots = NULL;
 
     unit_add(compiler->unit, compiler->body);
 
@@ -115,10 +182,33 @@ static struct compiler* compiler_new(struct ast_module* ast_module, struct unit_
     compiler->stack_count = 0;
     compiler->stack_capacity = 1;
 
+    compiler->regions = malloc(sizeof(struct region_scope));
+    assert(compiler->regions);
+    compiler->regions[0] = (struct region_scope){0, operand_none(), true};
+    compiler->region_count = 1;
+    compiler->region_capacity = 1;
+    compiler->region = 0;
+
+    compiler->owned = malloc(sizeof(struct owned_local));
+    assert(compiler->owned);
+    compiler->owned_count = 0;
+    compiler->owned_capacity = 1;
+    compiler->moved = malloc(sizeof(struct variable));
+    assert(compiler->moved);
+    compiler->moved_count = 0;
+    compiler->moved_capacity = 1;
+    compiler->depth = 0;
+    compiler->returned = token_null;
+
     return compiler;
 }
 
 static void compiler_begin(struct compiler* compiler) {
+    // a struct is constructed in the memory the caller passes after the arguments
+    if (compiler->return_type.type->type == AST_NODE_TYPE_STRUCT) {
+        compiler->return_value_ptr = compiler->unit->arguments[compiler->unit->argument_count - 1];
+        return;
+    }
     if (compiler->return_type.type->type != AST_NODE_TYPE_VOID) {
         compiler->return_value_ptr = register_table_add(compiler->regs, (struct token){}, compiler->return_type)->
                 pointer;
@@ -144,7 +234,12 @@ static void compiler_begin(struct compiler* compiler) {
 static void compiler_end(struct compiler* compiler) {
     struct operand return_op = operand_none();
 
-    if (compiler->return_type.type->type != AST_NODE_TYPE_VOID) {
+    // the caller gets the address of its struct back
+    if (compiler->return_type.type->type == AST_NODE_TYPE_STRUCT) {
+        return_op = compiler->return_value_ptr;
+        return_op.typename = compiler->return_type;
+    }
+    else if (compiler->return_type.type->type != AST_NODE_TYPE_VOID) {
         struct ssa_instruction load_ret_val = {};
         load_ret_val.operator = OP_LOAD;
         load_ret_val.type = compiler->return_type;
@@ -167,11 +262,22 @@ static void compiler_end(struct compiler* compiler) {
 
 static void compiler_free(struct compiler* compiler) {
     register_table_free(compiler->regs);
+    register_table_free(compiler->globals);
+    free(compiler->argument_slots);
+    free(compiler->regions);
+    free(compiler->owned);
+    free(compiler->moved);
     free(compiler);
 }
 
 static struct operand statement(struct compiler* compiler, struct ast_node* node);
 
+// the variable a name refers to, a local shadows a global of the same name. NULL if there is neither
+static struct variable* variable_named(struct compiler* compiler, struct token name) {
+    struct variable* variable = register_table_lookup(compiler->regs, name);
+    return variable != NULL ? variable : register_table_lookup(compiler->globals, name);
+}
+
 //casting rules
 
 static struct operand cast_emit_reinterpret(struct compiler* compiler, struct operand operand, struct ssa_type type);
@@ -180,6 +286,8 @@ static struct operand cast_emit_dereference(struct compiler* compiler, struct op
 
 static struct operand cast_emit_static(struct compiler* compiler, struct operand operand, struct ssa_type type);
 
+static struct operand cast_emit_broadcast(struct compiler* compiler, struct operand operand, struct ssa_type type);
+
 typedef struct operand (* cast_emit_fn)(struct compiler* compiler, struct operand operand, struct ssa_type);
 
 enum cast_type {
@@ -236,6 +344,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_U16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_I16] = {
         [AST_NODE_TYPE_I8] = {CAST_TYPE_EXPLICIT, cast_emit_static},
@@ -245,6 +354,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_U16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_I32] = {
         [AST_NODE_TYPE_I8] = {CAST_TYPE_EXPLICIT, cast_emit_static},
@@ -254,6 +364,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_U16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_I64] = {
         [AST_NODE_TYPE_I8] = {CAST_TYPE_EXPLICIT, cast_emit_static},
@@ -263,6 +374,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_U16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_U64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
 
     [AST_NODE_TYPE_U8] = {
@@ -273,6 +385,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_I16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_U16] = {
         [AST_NODE_TYPE_U8] = {CAST_TYPE_EXPLICIT, cast_emit_static},
@@ -282,6 +395,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_I16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_U32] = {
         [AST_NODE_TYPE_U8] = {CAST_TYPE_EXPLICIT, cast_emit_static},
@@ -291,6 +405,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_I16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_U64] = {
         [AST_NODE_TYPE_U8] = {CAST_TYPE_EXPLICIT, cast_emit_static},
@@ -300,6 +415,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_I16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_F32] = {
         [AST_NODE_TYPE_F64] = {CAST_TYPE_IMPLICIT, cast_emit_static},
@@ -312,6 +428,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_I16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     },
     [AST_NODE_TYPE_F64] = {
         [AST_NODE_TYPE_F32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
@@ -324,6 +441,7 @@ static struct cast_rule cast_rules[AST_NODE_TYPE_TYPE_COUNT][AST_NODE_TYPE_TYPE_
         [AST_NODE_TYPE_I16] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I32] = {CAST_TYPE_EXPLICIT, cast_emit_static},
         [AST_NODE_TYPE_I64] = {CAST_TYPE_EXPLICIT, cast_emit_static},
+        [AST_NODE_TYPE_SIMD] = {CAST_TYPE_IMPLICIT, cast_emit_broadcast},
     }
 };
 
@@ -369,7 +487,15 @@ static bool compare_nodes(struct ast_node* a, struct ast_node* b) {
     if (a_root != b_root) {
         return false;
     }
-    //TODO: simd types have number components!
+    // a struct is told apart by its name, its methods may name it again
+    if (a_root == AST_NODE_TYPE_STRUCT || a_root == AST_NODE_TYPE_INTERFACE) {
+        return ast_node_same_symbol(a, b);
+    }
+    // simd lane counts live in a child token, not in the node types
+    if (a_root == AST_NODE_TYPE_SIMD &&
+        strtol(a->children[1]->token.start, NULL, 10) != strtol(b->children[1]->token.start, NULL, 10)) {
+        return false;
+    }
     for (int i = 0; i < a->children_count; i++) {
         if (!compare_nodes(a->children[i], b->children[i])) {
             return false;
@@ -411,6 +537,12 @@ static struct ssa_type promote_type(struct ssa_type a, struct ssa_type b) {
         return a;
     if (is_pointer(b))
         return b;
+
+    // scalars are broadcast into vectors
+    if (a.type->type == AST_NODE_TYPE_SIMD)
+        return a;
+    if (b.type->type == AST_NODE_TYPE_SIMD)
+        return b;
     
     // float promotion
     if (a.type->type == AST_NODE_TYPE_FLOAT) {
@@ -454,6 +586,626 @@ static struct operand cast(struct compiler* compiler, struct operand operand, st
     return operand_none();
 }
 
+static struct operand cast_emit_broadcast(struct compiler* compiler, struct operand operand, struct ssa_type type) {
+    struct ssa_instruction instruction = {};
+    instruction.type = type;
+    instruction.operator = OP_BROADCAST;
+    instruction.operands[0] = cast(compiler, operand, ssa_type_from_ast(compiler->ast_module, type.type->children[0]),
+                                   CAST_TYPE_IMPLICIT);
+    instruction.result = register_table_alloc(compiler->regs, type);
+    block_add(compiler->body, instruction);
+    return instruction.result;
+}
+
+// lanes are named x, y, z and w, or s0, s1, ... for any lane, returns -1 if the vector has no such lane
+static int64_t simd_lane(struct ast_node* simd, struct token name) {
+    int64_t lanes = strtol(simd->children[1]->token.start, NULL, 10);
+    int64_t lane = -1;
+    if (name.length == 1 && strchr("xyzw", name.start[0]) != NULL) {
+        lane = strchr("xyzw", name.start[0]) - "xyzw";
+    } else if (name.length > 1 && name.start[0] == 's') {
+        char* end;
+        lane = strtol(name.start + 1, &end, 10);
+        if (end != name.start + name.length) {
+            lane = -1;
+        }
+    }
+    return lane < lanes ? lane : -1;
+}
+
+#pragma region interfaces
+
+// a pointer to an interface is a fat pointer, the address of the data followed by the vtable of the data's struct. it
+// lives in memory like a struct does, an operand typed as one holds the address of its two words
+
+static bool is_interface(struct ssa_type type) {
+    return type.type != NULL &&
+           (type.type->type == AST_NODE_TYPE_POINTER || type.type->type == AST_NODE_TYPE_REFERENCE) &&
+           type.type->children_count == 1 && type.type->children[0]->type == AST_NODE_TYPE_INTERFACE;
+}
+
+static struct ssa_type word_type(struct compiler* compiler) {
+    return ssa_type_from_ast(compiler->ast_module, ast_node_new(AST_NODE_TYPE_U64, token_null));
+}
+
+// a reference to the data word of a fat pointer at offset 0, or to its vtable word right after it
+static struct operand interface_word(struct compiler* compiler, struct operand fat, size_t offset) {
+    struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+    ast_node_append_child(reference, ast_node_new(AST_NODE_TYPE_U64, token_null));
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_FIELD;
+    instruction.type = ssa_type_from_ast(compiler->ast_module, reference);
+    instruction.operands[0] = fat;
+    instruction.operands[1] = operand_const_i64((int64_t) offset);
+    instruction.result = register_table_alloc(compiler->regs, instruction.type);
+    block_add(compiler->body, instruction);
+    return instruction.result;
+}
+
+static struct operand load_word(struct compiler* compiler, struct operand fat, size_t offset) {
+    struct ssa_instruction load = {};
+    load.operator = OP_LOAD;
+    load.type = word_type(compiler);
+    load.operands[0] = interface_word(compiler, fat, offset);
+    load.result = register_table_alloc(compiler->regs, load.type);
+    block_add(compiler->body, load);
+    return load.result;
+}
+
+static void store_word(struct compiler* compiler, struct operand fat, size_t offset, struct operand value) {
+    struct ssa_instruction store = {};
+    store.operator = OP_STORE;
+    store.type = word_type(compiler);
+    store.operands[0] = interface_word(compiler, fat, offset);
+    store.operands[1] = value;
+    block_add(compiler->body, store);
+}
+
+// the vtable of a struct for an interface, the struct has to implement every method of it
+static struct operand vtable(struct compiler* compiler, struct ast_node* structure, struct ast_node* interface) {
+    ERROR(ast_node_implements(structure, interface), "struct doesn't implement the interface\n");
+    struct unit_vtable* table = unit_module_vtable(compiler->unit_module, structure, interface);
+    for (uint32_t i = 0; i < table->method_count; i++) {
+        ERROR(table->methods[i] != NULL, "struct has no method with the signature the interface gives it\n");
+    }
+
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_VTABLE;
+    instruction.type = word_type(compiler);
+    instruction.operands[0] = operand_vtable(table);
+    instruction.result = register_table_alloc(compiler->regs, instruction.type);
+    block_add(compiler->body, instruction);
+    return instruction.result;
+}
+
+// stores a value into a fat pointer. another pointer to the same interface is copied, a pointer to a struct gets the
+// struct's vtable and null clears both words
+static void interface_store(struct compiler* compiler, struct operand fat, struct operand value) {
+    struct ast_node* interface = fat.typename.type->children[0];
+    if (is_interface(value.typename)) {
+        ERROR(ast_node_same_symbol(value.typename.type->children[0], interface),
+              "only a pointer to the same interface can be assigned\n");
+        struct operand data = load_word(compiler, value, 0);
+        struct operand table = load_word(compiler, value, sizeof(void*));
+        store_word(compiler, fat, 0, data);
+        store_word(compiler, fat, sizeof(void*), table);
+        return;
+    }
+    if (value.type == OPERAND_TYPE_INTEGER && value.value.integer == 0) {
+        ERROR(fat.typename.type->type == AST_NODE_TYPE_POINTER, "only nullable pointers can be null\n");
+        store_word(compiler, fat, 0, operand_const_i64(0));
+        store_word(compiler, fat, sizeof(void*), operand_const_i64(0));
+        return;
+    }
+    ERROR(is_pointer(value.typename) && value.typename.type->children_count == 1 &&
+          value.typename.type->children[0]->type == AST_NODE_TYPE_STRUCT,
+          "only pointers to structs can be made into interface pointers\n");
+    struct operand data = value;
+    data.typename = word_type(compiler);
+    store_word(compiler, fat, 0, data);
+    store_word(compiler, fat, sizeof(void*), vtable(compiler, value.typename.type->children[0], interface));
+}
+
+// a fat pointer only the current expression uses
+static struct operand interface_temporary(struct compiler* compiler, struct ssa_type type) {
+    struct ssa_instruction slot = {};
+    slot.operator = OP_ALLOC;
+    slot.type = type;
+    slot.result = register_table_alloc(compiler->regs, type);
+    slot.operands[0] = operand_const_i64((int64_t) type.size);
+    block_add(compiler->entry, slot);
+    return slot.result;
+}
+
+#pragma endregion
+
+#pragma region structs
+
+// struct values live in memory, an operand with a struct type holds the address of the struct instead of the struct
+
+static bool is_struct(struct ssa_type type) {
+    return type.type != NULL && type.type->type == AST_NODE_TYPE_STRUCT;
+}
+
+static struct ast_node* struct_members(struct ast_node* structure) {
+    return structure->children[STRUCT_LAYOUT_MEMBERS];
+}
+
+// a reference to the field called name of a struct
+static struct operand field_address(struct compiler* compiler, struct operand structure, struct token name) {
+    size_t offset;
+    struct ast_node* field = ast_node_struct_field(compiler->ast_module, structure.typename.type, name, &offset);
+    ERROR(field != NULL, "struct has no such field\n");
+
+    struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+    ast_node_append_child(reference, ast_node_clone(field->children[1]));
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_FIELD;
+    instruction.type = ssa_type_from_ast(compiler->ast_module, reference);
+    instruction.operands[0] = structure;
+    instruction.operands[1] = operand_const_i64((int64_t) offset);
+    instruction.result = register_table_alloc(compiler->regs, instruction.type);
+    block_add(compiler->body, instruction);
+    return instruction.result;
+}
+
+// what a field holds, a field holding a struct is that struct's address
+static struct operand field_value(struct compiler* compiler, struct operand address) {
+    struct ssa_type type = ssa_type_from_ast(compiler->ast_module, address.typename.type->children[0]);
+    if (is_struct(type) || is_interface(type)) {
+        address.typename = type;
+        return address;
+    }
+    struct ssa_instruction load = {};
+    load.operator = OP_LOAD;
+    load.type = type;
+    load.operands[0] = address;
+    load.result = register_table_alloc(compiler->regs, type);
+    block_add(compiler->body, load);
+    return load.result;
+}
+
+// ZII, every field is stored separately so the zeroes can be forwarded like any other store
+static void zero_fields(struct compiler* compiler, struct operand structure) {
+    struct ast_node* members = struct_members(structure.typename.type);
+    for (size_t i = 0; i < members->children_count; i++) {
+        struct ast_node* field = members->children[i];
+        if (field->type != AST_NODE_TYPE_FIELD) {
+            continue;
+        }
+        struct operand address = field_address(compiler, structure, field->children[0]->token);
+        if (field->children[1]->type == AST_NODE_TYPE_STRUCT) {
+            zero_fields(compiler, field_value(compiler, address));
+            continue;
+        }
+        if (is_interface(ssa_type_from_ast(compiler->ast_module, field->children[1]))) {
+            struct operand fat = field_value(compiler, address);
+            store_word(compiler, fat, 0, operand_const_i64(0));
+            store_word(compiler, fat, sizeof(void*), operand_const_i64(0));
+            continue;
+        }
+        struct ssa_instruction store = {};
+        store.operator = OP_STORE;
+        store.type = ssa_type_from_ast(compiler->ast_module, field->children[1]);
+        store.operands[0] = address;
+        store.operands[1] = operand_const_i64(0);
+        block_add(compiler->body, store);
+    }
+}
+
+// copies every field of target the source has a field of the same name and type for, the others are left as they
+// are. copying between two values of the same struct copies all of them, between different structs it is the smart
+// cast. each field is moved on its own, so once the structs are split into their fields the copy is plain moves
+static void copy_fields(struct compiler* compiler, struct operand target, struct operand source) {
+    struct ast_node* members = struct_members(target.typename.type);
+    for (size_t i = 0; i < members->children_count; i++) {
+        struct ast_node* field = members->children[i];
+        if (field->type != AST_NODE_TYPE_FIELD) {
+            continue;
+        }
+        struct token name = field->children[0]->token;
+        size_t offset;
+        struct ast_node* match = ast_node_struct_field(compiler->ast_module, source.typename.type, name, &offset);
+        if (match == NULL || !compare_nodes(match->children[1], field->children[1])) {
+            continue;
+        }
+
+        struct operand from = field_value(compiler, field_address(compiler, source, name));
+        struct operand to = field_address(compiler, target, name);
+        if (is_struct(from.typename)) {
+            copy_fields(compiler, field_value(compiler, to), from);
+            continue;
+        }
+        if (is_interface(from.typename)) {
+            interface_store(compiler, field_value(compiler, to), from);
+            continue;
+        }
+        struct ssa_instruction store = {};
+        store.operator = OP_STORE;
+        store.type = from.typename;
+        store.operands[0] = to;
+        store.operands[1] = from;
+        block_add(compiler->body, store);
+    }
+}
+
+// memory for a struct of the given type only the current expression uses, left as it is
+static struct operand struct_slot(struct compiler* compiler, struct ssa_type type) {
+    struct ssa_instruction slot = {};
+    slot.operator = OP_ALLOC;
+    slot.type = type;
+    slot.result = register_table_alloc(compiler->regs, type);
+    slot.operands[0] = operand_const_i64((int64_t) type.size);
+    block_add(compiler->entry, slot);
+    return slot.result;
+}
+
+// a zeroed struct of the given type only the current expression uses
+static struct operand struct_temporary(struct compiler* compiler, struct ssa_type type) {
+    struct operand slot = struct_slot(compiler, type);
+    zero_fields(compiler, slot);
+    return slot;
+}
+
+// a function returning a struct constructs it in memory its caller passes after the arguments and gives back its
+// address. a struct argument is the address of a struct the function owns, see transfer
+static bool has_result_slot(struct unit* unit) {
+    return is_struct(unit->return_type);
+}
+
+// the arguments a call is written with, this included
+static uint32_t parameter_count(struct unit* unit) {
+    return unit->argument_count - (has_result_slot(unit) ? 1 : 0);
+}
+
+// stores a value into what a reference refers to, a struct is copied field by field
+static void assign_reference(struct compiler* compiler, struct operand address, struct operand value) {
+    struct ssa_type type = ssa_type_from_ast(compiler->ast_module, address.typename.type->children[0]);
+    if (is_struct(type)) {
+        ERROR(compare_types(value.typename, type), "only a struct of the same type can be assigned\n");
+        copy_fields(compiler, field_value(compiler, address), value);
+        return;
+    }
+    if (is_interface(type)) {
+        interface_store(compiler, field_value(compiler, address), value);
+        return;
+    }
+
+    struct ssa_instruction store = {};
+    store.operator = OP_STORE;
+    store.type = type;
+    store.operands[0] = address;
+    store.operands[1] = cast(compiler, value, type, CAST_TYPE_IMPLICIT);
+    block_add(compiler->body, store);
+}
+
+#pragma endregion
+
+#pragma region regions
+
+// memory allocated in a region comes from the region's arena and is given back all at once when control leaves it, by
+// the end of the block or a return. a pointer into a region may only be kept in the region's own locals and memory, or
+// those of regions inside it, so none is left once the region is gone. calls only borrow the pointers they're passed
+
+static struct ssa_type region_handle_type(struct compiler* compiler) {
+    return ssa_type_from_ast(compiler->ast_module, ast_node_new(AST_NODE_TYPE_I64, token_null));
+}
+
+static uint32_t region_begin(struct compiler* compiler) {
+    struct ssa_instruction enter = {};
+    enter.operator = OP_REGION_ENTER;
+    enter.type = region_handle_type(compiler);
+    enter.result = register_table_alloc(compiler->regs, enter.type);
+    block_add(compiler->body, enter);
+
+    if (compiler->region_count == compiler->region_capacity) {
+        compiler->region_capacity *= 2;
+        compiler->regions = realloc(compiler->regions, sizeof(struct region_scope) * compiler->region_capacity);
+        assert(compiler->regions);
+    }
+    compiler->regions[compiler->region_count] = (struct region_scope){compiler->region, enter.result, true};
+    compiler->region = compiler->region_count++;
+    return compiler->region;
+}
+
+static void region_leave(struct compiler* compiler, uint32_t region) {
+    struct ssa_instruction leave = {};
+    leave.operator = OP_REGION_LEAVE;
+    leave.operands[0] = compiler->regions[region].handle;
+    leave.result = operand_none();
+    block_add(compiler->body, leave);
+}
+
+static void region_end(struct compiler* compiler) {
+    compiler->regions[compiler->region].open = false;
+    compiler->region = compiler->regions[compiler->region].parent;
+}
+
+// true if inner is outer or a region inside it, everything is inside of no region at all
+static bool region_within(struct compiler* compiler, uint32_t inner, uint32_t outer) {
+    for (uint32_t region = inner; region != 0; region = compiler->regions[region].parent) {
+        if (region == outer) {
+            return true;
+        }
+    }
+    return outer == 0;
+}
+
+static uint32_t region_innermost(struct compiler* compiler, uint32_t a, uint32_t b) {
+    return region_within(compiler, a, b) ? a : b;
+}
+
+static bool holds_pointer(struct ast_node* type) {
+    switch (type->type) {
+        case AST_NODE_TYPE_POINTER:
+        case AST_NODE_TYPE_REFERENCE:
+        case AST_NODE_TYPE_ARRAY:
+            return true;
+        case AST_NODE_TYPE_STRUCT: {
+            struct ast_node* members = struct_members(type);
+            for (size_t i = 0; i < members->children_count; i++) {
+                struct ast_node* field = members->children[i];
+                if (field->type == AST_NODE_TYPE_FIELD && field->children[1] != type &&
+                    holds_pointer(field->children[1])) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+// the innermost region the value of an expression may point into, 0 if none. what is loaded from a region's memory
+// may point into it too, and a call may give back any of the pointers it is passed
+static uint32_t region_of(struct compiler* compiler, struct ast_node* node) {
+    switch (node->type) {
+        case AST_NODE_TYPE_NAME: {
+            struct variable* variable = register_table_lookup(compiler->regs, node->token);
+            return variable != NULL && holds_pointer(variable->type.type) ? variable->region : 0;
+        }
+        case AST_NODE_TYPE_CALL: {
+            struct token name = node->children[0]->token;
+            if (name.length == 5 && memcmp(name.start, "alloc", 5) == 0 &&
+                unit_module_overloads(compiler->unit_module, name) == NULL) {
+                return compiler->region;
+            }
+            // a method may give back this as well
+            uint32_t region = 0;
+            if (node->children[0]->type == AST_NODE_TYPE_GET_FIELD) {
+                region = region_of(compiler, node->children[0]->children[0]);
+            }
+            for (size_t i = 1; i < node->children_count; i++) {
+                region = region_innermost(compiler, region, region_of(compiler, node->children[i]));
+            }
+            return region;
+        }
+        case AST_NODE_TYPE_STATIC_CAST:
+            if (node->children[0]->type == AST_NODE_TYPE_ARRAY) {
+                return compiler->region;
+            }
+            return region_of(compiler, node->children[1]);
+        case AST_NODE_TYPE_REINTERPRET_CAST:
+            return region_of(compiler, node->children[1]);
+        case AST_NODE_TYPE_ADDRESS:
+        case AST_NODE_TYPE_LOCK:
+        case AST_NODE_TYPE_MOVE:
+        case AST_NODE_TYPE_COPY:
+        case AST_NODE_TYPE_GET_FIELD:
+        case AST_NODE_TYPE_INDEX:
+            return region_of(compiler, node->children[0]);
+        case AST_NODE_TYPE_ASSIGN:
+            return region_of(compiler, node->children[1]);
+        default:
+            return 0;
+    }
+}
+
+// rejects keeping a value that may point into a region somewhere that belongs to a region around it
+static void region_keep(struct compiler* compiler, uint32_t target, struct ast_node* node, struct operand value) {
+    ERROR(!holds_pointer(value.typename.type) || region_within(compiler, target, region_of(compiler, node)),
+          "a pointer into a region can't be kept outside of it\n");
+}
+
+// zeroed memory from the innermost region, or the heap outside of regions
+static struct operand allocate(struct compiler* compiler, struct ssa_type type, struct operand size) {
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_HEAP_ALLOC;
+    instruction.type = type;
+    instruction.operands[0] = size;
+    if (compiler->region != 0) {
+        instruction.operands[1] = compiler->regions[compiler->region].handle;
+    }
+    instruction.result = register_table_alloc(compiler->regs, type);
+    block_add(compiler->body, instruction);
+    return instruction.result;
+}
+
+#pragma endregion
+
+#pragma region arrays
+
+// an array is a pointer to its array_header, the elements follow the header. a soa array of structs keeps each field in
+// a column of capacity values instead, the columns are in the order of the struct's layout so the column of a field
+// starts capacity times the field's offset past the header and the columns take as much room as the elements would
+
+static bool is_array(struct ssa_type type) {
+    return type.type != NULL && type.type->type == AST_NODE_TYPE_ARRAY;
+}
+
+static bool is_soa(struct ssa_type type) {
+    return is_array(type) && type.type->children_count > 1;
+}
+
+static struct ssa_type array_element(struct compiler* compiler, struct ssa_type array) {
+    return ssa_type_from_ast(compiler->ast_module, array.type->children[0]);
+}
+
+static struct ssa_type offset_type(struct compiler* compiler) {
+    return ssa_type_from_ast(compiler->ast_module, ast_node_new(AST_NODE_TYPE_I64, token_null));
+}
+
+static struct operand offset_arithmetic(struct compiler* compiler, enum ssa_instruction_code operator,
+                                        struct operand x, struct operand y) {
+    struct ssa_instruction instruction = {};
+    instruction.operator = operator;
+    instruction.type = offset_type(compiler);
+    instruction.operands[0] = x;
+    instruction.operands[1] = y;
+    instruction.result = register_table_alloc(compiler->regs, instruction.type);
+    block_add(compiler->body, instruction);
+    return instruction.result;
+}
+
+// a reference to a value of the given type offset bytes into the array
+static struct operand array_reference(struct compiler* compiler, struct operand array, struct operand offset,
+                                      struct ast_node* type) {
+    struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+    ast_node_append_child(reference, ast_node_clone(type));
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_FIELD;
+    instruction.type = ssa_type_from_ast(compiler->ast_module, reference);
+    instruction.operands[0] = array;
+    instruction.operands[1] = offset;
+    instruction.result = register_table_alloc(compiler->regs, instruction.type);
+    block_add(compiler->body, instruction);
+    return instruction.result;
+}
+
+static struct operand array_header_field(struct compiler* compiler, struct operand array, size_t offset) {
+    struct operand address = array_reference(compiler, array, operand_const_i64((int64_t) offset),
+                                             offset_type(compiler).type);
+    return field_value(compiler, address);
+}
+
+static struct operand array_index(struct compiler* compiler, struct ast_node* node) {
+    return cast(compiler, statement(compiler, node), offset_type(compiler), CAST_TYPE_EXPLICIT);
+}
+
+// the index of an element of the array, the program stops when it is outside the array. most of these checks can't
+// fail and are removed again, see bounds_check.h
+static struct operand checked_index(struct compiler* compiler, struct operand array, struct ast_node* node) {
+    struct ssa_instruction check = {};
+    check.operator = OP_BOUNDS_CHECK;
+    check.type = offset_type(compiler);
+    check.operands[0] = array;
+    check.operands[1] = array_index(compiler, node);
+    check.result = register_table_alloc(compiler->regs, check.type);
+    block_add(compiler->body, check);
+    return check.result;
+}
+
+// the offset of the element at index past the start of the array, for elements size bytes apart from start on
+static struct operand element_offset(struct compiler* compiler, struct operand index, struct operand start,
+                                     size_t size) {
+    struct operand scaled = offset_arithmetic(compiler, OP_MUL, index, operand_const_i64((int64_t) size));
+    return offset_arithmetic(compiler, OP_ADD, scaled, start);
+}
+
+static struct operand element_address(struct compiler* compiler, struct operand array, struct operand index) {
+    struct ssa_type element = array_element(compiler, array.typename);
+    struct operand offset = element_offset(compiler, index, operand_const_i64(sizeof(struct array_header)),
+                                           element.size);
+    return array_reference(compiler, array, offset, element.type);
+}
+
+// a reference to the field called name of the element at index of a soa array
+static struct operand column_address(struct compiler* compiler, struct operand array, struct operand index,
+                                     struct token name) {
+    struct ssa_type element = array_element(compiler, array.typename);
+    size_t offset;
+    struct ast_node* field = ast_node_struct_field(compiler->ast_module, element.type, name, &offset);
+    ERROR(field != NULL, "struct has no such field\n");
+
+    struct operand capacity = array_header_field(compiler, array, offsetof(struct array_header, capacity));
+    struct operand column = offset_arithmetic(compiler, OP_MUL, capacity, operand_const_i64((int64_t) offset));
+    column = offset_arithmetic(compiler, OP_ADD, column, operand_const_i64(sizeof(struct array_header)));
+    struct operand start = element_offset(compiler, index, column,
+                                          ast_node_symbol_size(compiler->ast_module, field->children[1]));
+    return array_reference(compiler, array, start, field->children[1]);
+}
+
+// a reference to the field called name of an element, where node indexes the array
+static struct operand element_field(struct compiler* compiler, struct ast_node* node, struct token name) {
+    struct operand array = statement(compiler, node->children[0]);
+    ERROR(is_array(array.typename), "only arrays can be indexed\n");
+    ERROR(is_struct(array_element(compiler, array.typename)), "only struct elements have fields\n");
+    struct operand index = checked_index(compiler, array, node->children[1]);
+    if (is_soa(array.typename)) {
+        return column_address(compiler, array, index, name);
+    }
+    return field_address(compiler, field_value(compiler, element_address(compiler, array, index)), name);
+}
+
+// T[](count) makes an array of count zeroed elements
+static struct operand new_array(struct compiler* compiler, struct ssa_type type, struct operand count) {
+    struct ssa_type element = array_element(compiler, type);
+    ERROR(!is_soa(type) || is_struct(element), "only arrays of structs can have the soa layout\n");
+    count = cast(compiler, count, offset_type(compiler), CAST_TYPE_EXPLICIT);
+
+    struct operand size = element_offset(compiler, count, operand_const_i64(sizeof(struct array_header)), element.size);
+    struct operand array = allocate(compiler, type, size);
+
+    size_t fields[] = {offsetof(struct array_header, length), offsetof(struct array_header, capacity)};
+    for (int i = 0; i < 2; i++) {
+        struct ssa_instruction store = {};
+        store.operator = OP_STORE;
+        store.type = offset_type(compiler);
+        store.operands[0] = array_reference(compiler, array, operand_const_i64((int64_t) fields[i]), store.type.type);
+        store.operands[1] = count;
+        block_add(compiler->body, store);
+    }
+    return array;
+}
+
+// a soa element is gathered from its columns into a struct of its own
+static struct operand get_element(struct compiler* compiler, struct ast_node* node) {
+    struct operand array = statement(compiler, node->children[0]);
+    ERROR(is_array(array.typename), "only arrays can be indexed\n");
+    struct operand index = checked_index(compiler, array, node->children[1]);
+    if (!is_soa(array.typename)) {
+        return field_value(compiler, element_address(compiler, array, index));
+    }
+
+    struct operand element = struct_temporary(compiler, array_element(compiler, array.typename));
+    struct ast_node* members = struct_members(element.typename.type);
+    for (size_t i = 0; i < members->children_count; i++) {
+        struct ast_node* field = members->children[i];
+        if (field->type == AST_NODE_TYPE_FIELD) {
+            struct token name = field->children[0]->token;
+            struct operand column = column_address(compiler, array, index, name);
+            assign_reference(compiler, field_address(compiler, element, name), field_value(compiler, column));
+        }
+    }
+    return element;
+}
+
+// a soa element is scattered into its columns
+static void set_element(struct compiler* compiler, struct ast_node* node, struct operand value) {
+    struct operand array = statement(compiler, node->children[0]);
+    ERROR(is_array(array.typename), "only arrays can be indexed\n");
+    struct operand index = checked_index(compiler, array, node->children[1]);
+    if (!is_soa(array.typename)) {
+        assign_reference(compiler, element_address(compiler, array, index), value);
+        return;
+    }
+
+    ERROR(compare_types(value.typename, array_element(compiler, array.typename)),
+          "only a struct of the same type can be assigned\n");
+    struct ast_node* members = struct_members(value.typename.type);
+    for (size_t i = 0; i < members->children_count; i++) {
+        struct ast_node* field = members->children[i];
+        if (field->type == AST_NODE_TYPE_FIELD) {
+            struct token name = field->children[0]->token;
+            struct operand column = column_address(compiler, array, index, name);
+            assign_reference(compiler, column, field_value(compiler, field_address(compiler, value, name)));
+        }
+    }
+}
+
+#pragma endregion
+
 static struct operand binary(struct compiler* compiler, struct ast_node* node, enum ssa_instruction_code type) {
     struct ast_node* left = node->children[0];
     struct ast_node* right = node->children[1];
@@ -500,45 +1252,1040 @@ struct operand get_float(double value) {
     return operand_const_f64(value);
 }
 
-static struct operand statement(struct compiler* compiler, struct ast_node* node) {
-    struct block* current = compiler->body;
-    struct register_table* regs = compiler->regs;
-    switch (node->type) {
-        case AST_NODE_TYPE_SCOPE:
-            //TODO: begin a new scope
-        case AST_NODE_TYPE_SEQUENCE: {
-            struct operand last_operand = {};
-            for (int i = 0; i < node->children_count; i++) {
-                struct ast_node* child = node->children[i];
-                last_operand = statement(compiler, child);
-                if (last_operand.type == OPERAND_TYPE_END)
-                    break;
-            }
-            if (node->type == AST_NODE_TYPE_SCOPE) {
-                //TODO: end scope
-            }
-            return last_operand;
-        }
-        case AST_NODE_TYPE_INTEGER: {
-            int64_t immediate = strtoll(node->token.start, NULL, 10);
-            return get_int(immediate); //TODO: implement polymorphic literals
-        }
-        case AST_NODE_TYPE_FLOAT: {
-            double immediate = strtod(node->token.start, NULL);
-            return get_float(immediate); //TODO: implement polymorphic literals
-        }
-        case AST_NODE_TYPE_POINTER: {
-            struct operand op = {};
-            op.type = OPERAND_TYPE_REGISTER;
-            op.typename = ssa_type_from_ast(compiler->ast_module, node);
-            op.value.integer = 0;
-            return op;
-        }
-        case AST_NODE_TYPE_BOOL: {
-            struct operand op = {};
-            op.type = OPERAND_TYPE_REGISTER;
-            op.typename = ssa_type_from_ast(compiler->ast_module, node);
-            int64_t immediate = strtoll(node->token.start, NULL, 10);
+// a nullable pointer checked against null, what comes out of the check is a reference since it can't be null anymore
+static struct operand checked(struct compiler* compiler, struct operand pointer) {
+    if (pointer.typename.type->type == AST_NODE_TYPE_REFERENCE) {
+        return pointer;
+    }
+
+    struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+    ast_node_append_child(reference, ast_node_clone(pointer.typename.type->children[0]));
+    struct ssa_instruction check = {};
+    check.operator = OP_NULL_CHECK;
+    check.type = ssa_type_from_ast(compiler->ast_module, reference);
+    check.operands[0] = pointer;
+    check.result = register_table_alloc(compiler->regs, check.type);
+    block_add(compiler->body, check);
+    return check.result;
+}
+
+// the address `*p` goes through, checked first if the pointer is nullable
+static struct operand lock(struct compiler* compiler, struct ast_node* node) {
+    struct operand pointer = statement(compiler, node->children[0]);
+    ERROR(is_pointer(pointer.typename) && pointer.typename.type->children_count == 1, "only pointers can be locked\n");
+    return checked(compiler, pointer);
+}
+
+// the struct a value is, or the one a pointer or reference to a struct points to so its fields can be used without
+// locking it first. a nullable pointer is checked
+static struct operand struct_of(struct compiler* compiler, struct operand value) {
+    if (value.typename.type == NULL || !is_pointer(value.typename) || value.typename.type->children_count != 1 ||
+        value.typename.type->children[0]->type != AST_NODE_TYPE_STRUCT) {
+        return value;
+    }
+    struct operand structure = checked(compiler, value);
+    structure.typename = ssa_type_from_ast(compiler->ast_module, value.typename.type->children[0]);
+    return structure;
+}
+
+// `alloc(size)`, `realloc(pointer, size)` and `free(pointer)` are provided by the runtime unless the module defines
+// functions with those names. they are lowered to heap operators so later passes can see which allocations get freed
+// where. alloc in a region takes from the region, and freeing memory a region gave does nothing. returns false for any
+// other call
+static bool builtin_call(struct compiler* compiler, struct ast_node* node, struct operand* result) {
+    struct token name = node->children[0]->token;
+    if (unit_module_overloads(compiler->unit_module, name) != NULL) {
+        return false;
+    }
+
+    struct ssa_instruction instruction = {};
+    if (name.length == 5 && memcmp(name.start, "alloc", 5) == 0) {
+        ERROR(node->children_count == 2, "alloc takes the size in bytes\n");
+        struct ast_node* pointer = ast_node_new(AST_NODE_TYPE_POINTER, token_null);
+        ast_node_append_child(pointer, ast_node_new(AST_NODE_TYPE_U8, token_null));
+        *result = allocate(compiler, ssa_type_from_ast(compiler->ast_module, pointer),
+                           statement(compiler, node->children[1]));
+        return true;
+    }
+    if (name.length == 7 && memcmp(name.start, "realloc", 7) == 0) {
+        ERROR(node->children_count == 3, "realloc takes the pointer alloc gave and the new size in bytes\n");
+        instruction.operator = OP_HEAP_REALLOC;
+        instruction.operands[0] = statement(compiler, node->children[1]);
+        instruction.operands[1] = statement(compiler, node->children[2]);
+        ERROR(is_pointer(instruction.operands[0].typename), "only pointers can be reallocated\n");
+        instruction.type = instruction.operands[0].typename;
+        instruction.result = register_table_alloc(compiler->regs, instruction.type);
+        block_add(compiler->body, instruction);
+        *result = instruction.result;
+        return true;
+    }
+    if (name.length == 4 && memcmp(name.start, "free", 4) == 0) {
+        ERROR(node->children_count == 2, "free takes the pointer alloc gave\n");
+        instruction.operator = OP_HEAP_FREE;
+        instruction.operands[0] = statement(compiler, node->children[1]);
+        instruction.result = operand_none();
+        ERROR(is_pointer(instruction.operands[0].typename) || is_array(instruction.operands[0].typename),
+              "only pointers and arrays can be freed\n");
+        block_add(compiler->body, instruction);
+        *result = operand_none();
+        return true;
+    }
+    return false;
+}
+
+#pragma region calls
+
+static struct operand transfer(struct compiler* compiler, struct ast_node* node, struct operand value);
+
+// the argument node as the callee takes it, value is what it was lowered to. a pointer to an interface is passed as the
+// address of a fat pointer, which the callee copies when it starts, anything else is made into one first. a struct is
+// passed as memory the callee owns
+static struct operand call_argument(struct compiler* compiler, struct ast_node* node, struct operand value,
+                                    struct ssa_type type) {
+    if (is_struct(type) && compare_types(value.typename, type)) {
+        return transfer(compiler, node, value);
+    }
+    if (!is_interface(type)) {
+        return cast(compiler, value, type, CAST_TYPE_IMPLICIT);
+    }
+    if (is_interface(value.typename) && ast_node_same_symbol(value.typename.type->children[0], type.type->children[0])) {
+        return value;
+    }
+    struct operand fat = interface_temporary(compiler, type);
+    interface_store(compiler, fat, value);
+    return fat;
+}
+
+// calls a unit with the arguments of a call node. this is the struct a method is called on, none for functions.
+// values are the arguments when they were lowered already, NULL otherwise. a struct the unit returns is constructed in
+// slot, or in a temporary when it is none
+static struct operand call_unit(struct compiler* compiler, struct unit* callee, struct ast_node* node,
+                                struct operand this, struct operand* values, struct operand slot) {
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_CALL;
+    instruction.type = callee->return_type;
+    instruction.operands[0] = operand_unit(callee);
+    int first = 0;
+    if (this.type != OPERAND_TYPE_NONE) {
+        this.typename = callee->arguments[0].typename;
+        instruction.operands[1] = this;
+        first = 1;
+    }
+    int count = (int) parameter_count(callee);
+    ERROR(count - first == node->children_count - 1, "wrong number of arguments\n");
+
+    for (int i = first; i < count; i++) {
+        struct ast_node* argument = node->children[i - first + 1];
+        struct operand value = values != NULL ? values[i - first] : statement(compiler, argument);
+        instruction.operands[i + 1] = call_argument(compiler, argument, value, callee->arguments[i].typename);
+    }
+
+    if (has_result_slot(callee)) {
+        if (slot.type == OPERAND_TYPE_NONE) {
+            slot = struct_slot(compiler, callee->return_type);
+        }
+        instruction.operands[count + 1] = slot;
+        instruction.operands[count + 1].typename = callee->arguments[count].typename;
+    }
+
+    instruction.result = register_table_alloc(compiler->regs, instruction.type);
+    block_add(compiler->body, instruction);
+    if (has_result_slot(callee)) {
+        slot.typename = callee->return_type;
+        return slot;
+    }
+    return instruction.result;
+}
+
+// a method out of the vtable of a fat pointer, called with the data as this. the call is typed as the interface's
+// abstract method, devirtualize calls the struct's own method instead when it finds out which struct the data is
+static struct operand interface_call(struct compiler* compiler, struct ast_node* node, struct operand fat,
+                                     struct operand result) {
+    struct token name = node->children[0]->children[1]->token;
+    size_t slot;
+    struct ast_node* abstract = ast_node_interface_method(fat.typename.type->children[0], name, &slot);
+    ERROR(abstract != NULL, "interface has no such method\n");
+    struct ast_node* arguments = abstract->children[2];
+    ERROR(arguments->children_count == node->children_count - 1 && arguments->children_count + 3 <= MAX_OPERANDS,
+          "wrong number of arguments\n");
+
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_CALL;
+    instruction.type = ssa_type_from_ast(compiler->ast_module, abstract->children[1]);
+    for (size_t i = 0; i < arguments->children_count; i++) {
+        struct ssa_type type = ssa_type_from_ast(compiler->ast_module, arguments->children[i]->children[1]);
+        struct ast_node* argument = node->children[i + 1];
+        instruction.operands[i + 2] = call_argument(compiler, argument, statement(compiler, argument), type);
+    }
+    // the struct the method returns goes after the arguments, like for any other call
+    if (is_struct(instruction.type)) {
+        if (result.type == OPERAND_TYPE_NONE) {
+            result = struct_slot(compiler, instruction.type);
+        }
+        struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+        ast_node_append_child(reference, instruction.type.type);
+        instruction.operands[arguments->children_count + 2] = result;
+        instruction.operands[arguments->children_count + 2].typename =
+                ssa_type_from_ast(compiler->ast_module, reference);
+    }
+
+    struct operand table = load_word(compiler, fat, sizeof(void*));
+    if (fat.typename.type->type == AST_NODE_TYPE_POINTER) {
+        struct ssa_instruction check = {};
+        check.operator = OP_NULL_CHECK;
+        check.type = table.typename;
+        check.operands[0] = table;
+        check.result = register_table_alloc(compiler->regs, check.type);
+        block_add(compiler->body, check);
+        table = check.result;
+    }
+    struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+    ast_node_append_child(reference, ast_node_clone(abstract));
+    struct ssa_instruction field = {};
+    field.operator = OP_FIELD;
+    field.type = ssa_type_from_ast(compiler->ast_module, reference);
+    field.operands[0] = table;
+    field.operands[1] = operand_const_i64((int64_t) (slot * sizeof(void*)));
+    field.result = register_table_alloc(compiler->regs, field.type);
+    block_add(compiler->body, field);
+
+    // typed as the interface's own abstract method, which tells devirtualize what interface the call goes through
+    struct ssa_instruction method = {};
+    method.operator = OP_LOAD;
+    method.type = ssa_type_from_ast(compiler->ast_module, abstract);
+    method.operands[0] = field.result;
+    method.result = register_table_alloc(compiler->regs, method.type);
+    block_add(compiler->body, method);
+
+    instruction.operands[0] = method.result;
+    instruction.operands[1] = load_word(compiler, fat, 0);
+    instruction.result = register_table_alloc(compiler->regs, instruction.type);
+    block_add(compiler->body, instruction);
+    if (is_struct(instruction.type)) {
+        result.typename = instruction.type;
+        return result;
+    }
+    return instruction.result;
+}
+
+// the function a call names. when the name has variants the arguments are lowered first, their types pick the variant
+// and they are left in values with lowered set. otherwise the call lowers them
+static struct unit* call_target(struct compiler* compiler, struct ast_node* node, struct operand* values,
+                                bool* lowered) {
+    struct token name = node->children[0]->token;
+    struct unit_overloads* overloads = unit_module_overloads(compiler->unit_module, name);
+    *lowered = false;
+    if (overloads == NULL || overloads->count == 1) {
+        return overloads != NULL ? overloads->units[0] : NULL;
+    }
+    uint32_t count = node->children_count - 1;
+    ERROR(count < MAX_OPERANDS, "too many arguments\n");
+    for (uint32_t i = 0; i < count; i++) {
+        values[i] = statement(compiler, node->children[i + 1]);
+    }
+    *lowered = true;
+    struct unit* callee = unit_module_resolve(compiler->unit_module, name, values, count);
+    if (callee != NULL) {
+        return callee;
+    }
+
+    // otherwise the variant the arguments are cast to implicitly the fewest times, there must be only one
+    uint32_t best_casts = UINT32_MAX;
+    bool ambiguous = false;
+    for (uint32_t i = 0; i < overloads->count; i++) {
+        struct unit* variant = overloads->units[i];
+        if (parameter_count(variant) != count) {
+            continue;
+        }
+        uint32_t casts = 0;
+        for (uint32_t j = 0; j < count && casts != UINT32_MAX; j++) {
+            struct ssa_type type = variant->arguments[j].typename;
+            if (compare_types(values[j].typename, type)) {
+                continue;
+            }
+            if (values[j].typename.type == NULL) {
+                casts = UINT32_MAX;
+                break;
+            }
+            enum ast_node_type from = get_root_type(values[j].typename.type);
+            enum ast_node_type to = get_root_type(type.type);
+            casts = is_interface(type) || cast_rules[from][to].type == CAST_TYPE_IMPLICIT ? casts + 1 : UINT32_MAX;
+        }
+        if (casts < best_casts) {
+            callee = variant;
+            best_casts = casts;
+            ambiguous = false;
+        } else if (casts == best_casts && casts != UINT32_MAX) {
+            ambiguous = true;
+        }
+    }
+    ERROR(callee != NULL, "no variant of the function takes these arguments\n");
+    ERROR(!ambiguous, "more than one variant of the function takes these arguments\n");
+    return callee;
+}
+
+// `value.name(arguments)`. when value names a struct it is one of the struct's statics, otherwise a method of the
+// struct value is or points to, or of the interface it points to. a struct it returns is constructed in slot
+static struct operand member_call(struct compiler* compiler, struct ast_node* node, struct operand slot) {
+    struct ast_node* target = node->children[0]->children[0];
+    struct token name = node->children[0]->children[1]->token;
+    if (target->type == AST_NODE_TYPE_NAME && variable_named(compiler, target->token) == NULL) {
+        struct ast_node* structure = ast_module_get_symbol(compiler->ast_module->symbols, target->token);
+        ERROR(structure != NULL && structure->type == AST_NODE_TYPE_STRUCT, "only structs have statics\n");
+        struct ast_node* member = ast_node_struct_method(structure, name);
+        ERROR(member != NULL && member->type == AST_NODE_TYPE_FUNCTION, "struct has no such static\n");
+        return call_unit(compiler, unit_module_find_member(compiler->unit_module, structure, name), node,
+                         operand_none(), NULL, slot);
+    }
+
+    struct operand value = statement(compiler, target);
+    if (is_interface(value.typename)) {
+        return interface_call(compiler, node, value, slot);
+    }
+    struct operand structure = struct_of(compiler, value);
+    ERROR(is_struct(structure.typename), "only structs and interfaces have methods\n");
+    struct ast_node* method = ast_node_struct_method(structure.typename.type, name);
+    ERROR(method != NULL && method->type == AST_NODE_TYPE_METHOD, "struct has no such method\n");
+    return call_unit(compiler, unit_module_find_member(compiler->unit_module, structure.typename.type, name), node,
+                     structure, NULL, slot);
+}
+
+// a call of any kind, a struct it returns is constructed in slot, or in a temporary when it is none
+static struct operand call_expression(struct compiler* compiler, struct ast_node* node, struct operand slot) {
+    if (node->children[0]->type == AST_NODE_TYPE_GET_FIELD) {
+        return member_call(compiler, node, slot);
+    }
+    struct operand builtin;
+    if (builtin_call(compiler, node, &builtin)) {
+        return builtin;
+    }
+    struct operand values[MAX_OPERANDS];
+    bool lowered;
+    struct unit* callee = call_target(compiler, node, values, &lowered);
+    assert(callee);
+    return call_unit(compiler, callee, node, operand_none(), lowered ? values : NULL, slot);
+}
+
+#pragma endregion
+
+#pragma region short circuit
+
+// nodes an operand of && or || may have and still be evaluated whether or not it's needed
+#define SHORT_CIRCUIT_COST 8
+
+// true if evaluating node can't fail or have side effects and costs about as much as the branch that would skip it
+static bool cheap(struct ast_node* node, int* budget) {
+    if (--*budget < 0) {
+        return false;
+    }
+    switch (node->type) {
+        case AST_NODE_TYPE_INTEGER:
+        case AST_NODE_TYPE_FLOAT:
+        case AST_NODE_TYPE_BOOL:
+        case AST_NODE_TYPE_NAME:
+            return true;
+        case AST_NODE_TYPE_ADD:
+        case AST_NODE_TYPE_SUBTRACT:
+        case AST_NODE_TYPE_MULTIPLY:
+        case AST_NODE_TYPE_BITWISE_AND:
+        case AST_NODE_TYPE_BITWISE_OR:
+        case AST_NODE_TYPE_BITWISE_XOR:
+        case AST_NODE_TYPE_EQUAL:
+        case AST_NODE_TYPE_NOT_EQUAL:
+        case AST_NODE_TYPE_GREATER_THAN:
+        case AST_NODE_TYPE_GREATER_THAN_EQUAL:
+        case AST_NODE_TYPE_LESS_THAN:
+        case AST_NODE_TYPE_LESS_THAN_EQUAL:
+        case AST_NODE_TYPE_AND:
+        case AST_NODE_TYPE_OR:
+        case AST_NODE_TYPE_NOT:
+        case AST_NODE_TYPE_NEGATE:
+            for (int i = 0; i < node->children_count; i++) {
+                if (!cheap(node->children[i], budget)) {
+                    return false;
+                }
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_logical(struct ast_node* node) {
+    return node->type == AST_NODE_TYPE_AND || node->type == AST_NODE_TYPE_OR;
+}
+
+// true if the right side of && or || should be skipped with a branch rather than evaluated along with the left
+static bool short_circuits(struct ast_node* node) {
+    int budget = SHORT_CIRCUIT_COST;
+    return is_logical(node) && !cheap(node->children[1], &budget);
+}
+
+static void branch(struct compiler* compiler, struct operand value, struct block* on_true, struct block* on_false) {
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_IF;
+    instruction.result = operand_end();
+    instruction.operands[0] = value;
+    instruction.operands[1] = operand_block(on_true);
+    instruction.operands[2] = operand_block(on_false);
+    block_add(compiler->body, instruction);
+    block_link(compiler->body, on_true);
+    block_link(compiler->body, on_false);
+}
+
+static void jump(struct compiler* compiler, struct block* target) {
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_GOTO;
+    instruction.result = operand_end();
+    instruction.operands[0] = operand_block(target);
+    block_add(compiler->body, instruction);
+    block_link(compiler->body, target);
+}
+
+// goes to on_true or on_false depending on a condition, the comparison feeds the branch directly and && and || only
+// evaluate their right side when the left one didn't already decide
+static void condition(struct compiler* compiler, struct ast_node* node, struct block* on_true, struct block* on_false) {
+    if (node->type == AST_NODE_TYPE_NOT) {
+        condition(compiler, node->children[0], on_false, on_true);
+        return;
+    }
+    if (!short_circuits(node)) {
+        branch(compiler, statement(compiler, node), on_true, on_false);
+        return;
+    }
+
+    struct block* right = block_new(false, compiler->regs);
+    if (node->type == AST_NODE_TYPE_AND) {
+        condition(compiler, node->children[0], right, on_false);
+    } else {
+        condition(compiler, node->children[0], on_true, right);
+    }
+    unit_add(compiler->unit, right);
+    compiler->body = right;
+    condition(compiler, node->children[1], on_true, on_false);
+}
+
+// && and || as a value, both sides are computed branch free when the right one is cheap, otherwise it only runs when
+// the left side doesn't decide the result and the two paths meet through a local
+static struct operand logical(struct compiler* compiler, struct ast_node* node) {
+    enum ssa_instruction_code operator = node->type == AST_NODE_TYPE_AND ? OP_AND : OP_OR;
+    if (!short_circuits(node)) {
+        return binary(compiler, node, operator);
+    }
+
+    struct block* right = block_new(false, compiler->regs);
+    struct block* decided = block_new(false, compiler->regs);
+    struct block* after = block_new(false, compiler->regs);
+
+    struct operand x = statement(compiler, node->children[0]);
+    if (operator == OP_AND) {
+        branch(compiler, x, right, decided);
+    } else {
+        branch(compiler, x, decided, right);
+    }
+
+    unit_add(compiler->unit, right);
+    compiler->body = right;
+    struct operand y = statement(compiler, node->children[1]);
+    struct ssa_type type = promote_type(x.typename, y.typename);
+    struct operand zero = {OPERAND_TYPE_INTEGER, type, {.integer = 0}};
+
+    struct ssa_instruction slot = {};
+    slot.operator = OP_ALLOC;
+    slot.type = type;
+    slot.result = register_table_alloc(compiler->regs, type);
+    slot.operands[0] = operand_const_i64(type.size);
+    block_add(compiler->entry, slot);
+
+    // the result is 0 or 1 like the operator's, comparisons and nested logic already are
+    struct operand value = cast(compiler, y, type, CAST_TYPE_IMPLICIT);
+    enum ast_node_type kind = node->children[1]->type;
+    if (!is_logical(node->children[1]) && kind != AST_NODE_TYPE_NOT &&
+        (kind < AST_NODE_TYPE_EQUAL || kind > AST_NODE_TYPE_LESS_THAN_EQUAL)) {
+        struct ssa_instruction normalize = {};
+        normalize.operator = OP_NOT_EQUAL;
+        normalize.type = type;
+        normalize.operands[0] = value;
+        normalize.operands[1] = zero;
+        normalize.result = register_table_alloc(compiler->regs, type);
+        block_add(compiler->body, normalize);
+        value = normalize.result;
+    }
+
+    struct ssa_instruction store = {};
+    store.operator = OP_STORE;
+    store.type = type;
+    store.result = operand_none();
+    store.operands[0] = slot.result;
+    store.operands[1] = value;
+    block_add(compiler->body, store);
+    jump(compiler, after);
+
+    unit_add(compiler->unit, decided);
+    compiler->body = decided;
+    store.operands[1] = (struct operand){OPERAND_TYPE_INTEGER, type, {.integer = operator == OP_OR}};
+    block_add(compiler->body, store);
+    jump(compiler, after);
+
+    unit_add(compiler->unit, after);
+    compiler->body = after;
+    struct ssa_instruction load = {};
+    load.operator = OP_LOAD;
+    load.type = type;
+    load.operands[0] = slot.result;
+    load.result = register_table_alloc(compiler->regs, type);
+    block_add(compiler->body, load);
+    return load.result;
+}
+
+#pragma endregion
+
+#pragma region destructors
+
+// a local of a struct with a destructor is destroyed wherever control leaves its scope, at the end of the scope or by
+// a return, and only once it was declared. a return jumps into a chain of cleanup blocks, one per local, each
+// destroying its local and going on to the one declared before it, so returns out of the same locals share their
+// cleanup. a local that is returned is moved out to the caller and not destroyed
+
+static struct ast_node* destructor_of(struct ast_node* structure) {
+    struct token name = {TOKEN_TYPE_TILDE, "~", 1, 0};
+    return ast_node_struct_method(structure, name);
+}
+
+// false for structs that are trivially destructible, neither they nor the structs they hold have a destructor
+static bool has_destructor(struct ast_node* type) {
+    if (type->type != AST_NODE_TYPE_STRUCT) {
+        return false;
+    }
+    if (destructor_of(type) != NULL) {
+        return true;
+    }
+    struct ast_node* members = struct_members(type);
+    for (size_t i = 0; i < members->children_count; i++) {
+        struct ast_node* field = members->children[i];
+        if (field->type == AST_NODE_TYPE_FIELD && field->children[1] != type && has_destructor(field->children[1])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// runs a struct's destructor, then those of the structs it holds in the reverse of their order
+static void destroy(struct compiler* compiler, struct operand structure) {
+    struct ast_node* type = structure.typename.type;
+    struct ast_node* destructor = destructor_of(type);
+    if (destructor != NULL) {
+        struct unit* callee = unit_module_find_member(compiler->unit_module, type, destructor->children[0]->token);
+        struct ssa_instruction call = {};
+        call.operator = OP_CALL;
+        call.type = callee->return_type;
+        call.operands[0] = operand_unit(callee);
+        call.operands[1] = structure;
+        call.operands[1].typename = callee->arguments[0].typename;
+        call.result = register_table_alloc(compiler->regs, call.type);
+        block_add(compiler->body, call);
+    }
+    struct ast_node* members = struct_members(type);
+    for (size_t i = members->children_count; i-- > 0;) {
+        struct ast_node* field = members->children[i];
+        if (field->type == AST_NODE_TYPE_FIELD && field->children[1] != type && has_destructor(field->children[1])) {
+            destroy(compiler, field_value(compiler, field_address(compiler, structure, field->children[0]->token)));
+        }
+    }
+}
+
+// depth is how many scopes deep the local was declared, parameters are in the function's outermost one
+static void owned_add(struct compiler* compiler, struct token name, struct operand value, uint32_t depth) {
+    if (compiler->owned_count == compiler->owned_capacity) {
+        compiler->owned_capacity *= 2;
+        compiler->owned = realloc(compiler->owned, sizeof(struct owned_local) * compiler->owned_capacity);
+        assert(compiler->owned);
+    }
+    compiler->owned[compiler->owned_count++] = (struct owned_local){name, value, compiler->region, depth, false, NULL};
+}
+
+// the local a variable is, -1 if it has nothing to destroy
+static int64_t owned_find(struct compiler* compiler, struct variable* variable) {
+    for (uint32_t i = compiler->owned_count; i-- > 0;) {
+        struct owned_local* local = &compiler->owned[i];
+        if (same_name(local->name, variable->name) && local->value.value.integer == variable->pointer.value.integer) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// the struct local without a destructor a variable is among the moved ones, -1 if it wasn't moved away
+static int64_t moved_find(struct compiler* compiler, struct variable* variable) {
+    for (uint32_t i = 0; i < compiler->moved_count; i++) {
+        struct variable* local = &compiler->moved[i];
+        if (same_name(local->name, variable->name) && local->pointer.value.integer == variable->pointer.value.integer) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void moved_set(struct compiler* compiler, struct variable* variable, bool moved) {
+    int64_t index = moved_find(compiler, variable);
+    if (moved && index < 0) {
+        if (compiler->moved_count == compiler->moved_capacity) {
+            compiler->moved_capacity *= 2;
+            compiler->moved = realloc(compiler->moved, sizeof(struct variable) * compiler->moved_capacity);
+            assert(compiler->moved);
+        }
+        compiler->moved[compiler->moved_count++] = *variable;
+    }
+    else if (!moved && index >= 0) {
+        compiler->moved[index] = compiler->moved[--compiler->moved_count];
+    }
+}
+
+// whether the local at index holds anything to destroy. the cleanup chain skips locals that were moved away, so the
+// cleanups of the locals from index on no longer go to the right place
+static void owned_set_moved(struct compiler* compiler, uint32_t index, bool moved) {
+    if (compiler->owned[index].moved == moved) {
+        return;
+    }
+    compiler->owned[index].moved = moved;
+    for (uint32_t i = index; i < compiler->owned_count; i++) {
+        compiler->owned[i].cleanup = NULL;
+    }
+}
+
+// the end of a scope destroys what was declared in it since mark, innermost first. when control never gets there the
+// returns on the way already did
+static void owned_end(struct compiler* compiler, uint32_t mark, bool reachable) {
+    for (uint32_t i = compiler->owned_count; reachable && i-- > mark;) {
+        if (!compiler->owned[i].moved) {
+            destroy(compiler, compiler->owned[i].value);
+        }
+    }
+    compiler->owned_count = mark;
+}
+
+static struct block* owned_cleanup(struct compiler* compiler, uint32_t index);
+
+// leaves the function from inside region once the locals after the first count were dealt with. the regions the
+// remaining locals weren't declared in are left first, then their shared cleanup is
+static void owned_exit(struct compiler* compiler, uint32_t region, uint32_t count) {
+    while (count > 0 && compiler->owned[count - 1].moved) {
+        count--;
+    }
+    uint32_t outer = count > 0 ? compiler->owned[count - 1].region : 0;
+    for (; region != outer; region = compiler->regions[region].parent) {
+        region_leave(compiler, region);
+    }
+    jump(compiler, count > 0 ? owned_cleanup(compiler, count - 1) : compiler->exit);
+}
+
+static struct block* owned_cleanup(struct compiler* compiler, uint32_t index) {
+    if (compiler->owned[index].cleanup != NULL) {
+        return compiler->owned[index].cleanup;
+    }
+    struct block* body = compiler->body;
+    struct block* cleanup = block_new(false, compiler->regs);
+    unit_add(compiler->unit, cleanup);
+    compiler->owned[index].cleanup = cleanup;
+
+    compiler->body = cleanup;
+    destroy(compiler, compiler->owned[index].value);
+    owned_exit(compiler, compiler->owned[index].region, index);
+    compiler->body = body;
+    return cleanup;
+}
+
+// where a return goes once its value is stored, value is what it returns if anything
+static void owned_return(struct compiler* compiler, struct ast_node* value) {
+    uint32_t count = compiler->owned_count;
+    struct variable* variable = NULL;
+    if (value != NULL && value->type == AST_NODE_TYPE_MOVE) {
+        value = value->children[0];
+    }
+    if (value != NULL && value->type == AST_NODE_TYPE_NAME && is_struct(compiler->return_type)) {
+        variable = register_table_lookup(compiler->regs, value->token);
+    }
+    int64_t index = variable != NULL ? owned_find(compiler, variable) : -1;
+    if (index >= 0) {
+        // the locals after it aren't in the chain without it, they are destroyed right here
+        for (uint32_t i = count; i-- > index + 1;) {
+            if (!compiler->owned[i].moved) {
+                destroy(compiler, compiler->owned[i].value);
+            }
+        }
+        count = index;
+    }
+    owned_exit(compiler, compiler->region, count);
+}
+
+// a statement that is a scope of its own, like a branch of an if, whatever it declares is destroyed at its end
+static struct operand scoped_statement(struct compiler* compiler, struct ast_node* node) {
+    uint32_t mark = compiler->owned_count;
+    compiler->depth++;
+    struct operand result = statement(compiler, node);
+    compiler->depth--;
+    owned_end(compiler, mark, result.type != OPERAND_TYPE_END);
+    return result;
+}
+
+#pragma endregion
+
+#pragma region moves
+
+// a struct value is memory, passing it on hands that memory over instead of copying it whenever nothing else uses it
+// afterwards: the result of a call, a variable moved with move and a variable at its last use. what is handed over
+// isn't destroyed where it came from. a struct with a destructor is only copied when asked to with copy, both copies
+// would be destroyed otherwise
+
+static bool is_name(struct ast_node* node, struct token name) {
+    return node->type == AST_NODE_TYPE_NAME && same_name(node->token, name);
+}
+
+// true if the variable is used anywhere in node
+static bool mentions(struct ast_node* node, struct token name) {
+    if (node->type == AST_NODE_TYPE_STRUCT || node->type == AST_NODE_TYPE_INTERFACE) {
+        return false;
+    }
+    if (is_name(node, name)) {
+        return true;
+    }
+    for (size_t i = 0; i < node->children_count; i++) {
+        if (mentions(node->children[i], name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// true if the address of the variable, or of one of its fields, is taken anywhere in node. the memory may be used
+// through it after the variable's last use
+static bool address_taken(struct ast_node* node, struct token name) {
+    if (node->type == AST_NODE_TYPE_STRUCT || node->type == AST_NODE_TYPE_INTERFACE) {
+        return false;
+    }
+    if (node->type == AST_NODE_TYPE_ADDRESS) {
+        struct ast_node* root = node->children[0];
+        while (root->type == AST_NODE_TYPE_GET_FIELD) {
+            root = root->children[0];
+        }
+        if (is_name(root, name)) {
+            return true;
+        }
+    }
+    for (size_t i = 0; i < node->children_count; i++) {
+        if (address_taken(node->children[i], name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// true if the name node is the last use of its variable: nothing after it up to the end of the variable's scope
+// names it, and it isn't in a loop that would come back to it
+static bool last_use(struct ast_node* node) {
+    struct token name = node->token;
+    struct ast_node* child = node;
+    for (struct ast_node* parent = node->parent; parent != NULL; child = parent, parent = parent->parent) {
+        if (parent->type == AST_NODE_TYPE_WHILE || parent->type == AST_NODE_TYPE_DO_WHILE) {
+            return false;
+        }
+        bool after = false;
+        bool declared = false;
+        for (size_t i = 0; i < parent->children_count; i++) {
+            struct ast_node* sibling = parent->children[i];
+            if (sibling == child) {
+                after = true;
+            }
+            else if (after && mentions(sibling, name)) {
+                return false;
+            }
+            else if (!after && sibling->type == AST_NODE_TYPE_VARIABLE && is_name(sibling->children[0], name)) {
+                declared = true;
+            }
+        }
+        // parameters are declared by the function
+        if (declared || parent->type == AST_NODE_TYPE_IMPLEMENTATION || parent->type == AST_NODE_TYPE_FUNCTION ||
+            parent->type == AST_NODE_TYPE_METHOD) {
+            return !address_taken(parent, name);
+        }
+    }
+    return false;
+}
+
+// marks the variable named as moved away, explicit when it is moved with move. false if it can't be: a local with a
+// destructor is only moved in the scope it was declared in, moving it from a branch would leave it destroyed on one
+// path and not on the other
+static bool give_away(struct compiler* compiler, struct token name, bool explicit) {
+    struct variable* variable = register_table_lookup(compiler->regs, name);
+    int64_t index = variable != NULL ? owned_find(compiler, variable) : -1;
+    if (index < 0) {
+        if (variable != NULL && is_struct(variable->type)) {
+            moved_set(compiler, variable, true);
+        }
+        return true;
+    }
+    if (compiler->owned[index].depth != compiler->depth) {
+        ERROR(!explicit, "a variable with a destructor can only be moved in the scope it was declared in\n");
+        return false;
+    }
+    owned_set_moved(compiler, index, true);
+    return true;
+}
+
+// true if the memory of the struct value node was lowered to can be taken over, see the top of the region
+static bool moved_away(struct compiler* compiler, struct ast_node* node) {
+    switch (node->type) {
+        case AST_NODE_TYPE_CALL:
+        case AST_NODE_TYPE_MOVE:
+            return true;
+        case AST_NODE_TYPE_NAME:
+            return last_use(node) && give_away(compiler, node->token, false);
+        default:
+            return false;
+    }
+}
+
+// the struct value node was lowered to as memory the receiver owns, a copy when it can't be handed over
+static struct operand transfer(struct compiler* compiler, struct ast_node* node, struct operand value) {
+    if (moved_away(compiler, node)) {
+        return value;
+    }
+    ERROR(node->type == AST_NODE_TYPE_COPY || !has_destructor(value.typename.type),
+          "a struct with a destructor is only copied with copy\n");
+    struct operand copy = struct_slot(compiler, value.typename);
+    copy_fields(compiler, copy, value);
+    return copy;
+}
+
+// a local struct. the one every return gives back is the memory of the result, one initialized with a variable that
+// is moved away takes over that variable's memory and the result of a call is constructed right in it. anything else
+// is zeroed and copied into
+static struct operand struct_variable(struct compiler* compiler, struct token name, struct ssa_type type,
+                                      struct ast_node* value) {
+    struct operand source = operand_none();
+    bool moved = false;
+    if (value != NULL && value->type != AST_NODE_TYPE_CALL) {
+        source = statement(compiler, value);
+        ERROR(compare_types(source.typename, type), "only a struct of the same type can be assigned\n");
+        moved = (value->type == AST_NODE_TYPE_NAME || value->type == AST_NODE_TYPE_MOVE) && moved_away(compiler, value);
+        ERROR(moved || value->type == AST_NODE_TYPE_COPY || !has_destructor(type.type),
+              "a struct with a destructor is only copied with copy\n");
+    }
+
+    // the value is lowered first, the table of variables may move as it grows
+    struct variable* variable = register_table_add(compiler->regs, name, type);
+    variable->region = compiler->region;
+    variable->depth = compiler->depth;
+    bool returned = same_name(name, compiler->returned) && compare_types(type, compiler->return_type);
+    if (returned) {
+        variable->pointer = compiler->return_value_ptr;
+    }
+    struct operand structure = variable->pointer;
+    structure.typename = type;
+    if (moved && !returned) {
+        variable->pointer.value.integer = source.value.integer;
+        structure = source;
+    }
+    else {
+        if (!returned) {
+            struct ssa_instruction instruction = {};
+            instruction.operator = OP_ALLOC;
+            instruction.type = type;
+            instruction.result = variable->pointer;
+            instruction.operands[0] = operand_const_i64(type.size);
+            block_add(compiler->entry, instruction);
+        }
+        if (value != NULL && value->type == AST_NODE_TYPE_CALL) {
+            struct operand result = call_expression(compiler, value, structure);
+            ERROR(compare_types(result.typename, type), "only a struct of the same type can be assigned\n");
+        }
+        else {
+            zero_fields(compiler, structure);
+            if (source.type != OPERAND_TYPE_NONE) {
+                copy_fields(compiler, structure, source);
+            }
+        }
+    }
+
+    if (has_destructor(type.type)) {
+        owned_add(compiler, name, structure, compiler->depth);
+    }
+    structure.typename = variable->pointer.typename;
+    return structure;
+}
+
+// constructs the struct a return gives back in the memory of the result. the local every return gives back already
+// is that memory, a call constructs it there itself
+static void struct_result(struct compiler* compiler, struct ast_node* node) {
+    struct operand slot = compiler->return_value_ptr;
+    slot.typename = compiler->return_type;
+    // returning moves anyway, from any scope
+    if (node->type == AST_NODE_TYPE_MOVE) {
+        node = node->children[0];
+        ERROR(node->type == AST_NODE_TYPE_NAME, "only a variable can be moved\n");
+    }
+    struct operand value = node->type == AST_NODE_TYPE_CALL
+                           ? call_expression(compiler, node, slot)
+                           : statement(compiler, node);
+    ERROR(!holds_pointer(value.typename.type) || region_of(compiler, node) == 0,
+          "a pointer into a region can't be returned\n");
+    ERROR(compare_types(value.typename, compiler->return_type), "only a struct of the same type can be returned\n");
+    if (value.type == OPERAND_TYPE_REGISTER && value.value.integer == slot.value.integer) {
+        return;
+    }
+    // a local returned by name is moved out, owned_return leaves it out of the cleanup
+    ERROR(node->type == AST_NODE_TYPE_NAME || node->type == AST_NODE_TYPE_COPY || moved_away(compiler, node) ||
+          !has_destructor(value.typename.type), "a struct with a destructor is only copied with copy\n");
+    copy_fields(compiler, slot, value);
+}
+
+#pragma endregion
+
+#pragma region tail calls
+
+// which variant of a function is called is only known once the arguments are lowered, any of them may be this one
+static bool is_self_call(struct compiler* compiler, struct ast_node* node) {
+    if (node->type != AST_NODE_TYPE_CALL || node->children[0]->type != AST_NODE_TYPE_NAME) {
+        return false;
+    }
+    struct unit_overloads* overloads = unit_module_overloads(compiler->unit_module, node->children[0]->token);
+    for (uint32_t i = 0; overloads != NULL && i < overloads->count; i++) {
+        if (overloads->units[i] == compiler->unit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// true if the function returns the result of calling itself anywhere in node
+static bool has_self_tail_call(struct compiler* compiler, struct ast_node* node) {
+    if (node->type == AST_NODE_TYPE_RETURN_STATEMENT) {
+        return node->children_count && is_self_call(compiler, node->children[0]);
+    }
+    // a type names a struct's symbol, its methods aren't part of the body
+    if (node->type == AST_NODE_TYPE_STRUCT || node->type == AST_NODE_TYPE_INTERFACE) {
+        return false;
+    }
+    for (int i = 0; i < node->children_count; i++) {
+        if (has_self_tail_call(compiler, node->children[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// `return f(...)` needs nothing of this frame once f is called. calling itself becomes a jump back to the start of the
+// body with the new arguments, other calls returning the same type return their result straight away so the backend
+// can reuse the frame. returns none if the call has to be lowered like any other return value, and the value of the
+// call if it was lowered to pick a variant of the function but can't be returned straight away
+static struct operand tail_call(struct compiler* compiler, struct ast_node* node) {
+    if (node->children[0]->type != AST_NODE_TYPE_NAME) {
+        return operand_none();
+    }
+    struct operand values[MAX_OPERANDS];
+    bool lowered;
+    struct unit* callee = call_target(compiler, node, values, &lowered);
+    if (callee == NULL) {
+        return operand_none();
+    }
+
+    struct operand slot = compiler->return_value_ptr;
+    slot.typename = compiler->return_type;
+    if (!has_result_slot(callee) || !compare_types(callee->return_type, compiler->return_type)) {
+        slot = operand_none();
+    }
+    uint32_t count = parameter_count(callee);
+    if (callee == compiler->unit && compiler->start != NULL) {
+        // a fat pointer argument is copied as the function starts and a struct one is memory of the caller's frame,
+        // they are only passed along by a real call
+        for (uint32_t i = 0; i < count; i++) {
+            if (is_interface(callee->arguments[i].typename) || is_struct(callee->arguments[i].typename)) {
+                return lowered ? call_unit(compiler, callee, node, operand_none(), values, slot) : operand_none();
+            }
+        }
+        // every argument is computed before any local is overwritten, they may read each other
+        for (uint32_t i = 0; i < count; i++) {
+            struct operand value = lowered ? values[i] : statement(compiler, node->children[i + 1]);
+            values[i] = cast(compiler, value, callee->arguments[i].typename, CAST_TYPE_IMPLICIT);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            struct ssa_instruction store = {};
+            store.operator = OP_STORE;
+            store.result = operand_none();
+            store.operands[0] = compiler->argument_slots[i];
+            store.operands[1] = values[i];
+            block_add(compiler->body, store);
+        }
+
+        jump(compiler, compiler->start);
+        return operand_end();
+    }
+
+    struct operand result = lowered ? call_unit(compiler, callee, node, operand_none(), values, slot) : operand_none();
+    if (compiler->return_value_ptr.type == OPERAND_TYPE_NONE || !compare_types(callee->return_type, compiler->return_type)) {
+        return result;
+    }
+    if (!lowered) {
+        result = call_unit(compiler, callee, node, operand_none(), NULL, slot);
+    }
+
+    struct ssa_instruction ret = {};
+    ret.operator = OP_RETURN;
+    ret.result = operand_end();
+    ret.type = compiler->return_type;
+    ret.operands[0] = result;
+    block_add(compiler->body, ret);
+    return ret.result;
+}
+
+#pragma endregion
+
+static struct operand statement(struct compiler* compiler, struct ast_node* node) {
+    struct block* current = compiler->body;
+    struct register_table* regs = compiler->regs;
+    switch (node->type) {
+        case AST_NODE_TYPE_SCOPE:
+        case AST_NODE_TYPE_SEQUENCE: {
+            uint32_t owned = compiler->owned_count;
+            uint32_t depth = compiler->depth;
+            if (node->type == AST_NODE_TYPE_SCOPE) {
+                compiler->depth++;
+                register_table_begin(regs);
+            }
+            struct operand last_operand = {};
+            for (int i = 0; i < node->children_count; i++) {
+                struct ast_node* child = node->children[i];
+                last_operand = statement(compiler, child);
+                if (last_operand.type == OPERAND_TYPE_END)
+                    break;
+            }
+            compiler->depth = depth;
+            if (node->type == AST_NODE_TYPE_SCOPE) {
+                owned_end(compiler, owned, last_operand.type != OPERAND_TYPE_END);
+                register_table_end(regs);
+            }
+            return last_operand;
+        }
+        case AST_NODE_TYPE_INTEGER: {
+            int64_t immediate = strtoll(node->token.start, NULL, 10);
+            return get_int(immediate); //TODO: implement polymorphic literals
+        }
+        case AST_NODE_TYPE_FLOAT: {
+            double immediate = strtod(node->token.start, NULL);
+            return get_float(immediate); //TODO: implement polymorphic literals
+        }
+        case AST_NODE_TYPE_POINTER: {
+            struct operand op = {};
+            op.type = OPERAND_TYPE_INTEGER;
+            op.typename = ssa_type_from_ast(compiler->ast_module, node);
+            op.value.integer = 0;
+            return op;
+        }
+        case AST_NODE_TYPE_BOOL: {
+            struct operand op = {};
+            op.type = OPERAND_TYPE_INTEGER;
+            op.typename = ssa_type_from_ast(compiler->ast_module, node);
+            int64_t immediate = strtoll(node->token.start, NULL, 10);
             op.value.integer = immediate;
             return op;
         }
@@ -590,11 +2337,9 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
         case AST_NODE_TYPE_BITWISE_RIGHT: {
             return binary(compiler, node, OP_BITWISE_RIGHT);
         }
-        case AST_NODE_TYPE_AND: {
-            return binary(compiler, node, OP_AND);
-        }
+        case AST_NODE_TYPE_AND:
         case AST_NODE_TYPE_OR: {
-            return binary(compiler, node, OP_OR);
+            return logical(compiler, node);
         }
         case AST_NODE_TYPE_NEGATE: {
             return unary(compiler, node, OP_NEGATE);
@@ -606,7 +2351,17 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
             struct ast_node* cast_type = node->children[0];
             struct ast_node* value = node->children[1];
             struct operand x = statement(compiler, value);
-            return cast(compiler, x, ssa_type_from_ast(compiler->ast_module, cast_type), CAST_TYPE_EXPLICIT);
+            struct ssa_type type = ssa_type_from_ast(compiler->ast_module, cast_type);
+            if (is_array(type)) {
+                return new_array(compiler, type, x);
+            }
+            if (is_struct(type)) {
+                ERROR(is_struct(x.typename), "only structs can be cast to structs\n");
+                struct operand result = struct_temporary(compiler, type);
+                copy_fields(compiler, result, x);
+                return result;
+            }
+            return cast(compiler, x, type, CAST_TYPE_EXPLICIT);
         }
         case AST_NODE_TYPE_REINTERPRET_CAST: {
             struct ast_node* cast_type = node->children[0];
@@ -617,7 +2372,7 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
         }
         case AST_NODE_TYPE_ADDRESS: {
             struct ast_node* x = node->children[0];
-            struct variable* var = register_table_lookup(regs, x->token);
+            struct variable* var = variable_named(compiler, x->token);
             if (var == NULL) {
                 fprintf(stderr, "cannot reference a temporary value\n");
                 return operand_none();
@@ -625,31 +2380,45 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
             return var->pointer;
         }
         case AST_NODE_TYPE_LOCK: {
-            //NOTE: pointers need to be checked for null before being locked for safety!
-            struct ast_node* x = node->children[0];
-            struct variable* var = register_table_lookup(regs, x->token);
-            if (var == NULL) {
-                fprintf(stderr, "cannot lock a temporary value\n");
-                return operand_none();
-            }
-            return var->pointer;
+            struct operand pointer = lock(compiler, node);
+            struct ssa_instruction load = {};
+            load.operator = OP_LOAD;
+            load.type = ssa_type_from_ast(compiler->ast_module, pointer.typename.type->children[0]);
+            load.operands[0] = pointer;
+            load.result = register_table_alloc(regs, load.type);
+            block_add(compiler->body, load);
+            return load.result;
         }
         case AST_NODE_TYPE_VARIABLE: {
             struct ast_node* name = node->children[0];
             struct ast_node* type_node = node->children[1];
             struct ssa_type type = ssa_type_from_ast(compiler->ast_module, type_node);
             struct ast_node* value = node->children_count > 2 ? node->children[2] : NULL;
+            if (is_struct(type)) {
+                return struct_variable(compiler, name->token, type, value);
+            }
             struct ssa_instruction instruction = {};
             instruction.operator = OP_ALLOC;
             instruction.type = type;
 
-            instruction.result = register_table_add(current->symbol_table, name->token, type)->pointer;
+            struct variable* variable = register_table_add(current->symbol_table, name->token, type);
+            variable->region = compiler->region;
+            variable->depth = compiler->depth;
+            instruction.result = variable->pointer;
 
             //node size
             instruction.operands[0] = operand_const_i64(type.size);
 
             block_add(compiler->entry, instruction);
 
+            if (is_interface(type)) {
+                struct operand fat = instruction.result;
+                fat.typename = type;
+                ERROR(value != NULL || type.type->type == AST_NODE_TYPE_POINTER, "references MUST be assigned\n");
+                interface_store(compiler, fat, value ? statement(compiler, value) : operand_const_i64(0));
+                return instruction.result;
+            }
+
             //ZII
             struct ssa_instruction store = {};
             store.operator = OP_STORE;
@@ -667,7 +2436,7 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
                 store.operands[1] = operand_const_i64(0);
             }
 
-            block_add(current, store);
+            block_add(compiler->body, store);
 
             return instruction.result;
         }
@@ -676,7 +2445,74 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
             struct ast_node* value = node->children[1];
             struct ssa_instruction instruction = {};
             instruction.operator = OP_STORE;
-            struct variable* symbol = register_table_lookup(current->symbol_table, target->token);
+            if (target->type == AST_NODE_TYPE_LOCK) {
+                instruction.result = operand_none();
+                instruction.operands[0] = lock(compiler, target);
+                instruction.type = ssa_type_from_ast(compiler->ast_module, instruction.operands[0].typename.type->children[0]);
+                struct operand source = statement(compiler, value);
+                region_keep(compiler, region_of(compiler, target), value, source);
+                instruction.operands[1] = cast(compiler, source, instruction.type, CAST_TYPE_IMPLICIT);
+                block_add(compiler->body, instruction);
+                return instruction.result;
+            }
+            if (target->type == AST_NODE_TYPE_INDEX) {
+                struct operand source = statement(compiler, value);
+                region_keep(compiler, region_of(compiler, target), value, source);
+                set_element(compiler, target, source);
+                return operand_none();
+            }
+            struct variable* symbol = variable_named(compiler, target->token);
+            ERROR(symbol != NULL, "assigning to an unknown name\n");
+            if (is_struct(symbol->type)) {
+                struct operand source = statement(compiler, value);
+                // the value is lowered first, the table of variables may move as it grows
+                symbol = variable_named(compiler, target->token);
+                region_keep(compiler, symbol->region, value, source);
+                ERROR(compare_types(source.typename, symbol->type), "only a struct of the same type can be assigned\n");
+                int64_t index = owned_find(compiler, symbol);
+                bool moved = index >= 0 ? compiler->owned[index].moved : moved_find(compiler, symbol) >= 0;
+                // a new value from a branch would leave it moved on the path that doesn't take the branch
+                ERROR(!moved || symbol->depth == compiler->depth,
+                      "a moved variable can only be given a new value in the scope it was declared in\n");
+                struct operand structure = symbol->pointer;
+                structure.typename = symbol->type;
+                if (has_destructor(symbol->type.type)) {
+                    ERROR(value->type == AST_NODE_TYPE_COPY || moved_away(compiler, value),
+                          "a struct with a destructor is only copied with copy\n");
+                    // the value it held is replaced, one that was moved away is given a new one
+                    if (index >= 0 && !moved) {
+                        destroy(compiler, structure);
+                    }
+                    if (index >= 0) {
+                        owned_set_moved(compiler, index, false);
+                    }
+                }
+                moved_set(compiler, symbol, false);
+                // whatever it was moved into may have taken over its memory, the new value goes into memory of its own
+                if (moved) {
+                    struct ssa_instruction instruction = {};
+                    instruction.operator = OP_ALLOC;
+                    instruction.type = symbol->type;
+                    instruction.result = register_table_alloc(compiler->regs, symbol->pointer.typename);
+                    instruction.operands[0] = operand_const_i64(symbol->type.size);
+                    block_add(compiler->entry, instruction);
+                    symbol->pointer = instruction.result;
+                    structure.value.integer = instruction.result.value.integer;
+                    if (index >= 0) {
+                        compiler->owned[index].value = structure;
+                    }
+                }
+                copy_fields(compiler, structure, source);
+                return operand_none();
+            }
+            if (is_interface(symbol->type)) {
+                struct operand source = statement(compiler, value);
+                region_keep(compiler, symbol->region, value, source);
+                struct operand fat = symbol->pointer;
+                fat.typename = symbol->type;
+                interface_store(compiler, fat, source);
+                return operand_none();
+            }
             
             instruction.type = symbol->type;
             instruction.result = operand_none();
@@ -696,15 +2532,30 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
                 instruction.type = ssa_type_from_ast(compiler->ast_module, *symbol->type.type->children);
             }
 
-            instruction.operands[1] = cast(compiler, statement(compiler, value), instruction.type, CAST_TYPE_IMPLICIT);
+            struct operand source = statement(compiler, value);
+            region_keep(compiler, symbol->region, value, source);
+            instruction.operands[1] = cast(compiler, source, instruction.type, CAST_TYPE_IMPLICIT);
             
-            block_add(current, instruction);
+            block_add(compiler->body, instruction);
             return instruction.result;
         }
         case AST_NODE_TYPE_NAME: {
             struct ssa_instruction instruction = {};
             instruction.operator = OP_LOAD;
-            struct variable* var = register_table_lookup(current->symbol_table, node->token);
+            struct variable* var = variable_named(compiler, node->token);
+            ERROR(var != NULL, "unknown name\n");
+            ERROR(compiler->regions[var->region].open || !holds_pointer(var->type.type),
+                  "a pointer into a region can't be used after the region ends\n");
+            if (is_struct(var->type)) {
+                int64_t index = owned_find(compiler, var);
+                ERROR((index < 0 || !compiler->owned[index].moved) && moved_find(compiler, var) < 0,
+                      "a variable can't be used after it was moved\n");
+            }
+            if (is_struct(var->type) || is_interface(var->type)) {
+                struct operand structure = var->pointer;
+                structure.typename = var->type;
+                return structure;
+            }
             instruction.type = var->type;
             instruction.operands[0] = var->pointer;
             instruction.result = register_table_alloc(current->symbol_table, var->type);
@@ -712,107 +2563,177 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
 
             return instruction.result;
         }
-        case AST_NODE_TYPE_CALL: {
-            struct ast_node* name = node->children[0];
-            struct ssa_instruction instruction = {};
-            instruction.operator = OP_CALL;
-            struct unit* call = unit_module_find(compiler->unit_module, name->token);
-            assert(call);
-            instruction.type = call->return_type;
-            instruction.operands[0] = operand_unit(call);
-
-            for (int i = 0; i < call->argument_count; i++) {
-                struct operand arg = statement(compiler, node->children[i + 1]);
-                instruction.operands[i + 1] = cast(compiler, arg,
-                                                   call->arguments[i].typename, CAST_TYPE_IMPLICIT);
+        case AST_NODE_TYPE_GET_FIELD: {
+            struct token name = node->children[1]->token;
+            if (node->children[0]->type == AST_NODE_TYPE_INDEX) {
+                return field_value(compiler, element_field(compiler, node->children[0], name));
             }
+            struct operand vector = struct_of(compiler, statement(compiler, node->children[0]));
+            if (is_struct(vector.typename)) {
+                return field_value(compiler, field_address(compiler, vector, name));
+            }
+            if (is_array(vector.typename)) {
+                ERROR(name.length == 6 && memcmp(name.start, "length", 6) == 0, "arrays only have a length\n");
+                return array_header_field(compiler, vector, offsetof(struct array_header, length));
+            }
+            ERROR(vector.typename.type->type == AST_NODE_TYPE_SIMD, "only simd types have fields for now\n");
+            int64_t lane = simd_lane(vector.typename.type, node->children[1]->token);
+            ERROR(lane >= 0, "simd type has no such lane\n");
 
-            instruction.result = register_table_alloc(current->symbol_table, instruction.type);
-
-            block_add(current, instruction);
-
+            struct ssa_instruction instruction = {};
+            instruction.operator = OP_EXTRACT;
+            instruction.type = ssa_type_from_ast(compiler->ast_module, vector.typename.type->children[0]);
+            instruction.operands[0] = vector;
+            instruction.operands[1] = operand_const_i32((int32_t) lane);
+            instruction.result = register_table_alloc(regs, instruction.type);
+            block_add(compiler->body, instruction);
             return instruction.result;
         }
+        case AST_NODE_TYPE_SET_FIELD: {
+            struct ast_node* target = node->children[0];
+            struct ast_node* value = node->children[2];
+            if (target->type == AST_NODE_TYPE_INDEX) {
+                struct operand address = element_field(compiler, target, node->children[1]->token);
+                struct operand source = statement(compiler, value);
+                region_keep(compiler, region_of(compiler, target), value, source);
+                assign_reference(compiler, address, source);
+                return operand_none();
+            }
+            struct variable* symbol = target->type == AST_NODE_TYPE_NAME ? variable_named(compiler, target->token) : NULL;
+            if (symbol == NULL || symbol->type.type->type != AST_NODE_TYPE_SIMD) {
+                struct operand structure = struct_of(compiler, statement(compiler, target));
+                ERROR(is_struct(structure.typename), "only structs and simd variables have fields\n");
+                struct operand address = field_address(compiler, structure, node->children[1]->token);
+                struct operand source = statement(compiler, value);
+                region_keep(compiler, region_of(compiler, target), value, source);
+                assign_reference(compiler, address, source);
+                return operand_none();
+            }
+            ERROR(symbol->type.type->type == AST_NODE_TYPE_SIMD, "only simd types have fields for now\n");
+            int64_t lane = simd_lane(symbol->type.type, node->children[1]->token);
+            ERROR(lane >= 0, "simd type has no such lane\n");
+
+            struct ssa_type lane_type = ssa_type_from_ast(compiler->ast_module, symbol->type.type->children[0]);
+            struct operand lane_value = cast(compiler, statement(compiler, value), lane_type, CAST_TYPE_IMPLICIT);
+
+            struct ssa_instruction load = {};
+            load.operator = OP_LOAD;
+            load.type = symbol->type;
+            load.operands[0] = symbol->pointer;
+            load.result = register_table_alloc(regs, symbol->type);
+            block_add(compiler->body, load);
+
+            struct ssa_instruction insert = {};
+            insert.operator = OP_INSERT;
+            insert.type = symbol->type;
+            insert.operands[0] = load.result;
+            insert.operands[1] = operand_const_i32((int32_t) lane);
+            insert.operands[2] = lane_value;
+            insert.result = register_table_alloc(regs, symbol->type);
+            block_add(compiler->body, insert);
+
+            struct ssa_instruction store = {};
+            store.operator = OP_STORE;
+            store.type = symbol->type;
+            store.result = operand_none();
+            store.operands[0] = symbol->pointer;
+            store.operands[1] = insert.result;
+            block_add(compiler->body, store);
+            return store.result;
+        }
+        case AST_NODE_TYPE_INDEX: {
+            return get_element(compiler, node);
+        }
+        case AST_NODE_TYPE_CALL: {
+            return call_expression(compiler, node, operand_none());
+        }
+        case AST_NODE_TYPE_MOVE: {
+            ERROR(node->children[0]->type == AST_NODE_TYPE_NAME, "only a variable can be moved\n");
+            struct operand value = statement(compiler, node->children[0]);
+            give_away(compiler, node->children[0]->token, true);
+            return value;
+        }
+        case AST_NODE_TYPE_COPY: {
+            return statement(compiler, node->children[0]);
+        }
         case AST_NODE_TYPE_RETURN_STATEMENT: {
-            if (node->children_count) {
+            // a call returned from a region still needs the region, which is left once the call is done, and the
+            // locals are only destroyed after it too
+            struct operand called = operand_none();
+            if (node->children_count && node->children[0]->type == AST_NODE_TYPE_CALL && compiler->region == 0 &&
+                compiler->owned_count == 0) {
+                called = tail_call(compiler, node->children[0]);
+                if (called.type == OPERAND_TYPE_END) {
+                    return called;
+                }
+            }
+            if (node->children_count && is_struct(compiler->return_type)) {
+                struct_result(compiler, node->children[0]);
+            }
+            else if (node->children_count) {
                 struct ssa_instruction return_store = {};
                 return_store.operator = OP_STORE;
                 return_store.operands[0] = compiler->return_value_ptr;
-                return_store.operands[1] = cast(compiler, statement(compiler, node->children[0]),
-                                                compiler->return_type, CAST_TYPE_IMPLICIT);
-                block_add(current, return_store);
+                struct operand value = called.type != OPERAND_TYPE_NONE ? called : statement(compiler, node->children[0]);
+                ERROR(!holds_pointer(value.typename.type) || region_of(compiler, node->children[0]) == 0,
+                      "a pointer into a region can't be returned\n");
+                return_store.operands[1] = cast(compiler, value, compiler->return_type, CAST_TYPE_IMPLICIT);
+                block_add(compiler->body, return_store);
             }
 
-            struct ssa_instruction instruction = {};
-            instruction.operator = OP_GOTO;
-            instruction.result = operand_end();
-            instruction.operands[0] = operand_block(compiler->exit);
-
-            block_link(current, compiler->exit);
-
-            block_add(current, instruction);
-            return instruction.result;
+            owned_return(compiler, node->children_count ? node->children[0] : NULL);
+            return operand_end();
+        }
+        case AST_NODE_TYPE_REGION: {
+            uint32_t region = region_begin(compiler);
+            uint32_t owned = compiler->owned_count;
+            compiler->depth++;
+            struct operand last_operand = operand_none();
+            for (int i = 0; i < node->children_count; i++) {
+                last_operand = statement(compiler, node->children[i]);
+                if (last_operand.type == OPERAND_TYPE_END) {
+                    break;
+                }
+            }
+            compiler->depth--;
+            // what was declared in the region may still use its memory
+            owned_end(compiler, owned, last_operand.type != OPERAND_TYPE_END);
+            if (last_operand.type != OPERAND_TYPE_END) {
+                region_leave(compiler, region);
+                last_operand = operand_none();
+            }
+            region_end(compiler);
+            return last_operand;
         }
         case AST_NODE_TYPE_IF: {
-            struct ast_node* condition = node->children[0];
-            struct ssa_instruction instruction = {};
-
+            struct block* then_block = block_new(false, compiler->regs);
+            struct block* else_block = node->children_count > 2 ? block_new(false, compiler->regs) : NULL;
             struct block* after = block_new(false, compiler->regs);
 
-            instruction.operator = OP_IF;
-            instruction.result = operand_end();
-            instruction.operands[0] = statement(compiler, condition);
-            instruction.operands[2] = operand_block(after);
+            condition(compiler, node->children[0], then_block, else_block != NULL ? else_block : after);
 
-            struct ast_node* then = node->children[1];
-            struct block* then_block = block_new(false, compiler->regs);
-            instruction.operands[1] = operand_block(then_block);
             unit_add(compiler->unit, then_block);
-
-            block_link(current, then_block);
-
             compiler->body = then_block;
-
-            struct operand result = statement(compiler, then);
-
+            struct operand result = scoped_statement(compiler, node->children[1]);
             if (result.type != OPERAND_TYPE_END) {
-                struct ssa_instruction end = {};
-                end.operator = OP_GOTO;
-                end.result = operand_end();
-                end.operands[0] = operand_block(after);
-                block_add(compiler->body, end);
-                block_link(compiler->body, after);
+                jump(compiler, after);
             }
 
-            if (node->children_count > 2) {
-                struct block* else_block = block_new(false, compiler->regs);
+            if (else_block != NULL) {
                 unit_add(compiler->unit, else_block);
-                block_link(current, else_block);
-                struct ast_node* else_node = node->children[2];
-                instruction.operands[2] = operand_block(else_block);
                 compiler->body = else_block;
-                result = statement(compiler, else_node);
+                result = scoped_statement(compiler, node->children[2]);
                 if (result.type != OPERAND_TYPE_END) {
-                    struct ssa_instruction goto_instruction = {};
-                    goto_instruction.operator = OP_GOTO;
-                    goto_instruction.result = operand_end();
-                    goto_instruction.operands[0] = operand_block(after);
-                    block_add(compiler->body, goto_instruction);
-                    block_link(compiler->body, after);
+                    jump(compiler, after);
                 }
-            } else {
-                block_link(current, after);
             }
 
-            block_add(current, instruction);
-
             unit_add(compiler->unit, after);
             compiler->body = after;
 
             return operand_none();
         }
         case AST_NODE_TYPE_WHILE: {
-            struct ast_node* condition = node->children[0];
             struct ast_node* body = node->children[1];
             struct block* body_block = block_new(false, compiler->regs);
             struct block* loop_block = block_new(false, compiler->regs);
@@ -822,36 +2743,16 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
             unit_add(compiler->unit, loop_block);
             unit_add(compiler->unit, after_block);
 
-            //funitst we jump to the loop block
-            struct ssa_instruction jump = {};
-            jump.result = operand_end();
-            jump.operator = OP_GOTO;
-            jump.operands[0] = operand_block(loop_block);
-            block_add(current, jump);
-
-            //link body to the loop
-            block_link(current, loop_block);
-
-            //build the loop block conditions
+            //first we jump to the loop block, which tests the condition
+            jump(compiler, loop_block);
             compiler->body = loop_block;
-            struct ssa_instruction instruction = {};
-            instruction.operator = OP_IF;
-            instruction.result = operand_end();
-            instruction.operands[0] = statement(compiler, condition);
-            instruction.operands[1] = operand_block(body_block);
-            instruction.operands[2] = operand_block(after_block);
-            block_add(loop_block, instruction);
-
-            //link loop to body and after
-            block_link(loop_block, body_block);
-            block_link(loop_block, after_block);
+            condition(compiler, node->children[0], body_block, after_block);
 
             //build the body of the loop
             compiler->body = body_block;
-            struct operand result = statement(compiler, body);
+            struct operand result = scoped_statement(compiler, body);
             if (result.type != OPERAND_TYPE_END) {
-                block_link(body_block, loop_block);
-                block_add(body_block, jump);
+                jump(compiler, loop_block);
             }
 
             compiler->body = after_block;
@@ -864,83 +2765,212 @@ static struct operand statement(struct compiler* compiler, struct ast_node* node
     }
 }
 
-static struct operand argument(struct compiler* compiler, struct ast_node* node) {
-    switch (node->type) {
-        case AST_NODE_TYPE_SEQUENCE: {
-            for (int i = 0; i < node->children_count; i++) {
-                struct ast_node* child = node->children[i];
-                argument(compiler, child);
-            }
-            return operand_none();
+// true if every return in node gives back the variable name, the first one sets it
+static bool returns_same(struct ast_node* node, struct token* name) {
+    if (node->type == AST_NODE_TYPE_STRUCT || node->type == AST_NODE_TYPE_INTERFACE) {
+        return true;
+    }
+    if (node->type == AST_NODE_TYPE_RETURN_STATEMENT) {
+        if (node->children_count == 0 || node->children[0]->type != AST_NODE_TYPE_NAME) {
+            return false;
         }
-        case AST_NODE_TYPE_VARIABLE: {
-            struct ast_node* name = node->children[0];
-            struct ast_node* type = node->children[1];
-
-            //this is special and does not get alloc
-            struct operand variable = register_table_alloc(compiler->regs,
-                                                           ssa_type_from_ast(compiler->ast_module, type));
+        if (name->length == 0) {
+            *name = node->children[0]->token;
+        }
+        return same_name(node->children[0]->token, *name);
+    }
+    for (size_t i = 0; i < node->children_count; i++) {
+        if (!returns_same(node->children[i], name)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-            unit_arg(compiler->unit, variable);
+// how many variables named name node declares
+static size_t declarations(struct ast_node* node, struct token name) {
+    if (node->type == AST_NODE_TYPE_STRUCT || node->type == AST_NODE_TYPE_INTERFACE) {
+        return 0;
+    }
+    size_t count = node->type == AST_NODE_TYPE_VARIABLE && same_name(node->children[0]->token, name);
+    for (size_t i = 0; i < node->children_count; i++) {
+        count += declarations(node->children[i], name);
+    }
+    return count;
+}
 
-            //make a local copy pointer to a variable
-            struct ssa_instruction instruction = {};
-            instruction.operator = OP_ALLOC;
-            instruction.type = variable.typename;
-            instruction.result = register_table_add(compiler->regs, name->token, variable.typename)->pointer;
-            instruction.operands[0] = operand_const_i64(variable.typename.size);
+static struct operand argument(struct compiler* compiler, struct token name, struct operand variable) {
+    // a struct argument is memory the function owns already, the variable is that memory
+    if (is_struct(variable.typename)) {
+        struct variable* local = register_table_add(compiler->regs, name, variable.typename);
+        local->pointer.value.integer = variable.value.integer;
+        local->depth = 1;
+        if (has_destructor(variable.typename.type)) {
+            owned_add(compiler, name, variable, 1);
+        }
+        return local->pointer;
+    }
 
-            block_add(compiler->entry, instruction);
+    //make a local copy pointer to a variable
+    struct ssa_instruction instruction = {};
+    instruction.operator = OP_ALLOC;
+    instruction.type = variable.typename;
+    instruction.result = register_table_add(compiler->regs, name, variable.typename)->pointer;
+    instruction.operands[0] = operand_const_i64(variable.typename.size);
+
+    block_add(compiler->entry, instruction);
+
+    // the caller passed the address of a fat pointer, the two words are copied out of it
+    if (is_interface(variable.typename)) {
+        struct operand fat = instruction.result;
+        fat.typename = variable.typename;
+        interface_store(compiler, fat, variable);
+        return instruction.result;
+    }
 
-            struct ssa_instruction store = {};
-            store.operator = OP_STORE;
-            //location
-            store.operands[0] = instruction.result;
-            store.operands[1] = variable;
-            block_add(compiler->body, store);
+    struct ssa_instruction store = {};
+    store.operator = OP_STORE;
+    //location
+    store.operands[0] = instruction.result;
+    store.operands[1] = variable;
+    block_add(compiler->body, store);
+    return instruction.result;
+}
 
-            return operand_none();
-        }
-        default: {
-            fprintf(stderr, "unexpected node type: %s\n", ast_node_get_name(node));
+// the unit a function is lowered into, a member of a struct is found by the struct's name as well and a variant of a
+// function by its parameters
+static struct unit* symbol_unit(struct unit_module* unit_module, struct ast_module* module, struct ast_node* symbol) {
+    struct ast_node* owner = ast_module_get_owner(module->symbols, symbol);
+    if (owner != NULL) {
+        return unit_module_find_member(unit_module, owner, symbol->children[0]->token);
+    }
+    struct unit_overloads* overloads = unit_module_overloads(unit_module, symbol->children[0]->token);
+    if (overloads == NULL || overloads->count == 1) {
+        return overloads != NULL ? overloads->units[0] : NULL;
+    }
+    char* parameters = ast_module_function_parameters(symbol);
+    struct unit* unit = NULL;
+    for (uint32_t i = 0; i < overloads->count && unit == NULL; i++) {
+        if (overloads->units[i]->parameters != NULL && strcmp(overloads->units[i]->parameters, parameters) == 0) {
+            unit = overloads->units[i];
         }
     }
-    return operand_none();
+    free(parameters);
+    return unit;
 }
 
-static void definition(struct unit_module* unit_module, struct ast_module* module, struct ast_node* node) {
-    switch (node->type) {
-        case AST_NODE_TYPE_FUNCTION: {
-            struct unit* unit = unit_module_find(unit_module, node->children[0]->token);
-            struct ast_node* type = node->children[1]; //type
-            struct ast_node* args = node->children[2]; // args sequence
-            struct ast_node* body = node->children[3]; //function body
-            struct compiler* compiler = compiler_new(module, unit_module, unit, unit->return_type);
-            compiler_begin(compiler);
+static void function(struct unit_module* unit_module, struct ast_module* module, struct ast_node* symbol,
+                     struct ast_node* body) {
+    struct unit* unit = symbol_unit(unit_module, module, symbol);
+    struct ast_node* args = symbol->children[2]; // args sequence
+    ERROR(!is_interface(unit->return_type), "interface pointers can't be returned\n");
+    struct compiler* compiler = compiler_new(module, unit_module, unit, unit->return_type);
 
-            argument(compiler, args);
+    //the arguments were forwarded as the first registers, reserve them before anything else
+    for (int i = 0; i < unit->argument_count; i++) {
+        register_table_alloc(compiler->regs, unit->arguments[i].typename);
+    }
 
-            struct operand operand = statement(compiler, body);
+    compiler_begin(compiler);
 
-            if (operand.type != OPERAND_TYPE_END) {
-                struct ssa_instruction goto_instruction = {};
-                goto_instruction.operator = OP_GOTO;
-                goto_instruction.result = operand_end();
-                goto_instruction.operands[0] = operand_block(compiler->exit);
-                block_add(compiler->body, goto_instruction);
-                block_link(compiler->body, compiler->exit);
-            }
+    // a method's first argument is this, the ones it declares come after
+    int first = (int) parameter_count(unit) - (int) args->children_count;
+    compiler->argument_slots = malloc(sizeof(struct operand) * (unit->argument_count + 1));
+    assert(compiler->argument_slots);
+    if (first > 0) {
+        struct token this = {TOKEN_TYPE_IDENTIFIER, "this", 4, 0};
+        compiler->argument_slots[0] = argument(compiler, this, unit->arguments[0]);
+    }
+    for (int i = 0; i < args->children_count; i++) {
+        compiler->argument_slots[first + i] = argument(compiler, args->children[i]->children[0]->token,
+                                                       unit->arguments[first + i]);
+    }
+
+    // a struct every return gives back by the same name is constructed right in the result
+    struct token returned = token_null;
+    if (has_result_slot(unit) && returns_same(body, &returned) && returned.length > 0 &&
+        declarations(body, returned) == 1) {
+        compiler->returned = returned;
+    }
+
+    // self tail calls loop back to here, after the arguments were first copied into their locals
+    if (has_self_tail_call(compiler, body)) {
+        compiler->start = block_new(false, compiler->regs);
+        unit_add(compiler->unit, compiler->start);
+
+        jump(compiler, compiler->start);
+        compiler->body = compiler->start;
+    }
+
+    struct operand operand = statement(compiler, body);
+
+    if (operand.type != OPERAND_TYPE_END) {
+        struct ssa_instruction goto_instruction = {};
+        goto_instruction.operator = OP_GOTO;
+        goto_instruction.result = operand_end();
+        goto_instruction.operands[0] = operand_block(compiler->exit);
+        block_add(compiler->body, goto_instruction);
+        block_link(compiler->body, compiler->exit);
+    }
+
+    compiler_end(compiler);
+
+    compiler_free(compiler);
+}
 
-            compiler_end(compiler);
+// the initial value of a global is lowered into a function returning it, see const_eval for how it is used
+static void variable(struct unit_module* unit_module, struct ast_module* module, struct ast_node* symbol,
+                     struct ast_node* value) {
+    struct unit* unit = unit_module_find(unit_module, symbol->children[0]->token);
+    ERROR(!is_struct(unit->return_type), "a global struct can't have an initial value\n");
+    char* name = malloc(strlen(unit->symbol) + sizeof("_init_"));
+    assert(name);
+    sprintf(name, "_init_%s", unit->symbol);
+    unit->initializer = unit_new(name, false, CHUNK_TYPE_FUNCTION);
+    free(name);
+    unit->initializer->return_type = unit->return_type;
+
+    struct compiler* compiler = compiler_new(module, unit_module, unit->initializer, unit->return_type);
+    compiler_begin(compiler);
+
+    struct ssa_instruction store = {};
+    store.operator = OP_STORE;
+    store.operands[0] = compiler->return_value_ptr;
+    store.operands[1] = cast(compiler, statement(compiler, value), compiler->return_type, CAST_TYPE_IMPLICIT);
+    block_add(compiler->body, store);
+
+    struct ssa_instruction goto_instruction = {};
+    goto_instruction.operator = OP_GOTO;
+    goto_instruction.result = operand_end();
+    goto_instruction.operands[0] = operand_block(compiler->exit);
+    block_add(compiler->body, goto_instruction);
+    block_link(compiler->body, compiler->exit);
+
+    compiler_end(compiler);
+
+    compiler_free(compiler);
+}
 
-            compiler_free(compiler);
+static void definition(struct unit_module* unit_module, struct ast_module* module, struct ast_node* node) {
+    switch (node->type) {
+        case AST_NODE_TYPE_FUNCTION: {
+            function(unit_module, module, node, node->children[3]);
             break;
         }
         case AST_NODE_TYPE_VARIABLE: {
-            struct unit* unit = unit_module_find(unit_module, node->children[0]->token);
-            struct ast_node* type = node->children[0];
-            struct ast_node* value = node->children[1];
-            //TODO: implement IR instructions for generating this stuff
+            if (node->children_count > 2) {
+                variable(unit_module, module, node, node->children[2]);
+            }
+            break;
+        }
+        case AST_NODE_TYPE_IMPLEMENTATION: {
+            struct ast_node* symbol = node->children[0];
+            if (symbol->type == AST_NODE_TYPE_FUNCTION || symbol->type == AST_NODE_TYPE_METHOD) {
+                function(unit_module, module, symbol, node->children[1]);
+            }
+            else if (symbol->type == AST_NODE_TYPE_VARIABLE && node->children_count > 1) {
+                variable(unit_module, module, symbol, node->children[1]);
+            }
             break;
         }
         default: {
@@ -0,0 +1,442 @@
+#include "store_forward.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alias.h"
+#include "ast.h"
+#include "block.h"
+#include "loop.h"
+
+// the value each memory location holds at the start of every block. locations are the allocation sites and arguments
+// alias analysis traces pointers to, indexed by their register. a location holding OPERAND_TYPE_NONE has no known
+// value, one holding OPERAND_TYPE_END is on a path that hasn't been reached yet and takes whatever the others say
+struct forwarder {
+    struct unit* unit;
+    struct alias_analysis* aliases;
+    uint32_t count;
+    struct operand* states;
+    bool* reached;
+};
+
+static bool same_operand(struct operand a, struct operand b) {
+    if (a.type != b.type || a.typename.size != b.typename.size) {
+        return false;
+    }
+    switch (a.type) {
+        case OPERAND_TYPE_REGISTER:
+        case OPERAND_TYPE_INTEGER:
+            return a.value.integer == b.value.integer;
+        case OPERAND_TYPE_FLOAT:
+            return a.value.floating == b.value.floating;
+        default:
+            return true;
+    }
+}
+
+static bool is_kind(struct ssa_type type, enum ast_node_type kind) {
+    return type.type != NULL && type.type->type == kind;
+}
+
+static bool is_float(struct ssa_type type) {
+    return is_kind(type, AST_NODE_TYPE_F32) || is_kind(type, AST_NODE_TYPE_F64);
+}
+
+// the site a pointer refers to the start of, UINT32_MAX if it doesn't. fields further in aren't followed
+static uint32_t location(struct forwarder* forwarder, struct operand pointer) {
+    struct alias_base base = alias_base(forwarder->aliases, pointer);
+    if ((base.kind != ALIAS_BASE_LOCAL && base.kind != ALIAS_BASE_ARGUMENT) || base.offset != 0) {
+        return UINT32_MAX;
+    }
+    return base.index;
+}
+
+// a local no pointer the analysis can't follow refers to, nothing but the unit's own loads reads it
+static bool private_local(struct forwarder* forwarder, uint32_t location) {
+    struct alias_base base = forwarder->aliases->bases[location];
+    return base.kind == ALIAS_BASE_LOCAL && base.index == location && !forwarder->aliases->escaped[location];
+}
+
+// the instruction giving a value the type a load of it would have had, false if the value can't stand in for the
+// load. constants become constants of the load's type and registers are cast, which only rewraps them
+static bool replacement(struct operand value, struct ssa_type type, struct ssa_instruction* out) {
+    if (type.type == NULL || is_kind(type, AST_NODE_TYPE_SIMD) || is_kind(value.typename, AST_NODE_TYPE_SIMD)) {
+        return false;
+    }
+    struct ssa_instruction instruction = {};
+    instruction.type = type;
+    switch (value.type) {
+        case OPERAND_TYPE_REGISTER:
+            if (value.typename.size != type.size || is_float(value.typename) != is_float(type)) {
+                return false;
+            }
+            instruction.operator = OP_CAST;
+            instruction.operands[0] = value;
+            break;
+        case OPERAND_TYPE_INTEGER:
+            instruction.operator = OP_CONST;
+            if (is_float(type)) {
+                if (value.value.integer != 0) {
+                    return false;
+                }
+                instruction.operands[0] = (struct operand){OPERAND_TYPE_FLOAT, type, {.floating = 0}};
+            } else {
+                if (value.value.integer != 0 && value.typename.size != type.size) {
+                    return false;
+                }
+                instruction.operands[0] = (struct operand){OPERAND_TYPE_INTEGER, type, {.integer = value.value.integer}};
+            }
+            break;
+        case OPERAND_TYPE_FLOAT:
+            if (!is_float(type) || value.typename.size != type.size) {
+                return false;
+            }
+            instruction.operator = OP_CONST;
+            instruction.operands[0] = (struct operand){OPERAND_TYPE_FLOAT, type, {.floating = value.value.floating}};
+            break;
+        default:
+            return false;
+    }
+    *out = instruction;
+    return true;
+}
+
+#pragma region forwarding
+
+static void kill(struct forwarder* forwarder, struct operand* state, struct ssa_instruction* instruction) {
+    for (uint32_t i = 0; i < forwarder->count; i++) {
+        if (state[i].type != OPERAND_TYPE_NONE &&
+            alias_clobbers_base(forwarder->aliases, instruction, forwarder->aliases->bases[i])) {
+            state[i] = operand_none();
+        }
+    }
+}
+
+// runs a block over the values the locations hold, loads of known values are replaced when rewrite is set
+static void transfer(struct forwarder* forwarder, struct block* block, struct operand* state, bool rewrite) {
+    for (uint32_t i = 0; i < block->instructions_count; i++) {
+        struct ssa_instruction* instruction = &block->instructions[i];
+
+        // a register defined again in a loop no longer holds what was stored from it on the last trip
+        struct operand result = instruction->result;
+        if (result.type == OPERAND_TYPE_REGISTER) {
+            for (uint32_t j = 0; j < forwarder->count; j++) {
+                if (state[j].type == OPERAND_TYPE_REGISTER && state[j].value.integer == result.value.integer) {
+                    state[j] = operand_none();
+                }
+            }
+        }
+
+        switch (instruction->operator) {
+            case OP_STORE: {
+                kill(forwarder, state, instruction);
+                uint32_t target = location(forwarder, instruction->operands[0]);
+                if (target != UINT32_MAX && !is_kind(instruction->operands[1].typename, AST_NODE_TYPE_SIMD)) {
+                    state[target] = instruction->operands[1];
+                }
+                break;
+            }
+            case OP_CALL:
+                kill(forwarder, state, instruction);
+                break;
+            case OP_LOAD: {
+                uint32_t source = location(forwarder, instruction->operands[0]);
+                struct ssa_instruction forwarded;
+                if (source == UINT32_MAX || is_kind(instruction->result.typename, AST_NODE_TYPE_SIMD)) {
+                    break;
+                }
+                if (state[source].type == OPERAND_TYPE_NONE) {
+                    state[source] = instruction->result;
+                } else if (rewrite && replacement(state[source], instruction->result.typename, &forwarded)) {
+                    forwarded.result = instruction->result;
+                    *instruction = forwarded;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+static void forward(struct forwarder* forwarder) {
+    struct unit* unit = forwarder->unit;
+    uint32_t count = forwarder->count;
+    struct operand* state = malloc(sizeof(struct operand) * (count + 1));
+    assert(state);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 0; i < unit->block_count; i++) {
+            if (!forwarder->reached[i]) {
+                continue;
+            }
+            memcpy(state, forwarder->states + i * count, sizeof(struct operand) * count);
+            transfer(forwarder, unit->blocks[i], state, false);
+
+            uint32_t successors[2];
+            uint32_t successor_count = block_successors(unit, unit->blocks[i], successors);
+            for (uint32_t j = 0; j < successor_count; j++) {
+                struct operand* in = forwarder->states + successors[j] * count;
+                for (uint32_t k = 0; k < count; k++) {
+                    if (in[k].type == OPERAND_TYPE_NONE || same_operand(in[k], state[k])) {
+                        continue;
+                    }
+                    in[k] = in[k].type == OPERAND_TYPE_END ? state[k] : operand_none();
+                    changed = true;
+                }
+                if (!forwarder->reached[successors[j]]) {
+                    forwarder->reached[successors[j]] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+    free(state);
+}
+
+#pragma endregion
+
+#pragma region return values
+
+// the local a block loads and returns and nothing else, the exit block ssa_gen gives every function with a value
+static uint32_t return_slot(struct forwarder* forwarder, struct block* block) {
+    if (block->instructions_count != 2) {
+        return UINT32_MAX;
+    }
+    struct ssa_instruction* load = &block->instructions[0];
+    struct ssa_instruction* ret = &block->instructions[1];
+    if (load->operator != OP_LOAD || ret->operator != OP_RETURN || ret->operands[0].type != OPERAND_TYPE_REGISTER ||
+        ret->operands[0].value.integer != load->result.value.integer) {
+        return UINT32_MAX;
+    }
+    uint32_t slot = location(forwarder, load->operands[0]);
+    return slot != UINT32_MAX && private_local(forwarder, slot) ? slot : UINT32_MAX;
+}
+
+// a block that jumps to the exit with the return value known returns it straight away
+static void return_directly(struct forwarder* forwarder, struct block* block, struct operand* state) {
+    struct ssa_instruction* jump = block_terminator(block);
+    if (jump == NULL || jump->operator != OP_GOTO) {
+        return;
+    }
+    struct block* exit = jump->operands[0].value.block;
+    uint32_t slot = return_slot(forwarder, exit);
+    struct ssa_instruction value;
+    if (slot == UINT32_MAX || !replacement(state[slot], exit->instructions[0].result.typename, &value)) {
+        return;
+    }
+    struct ssa_instruction* ret = &exit->instructions[1];
+    if (value.operator == OP_CAST && value.operands[0].typename.type->type != ret->operands[0].typename.type->type) {
+        return;
+    }
+    struct ssa_instruction direct = *ret;
+    direct.operands[0] = value.operands[0];
+    *jump = direct;
+    block_unlink(block, exit);
+}
+
+// drops blocks control never reaches, like the leftovers of fully unrolled loops, so they don't keep the exit alive.
+// a block only goes when the one before it doesn't fall through into it
+static void remove_unreachable(struct unit* unit) {
+    bool* reached = calloc(unit->block_count, sizeof(bool));
+    uint32_t* stack = malloc(sizeof(uint32_t) * unit->block_count);
+    assert(reached && stack);
+    uint32_t top = 0;
+    reached[0] = true;
+    stack[top++] = 0;
+    while (top > 0) {
+        uint32_t successors[2];
+        uint32_t count = block_successors(unit, unit->blocks[stack[--top]], successors);
+        for (uint32_t i = 0; i < count; i++) {
+            if (!reached[successors[i]]) {
+                reached[successors[i]] = true;
+                stack[top++] = successors[i];
+            }
+        }
+    }
+    for (uint32_t i = unit->block_count; i-- > 1;) {
+        if (!reached[i] && block_terminator(unit->blocks[i - 1]) != NULL) {
+            unit_remove(unit, unit->blocks[i]);
+        }
+    }
+    free(reached);
+    free(stack);
+}
+
+static bool entered(struct unit* unit, struct block* block) {
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        uint32_t successors[2];
+        uint32_t count = block_successors(unit, unit->blocks[i], successors);
+        for (uint32_t j = 0; j < count; j++) {
+            if (unit->blocks[successors[j]] == block) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+#pragma endregion
+
+#pragma region dead stores
+
+// runs a block backwards over which private locals may still be read, stores to the others are dropped when remove
+// is set
+static void scan_backwards(struct forwarder* forwarder, struct block* block, bool* live, bool remove) {
+    uint32_t kept = block->instructions_count;
+    for (uint32_t i = block->instructions_count; i-- > 0;) {
+        struct ssa_instruction instruction = block->instructions[i];
+        uint32_t slot = location(forwarder, instruction.operands[0]);
+        struct alias_base base = alias_base(forwarder->aliases, instruction.operands[0]);
+        if (instruction.operator == OP_LOAD && slot == UINT32_MAX && base.kind == ALIAS_BASE_LOCAL) {
+            // reads a field further into the local, which a store to its start may have written
+            live[base.index] = true;
+        }
+        if (slot != UINT32_MAX && private_local(forwarder, slot)) {
+            if (instruction.operator == OP_LOAD) {
+                live[slot] = true;
+            } else if (instruction.operator == OP_STORE) {
+                bool dead = !live[slot];
+                live[slot] = false;
+                if (remove && dead) {
+                    continue;
+                }
+            }
+        }
+        block->instructions[--kept] = instruction;
+    }
+    if (remove) {
+        memmove(block->instructions, block->instructions + kept,
+                sizeof(struct ssa_instruction) * (block->instructions_count - kept));
+        block->instructions_count -= kept;
+    }
+}
+
+static void live_out(struct forwarder* forwarder, bool* live, uint32_t block, bool* state) {
+    uint32_t count = forwarder->count;
+    memset(state, 0, sizeof(bool) * count);
+    uint32_t successors[2];
+    uint32_t successor_count = block_successors(forwarder->unit, forwarder->unit->blocks[block], successors);
+    for (uint32_t i = 0; i < successor_count; i++) {
+        for (uint32_t j = 0; j < count; j++) {
+            state[j] |= live[successors[i] * count + j];
+        }
+    }
+}
+
+// a store is dead when no path from it reads the local before storing to it again or returning
+static void remove_dead_stores(struct forwarder* forwarder) {
+    struct unit* unit = forwarder->unit;
+    uint32_t count = forwarder->count;
+    bool* live = calloc((size_t) unit->block_count * count + 1, sizeof(bool));
+    bool* state = malloc(sizeof(bool) * (count + 1));
+    assert(live && state);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = unit->block_count; i-- > 0;) {
+            live_out(forwarder, live, i, state);
+            scan_backwards(forwarder, unit->blocks[i], state, false);
+            if (memcmp(live + i * count, state, sizeof(bool) * count) != 0) {
+                memcpy(live + i * count, state, sizeof(bool) * count);
+                changed = true;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        live_out(forwarder, live, i, state);
+        scan_backwards(forwarder, unit->blocks[i], state, true);
+    }
+    free(live);
+    free(state);
+}
+
+// allocations nothing refers to anymore, all their loads having been forwarded and their stores found dead
+static void remove_unused_locals(struct unit* unit) {
+    uint32_t count = unit_register_count(unit);
+    bool* used = calloc(count + 1, sizeof(bool));
+    assert(used);
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            for (int k = 0; k < MAX_OPERANDS; k++) {
+                struct operand operand = block->instructions[j].operands[k];
+                if (operand.type == OPERAND_TYPE_REGISTER && operand.value.integer < count) {
+                    used[operand.value.integer] = true;
+                }
+            }
+        }
+    }
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        uint32_t kept = 0;
+        for (uint32_t j = 0; j < block->instructions_count; j++) {
+            struct ssa_instruction* instruction = &block->instructions[j];
+            if (instruction->operator == OP_ALLOC && !used[instruction->result.value.integer]) {
+                continue;
+            }
+            block->instructions[kept++] = *instruction;
+        }
+        block->instructions_count = kept;
+    }
+    free(used);
+}
+
+#pragma endregion
+
+void unit_forward_stores(struct unit* unit) {
+    if (unit->type != CHUNK_TYPE_FUNCTION || unit->block_count == 0) {
+        return;
+    }
+
+    remove_unreachable(unit);
+
+    struct forwarder forwarder = {};
+    forwarder.unit = unit;
+    forwarder.aliases = alias_analysis_new(unit);
+    forwarder.count = forwarder.aliases->register_count;
+    forwarder.states = malloc(sizeof(struct operand) * ((size_t) forwarder.count * unit->block_count + 1));
+    forwarder.reached = calloc(unit->block_count, sizeof(bool));
+    assert(forwarder.states && forwarder.reached);
+    for (uint32_t i = 0; i < forwarder.count * unit->block_count; i++) {
+        forwarder.states[i] = i < forwarder.count ? operand_none() : operand_end();
+    }
+    forwarder.reached[0] = true;
+    forward(&forwarder);
+
+    struct operand* state = malloc(sizeof(struct operand) * (forwarder.count + 1));
+    assert(state);
+    struct block* exit = NULL;
+    for (uint32_t i = 0; i < unit->block_count; i++) {
+        struct block* block = unit->blocks[i];
+        if (return_slot(&forwarder, block) != UINT32_MAX) {
+            exit = block;
+        }
+        if (!forwarder.reached[i]) {
+            continue;
+        }
+        memcpy(state, forwarder.states + i * forwarder.count, sizeof(struct operand) * forwarder.count);
+        transfer(&forwarder, block, state, true);
+        return_directly(&forwarder, block, state);
+    }
+    free(state);
+    free(forwarder.states);
+    free(forwarder.reached);
+
+    if (exit != NULL && !entered(unit, exit)) {
+        unit_remove(unit, exit);
+    }
+    remove_dead_stores(&forwarder);
+    remove_unused_locals(unit);
+    alias_analysis_free(forwarder.aliases);
+}
+
+void unit_module_forward_stores(struct unit_module* module) {
+    for (size_t i = 0; i < module->unit_count; i++) {
+        unit_forward_stores(module->units[i]);
+    }
+}
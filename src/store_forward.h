@@ -0,0 +1,14 @@
+#ifndef COMPILER_STORE_FORWARD_H
+#define COMPILER_STORE_FORWARD_H
+
+#include "unit.h"
+
+// replaces loads of memory whose value is already in a register, because it was stored or loaded on every path
+// there, with that register. then removes stores to locals that are overwritten or never read again, and locals
+// nothing uses anymore. blocks that store the return value and jump to a shared exit just to load it return it
+// themselves, so the return value's local goes away when all of them do
+void unit_forward_stores(struct unit* unit);
+
+void unit_module_forward_stores(struct unit_module* module);
+
+#endif //COMPILER_STORE_FORWARD_H
@@ -14,6 +14,17 @@ static struct ast_node* type_declaration_struct(struct parser* parser) {
     ast_node_append_child(symbol, members);
     ast_node_append_child(symbol, statics);
     
+    if (parser_match(parser, TOKEN_TYPE_LESS)) {
+        struct ast_node* generics = parser_generic_parameters(parser);
+        ast_node_append_child(symbol, generics);
+        if (parser->error)
+            goto fail;
+        generic_declare(parser->module->generics, parser->module, symbol, generics);
+    }
+    else {
+        ast_node_append_child(symbol, ast_node_new(AST_NODE_TYPE_SEQUENCE, token_null));
+    }
+    
     if (parser_match(parser, TOKEN_TYPE_COLON)) {
         do {
             parser_consume(parser, TOKEN_TYPE_IDENTIFIER, "expected identifier");
@@ -0,0 +1,257 @@
+#include "type_layout.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_layout.h"
+
+// open addressing on the struct node, the capacity is a power of two
+struct type_layout_cache {
+    struct type_layout** entries;
+    size_t count;
+    size_t capacity;
+};
+
+static size_t align_up(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static size_t slot_of(struct type_layout_cache* cache, struct ast_node* structure) {
+    size_t slot = ((uintptr_t) structure >> 4) * 0x9E3779B97F4A7C15ull & (cache->capacity - 1);
+    while (cache->entries[slot] != NULL && cache->entries[slot]->structure != structure) {
+        slot = (slot + 1) & (cache->capacity - 1);
+    }
+    return slot;
+}
+
+static void cache_add(struct type_layout_cache* cache, struct type_layout* layout) {
+    if ((cache->count + 1) * 4 > cache->capacity * 3) {
+        struct type_layout** old = cache->entries;
+        size_t old_capacity = cache->capacity;
+        cache->capacity = old_capacity * 2;
+        cache->entries = calloc(cache->capacity, sizeof(struct type_layout*));
+        assert(cache->entries);
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i] != NULL) {
+                cache->entries[slot_of(cache, old[i]->structure)] = old[i];
+            }
+        }
+        free(old);
+    }
+    cache->entries[slot_of(cache, layout->structure)] = layout;
+    cache->count++;
+}
+
+static bool is_private(struct ast_node* field) {
+    struct token name = field->children[0]->token;
+    return name.length > 0 && name.start[0] == '_';
+}
+
+struct placement {
+    struct ast_node* field;
+    size_t size;
+    size_t alignment;
+    size_t order;
+};
+
+// bigger alignments first, then bigger fields, declaration order otherwise so the layout is stable
+static int compare_placements(const void* a, const void* b) {
+    const struct placement* x = a;
+    const struct placement* y = b;
+    if (x->alignment != y->alignment) {
+        return x->alignment > y->alignment ? -1 : 1;
+    }
+    if (x->size != y->size) {
+        return x->size > y->size ? -1 : 1;
+    }
+    return x->order < y->order ? -1 : 1;
+}
+
+static bool splits_line(size_t offset, size_t size) {
+    return size <= CACHE_LINE_SIZE && offset / CACHE_LINE_SIZE != (offset + size - 1) / CACHE_LINE_SIZE;
+}
+
+static void place(struct type_layout* layout, struct placement* placement, size_t* offset) {
+    size_t start = align_up(*offset, placement->alignment);
+    layout->padding += start - *offset;
+    layout->fields[layout->field_count] = placement->field;
+    layout->offsets[layout->field_count++] = start;
+    *offset = start + placement->size;
+}
+
+// the first private field left that fits between offset and end, NULL if none does
+static struct placement* fitting(struct placement* privates, bool* used, size_t count, size_t offset, size_t end) {
+    for (size_t i = 0; i < count; i++) {
+        if (!used[i] && privates[i].size > 0 &&
+            align_up(offset, privates[i].alignment) + privates[i].size <= end) {
+            used[i] = true;
+            return &privates[i];
+        }
+    }
+    return NULL;
+}
+
+static void lay_out(struct ast_module* module, struct type_layout* layout) {
+    struct ast_node* members = layout->structure->children[STRUCT_LAYOUT_MEMBERS];
+    struct placement* publics = malloc(sizeof(struct placement) * (members->children_count + 1));
+    struct placement* privates = malloc(sizeof(struct placement) * (members->children_count + 1));
+    bool* used = calloc(members->children_count + 1, sizeof(bool));
+    assert(publics && privates && used);
+
+    bool reorder = module->reorder_fields;
+    size_t public_count = 0;
+    size_t private_count = 0;
+    size_t alignment = 1;
+    for (size_t i = 0; i < members->children_count; i++) {
+        struct ast_node* field = members->children[i];
+        if (field->type != AST_NODE_TYPE_FIELD) {
+            continue;
+        }
+        struct placement placement = {field, ast_node_symbol_size(module, field->children[1]),
+                                      ast_node_symbol_alignment(module, field->children[1]), i};
+        if (placement.alignment > alignment) {
+            alignment = placement.alignment;
+        }
+        if (reorder && is_private(field)) {
+            privates[private_count++] = placement;
+        } else {
+            publics[public_count++] = placement;
+        }
+    }
+    qsort(privates, private_count, sizeof(struct placement), compare_placements);
+
+    layout->fields = malloc(sizeof(struct ast_node*) * (public_count + private_count + 1));
+    layout->offsets = malloc(sizeof(size_t) * (public_count + private_count + 1));
+    assert(layout->fields && layout->offsets);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < public_count; i++) {
+        size_t start = align_up(offset, publics[i].alignment);
+        struct placement* filler;
+        while ((filler = fitting(privates, used, private_count, offset, start)) != NULL) {
+            place(layout, filler, &offset);
+        }
+        place(layout, &publics[i], &offset);
+    }
+
+    // the rest go after the public fields, one that would straddle a cache line waits for one that doesn't
+    for (size_t placed = 0; placed < private_count; placed++) {
+        size_t pick = SIZE_MAX;
+        for (size_t i = 0; i < private_count; i++) {
+            if (used[i]) {
+                continue;
+            }
+            if (pick == SIZE_MAX) {
+                pick = i;
+            }
+            if (!splits_line(align_up(offset, privates[i].alignment), privates[i].size)) {
+                pick = i;
+                break;
+            }
+        }
+        if (pick == SIZE_MAX) {
+            break;
+        }
+        used[pick] = true;
+        place(layout, &privates[pick], &offset);
+    }
+
+    layout->size = align_up(offset, alignment);
+    layout->padding += layout->size - offset;
+    layout->alignment = alignment;
+
+    free(used);
+    free(privates);
+    free(publics);
+}
+
+const struct type_layout* type_layout_of(struct ast_module* module, struct ast_node* structure) {
+    assert(module && structure->type == AST_NODE_TYPE_STRUCT);
+    if (module->layouts == NULL) {
+        module->layouts = malloc(sizeof(struct type_layout_cache));
+        assert(module->layouts);
+        module->layouts->count = 0;
+        module->layouts->capacity = 16;
+        module->layouts->entries = calloc(module->layouts->capacity, sizeof(struct type_layout*));
+        assert(module->layouts->entries);
+    }
+    struct type_layout* cached = module->layouts->entries[slot_of(module->layouts, structure)];
+    if (cached != NULL) {
+        if (cached->alignment == 0) {
+            struct token name = structure->children[STRUCT_LAYOUT_NAME]->token;
+            fprintf(stderr, "struct %.*s contains itself\n", (int) name.length, name.start);
+        }
+        return cached;
+    }
+
+    // cached before it is laid out, so a struct that contains itself finds itself unfinished instead of recursing
+    struct type_layout* layout = calloc(1, sizeof(struct type_layout));
+    assert(layout);
+    layout->structure = structure;
+    cache_add(module->layouts, layout);
+    lay_out(module, layout);
+    return layout;
+}
+
+void type_layout_cache_free(struct type_layout_cache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cache->capacity; i++) {
+        if (cache->entries[i] != NULL) {
+            free(cache->entries[i]->fields);
+            free(cache->entries[i]->offsets);
+            free(cache->entries[i]);
+        }
+    }
+    free(cache->entries);
+    free(cache);
+}
+
+static void debug_type(FILE* out, struct ast_node* type) {
+    switch (type->type) {
+        case AST_NODE_TYPE_STRUCT: {
+            struct token name = type->children[STRUCT_LAYOUT_NAME]->token;
+            fprintf(out, "%.*s", (int) name.length, name.start);
+            break;
+        }
+        case AST_NODE_TYPE_POINTER:
+        case AST_NODE_TYPE_REFERENCE:
+            debug_type(out, type->children[0]);
+            fprintf(out, type->type == AST_NODE_TYPE_POINTER ? "*?" : "*");
+            break;
+        default:
+            fprintf(out, "%s", ast_node_get_name(type));
+            break;
+    }
+}
+
+void type_layout_debug(FILE* out, const struct type_layout* layout) {
+    struct token name = layout->structure->children[STRUCT_LAYOUT_NAME]->token;
+    fprintf(out, "struct %.*s: size %zu, align %zu, %zu bytes padding\n", (int) name.length, name.start, layout->size,
+            layout->alignment, layout->padding);
+    for (size_t i = 0; i < layout->field_count; i++) {
+        struct ast_node* field = layout->fields[i];
+        struct token field_name = field->children[0]->token;
+        fprintf(out, "    %4zu %.*s: ", layout->offsets[i], (int) field_name.length, field_name.start);
+        debug_type(out, field->children[1]);
+        fprintf(out, "\n");
+    }
+}
+
+static void debug_structs(FILE* out, struct ast_module* module, struct ast_node* scope, size_t first) {
+    for (size_t i = first; i < scope->children_count; i++) {
+        struct ast_node* child = scope->children[i];
+        // a generic struct has no layout of its own, its instances do
+        if (child->type == AST_NODE_TYPE_STRUCT && !ast_node_is_generic(child)) {
+            type_layout_debug(out, type_layout_of(module, child));
+            debug_structs(out, module, child, STRUCT_LAYOUT_GENERICS + 1);
+        }
+    }
+}
+
+void type_layout_debug_module(FILE* out, struct ast_module* module) {
+    debug_structs(out, module, module->symbols, 0);
+}
@@ -0,0 +1,40 @@
+#ifndef COMPILER_TYPE_LAYOUT_H
+#define COMPILER_TYPE_LAYOUT_H
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "ast.h"
+#include "ast_module.h"
+
+// the line private fields are kept from straddling when they are reordered, in bytes
+#define CACHE_LINE_SIZE 64
+
+// where the fields of a struct are in memory. every field is aligned to its type like the c abi does, and the size is
+// rounded up to the struct's alignment so arrays of it stay aligned. fields are in the order they are laid out
+struct type_layout {
+    struct ast_node* structure;
+    size_t size;
+    // 0 while the layout is still being worked out, a struct that reaches itself again contains itself
+    size_t alignment;
+    // bytes between fields and after the last one
+    size_t padding;
+    size_t field_count;
+    struct ast_node** fields;
+    size_t* offsets;
+};
+
+struct type_layout_cache;
+
+// the layout of a struct, worked out the first time the module asks for it. private fields, the ones named with a
+// leading underscore, are moved into the padding between public fields and otherwise sorted by alignment when the
+// module reorders fields. public fields always stay in the order they are declared in
+const struct type_layout* type_layout_of(struct ast_module* module, struct ast_node* structure);
+
+void type_layout_cache_free(struct type_layout_cache* cache);
+
+void type_layout_debug(FILE* out, const struct type_layout* layout);
+
+// dumps the layout of every struct of the module, nested ones too
+void type_layout_debug_module(FILE* out, struct ast_module* module);
+
+#endif //COMPILER_TYPE_LAYOUT_H
@@ -7,6 +7,7 @@
 #include <string.h>
 
 #include "ast.h"
+#include "ast_layout.h"
 #include "block.h"
 
 struct unit* unit_new(char* symbol, bool global, enum unit_type type)
@@ -33,6 +34,13 @@ struct unit* unit_new(char* symbol, bool global, enum unit_type type)
     chunk->block_count = 0;
     chunk->block_capacity = 1;
 
+    chunk->pure = false;
+    chunk->parameters = NULL;
+    chunk->signature = 0;
+
+    chunk->initializer = NULL;
+    chunk->value = operand_none();
+
     return chunk;
 }
 
@@ -45,6 +53,14 @@ struct unit_module* unit_module_new(char* name)
     list->units = malloc(sizeof(struct unit*));
     list->unit_count = 0;
     list->unit_capacity = 1;
+    list->vtables = malloc(sizeof(struct unit_vtable*));
+    assert(list->vtables);
+    list->vtable_count = 0;
+    list->vtable_capacity = 1;
+    list->name_capacity = 8;
+    list->names = calloc(list->name_capacity, sizeof(struct unit_overloads*));
+    assert(list->names);
+    list->name_count = 0;
     return list;
 }
 
@@ -57,9 +73,99 @@ void unit_module_free(struct unit_module* list)
         unit_free(list->units[i]);
     }
     free(list->units);
+    for (size_t i = 0; i < list->vtable_count; i++)
+    {
+        free(list->vtables[i]->methods);
+        free(list->vtables[i]);
+    }
+    free(list->vtables);
+    for (size_t i = 0; i < list->name_capacity; i++)
+    {
+        if (list->names[i] != NULL)
+        {
+            free(list->names[i]->name);
+            free(list->names[i]->units);
+            free(list->names[i]);
+        }
+    }
+    free(list->names);
     free(list);
 }
 
+static uint64_t hash_text(const char* text, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t) text[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// the variants of a function are found by the name before their parameters
+static size_t name_length(const char* symbol, size_t length)
+{
+    const char* parameters = memchr(symbol, '(', length);
+    return parameters != NULL ? (size_t) (parameters - symbol) : length;
+}
+
+static size_t name_slot(struct unit_module* list, const char* name, size_t length)
+{
+    size_t slot = hash_text(name, length) & (list->name_capacity - 1);
+    while (list->names[slot] != NULL &&
+           (strlen(list->names[slot]->name) != length || memcmp(list->names[slot]->name, name, length) != 0))
+    {
+        slot = (slot + 1) & (list->name_capacity - 1);
+    }
+    return slot;
+}
+
+static void names_add(struct unit_module* list, struct unit* chunk)
+{
+    if ((list->name_count + 1) * 4 > list->name_capacity * 3)
+    {
+        struct unit_overloads** old = list->names;
+        size_t old_capacity = list->name_capacity;
+        list->name_capacity *= 2;
+        list->names = calloc(list->name_capacity, sizeof(struct unit_overloads*));
+        assert(list->names);
+        for (size_t i = 0; i < old_capacity; i++)
+        {
+            if (old[i] != NULL)
+            {
+                list->names[name_slot(list, old[i]->name, strlen(old[i]->name))] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    size_t length = name_length(chunk->symbol, strlen(chunk->symbol));
+    size_t slot = name_slot(list, chunk->symbol, length);
+    struct unit_overloads* overloads = list->names[slot];
+    if (overloads == NULL)
+    {
+        overloads = malloc(sizeof(struct unit_overloads));
+        assert(overloads);
+        overloads->name = malloc(length + 1);
+        assert(overloads->name);
+        memcpy(overloads->name, chunk->symbol, length);
+        overloads->name[length] = '\0';
+        overloads->units = malloc(sizeof(struct unit*));
+        assert(overloads->units);
+        overloads->count = 0;
+        overloads->capacity = 1;
+        list->names[slot] = overloads;
+        list->name_count++;
+    }
+    if (overloads->count >= overloads->capacity)
+    {
+        overloads->capacity *= 2;
+        overloads->units = realloc(overloads->units, overloads->capacity * sizeof(struct unit*));
+        assert(overloads->units);
+    }
+    overloads->units[overloads->count++] = chunk;
+}
+
 void unit_module_append(struct unit_module* list, struct unit* chunk)
 {
     if (list->unit_count >= list->unit_capacity)
@@ -69,33 +175,186 @@ void unit_module_append(struct unit_module* list, struct unit* chunk)
         assert(list->units);
     }
     list->units[list->unit_count++] = chunk;
+    names_add(list, chunk);
+}
+
+void unit_module_remove(struct unit_module* list, struct unit* chunk)
+{
+    for (size_t i = 0; i < list->unit_count; i++)
+    {
+        if (list->units[i] == chunk)
+        {
+            list->unit_count--;
+            memmove(&list->units[i], &list->units[i + 1], sizeof(struct unit*) * (list->unit_count - i));
+            break;
+        }
+    }
+    struct unit_overloads* overloads = list->names[name_slot(list, chunk->symbol,
+                                                              name_length(chunk->symbol, strlen(chunk->symbol)))];
+    for (uint32_t i = 0; overloads != NULL && i < overloads->count; i++)
+    {
+        if (overloads->units[i] == chunk)
+        {
+            overloads->count--;
+            memmove(&overloads->units[i], &overloads->units[i + 1], sizeof(struct unit*) * (overloads->count - i));
+            break;
+        }
+    }
 }
 
 void unit_free(struct unit* chunk)
 {
     assert(chunk != NULL);
     free(chunk->symbol);
+    free(chunk->parameters);
     for (int i = 0; i < chunk->block_count; i++)
     {
         block_free(chunk->blocks[i]);
     }
     free(chunk->blocks);
+    if (chunk->initializer != NULL)
+    {
+        unit_free(chunk->initializer);
+    }
     free(chunk);
 }
 
 struct unit* unit_module_find(struct unit_module* module, struct token symbol)
 {
-    for (int i = 0; i < module->unit_count; i++)
+    struct unit_overloads* overloads = unit_module_overloads(module, symbol);
+    for (uint32_t i = 0; overloads != NULL && i < overloads->count; i++)
     {
-        struct unit* chunk = module->units[i];
+        struct unit* chunk = overloads->units[i];
         if (symbol.length == strlen(chunk->symbol) && memcmp(chunk->symbol, symbol.start, symbol.length) == 0)
         {
-            return module->units[i];
+            return chunk;
         }
     }
     return NULL;
 }
 
+struct unit_overloads* unit_module_overloads(struct unit_module* module, struct token name)
+{
+    struct unit_overloads* overloads = module->names[name_slot(module, name.start,
+                                                               name_length(name.start, name.length))];
+    return overloads != NULL && overloads->count > 0 ? overloads : NULL;
+}
+
+struct unit* unit_module_resolve(struct unit_module* module, struct token name, struct operand* arguments,
+                                 uint32_t argument_count)
+{
+    struct unit_overloads* overloads = unit_module_overloads(module, name);
+    if (overloads == NULL)
+    {
+        return NULL;
+    }
+
+    struct ast_node** types = malloc(sizeof(struct ast_node*) * (argument_count + 1));
+    assert(types);
+    for (uint32_t i = 0; i < argument_count; i++)
+    {
+        // a value without a type matches no parameters
+        if (arguments[i].typename.type == NULL)
+        {
+            free(types);
+            return NULL;
+        }
+        types[i] = arguments[i].typename.type;
+    }
+    char* parameters = ast_node_mangle_parameters(types, argument_count);
+    uint64_t signature = hash_text(parameters, strlen(parameters));
+    free(types);
+
+    struct unit* found = NULL;
+    for (uint32_t i = 0; i < overloads->count && found == NULL; i++)
+    {
+        struct unit* chunk = overloads->units[i];
+        if (chunk->parameters != NULL && chunk->signature == signature && strcmp(chunk->parameters, parameters) == 0)
+        {
+            found = chunk;
+        }
+    }
+    free(parameters);
+    return found;
+}
+
+char* unit_member_symbol(struct ast_node* owner, struct token name)
+{
+    struct token owner_name = owner->children[STRUCT_LAYOUT_NAME]->token;
+    char* symbol = malloc(owner_name.length + name.length + 2);
+    assert(symbol);
+    sprintf(symbol, "%.*s.%.*s", (int) owner_name.length, owner_name.start, (int) name.length, name.start);
+    return symbol;
+}
+
+struct unit* unit_module_find_member(struct unit_module* module, struct ast_node* owner, struct token name)
+{
+    char* symbol = unit_member_symbol(owner, name);
+    struct token token = {TOKEN_TYPE_IDENTIFIER, symbol, strlen(symbol), 0};
+    struct unit* unit = unit_module_find(module, token);
+    free(symbol);
+    return unit;
+}
+
+// the method has to take the arguments the abstract one does and give back what it does
+static bool same_signature(struct ast_node* method, struct ast_node* abstract)
+{
+    struct ast_node* arguments = method->children[2];
+    struct ast_node* abstract_arguments = abstract->children[2];
+    if (arguments->children_count != abstract_arguments->children_count ||
+        method->children[1]->type != abstract->children[1]->type)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < arguments->children_count; i++)
+    {
+        if (arguments->children[i]->children[1]->type != abstract_arguments->children[i]->children[1]->type)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct unit_vtable* unit_module_vtable(struct unit_module* module, struct ast_node* structure, struct ast_node* interface)
+{
+    for (size_t i = 0; i < module->vtable_count; i++)
+    {
+        struct unit_vtable* vtable = module->vtables[i];
+        if (ast_node_same_symbol(vtable->structure, structure) && ast_node_same_symbol(vtable->interface, interface))
+        {
+            return vtable;
+        }
+    }
+
+    struct ast_node* abstracts = interface->children[INTERFACE_LAYOUT_ABSTRACTS];
+    struct unit_vtable* vtable = malloc(sizeof(struct unit_vtable));
+    assert(vtable);
+    vtable->structure = structure;
+    vtable->interface = interface;
+    vtable->method_count = abstracts->children_count;
+    vtable->methods = calloc(abstracts->children_count + 1, sizeof(struct unit*));
+    assert(vtable->methods);
+    for (uint32_t i = 0; i < vtable->method_count; i++)
+    {
+        struct ast_node* abstract = abstracts->children[i];
+        struct ast_node* method = ast_node_struct_method(structure, abstract->children[0]->token);
+        if (method != NULL && method->type == AST_NODE_TYPE_METHOD && same_signature(method, abstract))
+        {
+            vtable->methods[i] = unit_module_find_member(module, structure, abstract->children[0]->token);
+        }
+    }
+
+    if (module->vtable_count >= module->vtable_capacity)
+    {
+        module->vtable_capacity *= 2;
+        module->vtables = realloc(module->vtables, module->vtable_capacity * sizeof(struct unit_vtable*));
+        assert(module->vtables);
+    }
+    module->vtables[module->vtable_count++] = vtable;
+    return vtable;
+}
+
 void unit_add(struct unit* chunk, struct block* block)
 {
     assert(chunk != NULL);
@@ -109,6 +368,55 @@ void unit_add(struct unit* chunk, struct block* block)
     block->id = chunk->block_count;
 }
 
+void unit_remove(struct unit* chunk, struct block* block)
+{
+    assert(chunk != NULL);
+    assert(block->id >= 1 && block->id <= chunk->block_count && chunk->blocks[block->id - 1] == block);
+    while (block->children_count > 0)
+    {
+        block_unlink(block, block->children[0]);
+    }
+    while (block->parents_count > 0)
+    {
+        block_unlink(block->parents[0], block);
+    }
+    for (uint32_t i = block->id; i < chunk->block_count; i++)
+    {
+        chunk->blocks[i - 1] = chunk->blocks[i];
+        chunk->blocks[i - 1]->id = i;
+    }
+    chunk->block_count--;
+    block_free(block);
+}
+
+void unit_parameters(struct unit* chunk, struct ast_node** types, size_t count)
+{
+    free(chunk->parameters);
+    chunk->parameters = ast_node_mangle_parameters(types, count);
+    chunk->signature = hash_text(chunk->parameters, strlen(chunk->parameters));
+}
+
+uint32_t unit_register_count(struct unit* chunk)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < chunk->argument_count; i++)
+    {
+        if (chunk->arguments[i].value.integer >= count)
+            count = chunk->arguments[i].value.integer + 1;
+    }
+    for (uint32_t i = 0; i < chunk->block_count; i++)
+    {
+        struct block* block = chunk->blocks[i];
+        for (uint32_t j = 0; j < block->instructions_count; j++)
+        {
+            struct operand result = block->instructions[j].result;
+            if (result.type == OPERAND_TYPE_REGISTER && result.value.integer >= count)
+                count = result.value.integer + 1;
+        }
+    }
+    return count;
+}
+
 void unit_arg(struct unit* chunk, struct operand arg)
 {
     assert(chunk != NULL);
@@ -121,6 +429,16 @@ void unit_arg(struct unit* chunk, struct operand arg)
     chunk->arguments[chunk->argument_count++] = arg;
 }
 
+struct operand unit_address(struct unit* chunk)
+{
+    assert(chunk->type == CHUNK_TYPE_VARIABLE);
+    struct ast_node* reference = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+    ast_node_append_child(reference, ast_node_clone(chunk->return_type.type));
+    struct operand address = operand_unit(chunk);
+    address.typename = ssa_type_from_ast(chunk->return_type.module, reference);
+    return address;
+}
+
 char* unit_compile(struct unit* chunk, FILE* out)
 {
     //TODO: compile to ARM64
@@ -7,6 +7,8 @@
 #include "lexer.h"
 #include "ssa.h"
 
+struct token;
+
 enum unit_type {
     CHUNK_TYPE_FUNCTION,
     CHUNK_TYPE_VARIABLE,
@@ -25,6 +27,36 @@ struct unit {
     struct block** blocks;
     uint32_t block_count;
     uint32_t block_capacity;
+
+    // functions only: set by purity inference when the result depends on nothing but the arguments
+    bool pure;
+
+    // functions only: the types of the parameters as they are written, "(i32,f64)", and a hash of them. the variants of
+    // a function share its name and are told apart by these
+    char* parameters;
+    uint64_t signature;
+
+    // variables only: the code computing the initial value, and the value once it is known at compile time
+    struct unit* initializer;
+    struct operand value;
+};
+
+// the units implementing the methods of an interface for one struct, in the order the interface declares them. there is
+// one per struct and interface pair in a module, however many times the struct is made into the interface
+struct unit_vtable {
+    struct ast_node* structure;
+    struct ast_node* interface;
+    struct unit** methods;
+    uint32_t method_count;
+};
+
+// the units going by one name, a function with variants has one for each. their symbols have their parameters after
+// the name
+struct unit_overloads {
+    char* name;
+    struct unit** units;
+    uint32_t count;
+    uint32_t capacity;
 };
 
 struct unit_module {
@@ -34,6 +66,15 @@ struct unit_module {
     size_t unit_count;
     size_t unit_capacity;
 
+    struct unit_vtable** vtables;
+    size_t vtable_count;
+    size_t vtable_capacity;
+
+    // open addressing on the name, the capacity is a power of two
+    struct unit_overloads** names;
+    size_t name_count;
+    size_t name_capacity;
+
     struct ast_module* ast;
 };
 
@@ -43,16 +84,49 @@ void unit_module_free(struct unit_module* list);
 
 void unit_module_append(struct unit_module* list, struct unit* chunk);
 
+// takes a unit out of the module without freeing it
+void unit_module_remove(struct unit_module* list, struct unit* chunk);
+
+// the unit with the symbol, a function with variants has its parameters in the symbol of each
 struct unit* unit_module_find(struct unit_module* list, struct token symbol);
 
+// the units going by name, NULL if there are none
+struct unit_overloads* unit_module_overloads(struct unit_module* list, struct token name);
+
+// the variant of the function called name whose parameters have exactly the types of the arguments, compared by the
+// hash of the types first. NULL if there is none
+struct unit* unit_module_resolve(struct unit_module* list, struct token name, struct operand* arguments,
+                                 uint32_t argument_count);
+
+// the symbol of a method or static of a struct, the struct's name and the member's joined by a dot. has to be freed
+char* unit_member_symbol(struct ast_node* owner, struct token name);
+
+struct unit* unit_module_find_member(struct unit_module* list, struct ast_node* owner, struct token name);
+
+// the vtable of a struct for an interface, made the first time it's asked for. a method the struct doesn't implement
+// with the interface's signature is NULL
+struct unit_vtable* unit_module_vtable(struct unit_module* list, struct ast_node* structure, struct ast_node* interface);
+
 struct unit* unit_new(char* symbol, bool global, enum unit_type type);
 
 void unit_free(struct unit* chunk);
 
 void unit_add(struct unit* chunk, struct block* block);
 
+// takes a block nothing jumps to out of the unit and frees it, the blocks after it move up to keep ids dense
+void unit_remove(struct unit* chunk, struct block* block);
+
 void unit_arg(struct unit* chunk, struct operand arg);
 
+// sets the parameters variants are told apart by from the types the function declares them with
+void unit_parameters(struct unit* chunk, struct ast_node** types, size_t count);
+
+// one past the highest register the unit defines, registers are numbered densely from 0
+uint32_t unit_register_count(struct unit* chunk);
+
+// variables only: the address the variable is read and written through, a reference to its type
+struct operand unit_address(struct unit* chunk);
+
 char* unit_compile(struct unit* chunk, FILE* file);
 
 #endif //COMPILER_CHUNK_H
\ No newline at end of file
@@ -67,6 +67,13 @@ static void ast_node_type_debug(FILE* out, struct ast_node* node)
             fprintf(out, "<%.*s", (int)node->children[1]->token.length, node->children[1]->token.start);
             fprintf(out, ">");
             break;
+        case AST_NODE_TYPE_STRUCT:
+        case AST_NODE_TYPE_INTERFACE:
+            fprintf(out, "%.*s", (int)node->children[0]->token.length, node->children[0]->token.start);
+            break;
+        case AST_NODE_TYPE_ABSTRACT:
+            fprintf(out, "method %.*s", (int)node->children[0]->token.length, node->children[0]->token.start);
+            break;
         default:
             fprintf(out, "unknown");
             break;
@@ -140,6 +147,30 @@ static char* operator_name(enum ssa_instruction_code code)
             return "load";
         case OP_CAST:
             return "cast";
+        case OP_NULL_CHECK:
+            return "null_check";
+        case OP_BOUNDS_CHECK:
+            return "bounds_check";
+        case OP_HEAP_ALLOC:
+            return "heap_alloc";
+        case OP_HEAP_FREE:
+            return "heap_free";
+        case OP_HEAP_REALLOC:
+            return "heap_realloc";
+        case OP_FIELD:
+            return "field";
+        case OP_REGION_ENTER:
+            return "region_enter";
+        case OP_REGION_LEAVE:
+            return "region_leave";
+        case OP_VTABLE:
+            return "vtable";
+        case OP_BROADCAST:
+            return "broadcast";
+        case OP_EXTRACT:
+            return "extract";
+        case OP_INSERT:
+            return "insert";
         default:
             return "unsupported";
     }
@@ -171,6 +202,13 @@ static void operand_debug(FILE* out, struct operand operand)
         case OPERAND_TYPE_IR:
             fprintf(out, "[func @%s", operand.value.unit->symbol);
             break;
+        case OPERAND_TYPE_VTABLE: {
+            struct token structure = operand.value.vtable->structure->children[0]->token;
+            struct token interface = operand.value.vtable->interface->children[0]->token;
+            fprintf(out, "[vtable @%.*s:%.*s", (int) structure.length, structure.start, (int) interface.length,
+                    interface.start);
+            break;
+        }
     }
     type_code_name(out, operand.typename);
     fprintf(out, "] ");
@@ -203,7 +241,7 @@ static void block_debug(struct block* block)
         }
         printf("---> ");
     }
-    printf("BLOCK [%d] ---\n", block->id);
+    printf("BLOCK [%d] %s---\n", block->id, block->align ? "(aligned) " : "");
     for (int i = 0; i < block->instructions_count; i++)
     {
         instruction_debug(stdout, block->instructions[i]);
@@ -226,6 +264,12 @@ void unit_debug(struct unit* chunk)
 {
     assert(chunk != NULL);
     assert(chunk->blocks != NULL);
+    if (chunk->value.type != OPERAND_TYPE_NONE)
+    {
+        printf("value = ");
+        operand_debug(stdout, chunk->value);
+        printf("\n");
+    }
     for (size_t i = 0; i < chunk->block_count; i++)
     {
         block_debug(chunk->blocks[i]);
@@ -276,7 +320,13 @@ void unit_build_graph(struct unit* chunk, FILE* out)
         }
         operand_debug(out, chunk->arguments[i]);
     }
-    fprintf(out, ")\";\n");
+    fprintf(out, ")");
+    if (chunk->value.type != OPERAND_TYPE_NONE)
+    {
+        fprintf(out, " = ");
+        operand_debug(out, chunk->value);
+    }
+    fprintf(out, "\";\n");
     fprintf(out, "    style=filled;\n");
     fprintf(out, "    color=lightgrey;\n");
     fprintf(out, "    node [style=filled, color=white];\n");
@@ -287,7 +337,8 @@ void unit_build_graph(struct unit* chunk, FILE* out)
         block_build_graph(chunk->symbol, block, out);
     }
 
-    recursive_link(chunk->symbol, chunk->blocks[0], out);
+    if (chunk->block_count > 0)
+        recursive_link(chunk->symbol, chunk->blocks[0], out);
 
     fprintf(out, "    }\n");
 }
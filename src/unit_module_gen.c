@@ -18,22 +18,99 @@ static struct unit* unit_symbol_new(struct token symbol, enum unit_type type)
     return unit;
 }
 
+// how many functions in scope are called name, there is one for each variant
+static size_t variant_count(struct ast_node* scope, struct token name)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < scope->children_count; i++)
+    {
+        struct ast_node* child = scope->children[i];
+        struct token child_name = child->children_count > 0 ? child->children[0]->token : token_null;
+        if (child->type == AST_NODE_TYPE_FUNCTION && child_name.length == name.length &&
+            memcmp(child_name.start, name.start, name.length) == 0)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
 static struct unit* forward(struct ast_module* module, struct ast_node* node) {
     switch (node->type)
     {
         case AST_NODE_TYPE_FUNCTION:
+        case AST_NODE_TYPE_METHOD:
         {
-            struct unit* unit = unit_symbol_new(node->children[0]->token, CHUNK_TYPE_FUNCTION);
+            // members of a struct are called by the struct's name and theirs
+            struct ast_node* owner = ast_module_get_owner(module->symbols, node);
+            struct unit* unit;
+            if (owner != NULL)
+            {
+                char* symbol = unit_member_symbol(owner, node->children[0]->token);
+                unit = unit_new(symbol, node->children[0]->token.start[0] != '_', CHUNK_TYPE_FUNCTION);
+                free(symbol);
+            }
+            else
+            {
+                unit = unit_symbol_new(node->children[0]->token, CHUNK_TYPE_FUNCTION);
+            }
+
+            struct ast_node* args = node->children[2];
+            struct ast_node** types = malloc(sizeof(struct ast_node*) * (args->children_count + 1));
+            assert(types);
+            for (size_t i = 0; i < args->children_count; i++)
+            {
+                types[i] = args->children[i]->children[1];
+            }
+            unit_parameters(unit, types, args->children_count);
+            free(types);
+
+            // variants of a function have their parameters in their symbols to tell them apart
+            if (owner == NULL && variant_count(module->symbols, node->children[0]->token) > 1)
+            {
+                char* symbol = malloc(strlen(unit->symbol) + strlen(unit->parameters) + 1);
+                assert(symbol);
+                sprintf(symbol, "%s%s", unit->symbol, unit->parameters);
+                free(unit->symbol);
+                unit->symbol = symbol;
+            }
             struct ast_node* type = node->children[1]; //type
             unit->global = node->children[1]->token.start[0] != '_';
             unit->return_type = ssa_type_from_ast(module, type);
+
+            // a method is passed the struct it is called on before its arguments, as this
+            if (node->type == AST_NODE_TYPE_METHOD)
+            {
+                struct ast_node* this = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+                ast_node_append_child(this, owner);
+                unit_arg(unit, operand_reg(0, ssa_type_from_ast(module, this)));
+            }
+
+            // arguments occupy the first registers of the function, see ssa_gen
+            for (int i = 0; i < args->children_count; i++) {
+                struct ast_node* arg_type = args->children[i]->children[1];
+                unit_arg(unit, operand_reg(unit->argument_count, ssa_type_from_ast(module, arg_type)));
+            }
+
+            // a struct is returned by constructing it in memory the caller passes after the arguments
+            if (type->type == AST_NODE_TYPE_STRUCT)
+            {
+                struct ast_node* slot = ast_node_new(AST_NODE_TYPE_REFERENCE, token_null);
+                ast_node_append_child(slot, type);
+                unit_arg(unit, operand_reg(unit->argument_count, ssa_type_from_ast(module, slot)));
+            }
             return unit;
         }
         case AST_NODE_TYPE_VARIABLE:
         {
             struct unit* unit = unit_symbol_new(node->children[0]->token, CHUNK_TYPE_VARIABLE);
+            unit->return_type = ssa_type_from_ast(module, node->children[1]);
             return unit;
         }
+        case AST_NODE_TYPE_IMPLEMENTATION:
+        {
+            return forward(module, node->children[0]);
+        }
         default:
         {
             fprintf(stderr, "unexpected node type: %s\n", ast_node_get_name(node));